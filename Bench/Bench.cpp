@@ -0,0 +1,2072 @@
+/********************************************
+  Bench.cc - Host benchmark suite for the PlantMantra driver and upload paths.
+  Each driver call runs against SimBus; the I2C transactions, bytes, analog reads and
+  simulated bus time it costs are reported per call. Uploads run against HttpStub on
+  loopback. Every result is printed as one JSON object per line, e.g.
+
+  {"bench":"ReadTempValue","calls":1000,"i2c_transactions":2.000,...}
+
+  Build with the host command line in README.md (Benchmarks section).
+  Usage: plantbench [calls]
+  Exits 1 if any correctness check failed (mismatched, corrupt or lost samples, failed posts).
+*********************************************/
+
+#ifndef ARDUINO
+
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+
+#include "SimBus.h"
+#include "MoistureSensor.h"
+#include "SunlightSensor.h"
+#include "AlsAutoCollector.h"
+#include "AlsAutoRange.h"
+#include "TempSensor.h"
+#include "SampleScheduler.h"
+#include "FleetScheduler.h"
+#include "I2CMux.h"
+#include "SampleStore.h"
+#include "ReportPolicy.h"
+#include "PowerManager.h"
+#include "ThingSpeakUploader.h"
+#include "HttpStub.h"
+#include "HeapCounter.h"
+#include "LegacyString.h"
+#include "MqttStub.h"
+#include "MqttPublisher.h"
+#include "WiFiLink.h"
+#include "SampleLog.h"
+#include "QueryServer.h"
+#include "SamplePayload.h"
+
+#define BENCH_DEFAULT_CALLS 1000
+#define BENCH_UPLOAD_POSTS 50
+#define BENCH_FLEET_CYCLES 100
+#define BENCH_RES_LEVELS 64
+#define BENCH_RES_REPEATS 4
+#define BENCH_RES_NOISE 0.5
+#define BENCH_POLICY_SAMPLES 1440
+#define BENCH_POLICY_MIN_UPLOAD_MS 300000UL
+#define BENCH_POWER_CYCLES 1440
+#define BENCH_POWER_RADIO_MS 4000
+#define BENCH_POWER_RADIO_EVERY 60
+#define BENCH_TEMP_RES_CYCLES 120
+#define BENCH_ALERT_EVENTS 50
+#define BENCH_ALERT_PIN 2
+#define BENCH_ALS_INT_PIN 3
+#define BENCH_ALS_PERIOD_MS 10
+#define BENCH_ALS_RUN_MS 10000
+#define BENCH_ALS_DRAIN_MS 100
+#define BENCH_ALS_CYCLES 10
+#define BENCH_RANGE_MIN_LUX 0.1
+#define BENCH_RANGE_STEPS_PER_DECADE 4
+#define BENCH_RANGE_DECADES 6
+#define BENCH_RANGE_ERROR_MIN_LUX 10
+#define BENCH_RANGE_SUN_LUX 80000
+#define BENCH_LINK_RUN_MS 21600000UL
+#define BENCH_LINK_OUTAGE_START_MS 3600000UL
+#define BENCH_LINK_OUTAGE_END_MS 10800000UL
+#define BENCH_LINK_UPLOAD_MS 300000UL
+#define BENCH_LINK_POST_MS 500
+#define BENCH_LINK_LEGACY_RETRY_MS 10000
+#define BENCH_LINK_SEED 0x5EED1234UL
+#define BENCH_LOG_DAYS 28
+#define BENCH_LOG_SAMD_SIZE 65536
+#define BENCH_LOG_NOR_SIZE 524288
+#define BENCH_LOG_NOR_PAGE 256
+#define BENCH_LOG_NOR_SECTOR 4096
+#define BENCH_LOG_IMAGE "/tmp/plantbench_log.bin"
+#define BENCH_LOG_CUT_SIZE 8192
+#define BENCH_LOG_CUT_TRIALS 500
+#define BENCH_LOG_CUT_MAX_AGE_MS 600000UL
+#define BENCH_LOG_FUZZ_ROUNDS 2000
+#define BENCH_LOG_FUZZ_APPENDS 30
+#define BENCH_QUERY_REQUESTS 200
+#define BENCH_QUERY_OLD_BOOT 500
+#define BENCH_QUERY_SAMPLES 3000
+#define BENCH_QUERY_RESPONSE 2048
+#define BENCH_TRANSPORT_SAMPLES 320
+#define BENCH_REDELIVERY_SAMPLES 64
+#define BENCH_REDELIVERY_DROP 10
+#define BENCH_REDELIVERY_BATCH_DROP 2
+#define BENCH_LEGACY_TIMEOUT_MS 5000
+#define BENCH_PAYLOAD_SAMPLES 1440
+#define BENCH_PAYLOAD_REPEATS 50
+#define BENCH_PAYLOAD_TEXT_MAX 96
+
+//Correctness checks that failed (mismatches, corrupt or lost samples, failed posts); main() exits 1 if any did
+static uint32_t benchFailures = 0;
+
+/************************************
+BenchCheck() - Counts a failed correctness check; the JSON lines still carry the details.
+*************************************/
+static void BenchCheck(bool ok){ if(!ok){ benchFailures++; } }
+
+//BenchMark - bus statistics, simulated clock and wall clock captured at the start of a run.
+struct BenchMark{
+  SimBusStats Bus;
+  uint64_t SimMicros;
+  std::chrono::steady_clock::time_point Wall;
+};
+
+static BenchMark BenchStart(void){
+
+  SimBus &bus = HostSimBus();
+  bus.ResetStats();
+
+  BenchMark mark;
+  mark.Bus = bus.Stats;
+  mark.SimMicros = HostMicros64();
+  mark.Wall = std::chrono::steady_clock::now();
+
+  return mark;
+}
+
+/************************************
+BenchEmit() - Prints the per-call cost of a driver benchmark as one JSON line.
+Inputs: name -> benchmark name; calls -> calls made since mark; mark -> BenchStart() snapshot
+*************************************/
+static void BenchEmit(const char *name, uint32_t calls, const BenchMark &mark){
+
+  double wallNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - mark.Wall).count();
+  SimBusStats &stats = HostSimBus().Stats;
+
+  printf("{\"bench\":\"%s\",\"calls\":%u,\"i2c_transactions\":%.3f,\"bytes_written\":%.3f,\"bytes_read\":%.3f,"
+         "\"analog_reads\":%.3f,\"bus_us\":%.1f,\"sim_us\":%.1f,\"host_ns\":%.1f}\n",
+         name, calls,
+         (double)(stats.Transactions - mark.Bus.Transactions) / calls,
+         (double)(stats.BytesWritten - mark.Bus.BytesWritten) / calls,
+         (double)(stats.BytesRead - mark.Bus.BytesRead) / calls,
+         (double)(stats.AnalogReads - mark.Bus.AnalogReads) / calls,
+         (double)(stats.BusTimeMicros - mark.Bus.BusTimeMicros) / calls,
+         (double)(HostMicros64() - mark.SimMicros) / calls,
+         wallNs / calls);
+  fflush(stdout);
+}
+
+/************************************
+BenchCycle() - Runs the sampling half of the sketch's loop() until one sample is stored.
+Idle time the scheduler asks for is skipped with delay(), so sim_us is the cycle's active time plus
+the ALS conversion wait; the time skipped is excluded.
+*************************************/
+static void BenchCycle(SampleScheduler &sampler, SampleStore &store, uint32_t calls){
+
+  SensorSample sample;
+  uint64_t idleMicros = 0;
+  uint32_t serviceCalls = 0;
+
+  //The first cycle fires immediately; later ones wait out the interval
+  BenchMark mark = BenchStart();
+
+  for(uint32_t i = 0; i < calls; i++){
+    while(true){
+      unsigned long wait = sampler.MillisUntilNextStep();
+      if(wait > 0){
+        idleMicros += (uint64_t)wait * 1000;
+        delay(wait);
+      }
+
+      sampler.Service();
+      serviceCalls++;
+      if(sampler.TakeSample(sample)){
+        store.Push(sample);
+        break;
+      }
+    }
+  }
+
+  mark.SimMicros += idleMicros;
+  BenchEmit("loop_cycle", calls, mark);
+  printf("{\"bench\":\"loop_cycle_service\",\"calls\":%u,\"service_calls\":%.3f}\n", calls, (double)serviceCalls / calls);
+}
+
+/************************************
+BenchTempDecode() - Checks the integer MCP9808 decode: every 13-bit TA value against the exact
+conversion (worst error in centi-degrees, and whether two adjacent 0.0625 C steps ever collapse to
+the same centi-Celsius value), then readings through the bus across the -40 to +125 C range.
+*************************************/
+static void BenchTempDecode(TempSensor &temp){
+
+  SimBus &bus = HostSimBus();
+  double worstC = 0;
+  double worstF = 0;
+  uint32_t duplicates = 0;
+  uint32_t mismatches = 0;
+  uint32_t checked = 0;
+
+  for(int32_t raw = -4096; raw <= 4095; raw++){
+    double celsius = raw / 16.0;
+    double fahrenheit = celsius * 1.8 + 32;
+    int16_t centiC = TempSensor::RawToCentiCelsius(raw);
+
+    if(fabs(centiC - celsius * 100) > worstC){ worstC = fabs(centiC - celsius * 100); }
+    if(fabs(fahrenheit * 100) < 32767 && fabs(TempSensor::RawToCentiFahrenheit(raw) - fahrenheit * 100) > worstF){
+      worstF = fabs(TempSensor::RawToCentiFahrenheit(raw) - fahrenheit * 100);
+    }
+    if(raw > -4096 && centiC == TempSensor::RawToCentiCelsius(raw - 1)){ duplicates++; }
+  }
+
+  for(int16_t raw = -40 * 16; raw <= 125 * 16; raw += 7){
+    bus.Temp.SetTemperature(raw / 16.0f);
+    delay(TEMP_WAKE_MS);
+    if(temp.ReadTempRaw() != raw){ mismatches++; }
+    checked++;
+  }
+
+  BenchCheck(mismatches == 0 && duplicates == 0);
+  printf("{\"bench\":\"temp_decode\",\"raw_values\":8192,\"max_error_centi_c\":%.3f,\"max_error_centi_f\":%.3f,"
+         "\"duplicate_steps\":%u,\"bus_checked\":%u,\"bus_mismatches\":%u}\n",
+         worstC, worstF, duplicates, checked, mismatches);
+  fflush(stdout);
+
+  bus.Temp.SetTemperature(22.0f);
+  delay(TEMP_WAKE_MS);
+}
+
+/************************************
+BenchConfigVerify() - ApplyConfig() with the ALS_VIS bit of the SI1145 parameter RAM stuck low
+(CHLIST comes back without it), which must fail with PARAM_MISMATCH, then with the RAM healthy again.
+*************************************/
+static void BenchConfigVerify(SunlightSensor &sunlight){
+
+  SimBus &bus = HostSimBus();
+  SI1145Config lightConfig = SI1145_DEFAULT_CONFIG;
+
+  bus.Sunlight.ParamWriteMask = (uint8_t)~CHLIST_EN_ALS_VIS;
+  sunlight.InvalidateShadow();
+  uint8_t stuck = sunlight.ApplyConfig(lightConfig);
+
+  bus.Sunlight.ParamWriteMask = 0xFF;
+  sunlight.InvalidateShadow();
+  uint8_t healthy = sunlight.ApplyConfig(lightConfig);
+
+  BenchCheck(stuck == PARAM_MISMATCH && healthy == PARAM_OK);
+  printf("{\"bench\":\"als_config_verify\",\"stuck_bit_status\":%u,\"healthy_status\":%u,\"detected\":%s}\n",
+         stuck, healthy, (stuck == PARAM_MISMATCH && healthy == PARAM_OK) ? "true" : "false");
+  fflush(stdout);
+}
+
+/************************************
+BenchAlsError() - An ALS measurement that ends with an SI1145 error code other than an overflow
+(0x80, invalid setting) must come back as ALS_ERROR and flag the scheduler's sample
+SAMPLE_FLAG_ALS_ERROR; the next measurement, with the error gone, must read normally.
+*************************************/
+static void BenchAlsError(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp){
+
+  SimBus &bus = HostSimBus();
+  SampleScheduler sampler(moisture, sunlight, temp);
+  SensorSample sample;
+  uint16_t vis;
+  uint16_t ir;
+
+  bus.Sunlight.MeasureError = RESPONSE_ERROR_BIT;
+  uint8_t failed = sunlight.MeasureALS(vis, ir);
+  while(!sampler.TakeSample(sample)){
+    delay(sampler.MillisUntilNextStep());
+    sampler.Service();
+  }
+  bool flagged = (sample.Flags & SAMPLE_FLAG_ALS_ERROR) != 0;
+
+  bus.Sunlight.MeasureError = 0;
+  uint8_t recovered = sunlight.MeasureALS(vis, ir);
+
+  BenchCheck(failed == ALS_ERROR && flagged && recovered == ALS_DONE);
+  printf("{\"bench\":\"als_error\",\"error_status\":%u,\"sample_flagged\":%s,\"recovered_status\":%u}\n",
+         failed, flagged ? "true" : "false", recovered);
+  fflush(stdout);
+}
+
+/************************************
+BenchMoistureResolution() - Effective resolution of readOversampled() on a synthetic signal: a level
+swept across two 10-bit LSBs in 1/32 LSB steps with BENCH_RES_NOISE LSB of gaussian noise. The RMS
+error against the true level gives the effective number of bits, ENOB = log2(1024 / (rms * sqrt(12))).
+Inputs: hardware -> use the emulated SAMD21 accumulator instead of software oversampling
+*************************************/
+static void BenchMoistureResolution(bool hardware){
+
+  SimBus &bus = HostSimBus();
+  MoistureSensor probe(A6);
+  bus.SetHardwareAveraging(hardware);
+
+  for(uint8_t bits = MOISTURE_NATIVE_BITS; bits <= MOISTURE_MAX_BITS; bits++){
+
+    probe.setResolution(bits);
+    double scale = 1.0 / (1UL << (bits - MOISTURE_NATIVE_BITS));
+    double squares = 0;
+    uint32_t reads = 0;
+    BenchMark mark = BenchStart();
+
+    for(uint16_t level = 0; level < BENCH_RES_LEVELS; level++){
+      double truth = 500.0 + level / 32.0;
+      bus.SetAnalog(A6, truth, BENCH_RES_NOISE);
+      for(uint8_t r = 0; r < BENCH_RES_REPEATS; r++){
+        double error = probe.readOversampled() * scale - truth;
+        squares += error * error;
+        reads++;
+      }
+    }
+
+    SimBusStats &stats = bus.Stats;
+    double rms = sqrt(squares / reads);
+    printf("{\"bench\":\"moisture_resolution\",\"path\":\"%s\",\"bits\":%u,\"analog_calls_per_read\":%.1f,"
+           "\"sim_us_per_read\":%.1f,\"rms_error_lsb10\":%.4f,\"enob\":%.2f}\n",
+           hardware ? "hardware" : "software", bits, (double)(stats.AnalogReads - mark.Bus.AnalogReads) / reads,
+           (double)(HostMicros64() - mark.SimMicros) / reads, rms, log2(1024.0 / (rms * sqrt(12.0))));
+  }
+
+  fflush(stdout);
+  bus.SetHardwareAveraging(true);
+}
+
+/************************************
+BenchFleet() - Samples FLEET_MAX_PLANTS plants round-robin: one MCP9808 per address, one SI1145 per
+TCA9548A channel and one moisture probe per analog pin. Reports the per-sample bus cost and the
+longest single Service() call against the fleet's bus budget.
+*************************************/
+static void BenchFleet(uint32_t cycles){
+
+  SimBus &bus = HostSimBus();
+  SimTCA9548A simMux;
+  SimSI1145 simLight[FLEET_MAX_PLANTS - 1];
+  SimMCP9808 simTemp[FLEET_MAX_PLANTS - 1];
+
+  //Plant 0 uses the default simulated sensors; the SI1145 moves behind mux channel 0
+  bus.Detach(PhotoDetI2CAdd);
+  bus.Attach(TCA9548A_DEFAULT_ADDR, &simMux);
+  simMux.Attach(0, PhotoDetI2CAdd, &bus.Sunlight);
+  for(uint8_t i = 1; i < FLEET_MAX_PLANTS; i++){
+    simLight[i - 1].SetAmbient(100 * i, 50 * i);
+    simTemp[i - 1].SetTemperature(18 + i);
+    simMux.Attach(i, PhotoDetI2CAdd, &simLight[i - 1]);
+    bus.Attach(TEMP_ADDR_MIN + i, &simTemp[i - 1]);
+    bus.SetAnalog(A0 + i, 300 + 40 * i, 2);
+  }
+
+  I2CMux mux;
+  MuxChannelBus *channel[FLEET_MAX_PLANTS];
+  MoistureSensor *moisture[FLEET_MAX_PLANTS];
+  SunlightSensor *light[FLEET_MAX_PLANTS];
+  TempSensor *temp[FLEET_MAX_PLANTS];
+  SampleScheduler *plant[FLEET_MAX_PLANTS];
+  FleetScheduler fleet;
+  SI1145Config lightConfig = SI1145_DEFAULT_CONFIG;
+
+  for(uint8_t i = 0; i < FLEET_MAX_PLANTS; i++){
+    channel[i] = new MuxChannelBus(mux, i);
+    moisture[i] = new MoistureSensor(A0 + i);
+    light[i] = new SunlightSensor(*channel[i]);
+    temp[i] = new TempSensor(TEMP_ADDR_MIN + i);
+    light[i]->ApplyConfig(lightConfig);
+    plant[i] = new SampleScheduler(*moisture[i], *light[i], *temp[i]);
+    fleet.Add(*plant[i]);
+  }
+
+  fleet.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+
+  uint32_t selectsBefore = mux.Selects();
+  uint32_t samples = 0;
+  uint32_t perPlant[FLEET_MAX_PLANTS] = {0};
+  uint64_t idleMicros = 0;
+  SensorSample sample;
+  uint8_t index;
+  BenchMark mark = BenchStart();
+
+  while(samples < cycles * FLEET_MAX_PLANTS){
+    unsigned long wait = fleet.MillisUntilNextStep();
+    if(wait > 0){
+      idleMicros += (uint64_t)wait * 1000;
+      delay(wait);
+    }
+
+    fleet.Service();
+    while(fleet.TakeSample(index, sample)){
+      perPlant[index]++;
+      samples++;
+    }
+  }
+
+  mark.SimMicros += idleMicros;
+  BenchEmit("fleet_sample", samples, mark);
+
+  uint32_t fewest = perPlant[0];
+  for(uint8_t i = 1; i < FLEET_MAX_PLANTS; i++){ if(perPlant[i] < fewest){ fewest = perPlant[i]; } }
+
+  printf("{\"bench\":\"fleet_service\",\"plants\":%u,\"samples\":%u,\"fewest_per_plant\":%u,"
+         "\"mux_selects_per_sample\":%.3f,\"budget_us\":%u,\"max_service_us\":%lu}\n",
+         FLEET_MAX_PLANTS, samples, fewest, (double)(mux.Selects() - selectsBefore) / samples,
+         FLEET_DEFAULT_BUDGET_US, fleet.MaxServiceMicros());
+  fflush(stdout);
+
+  for(uint8_t i = 0; i < FLEET_MAX_PLANTS; i++){
+    delete plant[i];
+    delete temp[i];
+    delete light[i];
+    delete moisture[i];
+    delete channel[i];
+    if(i > 0){ bus.Detach(TEMP_ADDR_MIN + i); }
+  }
+  bus.Detach(TCA9548A_DEFAULT_ADDR);
+  bus.Attach(PhotoDetI2CAdd, &bus.Sunlight);
+}
+
+/************************************
+BenchReportPolicy() - Replays a day of one-minute samples through ReportPolicy and the sketch's
+upload spacing, and compares the posts made against posting every sample. A stable plant has
+small noise on every channel; a diurnal one adds a daylight curve and a slowly drying pot.
+*************************************/
+static void BenchReportPolicy(bool diurnal){
+
+  ReportPolicy policy;
+  uint32_t stored = 0;
+  uint32_t posts = 0;
+  unsigned long nextUpload = 0;
+  srand(1);
+
+  for(uint32_t i = 0; i < BENCH_POLICY_SAMPLES; i++){
+    unsigned long now = i * 60000UL;
+    double noise[3];
+    for(uint8_t c = 0; c < 3; c++){ noise[c] = (rand() % 1000) / 1000.0 - 0.5; }
+
+    double moisture = 520 + 6 * noise[0];
+    double light = 260 + 16 * noise[1];
+    double temperature = 7100 + 80 * noise[2];
+    if(diurnal){
+      double day = sin((i % 1440) * M_PI / 720.0 - M_PI / 2);
+      moisture -= i / 20.0;
+      light += (day > 0) ? 900 * day : 0;
+      temperature += 400 * day;
+    }
+
+    SensorSample sample = {now, (uint16_t)lround(moisture), (uint16_t)lround(light), (int16_t)lround(temperature), 0};
+    if(policy.Evaluate(sample) != REPORT_NONE){ stored++; }
+
+    if(stored > 0 && (long)(now - nextUpload) >= 0){
+      posts++;
+      stored = 0;
+      policy.ResetSuppressed();
+      nextUpload = now + BENCH_POLICY_MIN_UPLOAD_MS;
+    }
+  }
+
+  printf("{\"bench\":\"report_policy\",\"plant\":\"%s\",\"samples\":%u,\"reported\":%u,\"suppressed\":%u,"
+         "\"posts\":%u,\"posts_every_sample\":%u,\"post_reduction\":%.1f}\n",
+         diurnal ? "diurnal" : "stable", BENCH_POLICY_SAMPLES, policy.TotalReported(), policy.TotalSuppressed(),
+         posts, BENCH_POLICY_SAMPLES, (double)BENCH_POLICY_SAMPLES / posts);
+  fflush(stdout);
+}
+
+/************************************
+BenchPower() - Runs a day of one-minute sample cycles through PowerManager and reports the energy
+budget per phase. Duty-cycled: sensors in low-power mode, MCU asleep between steps, radio on for
+BENCH_POWER_RADIO_MS once an hour. Always-on (the old loop): radio associated and the MCU awake the
+whole time. The simulated temperature alternates every cycle, so a reading taken before the
+MCP9808 finished its first conversion after shutdown shows up as stale.
+*************************************/
+static void BenchPower(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp, bool lowPower){
+
+  SimBus &bus = HostSimBus();
+  SampleScheduler sampler(moisture, sunlight, temp);
+  PowerManager power;
+  SensorSample sample;
+  uint32_t samples = 0;
+  uint32_t stale = 0;
+  char report[POWER_REPORT_MAX];
+
+  sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+  sampler.SetLowPower(lowPower);
+  bus.Temp.SetTemperature(20.0f);
+  delay(TEMP_WAKE_MS);
+  power.Begin();
+
+  while(samples < BENCH_POWER_CYCLES){
+
+    power.Enter(lowPower ? POWER_PHASE_SAMPLE : POWER_PHASE_RADIO);
+    sampler.Service();
+
+    if(sampler.TakeSample(sample)){
+      int16_t expected = (samples % 2 == 0) ? 6800 : 8600;
+      if(sample.Temperature != expected){ stale++; }
+      samples++;
+      bus.Temp.SetTemperature((samples % 2 == 0) ? 20.0f : 30.0f);
+
+      if(lowPower && samples % BENCH_POWER_RADIO_EVERY == 0){
+        power.Enter(POWER_PHASE_RADIO);
+        delay(BENCH_POWER_RADIO_MS);
+      }
+    }
+
+    unsigned long wait = sampler.MillisUntilNextStep();
+    if(wait > 0){
+      if(lowPower){ sampler.ClockSkipped(power.Sleep(wait)); }
+      else{ delay(wait); }
+    }
+  }
+
+  power.FormatReport(report, sizeof(report));
+  printf("{\"bench\":\"power_day\",\"mode\":\"%s\",\"samples\":%u,\"stale_temperature\":%u,"
+         "\"sleep_ms\":%lu,\"idle_ms\":%lu,\"sample_ms\":%lu,\"radio_ms\":%lu,\"avg_ua\":%.1f,"
+         "\"battery_days\":%.1f,\"report\":\"%s\"}\n",
+         lowPower ? "duty_cycled" : "always_on", samples, stale,
+         (unsigned long)(power.PhaseMicros(POWER_PHASE_SLEEP) / 1000), (unsigned long)(power.PhaseMicros(POWER_PHASE_IDLE) / 1000),
+         (unsigned long)(power.PhaseMicros(POWER_PHASE_SAMPLE) / 1000), (unsigned long)(power.PhaseMicros(POWER_PHASE_RADIO) / 1000),
+         power.AverageMicroamps(), power.BatteryDays(), report);
+  fflush(stdout);
+
+  sampler.SetLowPower(false);
+  bus.Temp.SetTemperature(22.0f);
+}
+
+/************************************
+BenchTempResolution() - Low-power sample cycles at each MCP9808 resolution: time awake per cycle
+(the scheduler waits one conversion time after waking the sensor), average current and the
+worst reading error against the simulated temperature, which changes every cycle.
+*************************************/
+static void BenchTempResolution(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp){
+
+  static const float stepC[4] = {0.5f, 0.25f, 0.125f, 0.0625f};
+  SimBus &bus = HostSimBus();
+
+  for(uint8_t resolution = TEMP_RES_0_5C; resolution <= TEMP_RES_0_0625C; resolution++){
+
+    SampleScheduler sampler(moisture, sunlight, temp);
+    PowerManager power;
+    SensorSample sample;
+    uint32_t samples = 0;
+    double worst = 0;
+    float celsius = 21.0f;
+
+    temp.SetResolution(resolution);
+    sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+    sampler.SetLowPower(true);
+    bus.Temp.SetTemperature(celsius);
+    power.Begin();
+
+    while(samples < BENCH_TEMP_RES_CYCLES){
+      power.Enter(POWER_PHASE_SAMPLE);
+      sampler.Service();
+
+      if(sampler.TakeSample(sample)){
+        double error = fabs(sample.Temperature / 100.0 - (celsius * 1.8 + 32));
+        if(error > worst){ worst = error; }
+        samples++;
+        celsius = 18.0f + (rand() % 10000) / 1000.0f;
+        bus.Temp.SetTemperature(celsius);
+      }
+
+      unsigned long wait = sampler.MillisUntilNextStep();
+      if(wait > 0){ sampler.ClockSkipped(power.Sleep(wait)); }
+    }
+
+    double awakeMs = (power.PhaseMicros(POWER_PHASE_IDLE) + power.PhaseMicros(POWER_PHASE_SAMPLE)) / 1000.0 / samples;
+    printf("{\"bench\":\"temp_resolution\",\"step_c\":%.4f,\"register\":%u,\"conversion_ms\":%u,\"awake_ms_per_cycle\":%.1f,"
+           "\"avg_ua\":%.1f,\"max_error_f\":%.3f}\n",
+           stepC[resolution], bus.Temp.Reg[ResolutionREG], temp.ConversionMillis(), awakeMs, power.AverageMicroamps(), worst);
+    fflush(stdout);
+
+    sampler.SetLowPower(false);
+  }
+
+  bus.Temp.SetTemperature(22.0f);
+  delay(TEMP_WAKE_MS);
+}
+
+//Set by the alert pin handler in BenchTempAlert(), as the sketch's temperatureAlertISR() does
+static volatile bool benchAlert = false;
+
+static void BenchAlertISR(void){
+  benchAlert = true;
+  PowerManager::Wake();
+}
+
+/************************************
+BenchTempAlert() - Low-power sample cycles with the MCP9808 Alert pin wired to a wake pin. Between
+samples the simulated temperature jumps above T_UPPER at a random time and drops back one cycle later;
+reports how long the alert took to wake the node against waiting for the next scheduled sample (polling),
+plus the average current with the sensor left converting.
+*************************************/
+static void BenchTempAlert(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp){
+
+  SimBus &bus = HostSimBus();
+  SampleScheduler sampler(moisture, sunlight, temp);
+  PowerManager power;
+  SensorSample sample;
+  uint32_t events = 0;
+  uint32_t wakes = 0;
+  uint32_t polled = 0;
+  uint64_t alertTotal = 0;
+  uint64_t pollTotal = 0;
+  unsigned long alertWorst = 0;
+  unsigned long eventAt = 0;
+  unsigned long eventStart = 0;
+  bool eventPending = false;
+  bool alertOpen = false;
+  bool pollOpen = false;
+  bool hot = false;
+
+  bus.Temp.SetTemperature(22.0f);
+  bus.ConnectInterrupt(BENCH_ALERT_PIN, &bus.Temp);
+  temp.SetAlertLimits(5000, 9500, 10400);
+  delay(temp.ConversionMillis());
+  temp.EnableAlert(TEMP_ALERT_INTERRUPT);
+  sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+  sampler.SetLowPower(true);
+  sampler.SetTempContinuous(true);
+  power.SetCurrent(POWER_PHASE_SLEEP, POWER_SLEEP_UA + POWER_MCP9808_CONVERTING_UA);
+  power.WakeOnPin(BENCH_ALERT_PIN, BenchAlertISR);
+  benchAlert = false;
+  power.Begin();
+
+  while(events < BENCH_ALERT_EVENTS || alertOpen || pollOpen){
+
+    power.Enter(POWER_PHASE_SAMPLE);
+    sampler.Service();
+
+    if(sampler.TakeSample(sample)){
+      if(pollOpen){
+        unsigned long latency = power.Millis() - eventStart;
+        pollTotal += latency;
+        polled++;
+        pollOpen = false;
+      }
+
+      //Every other cycle: schedule a step up somewhere in the next interval, or step back down
+      if(hot){
+        bus.Temp.SetTemperature(22.0f);
+        hot = false;
+      }
+      else if(events < BENCH_ALERT_EVENTS){
+        eventAt = power.Millis() + 1000 + rand() % (SCHED_DEFAULT_INTERVAL_MS - 2000);
+        eventPending = true;
+      }
+    }
+
+    //Alert: read the temperature and release the latched output (one wake per crossing)
+    if(benchAlert){
+      benchAlert = false;
+      wakes++;
+      temp.ReadTemp();
+      temp.ClearAlert();
+
+      if(alertOpen){
+        unsigned long latency = power.Millis() - eventStart;
+        alertTotal += latency;
+        if(latency > alertWorst){ alertWorst = latency; }
+        alertOpen = false;
+      }
+    }
+
+    unsigned long wait = sampler.MillisUntilNextStep();
+    if(eventPending && (long)(power.Millis() + wait - eventAt) > 0){
+      long until = (long)(eventAt - power.Millis());
+      wait = (until > 0) ? until : 0;
+    }
+    if(wait > 0){ sampler.ClockSkipped(power.Sleep(wait)); }
+
+    if(eventPending && (long)(power.Millis() - eventAt) >= 0){
+      bus.Temp.SetTemperature(37.0f);
+      hot = true;
+      eventPending = false;
+      eventStart = power.Millis();
+      alertOpen = true;
+      pollOpen = true;
+      events++;
+    }
+  }
+
+  printf("{\"bench\":\"temp_alert\",\"events\":%u,\"wakes\":%u,\"alert_avg_ms\":%.1f,\"alert_max_ms\":%lu,"
+         "\"poll_avg_ms\":%.1f,\"avg_ua\":%.1f}\n",
+         events, wakes, (double)alertTotal / events, alertWorst, (double)pollTotal / polled, power.AverageMicroamps());
+  fflush(stdout);
+
+  temp.DisableAlert();
+  temp.ClearAlert();
+  sampler.SetTempContinuous(false);
+  sampler.SetLowPower(false);
+  bus.Temp.SetTemperature(22.0f);
+  delay(TEMP_WAKE_MS);
+}
+
+//INT handler for BenchAlsAuto(), as the sketch's lightISR() does
+static AlsAutoCollector *benchCollector = 0;
+
+static void BenchAlsISR(void){ benchCollector->HandleInterrupt(); }
+
+/************************************
+BenchAlsAuto() - SI1145 autonomous mode with the INT pin collected into the queue: readings per second,
+readings the sensor made that were not collected, queue overruns and the I2C cost per reading, next to
+the cost of a forced MeasureALS() (which also blocks for the conversion). loop() is simulated with a
+Service() call every millisecond and drains the queue every BENCH_ALS_DRAIN_MS. Then a few one-minute
+sample cycles take their light reading from the collector.
+*************************************/
+static void BenchAlsAuto(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp){
+
+  SimBus &bus = HostSimBus();
+  AlsAutoCollector collector(sunlight, BENCH_ALS_INT_PIN);
+  AlsReading reading;
+  uint16_t vis;
+  uint16_t ir;
+  uint32_t taken = 0;
+  uint32_t outOfOrder = 0;
+  unsigned long lastTimestamp = 0;
+
+  //Forced mode baseline
+  BenchMark mark = BenchStart();
+  for(uint32_t i = 0; i < BENCH_ALS_CYCLES * 10; i++){ sunlight.MeasureALS(vis, ir); }
+  double forcedTransactions = (double)(bus.Stats.Transactions - mark.Bus.Transactions) / (BENCH_ALS_CYCLES * 10);
+  double forcedBusUs = (double)(bus.Stats.BusTimeMicros - mark.Bus.BusTimeMicros) / (BENCH_ALS_CYCLES * 10);
+  double forcedBlockedUs = (double)(HostMicros64() - mark.SimMicros) / (BENCH_ALS_CYCLES * 10);
+
+  bus.ConnectInterrupt(BENCH_ALS_INT_PIN, &bus.Sunlight);
+  benchCollector = &collector;
+  collector.Begin(BENCH_ALS_PERIOD_MS, BenchAlsISR);
+
+  uint32_t measuredStart = bus.Sunlight.AutoMeasurements;
+  uint32_t collectedStart = collector.Collected();
+  mark = BenchStart();
+
+  for(uint32_t ms = 1; ms <= BENCH_ALS_RUN_MS; ms++){
+    delay(1);
+    collector.Service();
+
+    if(ms % BENCH_ALS_DRAIN_MS == 0){
+      while(collector.Take(reading)){
+        if(taken > 0 && (long)(reading.Timestamp - lastTimestamp) <= 0){ outOfOrder++; }
+        lastTimestamp = reading.Timestamp;
+        taken++;
+      }
+    }
+  }
+
+  uint32_t collected = collector.Collected() - collectedStart;
+  uint32_t measured = bus.Sunlight.AutoMeasurements - measuredStart;
+  uint32_t overruns = collector.Overruns();
+  double seconds = (HostMicros64() - mark.SimMicros) / 1.0e6;
+  double autoTransactions = (double)(bus.Stats.Transactions - mark.Bus.Transactions) / collected;
+  double autoBusUs = (double)(bus.Stats.BusTimeMicros - mark.Bus.BusTimeMicros) / collected;
+
+  //Sample cycles with the collector as the light source
+  SampleScheduler sampler(moisture, sunlight, temp);
+  SensorSample sample;
+  uint32_t samples = 0;
+  uint32_t timeouts = 0;
+  uint32_t lightError = 0;
+  uint32_t expected = sunlight.CountsToLux(ALS_CH_VIS, sunlight.ReadAmbVisData());
+
+  sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+  sampler.SetLightSource(&collector);
+  delay(SCHED_DEFAULT_INTERVAL_MS / 2);
+
+  while(samples < BENCH_ALS_CYCLES){
+    collector.Service();
+    sampler.Service();
+
+    if(sampler.TakeSample(sample)){
+      if(sample.Flags & SAMPLE_FLAG_ALS_TIMEOUT){ timeouts++; }
+      uint32_t error = (sample.Light > expected) ? sample.Light - expected : expected - sample.Light;
+      if(error > lightError){ lightError = error; }
+      samples++;
+    }
+
+    unsigned long wait = sampler.MillisUntilNextStep();
+    delay((wait < BENCH_ALS_PERIOD_MS) ? wait : BENCH_ALS_PERIOD_MS);
+  }
+
+  BenchCheck(measured == collected && outOfOrder == 0);
+  printf("{\"bench\":\"als_auto\",\"period_ms\":%u,\"readings_per_s\":%.1f,\"missed\":%u,\"overruns\":%u,\"out_of_order\":%u,"
+         "\"i2c_per_reading\":%.2f,\"bus_us_per_reading\":%.1f,\"forced_i2c_per_reading\":%.2f,\"forced_bus_us_per_reading\":%.1f,"
+         "\"forced_blocked_us_per_reading\":%.1f,\"samples\":%u,\"sample_timeouts\":%u,\"sample_light_error\":%u}\n",
+         BENCH_ALS_PERIOD_MS, taken / seconds, measured - collected, overruns, outOfOrder,
+         autoTransactions, autoBusUs, forcedTransactions, forcedBusUs, forcedBlockedUs, samples, timeouts, lightError);
+  fflush(stdout);
+
+  collector.Stop();
+  bus.ConnectInterrupt(BENCH_ALS_INT_PIN, 0);
+  benchCollector = 0;
+}
+
+/************************************
+BenchAlsRange() - Sweeps the simulated light from BENCH_RANGE_MIN_LUX over BENCH_RANGE_DECADES decades, up
+and back down, with AlsAutoRange following it one measurement + Update() at a time (the level carries over
+from the previous point, as it does between samples). Reports the measurements each point needed to get in
+range, the lux error (at or above BENCH_RANGE_ERROR_MIN_LUX, since lux is whole numbers) and how many points
+overflowed or stayed under ALS_RANGE_LOW_COUNTS while a more sensitive setting was left, next to a fixed
+gain 0 normal-range setting. Then a few
+sample cycles jump from a dim room to direct sun with the ranger in the scheduler, and a level change is
+made with the parameter RAM refusing writes, which must be reported and recovered from.
+*************************************/
+static void BenchAlsRange(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp){
+
+  SimBus &bus = HostSimBus();
+  AlsAutoRange range(sunlight);
+  uint16_t points = BENCH_RANGE_STEPS_PER_DECADE * BENCH_RANGE_DECADES;
+  uint32_t measured = 0;
+  uint32_t maxMeasurements = 0;
+  uint32_t unsettled = 0;
+  uint32_t rangedOverflow = 0;
+  uint32_t rangedLow = 0;
+  uint32_t fixedOverflow = 0;
+  uint32_t fixedLow = 0;
+  double maxError = 0;
+  uint16_t vis;
+  uint16_t ir;
+
+  range.Begin();
+
+  for(uint16_t step = 0; step <= 2 * points; step++){
+
+    uint16_t exponent = (step <= points) ? step : 2 * points - step;
+    double lux = BENCH_RANGE_MIN_LUX * pow(10.0, (double)exponent / BENCH_RANGE_STEPS_PER_DECADE);
+    bus.Sunlight.SetAmbient(lux, lux / 2);
+
+    //Ranged: measure until the controller stops changing the level (no cap, to check the bound)
+    uint8_t status;
+    uint8_t result;
+    uint32_t count = 0;
+    do{
+      status = sunlight.MeasureALS(vis, ir, range.TimeoutMillis());
+      result = range.Update(status, vis, ir);
+      count++;
+    }while(result == ALS_RANGE_RETRY && count < 2 * ALS_RANGE_MAX_MEASUREMENTS);
+
+    measured += count;
+    if(count > maxMeasurements){ maxMeasurements = count; }
+    if(result == ALS_RANGE_RETRY){ unsettled++; }
+    if(status == ALS_VIS_OVERFLOW){ rangedOverflow++; }
+    else if(vis < ALS_DARK_COUNTS + ALS_RANGE_LOW_COUNTS && range.Level(ALS_CH_VIS) > 0){ rangedLow++; }
+    if(lux >= BENCH_RANGE_ERROR_MIN_LUX){
+      double error = fabs((double)range.VisLux() - lux) / lux * 100.0;
+      if(error > maxError){ maxError = error; }
+    }
+
+    //Fixed gain 0, normal range (the default configuration)
+    uint8_t level[2] = {range.Level(ALS_CH_VIS), range.Level(ALS_CH_IR)};
+    sunlight.SetALSRange(ALS_CH_VIS, 0, false);
+    sunlight.SetALSRange(ALS_CH_IR, 0, false);
+    status = sunlight.MeasureALS(vis, ir);
+    if(status == ALS_VIS_OVERFLOW){ fixedOverflow++; }
+    else if(vis < ALS_DARK_COUNTS + ALS_RANGE_LOW_COUNTS){ fixedLow++; }
+    for(uint8_t ch = ALS_CH_VIS; ch <= ALS_CH_IR; ch++){
+      sunlight.SetALSRange(ch, AlsAutoRange::LevelGain(level[ch]), level[ch] == ALS_RANGE_HIGH_LEVEL);
+    }
+  }
+
+  //Scheduler: dim room, then direct sun; the sample must not report an overflow
+  SampleScheduler sampler(moisture, sunlight, temp);
+  SensorSample sample;
+  uint32_t samples = 0;
+  uint32_t overflows = 0;
+  double sampleError = 0;
+
+  bus.Sunlight.SetAmbient(20, 10);
+  range.Begin();
+  sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+  sampler.SetLightRange(&range);
+
+  while(samples < BENCH_ALS_CYCLES){
+    sampler.Service();
+
+    if(sampler.TakeSample(sample)){
+      double lux = (samples < BENCH_ALS_CYCLES / 2) ? 20 : BENCH_RANGE_SUN_LUX;
+      if(sample.Flags & SAMPLE_FLAG_ALS_OVERFLOW){ overflows++; }
+      double error = fabs((double)sample.Light - lux) / lux * 100.0;
+      if(error > sampleError){ sampleError = error; }
+      samples++;
+      if(samples == BENCH_ALS_CYCLES / 2){ bus.Sunlight.SetAmbient(BENCH_RANGE_SUN_LUX, BENCH_RANGE_SUN_LUX / 2); }
+    }
+
+    delay(sampler.MillisUntilNextStep());
+  }
+
+  //Level change with the parameter RAM refusing writes: the level must not move, the next reading
+  //is discarded while the levels are programmed again, and then ranging carries on
+  uint8_t faultStatus;
+  uint8_t faultLevel = range.Level(ALS_CH_VIS);
+  bus.Sunlight.SetAmbient(20, 10);
+  bus.Sunlight.ParamWriteMask = 0x00;
+  faultStatus = sunlight.MeasureALS(vis, ir, range.TimeoutMillis());
+  uint8_t faultResult = range.Update(faultStatus, vis, ir);
+  bool faultHeld = (range.Level(ALS_CH_VIS) == faultLevel);
+  bus.Sunlight.ParamWriteMask = 0xFF;
+  faultStatus = sunlight.MeasureALS(vis, ir, range.TimeoutMillis());
+  uint8_t recoverResult = range.Update(faultStatus, vis, ir);
+  uint32_t faultVisLux = 0;
+  uint32_t faultIrLux = 0;
+  faultStatus = range.Measure(faultVisLux, faultIrLux);
+  double faultError = fabs((double)faultVisLux - 20) / 20 * 100.0;
+  bool faultRecovered = (faultResult == ALS_RANGE_FAULT && faultHeld && recoverResult == ALS_RANGE_FAULT &&
+                         faultStatus == ALS_DONE && faultError <= maxError);
+  BenchCheck(faultRecovered);
+
+  printf("{\"bench\":\"als_range\",\"points\":%u,\"avg_measurements\":%.2f,\"max_measurements\":%u,\"unsettled\":%u,"
+         "\"max_lux_error_pct\":%.2f,\"overflow_points\":%u,\"low_count_points\":%u,\"fixed_gain0_overflow_points\":%u,"
+         "\"fixed_gain0_low_count_points\":%u,\"level_changes\":%u,\"samples\":%u,"
+         "\"sample_overflows\":%u,\"sample_lux_error_pct\":%.2f,\"level_fault_recovered\":%s}\n",
+         2 * points + 1, (double)measured / (2 * points + 1), maxMeasurements, unsettled, maxError,
+         rangedOverflow, rangedLow, fixedOverflow, fixedLow, range.Changes(),
+         samples, overflows, sampleError, faultRecovered ? "true" : "false");
+  fflush(stdout);
+
+  SI1145Config lightConfig = SI1145_DEFAULT_CONFIG;
+  sunlight.ApplyConfig(lightConfig);
+  bus.Sunlight.SetAmbient(300, 150);
+}
+
+/************************************
+BenchLinkApUp() - Access point schedule for BenchWiFiLink(): down between the outage start and end.
+*************************************/
+static bool BenchLinkApUp(unsigned long elapsed){
+
+  return elapsed < BENCH_LINK_OUTAGE_START_MS || elapsed >= BENCH_LINK_OUTAGE_END_MS;
+}
+
+/************************************
+BenchWiFiLink() - Six hours of one-minute samples with an upload every BENCH_LINK_UPLOAD_MS while the
+access point is down for the second and third hours. Legacy: the old wifiNetworkConnect() loop
+(WiFi.begin() + delay(10000) until connected) runs when an upload is due, so sampling stops with the
+link. Managed: WiFiLink connects in the background with backoff and the radio is off between attempts.
+Reports samples taken, the longest gap between samples, radio attempts and on-time, and how long after
+the access point came back the backlog was uploaded.
+*************************************/
+static void BenchWiFiLink(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp, bool managed){
+
+  SampleScheduler sampler(moisture, sunlight, temp);
+  SimRadio radio;
+  WiFiLink link(radio, "bench", "bench");
+  SensorSample sample;
+  uint32_t samples = 0;
+  uint32_t pending = 0;
+  uint32_t uploaded = 0;
+  unsigned long maxGap = 0;
+  unsigned long lastSample = 0;
+  unsigned long recovered = 0;
+  unsigned long start = millis();
+  unsigned long nextUpload = start + BENCH_LINK_UPLOAD_MS;
+  uint64_t outageStartMicros = 0;
+  uint64_t outageEndMicros = 0;
+  bool inOutage = false;
+
+  sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+  link.Begin(BENCH_LINK_SEED);
+
+  while((millis() - start) < BENCH_LINK_RUN_MS){
+
+    unsigned long now = millis();
+    radio.SetAccessPoint(BenchLinkApUp(now - start));
+    if(!inOutage && outageStartMicros == 0 && !BenchLinkApUp(now - start)){
+      outageStartMicros = radio.OnMicros();
+      inOutage = true;
+    }
+    if(inOutage && BenchLinkApUp(now - start)){
+      outageEndMicros = radio.OnMicros();
+      inOutage = false;
+    }
+
+    sampler.Service();
+    if(sampler.TakeSample(sample)){
+      if(samples > 0 && sample.Timestamp - lastSample > maxGap){ maxGap = sample.Timestamp - lastSample; }
+      lastSample = sample.Timestamp;
+      samples++;
+      pending++;
+    }
+
+    bool due = pending > 0 && (long)(millis() - nextUpload) >= 0;
+    bool posted = false;
+
+    if(managed){
+      if(due){ link.Request(); }
+      link.Service();
+      posted = due && link.Connected();
+    }
+    else if(due){
+      while(radio.Status() != RADIO_CONNECTED){
+        radio.Begin("bench", "bench");
+        delay(BENCH_LINK_LEGACY_RETRY_MS);
+        radio.SetAccessPoint(BenchLinkApUp(millis() - start));
+      }
+      posted = true;
+    }
+
+    if(posted){
+      delay(BENCH_LINK_POST_MS);
+      uploaded += pending;
+      pending = 0;
+      nextUpload = millis() + BENCH_LINK_UPLOAD_MS;
+      if(recovered == 0 && (millis() - start) >= BENCH_LINK_OUTAGE_END_MS){ recovered = millis() - start - BENCH_LINK_OUTAGE_END_MS; }
+      if(!managed){ radio.End(); }
+    }
+
+    //Sleep until the next step, with the radio off unless an upload is waiting on the link
+    unsigned long wait = sampler.MillisUntilNextStep();
+    long untilUpload = (long)(nextUpload - millis());
+    if(pending > 0){
+      unsigned long uploadWait = (untilUpload > 0) ? (unsigned long)untilUpload : 0;
+      if(managed && untilUpload <= 0){ uploadWait = link.MillisUntilNextStep(); }
+      if(uploadWait < wait){ wait = uploadWait; }
+    }
+    if(managed && (pending == 0 || untilUpload > 0)){ link.Release(); }
+    delay(wait);
+  }
+
+  printf("{\"bench\":\"wifi_link\",\"mode\":\"%s\",\"samples\":%u,\"expected_samples\":%lu,\"max_sample_gap_ms\":%lu,"
+         "\"uploaded\":%u,\"radio_begins\":%u,\"status_polls\":%u,\"radio_on_ms\":%lu,\"outage_radio_on_ms\":%lu,"
+         "\"backlog_uploaded_after_ms\":%lu,\"failures\":%u}\n",
+         managed ? "managed" : "legacy", samples, BENCH_LINK_RUN_MS / SCHED_DEFAULT_INTERVAL_MS, maxGap,
+         uploaded, radio.Begins, radio.StatusPolls, (unsigned long)(radio.OnMicros() / 1000),
+         (unsigned long)((outageEndMicros - outageStartMicros) / 1000), recovered, link.Failures());
+  fflush(stdout);
+}
+
+/************************************
+BenchLogSample() - Minute `i` of a synthetic plant: slow drying, a diurnal light curve and temperature
+swing, sensor noise, and an occasional flagged sample (any combination of the bits the log stores).
+*************************************/
+static SensorSample BenchLogSample(uint32_t i){
+
+  double day = 2.0 * M_PI * (double)(i % 1440) / 1440.0;
+  double sun = sin(day - M_PI / 2.0);
+  SensorSample sample;
+
+  sample.Timestamp = (unsigned long)i * 60000UL + (unsigned long)(rand() % 50);
+  sample.Moisture = (uint16_t)(560 - (i / 240) % 200 + rand() % 5);
+  sample.Light = (sun > 0) ? (uint32_t)(12000.0 * sun * (0.98 + (rand() % 400) / 10000.0)) : (uint32_t)(rand() % 3);
+  sample.Temperature = (int16_t)(7000 + 400 * sun + (rand() % 3 - 1) * 11);
+  sample.Flags = (rand() % 500 == 0) ? (uint8_t)(1 + rand() % LOG_TAG_FLAGS_MASK) : 0;
+
+  return sample;
+}
+
+/************************************
+BenchLogMatches() - Compares a logged sample with the one appended (timestamps in whole seconds).
+*************************************/
+static bool BenchLogMatches(const SensorSample &logged, const SensorSample &appended){
+
+  return logged.Timestamp / 1000 == appended.Timestamp / 1000 && logged.Moisture == appended.Moisture &&
+         logged.Light == appended.Light && logged.Temperature == appended.Temperature && logged.Flags == appended.Flags;
+}
+
+/************************************
+BenchLogCapacity() - Logs BENCH_LOG_DAYS days of one-minute samples into a part and reads back what it
+holds: bytes per sample, days retained, erase count spread across the erase units (wear leveling), and
+every retained sample checked against what was appended. Bigger pages need a longer maximum block age
+to fill before they are committed.
+*************************************/
+static void BenchLogCapacity(const char *part, uint32_t size, uint16_t pageSize, uint32_t eraseSize, unsigned long maxAge,
+                             const char *path){
+
+  uint32_t total = BENCH_LOG_DAYS * 1440UL;
+  SensorSample *appended = (SensorSample *)malloc(total * sizeof(SensorSample));
+  FileFlash flash(size, pageSize, eraseSize);
+  if(path != 0){ flash.Open(path, true); }
+  SampleLog log(flash);
+  LogEntry entry;
+
+  srand(7);
+  log.Begin();
+  log.SetMaxAge(maxAge);
+
+  for(uint32_t i = 0; i < total; i++){
+    appended[i] = BenchLogSample(i);
+    log.Append(appended[i]);
+  }
+  log.Flush();
+
+  uint32_t retained = 0;
+  uint32_t mismatches = 0;
+  uint32_t first = 0;
+  log.Rewind();
+  while(log.Next(entry)){
+    if(retained == 0){ first = entry.Sample.Timestamp / 60000; }
+    uint32_t index = first + retained;
+    if(index >= total || !BenchLogMatches(entry.Sample, appended[index])){ mismatches++; }
+    retained++;
+  }
+  if(first + retained != total){ mismatches++; }
+
+  uint32_t units = size / eraseSize;
+  uint32_t minErase = 0xFFFFFFFF;
+  uint32_t maxErase = 0;
+  for(uint32_t unit = 0; unit < units; unit++){
+    uint32_t count = flash.EraseCount(unit);
+    if(count < minErase){ minErase = count; }
+    if(count > maxErase){ maxErase = count; }
+  }
+
+  BenchCheck(mismatches == 0);
+  printf("{\"bench\":\"sample_log\",\"part\":\"%s\",\"bytes\":%lu,\"page\":%u,\"erase_unit\":%lu,\"samples\":%lu,"
+         "\"bytes_per_sample\":%.2f,\"raw_bytes_per_sample\":%u,\"retained_samples\":%lu,\"retained_days\":%.1f,"
+         "\"max_age_s\":%lu,\"mismatches\":%lu,\"erases_min\":%lu,\"erases_max\":%lu,\"skipped_pages\":%lu}\n",
+         part, (unsigned long)size, (unsigned int)pageSize, (unsigned long)eraseSize, (unsigned long)total,
+         (double)log.Committed() * pageSize / total, (unsigned int)sizeof(SensorSample), (unsigned long)retained,
+         retained / 1440.0, maxAge / 1000, (unsigned long)mismatches, (unsigned long)minErase, (unsigned long)maxErase,
+         (unsigned long)log.SkippedPages());
+  fflush(stdout);
+
+  free(appended);
+}
+
+/************************************
+BenchLogPowerCut() - Crash safety: each trial logs a random number of samples, cuts the power at a random
+point of a later program or erase (torn page or half-erased row), then "reboots" (new SampleLog on the
+same flash), reads the log back and logs on. Every sample read must be one that was appended, in order;
+lost samples are the ones not yet committed (at most a block and the one being built).
+*************************************/
+static void BenchLogPowerCut(void){
+
+  uint32_t capacity = 6000;
+  SensorSample *appended = (SensorSample *)malloc(capacity * sizeof(SensorSample));
+  uint32_t corrupt = 0;
+  uint32_t torn = 0;
+  uint32_t maxLost = 0;
+  uint32_t resumeFailures = 0;
+
+  srand(11);
+
+  for(uint32_t trial = 0; trial < BENCH_LOG_CUT_TRIALS; trial++){
+
+    FileFlash flash(BENCH_LOG_CUT_SIZE, SAMD_FLASH_PAGE_SIZE, SAMD_FLASH_ROW_SIZE);
+    SampleLog log(flash);
+    LogEntry entry;
+    uint32_t count = 0;
+
+    log.Begin();
+    log.SetMaxAge(BENCH_LOG_CUT_MAX_AGE_MS);
+
+    uint32_t before = rand() % 3000;
+    while(count < before){
+      appended[count] = BenchLogSample(count);
+      log.Append(appended[count]);
+      count++;
+    }
+
+    //Power goes out somewhere in the next few pages' worth of programming/erasing
+    flash.CutPowerAfter(rand() % (4 * SAMD_FLASH_ROW_SIZE), rand() | 1);
+    while(!flash.PowerCut() && count < before + 1000){
+      appended[count] = BenchLogSample(count);
+      if(log.Append(appended[count]) == LOG_OK){ count++; }
+    }
+
+    //Reboot
+    flash.CutPowerAfter(FILE_FLASH_NO_CUT, 1);
+    SampleLog rebooted(flash);
+    rebooted.Begin();
+
+    uint32_t read = 0;
+    uint32_t first = 0;
+    bool ok = true;
+    rebooted.Rewind();
+    while(rebooted.Next(entry)){
+      if(read == 0){ first = entry.Sample.Timestamp / 60000; }
+      if(first + read >= count || !BenchLogMatches(entry.Sample, appended[first + read])){ ok = false; }
+      read++;
+    }
+    if(!ok){ corrupt++; }
+    if(rebooted.SkippedPages() > 0 || read == 0 || first + read < count){ torn++; }
+
+    uint32_t lost = (read > 0) ? count - (first + read) : count;
+    if(read > 0 && lost > maxLost){ maxLost = lost; }
+
+    //Logging resumes after the last good block, under the next boot count
+    uint32_t resumeAt = count;
+    for(uint32_t i = 0; i < BENCH_LOG_FUZZ_APPENDS; i++){
+      appended[count] = BenchLogSample(count);
+      rebooted.Append(appended[count]);
+      count++;
+    }
+    rebooted.Flush();
+
+    uint32_t resumed = 0;
+    rebooted.Rewind();
+    while(rebooted.Next(entry)){
+      if(entry.Boot != rebooted.Boot()){ continue; }
+      uint32_t index = resumeAt + resumed;
+      if(index >= count || !BenchLogMatches(entry.Sample, appended[index])){ ok = false; }
+      resumed++;
+    }
+    if(!ok || resumed != BENCH_LOG_FUZZ_APPENDS){ resumeFailures++; }
+  }
+
+  BenchCheck(corrupt == 0 && resumeFailures == 0);
+  printf("{\"bench\":\"sample_log_power_cut\",\"trials\":%u,\"trials_with_loss\":%lu,"
+         "\"corrupt_or_out_of_order\":%lu,\"max_lost_samples\":%lu,\"resume_failures\":%lu}\n",
+         BENCH_LOG_CUT_TRIALS, (unsigned long)torn, (unsigned long)corrupt,
+         (unsigned long)maxLost, (unsigned long)resumeFailures);
+  fflush(stdout);
+
+  free(appended);
+}
+
+/************************************
+BenchLogFuzz() - Mutates a wrapped log image (bit flips, bytes overwritten, pages of random data,
+random headers with a good magic) and runs recovery and the reader on it. The reader must stop within
+the image's page count and the writer must still append and read back BENCH_LOG_FUZZ_APPENDS samples.
+*************************************/
+static void BenchLogFuzz(void){
+
+  FileFlash base(BENCH_LOG_CUT_SIZE, SAMD_FLASH_PAGE_SIZE, SAMD_FLASH_ROW_SIZE);
+  SampleLog baseLog(base);
+  SensorSample appended[BENCH_LOG_FUZZ_APPENDS];
+  uint32_t runaway = 0;
+  uint32_t resumeFailures = 0;
+  uint32_t decoded = 0;
+
+  srand(13);
+  baseLog.Begin();
+  for(uint32_t i = 0; i < 4000; i++){ baseLog.Append(BenchLogSample(i)); }
+  baseLog.Flush();
+
+  uint32_t pages = BENCH_LOG_CUT_SIZE / SAMD_FLASH_PAGE_SIZE;
+
+  for(uint32_t round = 0; round < BENCH_LOG_FUZZ_ROUNDS; round++){
+
+    FileFlash flash(BENCH_LOG_CUT_SIZE, SAMD_FLASH_PAGE_SIZE, SAMD_FLASH_ROW_SIZE);
+    uint8_t *image = flash.Image();
+    memcpy(image, base.Image(), BENCH_LOG_CUT_SIZE);
+
+    uint8_t mutations = 1 + rand() % 16;
+    for(uint8_t m = 0; m < mutations; m++){
+      uint32_t page = rand() % pages;
+      uint8_t *p = image + page * SAMD_FLASH_PAGE_SIZE;
+      switch(rand() % 4){
+        case 0: p[rand() % SAMD_FLASH_PAGE_SIZE] ^= (uint8_t)(1 << (rand() % 8)); break;
+        case 1: p[rand() % SAMD_FLASH_PAGE_SIZE] = (uint8_t)rand(); break;
+        case 2: for(uint8_t i = 0; i < SAMD_FLASH_PAGE_SIZE; i++){ p[i] = (uint8_t)rand(); } break;
+        case 3: {
+          //A header that passes the magic check; half the time with a matching CRC over random payload
+          uint16_t length = rand() % (SAMD_FLASH_PAGE_SIZE - LOG_HEADER_SIZE - LOG_CRC_SIZE + 1);
+          p[0] = LOG_BLOCK_MAGIC;
+          p[1] = (uint8_t)(1 + rand() % 255);
+          p[2] = (uint8_t)length;
+          p[3] = 0;
+          for(uint16_t i = 4; i < LOG_HEADER_SIZE + length; i++){ p[i] = (uint8_t)rand(); }
+          if(rand() % 2){
+            uint16_t crc = SampleLog::Crc16(p, LOG_HEADER_SIZE + length);
+            p[LOG_HEADER_SIZE + length] = (uint8_t)crc;
+            p[LOG_HEADER_SIZE + length + 1] = (uint8_t)(crc >> 8);
+          }
+          break;
+        }
+      }
+    }
+
+    SampleLog log(flash);
+    LogEntry entry;
+    uint32_t read = 0;
+
+    log.Begin();
+    log.Rewind();
+    while(log.Next(entry) && read <= pages * 255){ read++; }
+    if(read > pages * 255){ runaway++; }
+    decoded += read;
+
+    for(uint8_t i = 0; i < BENCH_LOG_FUZZ_APPENDS; i++){
+      appended[i] = BenchLogSample(5000 + round * BENCH_LOG_FUZZ_APPENDS + i);
+      log.Append(appended[i]);
+    }
+    log.Flush();
+
+    uint32_t resumed = 0;
+    bool ok = true;
+    log.Rewind();
+    while(log.Next(entry)){
+      if(entry.Boot != log.Boot()){ continue; }
+      if(resumed >= BENCH_LOG_FUZZ_APPENDS || !BenchLogMatches(entry.Sample, appended[resumed])){ ok = false; }
+      resumed++;
+    }
+    if(!ok || resumed != BENCH_LOG_FUZZ_APPENDS){ resumeFailures++; }
+  }
+
+  BenchCheck(runaway == 0 && resumeFailures == 0);
+  printf("{\"bench\":\"sample_log_fuzz\",\"rounds\":%u,\"samples_decoded\":%lu,\"reader_runaway\":%lu,\"resume_failures\":%lu}\n",
+         BENCH_LOG_FUZZ_ROUNDS, (unsigned long)decoded, (unsigned long)runaway, (unsigned long)resumeFailures);
+  fflush(stdout);
+}
+
+/************************************
+CompareDouble() - qsort order for latency percentiles.
+*************************************/
+static int CompareDouble(const void *a, const void *b){
+
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/************************************
+BenchQuery() - One request to the query server over loopback, the way a LAN controller would send
+it: connect, send, then read until the server closes. Service() is called in between, as loop() would.
+Inputs: port -> listener port; server -> server under test; path -> request path; response -> reply
+        (status line, headers and body, NUL terminated); wallUs -> set to the round trip time
+return: reply length
+*************************************/
+static uint16_t BenchQuery(uint16_t port, QueryServer &server, const char *path, char *response, double &wallUs){
+
+  HostSocketClient client;
+  char request[160];
+  uint16_t length = 0;
+  int requestLength = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: plant.local\r\nAccept: */*\r\n\r\n", path);
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  client.connect("127.0.0.1", port);
+  client.write((const uint8_t *)request, requestLength);
+
+  for(uint32_t polls = 0; polls < 10000 && client.connected(); polls++){
+    server.Service(true);
+    while(client.available() > 0 && length < BENCH_QUERY_RESPONSE - 1){
+      int got = client.read((uint8_t *)&response[length], BENCH_QUERY_RESPONSE - 1 - length);
+      if(got > 0){ length += got; }
+    }
+  }
+  client.stop();
+
+  wallUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  response[length] = '\0';
+
+  return length;
+}
+
+/************************************
+BenchQueryEndpoint() - Round trip latency of one endpoint (median and worst of BENCH_QUERY_REQUESTS).
+*************************************/
+static void BenchQueryEndpoint(uint16_t port, QueryServer &server, const char *path){
+
+  static double latency[BENCH_QUERY_REQUESTS];
+  char response[BENCH_QUERY_RESPONSE];
+  uint32_t ok = 0;
+  uint16_t bytes = 0;
+
+  for(uint32_t i = 0; i < BENCH_QUERY_REQUESTS; i++){
+    bytes = BenchQuery(port, server, path, response, latency[i]);
+    if(strncmp(response, "HTTP/1.1 200", 12) == 0){ ok++; }
+  }
+
+  qsort(latency, BENCH_QUERY_REQUESTS, sizeof(double), CompareDouble);
+
+  BenchCheck(ok == BENCH_QUERY_REQUESTS);
+  printf("{\"bench\":\"query_server\",\"path\":\"%s\",\"requests\":%u,\"ok\":%lu,\"response_bytes\":%u,"
+         "\"p50_us\":%.1f,\"max_us\":%.1f}\n", path, BENCH_QUERY_REQUESTS, (unsigned long)ok, (unsigned int)bytes,
+         latency[BENCH_QUERY_REQUESTS / 2], latency[BENCH_QUERY_REQUESTS - 1]);
+  fflush(stdout);
+}
+
+/************************************
+BenchQueryServer() - Local query endpoint on the host loopback listener: a log with a previous boot's
+samples and this boot's, then /latest and /stats latency, a full /history walk page by page (every
+sample of this boot exactly once, in order, including the ones only in RAM) and bad requests.
+*************************************/
+static void BenchQueryServer(void){
+
+  FileFlash flash(BENCH_LOG_SAMD_SIZE, SAMD_FLASH_PAGE_SIZE, SAMD_FLASH_ROW_SIZE);
+  SampleLog previous(flash);
+  SampleLog log(flash);
+  HostListener listener(0);
+  QueryServer server(listener, &log);
+  PowerManager power;
+  char powerReport[POWER_REPORT_MAX];
+  char response[BENCH_QUERY_RESPONSE];
+  double wallUs;
+
+  srand(17);
+  previous.Begin();
+  for(uint32_t i = 0; i < BENCH_QUERY_OLD_BOOT; i++){ previous.Append(BenchLogSample(i)); }
+  previous.Flush();
+
+  log.Begin();
+  unsigned long lastTimestamp = 0;
+  for(uint32_t i = 0; i < BENCH_QUERY_SAMPLES; i++){
+    SensorSample sample = BenchLogSample(i);
+    log.Append(sample);
+    server.Record(sample);
+    lastTimestamp = sample.Timestamp;
+  }
+
+  server.Service(true);
+  uint16_t port = listener.Port();
+
+  power.FormatReport(powerReport, sizeof(powerReport));
+  server.SetPowerReport(powerReport);
+
+  BenchQueryEndpoint(port, server, "/latest");
+  BenchQueryEndpoint(port, server, "/stats");
+
+  //The daily power report rides along in /stats
+  BenchQuery(port, server, "/stats", response, wallUs);
+  bool powerServed = strstr(response, "\"power\":\"sleep=") != 0;
+  BenchCheck(powerServed);
+  printf("{\"bench\":\"query_power_report\",\"served\":%s,\"report_bytes\":%u}\n", powerServed ? "true" : "false",
+         (unsigned int)strlen(powerReport));
+  fflush(stdout);
+
+  //Page through the whole history
+  uint32_t returned = 0;
+  uint32_t pages = 0;
+  uint32_t outOfOrder = 0;
+  unsigned long since = 0;
+  unsigned long last = 0;
+  double totalUs = 0;
+  double worstUs = 0;
+  bool more = true;
+  uint32_t readBefore = flash.BytesRead;
+
+  while(more && pages < 1000){
+    char path[48];
+    if(pages == 0){ snprintf(path, sizeof(path), "/history"); }
+    else{ snprintf(path, sizeof(path), "/history?since=%lu", since); }
+    BenchQuery(port, server, path, response, wallUs);
+    pages++;
+    totalUs += wallUs;
+    if(wallUs > worstUs){ worstUs = wallUs; }
+
+    for(const char *record = strstr(response, "{\"t\":"); record != 0; record = strstr(record + 1, "{\"t\":")){
+      unsigned long t = strtoul(record + 5, 0, 10);
+      if(returned > 0 && t <= last){ outOfOrder++; }
+      last = t;
+      returned++;
+    }
+
+    const char *next = strstr(response, "\"next\":");
+    more = strstr(response, "\"more\":true") != 0;
+    since = (next != 0) ? strtoul(next + 7, 0, 10) : last;
+  }
+
+  bool newest = last == lastTimestamp;
+
+  BenchCheck(returned == BENCH_QUERY_SAMPLES && outOfOrder == 0 && newest);
+  printf("{\"bench\":\"query_history\",\"samples\":%u,\"returned\":%lu,\"out_of_order\":%lu,\"newest_included\":%s,"
+         "\"pages\":%lu,\"samples_per_page\":%.1f,\"page_avg_us\":%.1f,\"page_max_us\":%.1f,\"page_flash_kb\":%.1f,"
+         "\"log_pending\":%u}\n",
+         BENCH_QUERY_SAMPLES, (unsigned long)returned, (unsigned long)outOfOrder, newest ? "true" : "false",
+         (unsigned long)pages, (double)returned / pages, totalUs / pages, worstUs,
+         (double)(flash.BytesRead - readBefore) / pages / 1024, (unsigned int)log.Pending());
+  fflush(stdout);
+
+  //Bad requests get an error status, and the server carries on
+  uint32_t errorsBefore = server.Errors();
+  BenchQuery(port, server, "/missing", response, wallUs);
+  bool notFound = strncmp(response, "HTTP/1.1 404", 12) == 0;
+  BenchQuery(port, server, "/history?since=notanumber", response, wallUs);
+  bool lenient = strncmp(response, "HTTP/1.1 200", 12) == 0;
+  BenchQuery(port, server, "/latest", response, wallUs);
+  bool recovered = strncmp(response, "HTTP/1.1 200", 12) == 0;
+
+  BenchCheck(notFound && lenient && recovered);
+  printf("{\"bench\":\"query_errors\",\"not_found\":%s,\"bad_since_served\":%s,\"served_after\":%s,\"errors\":%lu,"
+         "\"requests\":%lu,\"accepted\":%lu}\n", notFound ? "true" : "false", lenient ? "true" : "false",
+         recovered ? "true" : "false", (unsigned long)(server.Errors() - errorsBefore), (unsigned long)server.Requests(),
+         (unsigned long)listener.Accepted);
+  fflush(stdout);
+}
+
+/************************************
+BenchPayloadText() - Size and encode time of one sample per message in a text form: the original
+ThingSpeak update body (field1=..&field2=..&field3=..) or the MQTT packed text.
+*************************************/
+static void BenchPayloadText(const char *name, const SensorSample *samples, uint32_t total){
+
+  char text[BENCH_PAYLOAD_TEXT_MAX];
+  uint32_t bytes = 0;
+  bool form = strcmp(name, "form_text") == 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(uint32_t repeat = 0; repeat < BENCH_PAYLOAD_REPEATS; repeat++){
+    bytes = 0;
+    for(uint32_t i = 0; i < total; i++){
+      const SensorSample &sample = samples[i];
+      int length;
+      if(form){
+        int temperature = sample.Temperature;
+        const char *sign = (temperature < 0) ? "-" : "";
+        if(temperature < 0){ temperature = -temperature; }
+        length = snprintf(text, sizeof(text), "field1=%u&field2=%lu&field3=%s%d.%02d", (unsigned int)sample.Moisture,
+                          (unsigned long)sample.Light, sign, temperature / 100, temperature % 100);
+      }
+      else{
+        length = snprintf(text, sizeof(text), "t=%lu&m=%u&l=%lu&c=%d", (unsigned long)sample.Timestamp,
+                          (unsigned int)sample.Moisture, (unsigned long)sample.Light, (int)sample.Temperature);
+        if(sample.Flags != 0){ length += snprintf(&text[length], sizeof(text) - length, "&f=%u", (unsigned int)sample.Flags); }
+      }
+      bytes += length;
+    }
+  }
+  double wallNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  printf("{\"bench\":\"payload\",\"format\":\"%s\",\"batch\":1,\"samples\":%lu,\"bytes_per_sample\":%.2f,"
+         "\"encode_ns_per_sample\":%.1f}\n", name, (unsigned long)total, (double)bytes / total,
+         wallNs / ((double)total * BENCH_PAYLOAD_REPEATS));
+  fflush(stdout);
+}
+
+/************************************
+BenchPayloadJson() - Size and encode time of the ThingSpeak bulk-update records (SampleStore) for
+batches of samples; the request header and the records' separators are counted, the HTTP headers not.
+*************************************/
+static void BenchPayloadJson(const SensorSample *samples, uint32_t total, uint16_t batch){
+
+  SampleStore store;
+  char text[BULK_RECORD_MAX];
+  uint32_t bytes = 0;
+  double wallNs = 0;
+
+  for(uint32_t first = 0; first < total; first += batch){
+    uint16_t count = (total - first < batch) ? total - first : batch;
+    store.Clear();
+    for(uint16_t i = 0; i < count; i++){ store.Push(samples[first + i]); }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(uint32_t repeat = 0; repeat < BENCH_PAYLOAD_REPEATS; repeat++){
+      uint32_t length = SampleStore::FormatBulkHeader("BENCHKEY0000000", text, sizeof(text)) + strlen(BULK_TRAILER);
+      for(uint16_t i = 0; i < count; i++){ length += store.FormatBulkRecord(i, text, sizeof(text)); }
+      if(repeat == 0){ bytes += length; }
+    }
+    wallNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  printf("{\"bench\":\"payload\",\"format\":\"json_bulk\",\"batch\":%u,\"samples\":%lu,\"bytes_per_sample\":%.2f,"
+         "\"encode_ns_per_sample\":%.1f}\n", (unsigned int)batch, (unsigned long)total, (double)bytes / total,
+         wallNs / ((double)total * BENCH_PAYLOAD_REPEATS));
+  fflush(stdout);
+}
+
+/************************************
+BenchPayloadBinary() - Encodes the samples into SamplePayload payloads of up to `batch` records, decodes
+them back and checks every sample (timestamps to the second). Every truncation of the first payload is
+also decoded: none may pass as complete.
+*************************************/
+static void BenchPayloadBinary(const char *name, uint8_t format, const SensorSample *samples, uint32_t total, uint8_t batch){
+
+  uint16_t stride = PayloadEncoder::MaxLength(format, batch);
+  uint8_t *encoded = (uint8_t *)malloc((size_t)total * stride);
+  uint16_t *lengths = (uint16_t *)malloc(total * sizeof(uint16_t));
+  PayloadEncoder encoder(format);
+  uint32_t payloads = 0;
+  uint32_t bytes = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(uint32_t repeat = 0; repeat < BENCH_PAYLOAD_REPEATS; repeat++){
+    payloads = 0;
+    bytes = 0;
+    uint32_t i = 0;
+    while(i < total){
+      uint8_t *out = &encoded[(size_t)payloads * stride];
+      encoder.Begin(out, stride);
+      while(i < total && encoder.Count() < batch && encoder.Add(samples[i])){ i++; }
+      lengths[payloads] = encoder.Finish();
+      bytes += lengths[payloads];
+      payloads++;
+    }
+  }
+  double encodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  uint32_t mismatches = 0;
+  uint32_t decoded = 0;
+  start = std::chrono::steady_clock::now();
+  for(uint32_t repeat = 0; repeat < BENCH_PAYLOAD_REPEATS; repeat++){
+    decoded = 0;
+    for(uint32_t p = 0; p < payloads; p++){
+      PayloadDecoder decoder(&encoded[(size_t)p * stride], lengths[p]);
+      SensorSample sample;
+      while(decoder.Next(sample)){
+        if(repeat == 0 && (decoded >= total || !BenchLogMatches(sample, samples[decoded]))){ mismatches++; }
+        decoded++;
+      }
+      if(decoder.Error() || decoder.Format() != format){ mismatches++; }
+    }
+  }
+  double decodeNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  if(decoded != total){ mismatches++; }
+
+  uint32_t truncatedAccepted = 0;
+  for(uint16_t length = 0; length < lengths[0]; length++){
+    PayloadDecoder decoder(encoded, length);
+    SensorSample sample;
+    while(decoder.Next(sample)){}
+    if(!decoder.Error()){ truncatedAccepted++; }
+  }
+
+  BenchCheck(mismatches == 0 && truncatedAccepted == 0);
+  printf("{\"bench\":\"payload\",\"format\":\"%s\",\"batch\":%u,\"samples\":%lu,\"payloads\":%lu,\"bytes_per_sample\":%.2f,"
+         "\"bytes_per_payload\":%.1f,\"encode_ns_per_sample\":%.1f,\"decode_ns_per_sample\":%.1f,\"mismatches\":%lu,"
+         "\"truncated_accepted\":%lu}\n", name, (unsigned int)batch, (unsigned long)total, (unsigned long)payloads,
+         (double)bytes / total, (double)bytes / payloads, encodeNs / ((double)total * BENCH_PAYLOAD_REPEATS),
+         decodeNs / ((double)total * BENCH_PAYLOAD_REPEATS), (unsigned long)mismatches, (unsigned long)truncatedAccepted);
+  fflush(stdout);
+
+  free(lengths);
+  free(encoded);
+}
+
+/************************************
+BenchPayload() - A day of one-minute samples in each uplink payload form: text against the binary
+encodings, for single samples and batches.
+*************************************/
+static void BenchPayload(void){
+
+  SensorSample *samples = (SensorSample *)malloc(BENCH_PAYLOAD_SAMPLES * sizeof(SensorSample));
+
+  srand(11);
+  for(uint32_t i = 0; i < BENCH_PAYLOAD_SAMPLES; i++){ samples[i] = BenchLogSample(i); }
+
+  BenchPayloadText("form_text", samples, BENCH_PAYLOAD_SAMPLES);
+  BenchPayloadText("mqtt_text", samples, BENCH_PAYLOAD_SAMPLES);
+  BenchPayloadJson(samples, BENCH_PAYLOAD_SAMPLES, 1);
+  BenchPayloadJson(samples, BENCH_PAYLOAD_SAMPLES, BULK_MAX_RECORDS);
+
+  const uint8_t batches[3] = {1, MQTT_BATCH_RECORDS, BULK_MAX_RECORDS};
+  for(uint8_t b = 0; b < 3; b++){
+    BenchPayloadBinary("cbor", PAYLOAD_CBOR, samples, BENCH_PAYLOAD_SAMPLES, batches[b]);
+    BenchPayloadBinary("packed", PAYLOAD_PACKED, samples, BENCH_PAYLOAD_SAMPLES, batches[b]);
+  }
+
+  free(samples);
+}
+
+/************************************
+BenchTransport() - Drains BENCH_TRANSPORT_SAMPLES samples through one SampleTransport in batches,
+dropping what each Publish() reports delivered, and prints the bytes each sample costs on the
+connection (application bytes both ways; TCP/IP headers come on top, about 40 bytes per segment).
+*************************************/
+static void BenchTransport(const char *name, SampleTransport &transport, HostSocketClient &client, uint16_t batch){
+
+  static unsigned long timestamp = 0;
+  SampleStore store;
+  uint32_t publishes = 0;
+  uint32_t failures = 0;
+  uint32_t delivered = 0;
+  uint32_t pushed = 0;
+
+  memset(&client.Stats, 0, sizeof(client.Stats));
+
+  while(delivered < BENCH_TRANSPORT_SAMPLES && publishes < 4 * BENCH_TRANSPORT_SAMPLES){
+    while(store.Count() < batch && pushed < BENCH_TRANSPORT_SAMPLES){
+      SensorSample sample = {timestamp, (uint16_t)(500 + pushed % 37), (uint32_t)(260 + pushed % 91), (int16_t)(7200 + pushed % 53), 0};
+      timestamp += 60000;
+      store.Push(sample);
+      pushed++;
+    }
+
+    uint16_t count = store.Count();
+    if(transport.Publish(store, count) != UPLOAD_OK){ failures++; }
+    store.Drop(count);
+    delivered += count;
+    publishes++;
+  }
+
+  transport.Close();
+
+  BenchCheck(failures == 0 && delivered == BENCH_TRANSPORT_SAMPLES);
+  printf("{\"bench\":\"transport\",\"name\":\"%s\",\"batch\":%u,\"samples\":%u,\"delivered\":%lu,\"failures\":%lu,"
+         "\"connects\":%lu,\"writes_per_sample\":%.3f,\"bytes_sent_per_sample\":%.1f,\"bytes_received_per_sample\":%.1f,"
+         "\"bytes_per_sample\":%.1f}\n", name, (unsigned int)batch, BENCH_TRANSPORT_SAMPLES, (unsigned long)delivered,
+         (unsigned long)failures, (unsigned long)transport.Connects(), (double)client.Stats.Writes / delivered,
+         (double)client.Stats.BytesSent / delivered, (double)client.Stats.BytesReceived / delivered,
+         (double)(client.Stats.BytesSent + client.Stats.BytesReceived) / delivered);
+  fflush(stdout);
+}
+
+/************************************
+BenchMqttRedelivery() - QoS 1 over a broker that drops the connection after `drop` PUBLISHes without
+acknowledging them: the unacknowledged samples stay in the store and are resent
+with DUP set on the resumed session, so every sample arrives at least once. Samples received are
+counted from the broker's distinct messages (decoded, for the batched layouts).
+*************************************/
+static void BenchMqttRedelivery(MqttStub &broker, uint8_t layout, const char *name, uint32_t drop){
+
+  HostSocketClient client;
+  char clientId[40];
+  char topic[40];
+  snprintf(clientId, sizeof(clientId), "bench-redelivery-%s", name);
+  snprintf(topic, sizeof(topic), "plants/redelivery/%s", name);
+  MqttPublisher publisher(client, "127.0.0.1", broker.Port(), clientId, topic);
+  SampleStore store;
+
+  publisher.SetQoS(1);
+  publisher.SetTopicLayout(layout);
+
+  for(uint32_t i = 0; i < BENCH_REDELIVERY_SAMPLES; i++){
+    SensorSample sample = {900000000UL + i * 60000UL, (uint16_t)(400 + i), (uint32_t)(1000 + i), (int16_t)(6800 + i), 0};
+    store.Push(sample);
+  }
+
+  uint32_t duplicatesBefore = broker.Duplicates;
+  uint32_t resumedBefore = broker.SessionsResumed;
+  uint32_t failures = 0;
+  uint32_t publishes = 0;
+
+  //Prime the session, then drop the connection partway through the first batch
+  uint16_t none = 0;
+  publisher.Publish(store, none);
+  broker.DropAfter(drop);
+
+  while(store.Count() > 0 && publishes < 20){
+    uint16_t count = (store.Count() < BULK_MAX_RECORDS) ? store.Count() : BULK_MAX_RECORDS;
+    if(publisher.Publish(store, count) != UPLOAD_OK){ failures++; }
+    store.Drop(count);
+    publishes++;
+  }
+
+  //An idle connection is kept alive with PINGREQ
+  uint32_t pingsBefore = broker.Pings;
+  delay(MQTT_KEEPALIVE_S * 1000UL);
+  publisher.Service();
+  bool pinged = broker.Pings > pingsBefore && client.connected();
+
+  publisher.Close();
+
+  std::set<unsigned long> received;
+  std::vector<std::string> payloads = broker.Payloads(topic);
+  for(size_t i = 0; i < payloads.size(); i++){
+    if(layout == MQTT_TOPIC_PACKED){
+      received.insert(strtoul(payloads[i].c_str() + 2, 0, 10));
+      continue;
+    }
+    PayloadDecoder decoder((const uint8_t *)payloads[i].data(), payloads[i].size());
+    SensorSample sample;
+    while(decoder.Next(sample)){ received.insert(sample.Timestamp / 1000); }
+  }
+
+  BenchCheck(received.size() == BENCH_REDELIVERY_SAMPLES && store.Count() == 0 && broker.ProtocolErrors == 0);
+  printf("{\"bench\":\"mqtt_redelivery\",\"layout\":\"%s\",\"samples\":%u,\"left_in_store\":%u,\"unique_received\":%lu,\"duplicates\":%lu,"
+         "\"failed_publishes\":%lu,\"connects\":%lu,\"sessions_resumed\":%lu,\"keepalive_ping\":%s,\"protocol_errors\":%lu}\n",
+         name, BENCH_REDELIVERY_SAMPLES, (unsigned int)store.Count(), (unsigned long)received.size(),
+         (unsigned long)(broker.Duplicates - duplicatesBefore), (unsigned long)failures, (unsigned long)publisher.Connects(),
+         (unsigned long)(broker.SessionsResumed - resumedBefore), pinged ? "true" : "false", (unsigned long)broker.ProtocolErrors);
+  fflush(stdout);
+}
+
+/************************************
+BenchTransports() - Bytes per sample of the ThingSpeak HTTP bulk update against MQTT, over loopback
+to HttpStub and MqttStub.
+*************************************/
+static void BenchTransports(HttpStub &stub){
+
+  MqttStub broker;
+  if(!broker.Start()){
+    printf("{\"bench\":\"transport\",\"error\":\"broker did not start\"}\n");
+    BenchCheck(false);
+    return;
+  }
+
+  {
+    HostSocketClient client;
+    ThingSpeakUploader uploader(client, "127.0.0.1", stub.Port(), "/channels/0/bulk_update.json", "BENCHKEY0000000");
+    BenchTransport("http_bulk", uploader, client, 1);
+    BenchTransport("http_bulk", uploader, client, BULK_MAX_RECORDS);
+  }
+
+  const uint8_t layouts[4] = {MQTT_TOPIC_PACKED, MQTT_TOPIC_PER_CHANNEL, MQTT_TOPIC_CBOR, MQTT_TOPIC_BINARY};
+  const char *layoutNames[4] = {"packed", "per_channel", "cbor", "binary"};
+  for(uint8_t layout = 0; layout < 4; layout++){
+    for(uint8_t qos = 0; qos < 2; qos++){
+      HostSocketClient client;
+      MqttPublisher publisher(client, "127.0.0.1", broker.Port(), "bench-plant", "plants/bench");
+      char name[32];
+      publisher.SetQoS(qos);
+      publisher.SetTopicLayout(layouts[layout]);
+      snprintf(name, sizeof(name), "mqtt_%s_qos%u", layoutNames[layout], (unsigned int)qos);
+      BenchTransport(name, publisher, client, 1);
+      BenchTransport(name, publisher, client, BULK_MAX_RECORDS);
+    }
+  }
+
+  BenchMqttRedelivery(broker, MQTT_TOPIC_PACKED, "packed", BENCH_REDELIVERY_DROP);
+  BenchMqttRedelivery(broker, MQTT_TOPIC_CBOR, "cbor", BENCH_REDELIVERY_BATCH_DROP);
+  broker.Stop();
+}
+
+/************************************
+BenchUpload() - Posts batches of records to the local stub over one keep-alive connection.
+*************************************/
+static void BenchUpload(HttpStub &stub, uint16_t records, uint32_t posts){
+
+  HostSocketClient client;
+  SampleStore store;
+  ThingSpeakUploader uploader(client, "127.0.0.1", stub.Port(), "/channels/0/bulk_update.json", "BENCHKEY0000000");
+
+  uint32_t requestsBefore = stub.Requests;
+  uint32_t failures = 0;
+  uint32_t sent = 0;
+  unsigned long timestamp = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for(uint32_t i = 0; i < posts; i++){
+    for(uint16_t r = 0; r < records; r++){
+      SensorSample sample = {timestamp, (uint16_t)(500 + r), (uint32_t)(260 + r), (int16_t)(7200 + r), 0};
+      timestamp += 60000;
+      store.Push(sample);
+    }
+
+    uint16_t batch = store.Count();
+    if(uploader.PostBulk(store, batch) == UPLOAD_OK){
+      store.Drop(batch);
+      sent += batch;
+    }
+    else{ failures++; }
+  }
+
+  double wallUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  uploader.Close();
+
+  char name[32];
+  snprintf(name, sizeof(name), "upload_bulk_%u", (unsigned int)records);
+  BenchCheck(failures == 0);
+  printf("{\"bench\":\"%s\",\"posts\":%u,\"failures\":%u,\"records_sent\":%u,\"connects\":%u,\"requests_seen\":%u,"
+         "\"writes_per_post\":%.3f,\"bytes_sent_per_post\":%.1f,\"bytes_received_per_post\":%.1f,"
+         "\"request_bytes\":%u,\"wall_us_per_post\":%.1f}\n",
+         name, posts, failures, sent, uploader.Connects(), (uint32_t)stub.Requests - requestsBefore,
+         (double)client.Stats.Writes / posts, (double)client.Stats.BytesSent / posts,
+         (double)client.Stats.BytesReceived / posts, uploader.LastRequestLength(), wallUs / posts);
+  fflush(stdout);
+}
+
+
+/************************************
+BenchLegacyWrite() - Print::print() of a C string: one write per call, as on the NINA module.
+*************************************/
+static void BenchLegacyWrite(HostSocketClient &client, const char *text){
+
+  client.write((const uint8_t *)text, strlen(text));
+}
+
+/************************************
+BenchLegacyPost() - The original sketch's mHttpRequest() and getResponse() with LegacyString in place
+of String: the form body and the API-key header built from String temporaries, the request written
+piece by piece and the response grown a character at a time. The client is already connected (the
+socket setup is not part of what the sketch allocated). The blank line after the headers is sent as
+CRLF CRLF instead of the original's bare "\n\n", so the stub sees the end of the request; the
+allocations are the same.
+return: true if a response arrived
+*************************************/
+static bool BenchLegacyPost(HostSocketClient &client, const LegacyString &writeAPIKey, uint16_t moistData,
+                            uint16_t lightData, uint16_t tempData){
+
+  //String data = "field1=" + String(moistData) + "&field2=" + String(lightData) + "&field3=" + String(tempData);
+  LegacyString sum("field1=");
+  sum += LegacyString(moistData);
+  sum += "&field2=";
+  sum += LegacyString(lightData);
+  sum += "&field3=";
+  sum += LegacyString(tempData);
+  LegacyString data(sum);
+
+  char length[12];
+  snprintf(length, sizeof(length), "%u", data.length());
+
+  BenchLegacyWrite(client, "POST /update HTTP/1.1\r\n");
+  BenchLegacyWrite(client, "Host: api.thingspeak.com\r\n");
+  BenchLegacyWrite(client, "Connection: close\r\n");
+  {
+    LegacyString header("X-THINGSPEAKAPIKEY: ");
+    header += writeAPIKey;
+    BenchLegacyWrite(client, header.c_str());
+    BenchLegacyWrite(client, "\r\n");
+  }
+  BenchLegacyWrite(client, "Content-Type: application/x-www-form-urlencoded\r\n");
+  BenchLegacyWrite(client, "Content-Length: ");
+  BenchLegacyWrite(client, length);
+  BenchLegacyWrite(client, "\r\n\r\n");
+  BenchLegacyWrite(client, data.c_str());
+
+  //getResponse()
+  LegacyString serverResponse;
+  unsigned long startTime = millis();
+  while(client.available() == 0 && (millis() - startTime) < BENCH_LEGACY_TIMEOUT_MS){ delay(5); }
+  while(client.available() > 0){ serverResponse += (char)client.read(); }
+
+  return serverResponse.length() > 0;
+}
+
+static void BenchHeapAdd(HeapStats &total, const HeapStats &post){
+
+  total.Allocations += post.Allocations;
+  total.Reallocations += post.Reallocations;
+  total.Frees += post.Frees;
+  total.BytesRequested += post.BytesRequested;
+  total.LiveBytes += post.LiveBytes;
+  if(post.PeakLiveBytes > total.PeakLiveBytes){ total.PeakLiveBytes = post.PeakLiveBytes; }
+}
+
+static void BenchHeapEmit(const char *path, uint16_t records, uint32_t posts, uint32_t failures, const HeapStats &total,
+                          const HostSocketClient &client){
+
+  BenchCheck(failures == 0 && total.LiveBytes == 0);
+  printf("{\"bench\":\"heap\",\"path\":\"%s\",\"records\":%u,\"posts\":%lu,\"failures\":%lu,\"allocations_per_post\":%.1f,"
+         "\"reallocations_per_post\":%.1f,\"frees_per_post\":%.1f,\"bytes_requested_per_post\":%.1f,\"peak_live_bytes\":%lld,"
+         "\"leaked_bytes\":%lld,\"writes_per_post\":%.1f}\n", path, (unsigned int)records, (unsigned long)posts,
+         (unsigned long)failures, (double)total.Allocations / posts, (double)total.Reallocations / posts,
+         (double)total.Frees / posts, (double)total.BytesRequested / posts, (long long)total.PeakLiveBytes,
+         (long long)total.LiveBytes, (double)client.Stats.Writes / posts);
+  fflush(stdout);
+}
+
+/************************************
+BenchHeap() - Heap calls per post, counted by HeapCounter: ThingSpeakUploader (fixed buffer, streaming
+response parser) against the original String-built request and String-grown response. Every heap call
+is a chance to fragment the SAMD21's 32 KB heap (newlib's allocator is not modeled here; the counts
+and the bytes still live afterwards are what it sees). Connection setup is left out of both counts.
+*************************************/
+static void BenchHeap(HttpStub &stub){
+
+  HeapStats total;
+  uint32_t failures = 0;
+  const uint16_t batches[2] = {1, BULK_MAX_RECORDS};
+
+  for(uint8_t b = 0; b < 2; b++){
+    HostSocketClient client;
+    SampleStore store;
+    ThingSpeakUploader uploader(client, "127.0.0.1", stub.Port(), "/channels/0/bulk_update.json", "BENCHKEY0000000");
+    unsigned long timestamp = 0;
+
+    memset(&total, 0, sizeof(total));
+    failures = 0;
+
+    for(uint32_t post = 0; post <= BENCH_UPLOAD_POSTS; post++){
+      for(uint16_t r = 0; r < batches[b]; r++){
+        SensorSample sample = {timestamp, (uint16_t)(500 + r), (uint32_t)(260 + r), (int16_t)(7200 + r), 0};
+        timestamp += 60000;
+        store.Push(sample);
+      }
+
+      //The first post opens the kept-alive connection and is not counted
+      uint16_t count = store.Count();
+      if(post > 0){
+        if(post == 1){ memset(&client.Stats, 0, sizeof(client.Stats)); }
+        HeapCountBegin();
+      }
+      uint8_t result = uploader.PostBulk(store, count);
+      if(post > 0){ BenchHeapAdd(total, HeapCountEnd()); }
+
+      if(result != UPLOAD_OK){ failures++; }
+      store.Drop(count);
+    }
+
+    uploader.Close();
+    BenchCheck(total.Allocations == 0 && total.Reallocations == 0);
+    BenchHeapEmit("uploader", batches[b], BENCH_UPLOAD_POSTS, failures, total, client);
+  }
+
+  HostSocketClient client;
+  LegacyString writeAPIKey("BENCHKEY0000000");
+
+  memset(&total, 0, sizeof(total));
+  failures = 0;
+
+  for(uint32_t post = 0; post < BENCH_UPLOAD_POSTS; post++){
+    if(!client.connect("127.0.0.1", stub.Port())){
+      failures++;
+      continue;
+    }
+    HeapCountBegin();
+    bool answered = BenchLegacyPost(client, writeAPIKey, 500 + post % 37, 260 + post % 91, 7200 + post % 53);
+    BenchHeapAdd(total, HeapCountEnd());
+    client.stop();
+    if(!answered){ failures++; }
+  }
+
+  BenchHeapEmit("string_legacy", 1, BENCH_UPLOAD_POSTS, failures, total, client);
+}
+
+
+int main(int argc, char **argv){
+
+  uint32_t calls = (argc > 1) ? strtoul(argv[1], 0, 10) : BENCH_DEFAULT_CALLS;
+  if(calls == 0){ calls = BENCH_DEFAULT_CALLS; }
+
+  SimBus &bus = HostSimBus();
+  bus.Sunlight.SetAmbient(300, 150);
+  bus.Temp.SetTemperature(22.5);
+  bus.SetAnalog(NA555_PIN, 0.55, 0.01);
+
+  MoistureSensor moisture(NA555_PIN);
+  SunlightSensor sunlight;
+  TempSensor temp;
+  SI1145Config lightConfig = SI1145_DEFAULT_CONFIG;
+  sunlight.SetHWKEY(0x17);
+  sunlight.ApplyConfig(lightConfig);
+
+  BenchMark mark;
+  uint16_t vis;
+  uint16_t ir;
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ temp.ReadTempValue(); }
+  BenchEmit("ReadTempValue", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ temp.ReadTemp(); }
+  BenchEmit("ReadTemp", calls, mark);
+  BenchTempDecode(temp);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ sunlight.ReadAmbVisData(); }
+  BenchEmit("ReadAmbVisData", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ sunlight.ReadALSData(vis, ir); }
+  BenchEmit("ReadALSData", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ sunlight.RAMQUERY(RAM_CHLIST); }
+  BenchEmit("RAMQUERY", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ sunlight.RAMGET(RAM_CHLIST); }
+  BenchEmit("RAMGET", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ sunlight.MeasureALS(vis, ir); }
+  BenchEmit("MeasureALS", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ moisture.readAndAve(); }
+  BenchEmit("readAndAve", calls, mark);
+
+  mark = BenchStart();
+  for(uint32_t i = 0; i < calls; i++){ sunlight.ApplyConfig(lightConfig); }
+  BenchEmit("ApplyConfig_unchanged", calls, mark);
+  BenchConfigVerify(sunlight);
+  BenchAlsError(moisture, sunlight, temp);
+
+  SampleScheduler sampler(moisture, sunlight, temp);
+  SampleStore store;
+  sampler.SetInterval(SCHED_DEFAULT_INTERVAL_MS);
+  BenchCycle(sampler, store, calls);
+  BenchFleet(BENCH_FLEET_CYCLES);
+  BenchMoistureResolution(false);
+  BenchMoistureResolution(true);
+  BenchReportPolicy(false);
+  BenchReportPolicy(true);
+  BenchPower(moisture, sunlight, temp, false);
+  BenchPower(moisture, sunlight, temp, true);
+  BenchTempResolution(moisture, sunlight, temp);
+  BenchTempAlert(moisture, sunlight, temp);
+  BenchAlsAuto(moisture, sunlight, temp);
+  BenchAlsRange(moisture, sunlight, temp);
+  BenchWiFiLink(moisture, sunlight, temp, false);
+  BenchWiFiLink(moisture, sunlight, temp, true);
+  BenchLogCapacity("samd21_internal", BENCH_LOG_SAMD_SIZE, SAMD_FLASH_PAGE_SIZE, SAMD_FLASH_ROW_SIZE, LOG_DEFAULT_MAX_AGE_MS, BENCH_LOG_IMAGE);
+  BenchLogCapacity("spi_nor", BENCH_LOG_NOR_SIZE, BENCH_LOG_NOR_PAGE, BENCH_LOG_NOR_SECTOR, LOG_DEFAULT_MAX_AGE_MS, 0);
+  BenchLogCapacity("spi_nor", BENCH_LOG_NOR_SIZE, BENCH_LOG_NOR_PAGE, BENCH_LOG_NOR_SECTOR, 4 * LOG_DEFAULT_MAX_AGE_MS, 0);
+  BenchLogPowerCut();
+  BenchLogFuzz();
+  BenchQueryServer();
+  BenchPayload();
+
+  HttpStub stub;
+  if(!stub.Start()){
+    printf("{\"bench\":\"upload\",\"error\":\"stub failed to start\"}\n");
+    return 1;
+  }
+
+  BenchUpload(stub, 1, BENCH_UPLOAD_POSTS);
+  BenchUpload(stub, BULK_MAX_RECORDS, BENCH_UPLOAD_POSTS);
+  BenchHeap(stub);
+  BenchTransports(stub);
+  stub.Stop();
+
+  return (benchFailures > 0) ? 1 : 0;
+}
+
+#endif
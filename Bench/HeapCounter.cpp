@@ -0,0 +1,103 @@
+/********************************************
+  HeapCounter.cc - malloc family replacement that counts calls for the bench.
+*********************************************/
+
+#include "HeapCounter.h"
+
+#ifndef ARDUINO
+
+#include <string.h>
+#include <malloc.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *block, size_t size);
+extern "C" void __libc_free(void *block);
+
+static __thread bool heapCounting = false;
+static __thread HeapStats heapStats;
+
+static void HeapAdd(void *block){
+
+  if(block == 0){ return; }
+
+  heapStats.LiveBytes += malloc_usable_size(block);
+  if(heapStats.LiveBytes > heapStats.PeakLiveBytes){ heapStats.PeakLiveBytes = heapStats.LiveBytes; }
+}
+
+static void HeapRemove(void *block){
+
+  if(block != 0){ heapStats.LiveBytes -= malloc_usable_size(block); }
+}
+
+/************************************
+HeapCountBegin() - Clears the counters and starts counting this thread's heap calls.
+*************************************/
+void HeapCountBegin(void){
+
+  memset(&heapStats, 0, sizeof(heapStats));
+  heapCounting = true;
+}
+
+/************************************
+HeapCountEnd() - Stops counting.
+return: the calls and bytes since HeapCountBegin()
+*************************************/
+HeapStats HeapCountEnd(void){
+
+  heapCounting = false;
+  return heapStats;
+}
+
+extern "C" void *malloc(size_t size){
+
+  void *block = __libc_malloc(size);
+
+  if(heapCounting){
+    heapStats.Allocations++;
+    heapStats.BytesRequested += size;
+    HeapAdd(block);
+  }
+
+  return block;
+}
+
+extern "C" void *calloc(size_t count, size_t size){
+
+  void *block = __libc_calloc(count, size);
+
+  if(heapCounting){
+    heapStats.Allocations++;
+    heapStats.BytesRequested += count * size;
+    HeapAdd(block);
+  }
+
+  return block;
+}
+
+extern "C" void *realloc(void *block, size_t size){
+
+  if(!heapCounting){ return __libc_realloc(block, size); }
+
+  if(block == 0){ heapStats.Allocations++; }
+  else{ heapStats.Reallocations++; }
+  heapStats.BytesRequested += size;
+  HeapRemove(block);
+
+  void *moved = __libc_realloc(block, size);
+  HeapAdd((moved != 0 || size == 0) ? moved : block);
+
+  return moved;
+}
+
+extern "C" void free(void *block){
+
+  if(heapCounting && block != 0){
+    heapStats.Frees++;
+    HeapRemove(block);
+  }
+
+  __libc_free(block);
+}
+
+#endif
@@ -0,0 +1,29 @@
+/********************************************
+  HeapCounter.h - Counts heap calls made by the code under test on a Linux host.
+  The bench program replaces malloc/calloc/realloc/free (forwarding to glibc's
+  __libc_ functions); only calls the current thread makes between HeapCountBegin()
+  and HeapCountEnd() are counted, so the stub servers' threads do not show up.
+*********************************************/
+
+#ifndef HeapCounter_h
+#define HeapCounter_h
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+
+struct HeapStats{
+  uint32_t Allocations;     // malloc and calloc
+  uint32_t Reallocations;   // realloc of an existing block (the grow-by-one pattern)
+  uint32_t Frees;
+  uint64_t BytesRequested;
+  int64_t LiveBytes;        // usable bytes allocated and not yet freed since HeapCountBegin()
+  int64_t PeakLiveBytes;
+};
+
+void HeapCountBegin(void);
+HeapStats HeapCountEnd(void);
+
+#endif
+
+#endif
@@ -0,0 +1,136 @@
+/********************************************
+  HttpStub.cc - Minimal keep-alive HTTP/1.1 server for host benchmarks.
+*********************************************/
+
+#include "HttpStub.h"
+
+#ifndef ARDUINO
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+static const char STUB_RESPONSE[] = "HTTP/1.1 202 Accepted\r\nContent-Type: application/json\r\n"
+                                    "Content-Length: 16\r\nConnection: keep-alive\r\n\r\n{\"success\":true}";
+
+HttpStub::HttpStub(void) : Requests(0), Connections(0), BodyBytes(0){
+  _listenFd = -1;
+  _port = 0;
+  _running = false;
+}
+
+HttpStub::~HttpStub(void){ Stop(); }
+
+/************************************
+Start() - Binds an ephemeral loopback port and starts serving.
+return: true if the server is listening
+*************************************/
+bool HttpStub::Start(void){
+
+  _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if(_listenFd < 0){ return false; }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  socklen_t length = sizeof(address);
+  if(bind(_listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(_listenFd, 4) != 0 ||
+     getsockname(_listenFd, (struct sockaddr *)&address, &length) != 0){
+    close(_listenFd);
+    _listenFd = -1;
+    return false;
+  }
+
+  _port = ntohs(address.sin_port);
+  _running = true;
+  _thread = std::thread(&HttpStub::Run, this);
+
+  return true;
+}
+
+void HttpStub::Stop(void){
+
+  if(!_running){ return; }
+
+  _running = false;
+  _thread.join();
+  close(_listenFd);
+  _listenFd = -1;
+}
+
+uint16_t HttpStub::Port(void){ return _port; }
+
+/************************************
+Run() - Accept loop; connections are served one at a time, like the uploader uses them.
+*************************************/
+void HttpStub::Run(void){
+
+  while(_running){
+    struct pollfd entry;
+    entry.fd = _listenFd;
+    entry.events = POLLIN;
+    if(poll(&entry, 1, 20) <= 0){ continue; }
+
+    int fd = accept(_listenFd, 0, 0);
+    if(fd < 0){ continue; }
+
+    Connections++;
+    Serve(fd);
+    close(fd);
+  }
+}
+
+/************************************
+Serve() - Reads requests (headers + Content-Length body) and answers each until the client closes.
+*************************************/
+void HttpStub::Serve(int fd){
+
+  char buffer[HTTP_STUB_BUFFER];
+  size_t length = 0;
+
+  while(_running){
+
+    //Consume every complete request already buffered
+    char *end = (char *)memmem(buffer, length, "\r\n\r\n", 4);
+    if(end != 0){
+      size_t headerLength = (end - buffer) + 4;
+      size_t bodyLength = 0;
+
+      for(char *line = buffer; line < end; line = strstr(line, "\r\n") + 2){
+        if(strncasecmp(line, "Content-Length:", 15) == 0){ bodyLength = strtoul(line + 15, 0, 10); }
+      }
+
+      if(headerLength + bodyLength > sizeof(buffer)){ return; }
+      if(length >= headerLength + bodyLength){
+        Requests++;
+        BodyBytes += bodyLength;
+        if(send(fd, STUB_RESPONSE, sizeof(STUB_RESPONSE) - 1, MSG_NOSIGNAL) <= 0){ return; }
+
+        length -= headerLength + bodyLength;
+        memmove(buffer, buffer + headerLength + bodyLength, length);
+        buffer[length] = '\0';
+        continue;
+      }
+    }
+
+    struct pollfd entry;
+    entry.fd = fd;
+    entry.events = POLLIN;
+    if(poll(&entry, 1, 20) <= 0){ continue; }
+
+    ssize_t result = recv(fd, buffer + length, sizeof(buffer) - 1 - length, 0);
+    if(result <= 0){ return; }
+    length += result;
+    buffer[length] = '\0';
+  }
+}
+
+#endif
@@ -0,0 +1,41 @@
+/********************************************
+  HttpStub.h - Minimal keep-alive HTTP/1.1 server for host benchmarks.
+  Runs on a background thread on 127.0.0.1, answers every request with
+  202 {"success":true} and counts what it received.
+*********************************************/
+
+#ifndef HttpStub_h
+#define HttpStub_h
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+
+#define HTTP_STUB_BUFFER 4096
+
+
+class HttpStub{
+  public:
+    HttpStub(void);
+    ~HttpStub(void);
+    bool Start(void);
+    void Stop(void);
+    uint16_t Port(void);
+    std::atomic<uint32_t> Requests;
+    std::atomic<uint32_t> Connections;
+    std::atomic<uint32_t> BodyBytes;
+
+  private:
+    void Run(void);
+    void Serve(int fd);
+    int _listenFd;
+    uint16_t _port;
+    std::atomic<bool> _running;
+    std::thread _thread;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+/********************************************
+  LegacyString.cc - Arduino String allocation pattern on the host.
+*********************************************/
+
+#include "LegacyString.h"
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+LegacyString::LegacyString(const char *text){
+  _buffer = 0;
+  _capacity = 0;
+  _length = 0;
+  Concat(text, strlen(text));
+}
+
+//Like String(unsigned int): formats into a stack buffer, then copies (one allocation)
+LegacyString::LegacyString(unsigned int value){
+  char digits[12];
+  _buffer = 0;
+  _capacity = 0;
+  _length = 0;
+  snprintf(digits, sizeof(digits), "%u", value);
+  Concat(digits, strlen(digits));
+}
+
+LegacyString::LegacyString(const LegacyString &other){
+  _buffer = 0;
+  _capacity = 0;
+  _length = 0;
+  Concat(other._buffer, other._length);
+}
+
+LegacyString::~LegacyString(void){ free(_buffer); }
+
+LegacyString &LegacyString::operator+=(const LegacyString &other){
+
+  Concat(other._buffer, other._length);
+  return *this;
+}
+
+LegacyString &LegacyString::operator+=(const char *text){
+
+  Concat(text, strlen(text));
+  return *this;
+}
+
+LegacyString &LegacyString::operator+=(char c){
+
+  Concat(&c, 1);
+  return *this;
+}
+
+unsigned int LegacyString::length(void) const{ return _length; }
+
+const char *LegacyString::c_str(void) const{ return (_buffer != 0) ? _buffer : ""; }
+
+/************************************
+Reserve() - WString::reserve(): keeps the buffer if it is big enough, otherwise reallocates it to
+exactly size + 1 bytes (no growth margin).
+*************************************/
+bool LegacyString::Reserve(unsigned int size){
+
+  if(_buffer != 0 && _capacity >= size){ return true; }
+
+  char *grown = (char *)realloc(_buffer, size + 1);
+  if(grown == 0){ return false; }
+
+  _buffer = grown;
+  _capacity = size;
+  if(_length == 0){ _buffer[0] = 0; }
+
+  return true;
+}
+
+void LegacyString::Concat(const char *text, unsigned int length){
+
+  if(!Reserve(_length + length)){ return; }
+
+  memcpy(&_buffer[_length], text, length);
+  _length += length;
+  _buffer[_length] = 0;
+
+  return;
+}
+
+#endif
@@ -0,0 +1,39 @@
+/********************************************
+  LegacyString.h - Host copy of the heap behaviour of the Arduino String class
+  (WString.cpp), for measuring the original upload code: every construction
+  allocates, and every concatenation that grows the string reallocates to exactly
+  the new length (reserve() -> changeBuffer() -> realloc(len + 1)).
+*********************************************/
+
+#ifndef LegacyString_h
+#define LegacyString_h
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+
+
+class LegacyString{
+  public:
+    LegacyString(const char *text = "");
+    LegacyString(unsigned int value);
+    LegacyString(const LegacyString &other);
+    ~LegacyString(void);
+    LegacyString &operator+=(const LegacyString &other);
+    LegacyString &operator+=(const char *text);
+    LegacyString &operator+=(char c);
+    unsigned int length(void) const;
+    const char *c_str(void) const;
+
+  private:
+    LegacyString &operator=(const LegacyString &other);
+    bool Reserve(unsigned int size);
+    void Concat(const char *text, unsigned int length);
+    char *_buffer;
+    unsigned int _capacity;
+    unsigned int _length;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/********************************************
+  MqttStub.cc - Minimal MQTT 3.1.1 broker stand-in for host benchmarks.
+*********************************************/
+
+#include "MqttStub.h"
+
+#ifndef ARDUINO
+
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+MqttStub::MqttStub(void) : Connections(0), SessionsResumed(0), Publishes(0), Duplicates(0), Pings(0), ProtocolErrors(0){
+  _listenFd = -1;
+  _port = 0;
+  _running = false;
+  _dropAfter = 0;
+}
+
+MqttStub::~MqttStub(void){ Stop(); }
+
+/************************************
+Start() - Binds an ephemeral loopback port and starts serving.
+return: true if the broker is listening
+*************************************/
+bool MqttStub::Start(void){
+
+  _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if(_listenFd < 0){ return false; }
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  socklen_t length = sizeof(address);
+  if(bind(_listenFd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(_listenFd, 4) != 0 ||
+     getsockname(_listenFd, (struct sockaddr *)&address, &length) != 0){
+    close(_listenFd);
+    _listenFd = -1;
+    return false;
+  }
+
+  _port = ntohs(address.sin_port);
+  _running = true;
+  _thread = std::thread(&MqttStub::Run, this);
+
+  return true;
+}
+
+void MqttStub::Stop(void){
+
+  if(!_running){ return; }
+
+  _running = false;
+  _thread.join();
+  close(_listenFd);
+  _listenFd = -1;
+}
+
+uint16_t MqttStub::Port(void){ return _port; }
+
+/************************************
+DropAfter() - Closes the connection, unacknowledged, when this many more PUBLISHes have arrived.
+*************************************/
+void MqttStub::DropAfter(uint32_t publishes){ _dropAfter = publishes; }
+
+/************************************
+UniqueMessages() - Distinct topic + payload pairs received (redelivered duplicates count once).
+*************************************/
+uint32_t MqttStub::UniqueMessages(void){
+
+  std::lock_guard<std::mutex> guard(_lock);
+  return _messages.size();
+}
+
+/************************************
+Payloads() - Distinct payloads received on one topic.
+*************************************/
+std::vector<std::string> MqttStub::Payloads(const std::string &topic){
+
+  std::lock_guard<std::mutex> guard(_lock);
+  std::vector<std::string> payloads;
+  std::string prefix = topic + '\n';
+
+  for(std::set<std::string>::const_iterator it = _messages.begin(); it != _messages.end(); ++it){
+    if(it->compare(0, prefix.size(), prefix) == 0){ payloads.push_back(it->substr(prefix.size())); }
+  }
+
+  return payloads;
+}
+
+/************************************
+Run() - Accept loop; connections are served one at a time, like the publisher uses them.
+*************************************/
+void MqttStub::Run(void){
+
+  while(_running){
+    struct pollfd entry;
+    entry.fd = _listenFd;
+    entry.events = POLLIN;
+    if(poll(&entry, 1, 20) <= 0){ continue; }
+
+    int fd = accept(_listenFd, 0, 0);
+    if(fd < 0){ continue; }
+
+    Connections++;
+    Serve(fd);
+    close(fd);
+  }
+}
+
+/************************************
+Serve() - Decodes control packets (fixed header, Remaining Length, body) and answers each until the
+client disconnects. A malformed packet counts as a protocol error and closes the connection.
+*************************************/
+void MqttStub::Serve(int fd){
+
+  uint8_t buffer[MQTT_STUB_BUFFER];
+  size_t length = 0;
+  bool connected = false;
+
+  while(_running){
+
+    //Consume every complete packet already buffered
+    size_t header = 1;
+    uint32_t remaining = 0;
+    bool complete = false;
+    for(uint8_t shift = 0; header < length && shift < 28; shift += 7){
+      uint8_t byte = buffer[header++];
+      remaining |= (uint32_t)(byte & 0x7F) << shift;
+      if((byte & 0x80) == 0){ complete = length >= header + remaining; break; }
+    }
+
+    if(length > 0 && header + remaining > sizeof(buffer)){ ProtocolErrors++; return; }
+
+    if(complete){
+      uint8_t type = buffer[0] & 0xF0;
+      const uint8_t *body = &buffer[header];
+
+      if(type == 0x10){
+        //CONNECT: "MQTT", level 4, flags, keep alive, client id
+        if(remaining < 12 || memcmp(body, "\x00\x04MQTT\x04", 7) != 0){ ProtocolErrors++; return; }
+        bool clean = (body[7] & 0x02) != 0;
+        uint16_t idLength = (body[10] << 8) | body[11];
+        if((uint32_t)(12 + idLength) > remaining){ ProtocolErrors++; return; }
+        std::string id((const char *)&body[12], idLength);
+        bool present = false;
+        {
+          std::lock_guard<std::mutex> guard(_lock);
+          if(clean){ _sessions.erase(id); }
+          else{
+            present = _sessions.count(id) > 0;
+            _sessions.insert(id);
+          }
+        }
+        if(present){ SessionsResumed++; }
+        uint8_t connack[4] = {0x20, 0x02, (uint8_t)(present ? 1 : 0), 0x00};
+        if(send(fd, connack, sizeof(connack), MSG_NOSIGNAL) <= 0){ return; }
+        connected = true;
+      }
+      else if(!connected){ ProtocolErrors++; return; }
+      else if(type == 0x30){
+        uint8_t qos = (buffer[0] >> 1) & 0x03;
+        uint16_t topicLength = (body[0] << 8) | body[1];
+        uint32_t offset = 2 + topicLength + ((qos > 0) ? 2 : 0);
+        if(remaining < 2 || offset > remaining || qos > 1){ ProtocolErrors++; return; }
+
+        Publishes++;
+        if(buffer[0] & 0x08){ Duplicates++; }
+        {
+          std::lock_guard<std::mutex> guard(_lock);
+          _messages.insert(std::string((const char *)&body[2], topicLength) + '\n' +
+                           std::string((const char *)&body[offset], remaining - offset));
+        }
+
+        if(_dropAfter > 0 && --_dropAfter == 0){ return; }
+
+        if(qos == 1){
+          uint8_t puback[4] = {0x40, 0x02, body[2 + topicLength], body[3 + topicLength]};
+          if(send(fd, puback, sizeof(puback), MSG_NOSIGNAL) <= 0){ return; }
+        }
+      }
+      else if(type == 0xC0){
+        Pings++;
+        uint8_t pingresp[2] = {0xD0, 0x00};
+        if(send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL) <= 0){ return; }
+      }
+      else if(type == 0xE0){ return; }
+      else{ ProtocolErrors++; return; }
+
+      length -= header + remaining;
+      memmove(buffer, buffer + header + remaining, length);
+      continue;
+    }
+
+    struct pollfd entry;
+    entry.fd = fd;
+    entry.events = POLLIN;
+    if(poll(&entry, 1, 20) <= 0){ continue; }
+
+    ssize_t result = recv(fd, buffer + length, sizeof(buffer) - length, 0);
+    if(result <= 0){ return; }
+    length += result;
+  }
+}
+
+#endif
@@ -0,0 +1,57 @@
+/********************************************
+  MqttStub.h - Minimal MQTT 3.1.1 broker stand-in for host benchmarks.
+  Runs on a background thread on 127.0.0.1, serving one connection at a time:
+  answers CONNECT (keeping persistent sessions by client id), PUBLISH at QoS 0/1,
+  PINGREQ and DISCONNECT, and counts what it received. DropAfter() closes the
+  connection without acknowledging, to exercise QoS 1 redelivery.
+*********************************************/
+
+#ifndef MqttStub_h
+#define MqttStub_h
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MQTT_STUB_BUFFER 4096
+
+
+class MqttStub{
+  public:
+    MqttStub(void);
+    ~MqttStub(void);
+    bool Start(void);
+    void Stop(void);
+    uint16_t Port(void);
+    void DropAfter(uint32_t publishes);
+    uint32_t UniqueMessages(void);
+    std::vector<std::string> Payloads(const std::string &topic);
+    std::atomic<uint32_t> Connections;
+    std::atomic<uint32_t> SessionsResumed;
+    std::atomic<uint32_t> Publishes;
+    std::atomic<uint32_t> Duplicates;
+    std::atomic<uint32_t> Pings;
+    std::atomic<uint32_t> ProtocolErrors;
+
+  private:
+    void Run(void);
+    void Serve(int fd);
+    int _listenFd;
+    uint16_t _port;
+    std::atomic<bool> _running;
+    std::atomic<uint32_t> _dropAfter;
+    std::thread _thread;
+    std::mutex _lock;
+    std::set<std::string> _sessions;
+    std::set<std::string> _messages;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,172 @@
+/********************************************
+  HostNet.cc - POSIX socket implementation of the host Client stand-in.
+  available() waits up to HOSTNET_WAIT_MS of real time when no data is buffered,
+  so millis()-based wait loops in the network code still span real network time.
+*********************************************/
+
+#include "HostNet.h"
+
+#ifndef ARDUINO
+
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+HostSocketClient::HostSocketClient(void){
+  _fd = -1;
+  _peerClosed = false;
+  _rxLength = 0;
+  _rxIndex = 0;
+  memset(&Stats, 0, sizeof(Stats));
+}
+
+HostSocketClient::~HostSocketClient(void){ stop(); }
+
+/************************************
+connect() - Opens a TCP connection (Nagle disabled, like the NINA module's small-segment behaviour).
+Inputs: host -> name or address; port -> TCP port
+return: 1 on success, 0 on failure
+*************************************/
+int HostSocketClient::connect(const char *host, uint16_t port){
+
+  stop();
+
+  char portText[8];
+  snprintf(portText, sizeof(portText), "%u", (unsigned int)port);
+
+  struct addrinfo hints;
+  struct addrinfo *result = 0;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  if(getaddrinfo(host, portText, &hints, &result) != 0){ return 0; }
+
+  for(struct addrinfo *entry = result; entry != 0; entry = entry->ai_next){
+    _fd = socket(entry->ai_family, entry->ai_socktype, entry->ai_protocol);
+    if(_fd < 0){ continue; }
+    if(::connect(_fd, entry->ai_addr, entry->ai_addrlen) == 0){ break; }
+    close(_fd);
+    _fd = -1;
+  }
+  freeaddrinfo(result);
+
+  if(_fd < 0){ return 0; }
+
+  int noDelay = 1;
+  setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+  _peerClosed = false;
+  _rxLength = 0;
+  _rxIndex = 0;
+  Stats.Connects++;
+
+  return 1;
+}
+
+/************************************
+Attach() - Takes over a connected socket, e.g. one accepted by HostListener (closed by stop()).
+Inputs: fd -> connected TCP socket
+return: none
+*************************************/
+void HostSocketClient::Attach(int fd){
+
+  stop();
+
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+  _fd = fd;
+  Stats.Connects++;
+}
+
+/************************************
+write() - Sends the whole buffer.
+return: bytes sent (less than size if the connection failed)
+*************************************/
+size_t HostSocketClient::write(const uint8_t *buf, size_t size){
+
+  if(_fd < 0){ return 0; }
+
+  size_t sent = 0;
+  while(sent < size){
+    ssize_t result = send(_fd, buf + sent, size - sent, MSG_NOSIGNAL);
+    if(result <= 0){ _peerClosed = true; break; }
+    sent += result;
+  }
+
+  Stats.Writes++;
+  Stats.BytesSent += sent;
+
+  return sent;
+}
+
+/************************************
+Fill() - Pulls pending socket data into the receive buffer, waiting up to waitMs for it to arrive.
+*************************************/
+void HostSocketClient::Fill(int waitMs){
+
+  if(_fd < 0 || _peerClosed || _rxIndex < _rxLength){ return; }
+
+  struct pollfd entry;
+  entry.fd = _fd;
+  entry.events = POLLIN;
+  if(poll(&entry, 1, waitMs) <= 0){ return; }
+
+  ssize_t result = recv(_fd, _rx, sizeof(_rx), MSG_DONTWAIT);
+  if(result == 0){ _peerClosed = true; return; }
+  if(result < 0){ return; }
+
+  _rxLength = result;
+  _rxIndex = 0;
+  Stats.BytesReceived += result;
+}
+
+int HostSocketClient::available(void){
+
+  Fill(HOSTNET_WAIT_MS);
+  return _rxLength - _rxIndex;
+}
+
+int HostSocketClient::read(void){
+
+  Fill(0);
+  if(_rxIndex >= _rxLength){ return -1; }
+
+  return _rx[_rxIndex++];
+}
+
+int HostSocketClient::read(uint8_t *buf, size_t size){
+
+  Fill(0);
+
+  int count = 0;
+  while(count < (int)size && _rxIndex < _rxLength){ buf[count++] = _rx[_rxIndex++]; }
+
+  return (count > 0) ? count : -1;
+}
+
+void HostSocketClient::stop(void){
+
+  if(_fd >= 0){ close(_fd); }
+  _fd = -1;
+  _peerClosed = false;
+  _rxLength = 0;
+  _rxIndex = 0;
+}
+
+/************************************
+connected() - True while the socket is open and either the peer has not closed or data is still buffered.
+*************************************/
+uint8_t HostSocketClient::connected(void){
+
+  if(_fd < 0){ return 0; }
+
+  Fill(0);
+  return (!_peerClosed || _rxIndex < _rxLength) ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,64 @@
+/********************************************
+  HostNet.h - Stand-in for the Arduino Client class on a Linux host, backed by
+  POSIX TCP sockets, so the network code can be exercised against local servers.
+  Only the subset of the Client API the PlantMantra libraries use is provided.
+*********************************************/
+
+#ifndef HostNet_h
+#define HostNet_h
+
+#ifndef ARDUINO
+
+#include "HostPlatform.h"
+
+/******** Host Socket Settings ********/
+#define HOSTNET_RX_BUFFER 512
+#define HOSTNET_WAIT_MS 1
+
+
+class Client{
+  public:
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual size_t write(const uint8_t *buf, size_t size) = 0;
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int read(uint8_t *buf, size_t size) = 0;
+    virtual void stop(void) = 0;
+    virtual uint8_t connected(void) = 0;
+};
+
+
+struct HostNetStats{
+  uint32_t Connects;
+  uint32_t Writes;
+  uint32_t BytesSent;
+  uint32_t BytesReceived;
+};
+
+
+class HostSocketClient : public Client{
+  public:
+    HostSocketClient(void);
+    ~HostSocketClient(void);
+    int connect(const char *host, uint16_t port);
+    size_t write(const uint8_t *buf, size_t size);
+    int available(void);
+    int read(void);
+    int read(uint8_t *buf, size_t size);
+    void stop(void);
+    uint8_t connected(void);
+    void Attach(int fd);
+    HostNetStats Stats;
+
+  private:
+    void Fill(int waitMs);
+    int _fd;
+    bool _peerClosed;
+    uint8_t _rx[HOSTNET_RX_BUFFER];
+    int _rxLength;
+    int _rxIndex;
+};
+
+#endif
+
+#endif
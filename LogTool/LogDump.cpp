@@ -0,0 +1,82 @@
+/********************************************
+  LogDump.cc - Decodes a SampleLog flash image on a Linux host.
+  Reads an image file (a dump of the log area, or one written by FileFlash) and
+  prints every sample, oldest first, as CSV:
+
+  boot,seconds,moisture,light_lux,temperature_centi,flags
+
+  followed by a summary line on stderr. Build with the host command line in
+  README.md (Sample log section).
+  Usage: logdump image.bin [page_size erase_size]   (default: SAMD21 64 / 256)
+*********************************************/
+
+#ifndef ARDUINO
+
+#include <stdlib.h>
+
+#include "SampleLog.h"
+
+int main(int argc, char **argv){
+
+  //The page and erase sizes come as a pair: one without the other is a mistake, not a default
+  if(argc != 2 && argc != 4){
+    fprintf(stderr, "usage: %s image.bin [page_size erase_size]\n", argv[0]);
+    return 2;
+  }
+
+  uint16_t pageSize = (argc == 4) ? (uint16_t)strtoul(argv[2], 0, 10) : SAMD_FLASH_PAGE_SIZE;
+  uint32_t eraseSize = (argc == 4) ? strtoul(argv[3], 0, 10) : SAMD_FLASH_ROW_SIZE;
+
+  FILE *image = fopen(argv[1], "rb");
+  if(image == 0){
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  fseek(image, 0, SEEK_END);
+  long size = ftell(image);
+  fclose(image);
+
+  if(size <= 0 || eraseSize == 0){
+    fprintf(stderr, "%s: empty image\n", argv[0]);
+    return 1;
+  }
+
+  //Round down to whole erase units; the flash is opened read-only in effect (nothing is appended)
+  FileFlash flash((uint32_t)size - (uint32_t)size % eraseSize, pageSize, eraseSize);
+  if(!flash.Open(argv[1], false)){
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[1]);
+    return 1;
+  }
+
+  SampleLog log(flash);
+  if(log.Begin() != LOG_OK){
+    fprintf(stderr, "%s: page size %u / erase size %lu do not fit a sample log\n", argv[0],
+            (unsigned int)pageSize, (unsigned long)eraseSize);
+    return 1;
+  }
+
+  LogEntry entry;
+  uint32_t samples = 0;
+  uint32_t blocks = 0;
+  uint32_t lastSequence = 0;
+
+  printf("boot,seconds,moisture,light_lux,temperature_centi,flags\n");
+
+  log.Rewind();
+  while(log.Next(entry)){
+    if(samples == 0 || entry.Sequence != lastSequence){ blocks++; }
+    lastSequence = entry.Sequence;
+    samples++;
+    printf("%u,%lu,%u,%lu,%d,%u\n", (unsigned int)entry.Boot, (unsigned long)(entry.Sample.Timestamp / 1000),
+           (unsigned int)entry.Sample.Moisture, (unsigned long)entry.Sample.Light,
+           (int)entry.Sample.Temperature, (unsigned int)entry.Sample.Flags);
+  }
+
+  fprintf(stderr, "%lu bytes, %lu pages: %lu blocks, %lu samples, next boot %u, next sequence %lu\n",
+          (unsigned long)flash.Size(), (unsigned long)log.PageCount(), (unsigned long)blocks,
+          (unsigned long)samples, (unsigned int)log.Boot(), (unsigned long)log.Sequence());
+
+  return 0;
+}
+
+#endif
@@ -1,3 +1,4 @@
 #define SECRET_SSID "YOURNETWORKID"
 #define SECRET_PASS "YOURNETWORKPW"
 #define SECRET_KEY "YOURTHINGSPEAKKEY"
+#define SECRET_CHANNEL "YOURTHINGSPEAKCHANNELID"
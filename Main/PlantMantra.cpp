@@ -14,15 +14,28 @@ Written by Sierra Catelani - March 29, 2020
 #include "MoistureSensor.h"
 #include "TempSensor.h"
 #include "SunlightSensor.h"
-#include "NetworkCodes.h" 
-
-//************* DEFINITIONS HERE **************//
-#define TIMEOUT  5000  // Timeout for server response.
+#include "AlsAutoCollector.h"
+#include "AlsAutoRange.h"
+#include "SampleScheduler.h"
+#include "SampleStore.h"
+#include "SensorStats.h"
+#include "ReportPolicy.h"
+#include "PowerManager.h"
+#include "ThingSpeakUploader.h"
+#include "MqttPublisher.h"
+#include "WiFiLink.h"
+#include "SampleLog.h"
+#include "QueryServer.h"
+#include "PasscodeInfo.h"
 
 //******** SETUP LOCAL NETWORK DETAILS ********//
 char ssid[] = SECRET_SSID;        // your network SSID (name)
 char pass[] = SECRET_PASS;    // your network password (use for WPA, or use as key for WEP)
-int status = WL_IDLE_STATUS;     // the Wifi radio's status
+
+//The link is brought up only while an upload is due; a failed attempt turns the radio off for a
+//growing, jittered backoff window instead of retrying in a blocking loop
+NinaRadio wifiRadio;
+WiFiLink wifiLink(wifiRadio, ssid, pass);
 
 //*********** SETUP CLIENT + SERVER ***********//
 
@@ -32,7 +45,22 @@ WiFiClient sensorClient;
 
 //Setup ThinkSpeak Server
 char ThingSpeakServer[] = "api.thingspeak.com";
-String writeAPIKey = SECRET_KEY;
+char ThingSpeakBulkPath[] = "/channels/" SECRET_CHANNEL "/bulk_update.json";
+
+//Uploads reuse one kept-alive connection to ThingSpeak
+ThingSpeakUploader uploader(sensorClient, ThingSpeakServer, 80, ThingSpeakBulkPath, SECRET_KEY);
+
+//MQTT instead of the ThingSpeak bulk update (useMqtt): batches of samples in compact CBOR PUBLISHes to a
+//local broker, QoS 1 with a persistent session so nothing is lost when the connection drops mid-batch
+bool useMqtt = false;
+WiFiClient mqttClient;
+char MqttBroker[] = "mqtt.local";
+char MqttClientId[] = "plantmantra-" SECRET_CHANNEL;
+char MqttTopic[] = "plants/" SECRET_CHANNEL;
+MqttPublisher mqtt(mqttClient, MqttBroker, MQTT_DEFAULT_PORT, MqttClientId, MqttTopic);
+
+//Samples leave through one transport: ThingSpeak HTTP by default
+SampleTransport *transport = &uploader;
 
 
 //******** SET UP SENSOR INSTANCES  ************//
@@ -42,14 +70,65 @@ MoistureSensor sensorNA555(NA555_PIN);
 SunlightSensor sensorSI1145;
 TempSensor sensorMCP9808;
 
-uint8_t hwKey = 0x17;
+//Autonomous light mode: the SI1145 measures every lightAutoPeriod ms by itself and its INT handler
+//queues the readings; each sample's light value is their mean. Off: one forced measurement per sample.
+#define ALS_INT_PIN 3
+bool lightAutoMode = false;
+uint16_t lightAutoPeriod = 100;
+AlsAutoCollector lightCollector(sensorSI1145, ALS_INT_PIN);
+//Forced mode only: the gain follows the light (gain 7 in a dim room, high range in direct sun)
+AlsAutoRange lightRange(sensorSI1145);
+
+//Sampling runs as a non-blocking state machine driven from loop()
+SampleScheduler sampler(sensorNA555, sensorSI1145, sensorMCP9808);
+SensorSample latestSample;
+
+//Samples wait here until they are uploaded, so nothing is lost while the link is down
+SampleStore sampleStore;
+
+//Running statistics since the last upload, sent along with the samples (fields 4-8 + status)
+SampleSummary sampleSummary;
+char summaryFields[SUMMARY_FIELDS_MAX];
+
+//Every sample (reported or not) is also kept in a wear-leveled log in a 64 KB row-aligned area of flash; read it back
+//with LogTool. The array is part of the sketch image, placed by the linker with the other constants (not at a fixed
+//address), so every firmware upload reprograms it to zeros and the log starts over - dump it before reflashing.
+__attribute__((__aligned__(SAMD_FLASH_ROW_SIZE))) const uint8_t sampleLogArea[65536] = {};
+SamdFlash sampleLogFlash(sampleLogArea, sizeof(sampleLogArea));
+SampleLog sampleLog(sampleLogFlash);
+
+//Local query endpoint: controllers on the LAN GET /latest, /stats and /history?since=ms without the cloud.
+//While it is on, the link stays up and the MCU wakes every QUERY_POLL_MS to answer (costs radio current)
+bool queryServerEnabled = false;
+NinaListener queryListener(QUERY_DEFAULT_PORT);
+QueryServer queryServer(queryListener, &sampleLog);
+
+//Report by exception: only samples that move past a deadband (or the hourly heartbeat) are uploaded
+ReportPolicy reportPolicy;
+
+//Low-power mode: sensors shut down, radio off and the MCU in standby between cycles
+PowerManager power;
+bool lowPowerMode = true;
+uint8_t tempResolution = TEMP_RES_0_0625C;   // 0.0625 C, 250 ms per reading; TEMP_RES_0_5C takes 30 ms
+char powerReport[POWER_REPORT_MAX];
+
+//Temperature alarm: the MCP9808 compares every conversion against these limits (centi-degrees, TEMP_UNIT)
+//and pulls its Alert pin low on a crossing, which wakes the MCU for an immediate upload
+#define TEMP_ALERT_PIN 2
+int16_t tempAlertLower = 5000;      // 50.00 F
+int16_t tempAlertUpper = 9500;      // 95.00 F
+int16_t tempAlertCritical = 10400;  // 104.00 F
+volatile bool temperatureAlert = false;
 
 uint16_t moistureData;
-uint16_t visLightData;
-uint16_t temperatureData;
+uint32_t visLightData;      // lux
+int16_t temperatureData;    // centi-degrees (TEMP_UNIT, F by default)
 
 unsigned long dataLogDelta = 60000;
-unsigned long previousDataLog = 600000;
+unsigned long uploadMinDelta = 300000;    // reported samples are batched for at least 5 minutes between posts
+unsigned long uploadRetryDelta = 15000;   // ThingSpeak free-tier minimum update spacing
+unsigned long nextUpload = 0;
+unsigned long nextPowerReport = 86400000;  // energy budget is reported (/stats) and restarted once a day
 
 /**************** SETUP FUNCTION - CONNECT TO WIFI ******************/
 void setup() {
@@ -57,22 +136,50 @@ void setup() {
   Wire.begin();
 
   //SETUP SENSOR HARDWARE
-  sensorSI1145.SetHWKEY(0x17);
-  sensorSI1145.SetMeasRate(0x00,0x00);
-
-  sensorSI1145.EnProximatySensors(0);
-  sensorSI1145.EnALSSensors(1);
-  sensorSI1145.EnUVSensor(0);
-
-  //CONNECT TO WIFI
-  
-  // check for the WiFi module - system will hang if WiFi module not found.
-  while (WiFi.status() == WL_NO_MODULE) {
-    // don't continue
+  //Forced mode, ALS (visible + IR) on, proximity/UV/AUX off - applied in one pass, each RAM write
+  //read back. A sensor that does not take it is reset and configured once more; if that fails too,
+  //samples are still taken but flagged SAMPLE_FLAG_ALS_CONFIG.
+  SI1145Config lightConfig = SI1145_DEFAULT_CONFIG;
+  uint8_t lightStatus = sensorSI1145.ApplyConfig(lightConfig);
+  if(lightStatus != PARAM_OK){
+    sensorSI1145.SWResetCMD();
+    delay(SI1145_RESET_MS);
+    lightStatus = sensorSI1145.ApplyConfig(lightConfig);
   }
-  
-  //Connect device to LAN Network
-  wifiNetworkConnect();
+  sampler.SetLightFault(lightStatus != PARAM_OK);
+
+  if(lightAutoMode && lightCollector.Begin(lightAutoPeriod, lightISR) == PARAM_OK){
+    sampler.SetLightSource(&lightCollector);
+  }
+  else if(lightRange.Begin() == PARAM_OK){
+    sampler.SetLightRange(&lightRange);
+  }
+
+  sensorMCP9808.SetResolution(tempResolution);
+  sampler.SetInterval(dataLogDelta);
+  sampler.SetLowPower(lowPowerMode);
+  power.Begin();
+  sampleLog.Begin();
+  queryServer.SetPowerReport(powerReport);
+
+  //Alert in interrupt mode: one wake per crossing (into or out of the window) until cleared.
+  //The sensor keeps converting between cycles so it can compare, which costs a little sleep current.
+  sensorMCP9808.SetAlertLimits(tempAlertLower, tempAlertUpper, tempAlertCritical);
+  delay(sensorMCP9808.ConversionMillis());
+  sensorMCP9808.EnableAlert(TEMP_ALERT_INTERRUPT);
+  sampler.SetTempContinuous(true);
+  power.SetCurrent(POWER_PHASE_SLEEP, POWER_SLEEP_UA + POWER_MCP9808_CONVERTING_UA);
+  power.WakeOnPin(TEMP_ALERT_PIN, temperatureAlertISR);
+
+  if(useMqtt){
+    mqtt.SetQoS(1);
+    mqtt.SetTopicLayout(MQTT_TOPIC_CBOR);
+    transport = &mqtt;
+  }
+
+  //CONNECT TO WIFI - on the first upload; a missing module or access point only delays uploads.
+  //A7 is not connected: its noise seeds the retry jitter.
+  wifiLink.Begin(((uint32_t)analogRead(A7) << 16) ^ micros());
 
 }
 
@@ -81,35 +188,18 @@ void setup() {
 /**************** COLLECT DATA AND SEND TO THINGSPEAK CLOUD ******************/
 void loop() {
 
+  power.Enter(POWER_PHASE_SAMPLE);
 
-  //Wait for 5 minutes to pass between datalogs
-  if(millis() - previousDataLog > dataLogDelta){
+  //Advance the sample cycle (arm ALS -> wait for completion -> read sensors); never blocks
+  lightCollector.Service();
+  sampler.Service();
 
-      //Reset datalog timestamp
-      previousDataLog = millis();
+  //Every sample feeds the summary; only reported ones are stored for upload
+  if(sampler.TakeSample(latestSample)){
 
-      //reconnect to LAN network if connection was lost
-      if(WiFi.status != WL_CONNECTED){
-        wifiNetworkConnect();
-      } 
-
-      //Check that finicky sunlight sensor is ready to run a measurement
-      hwKey = sensorSI1145.RegRead(REG_HW_KEY);
-  
-      while(hwKey != 0x17){
-        //Serial.print("\nSI1143 not ready!\n");
-        delay(1000);
-      }
-
-      //Force sunlight sensor measurement
-      sensorSI1145.MeasureALSCMD();
-      delay(5000);
-
-
-      //Sample all sensors
-      moistureData = sensorNA555.readAndAve();
-      visLightData = sensorSI1145.ReadAmbVisData();
-      temperatureData = sensorMCP9808.ReadTempValue();
+      moistureData = latestSample.Moisture;
+      visLightData = latestSample.Light;
+      temperatureData = latestSample.Temperature;
 
       //Post sensor readings to Serial Monitor
       /*
@@ -118,91 +208,117 @@ void loop() {
       Serial.println("Temperature Reading = " + String(temperatureData));
       Serial.println();
       */
-      
-      //Send HTTP Command to post data from sensors to ThingSpeak Cloud database
-      if(!mHttpRequest(moistureData,visLightData,temperatureData)){
-        //Serial.print("Error: Could not connect to ThingSpeakServer!");
-      }   
-   }
-}
 
+      sampleSummary.Add(latestSample);
+      sampleLog.Append(latestSample);
+      queryServer.Record(latestSample);
+      if(reportPolicy.Evaluate(latestSample) != REPORT_NONE){
+        sampleStore.Push(latestSample);
+      }
+   }
 
-/***************************  WIFI FUNCTIONS **********************************/
-/**************** *************************************************************/
+  //Temperature crossed an alert limit: report it out of band and upload right away
+  if(temperatureAlert){
+
+      temperatureAlert = false;
+
+      SensorSample alertSample = latestSample;
+      lightCollector.Hold();
+      alertSample.Temperature = sensorMCP9808.ReadTemp();
+      alertSample.Timestamp = power.Millis();
+      alertSample.Flags |= SAMPLE_FLAG_TEMP_ALERT;
+      temperatureData = alertSample.Temperature;
+      sensorMCP9808.ClearAlert();
+      lightCollector.Release();
+
+      sampleLog.Append(alertSample);
+      queryServer.Record(alertSample);
+      reportPolicy.Force();
+      reportPolicy.Evaluate(alertSample);
+      sampleStore.Push(alertSample);
+      nextUpload = power.Millis();
+   }
 
-// This function runs the WiFi connect sequence to connect IOT device to local network.
-// Note: program will hang if device does not connect.
-// returns:  none
-void wifiNetworkConnect(void){
-  
-    // attempt to connect to Wifi network:
-    while (status != WL_CONNECTED) {
-      //Connect to WPA/WPA2 network:
-      status = WiFi.begin(ssid, pass);
-  
-      //wait 10 seconds for connection:
-      delay(10000);
+  //Drain reported samples in bulk, at most every uploadMinDelta; failed or partial uploads retry after uploadRetryDelta.
+  //The link is requested while an upload is due and connects in the background (sampling carries on)
+  bool uploadDue = sampleStore.Count() > 0 && (long)(power.Millis() - nextUpload) >= 0;
+  if(uploadDue || queryServerEnabled){ wifiLink.Request(); }
+  wifiLink.Service();
+  if(queryServerEnabled){ queryServer.Service(wifiLink.Connected()); }
+  if(wifiLink.Connected()){ transport->Service(); }
+
+  if(uploadDue && wifiLink.Connected()){
+
+      power.Enter(POWER_PHASE_RADIO);
+      nextUpload = power.Millis() + uploadRetryDelta;
+
+      uint16_t batch = sampleStore.Count();
+      if(batch > BULK_MAX_RECORDS){ batch = BULK_MAX_RECORDS; }
+
+      //Post stored data through the transport; what was not delivered stays in the store for the retry.
+      //Publish sets batch to the samples delivered (ThingSpeak: all or none, trimmed to its request buffer)
+      sampleSummary.FormatFields(summaryFields, sizeof(summaryFields), reportPolicy.Suppressed());
+      uint8_t result = transport->Publish(sampleStore, batch, summaryFields);
+      sampleStore.Drop(batch);
+      if(result == UPLOAD_OK){
+        sampleSummary.Reset();
+        reportPolicy.ResetSuppressed();
+        if(sampleStore.Count() == 0){ nextUpload = power.Millis() + uploadMinDelta; }
       }
-      
-    return;
-}
+      else{
+        //Serial.print("Error: Could not post to ThingSpeakServer!");
+      }
+   }
 
+  //Keep the day's time and charge per phase (sleep/idle/sample/radio) for /stats and start a new budget
+  if((long)(power.Millis() - nextPowerReport) >= 0){
+      power.FormatReport(powerReport, sizeof(powerReport));
+      power.ResetBudget();
+      nextPowerReport += 86400000;
+   }
 
-// This function writes an Http message to the Server to write data to the ThingSpeak cloud database.
-// returns:  1 on success, -1 on fail.
-int mHttpRequest(uint16_t moistData, uint16_t lightData, uint16_t tempData){
-
-    // Create data string to send to ThingSpeak.
-    String data = "field1=" + String(moistData) + "&field2=" + String(lightData) + "&field3=" + String(tempData);
-    
-    // POST data to ThingSpeak.
-    if (sensorClient.connect(ThingSpeakServer, 80)) {
-        
-        sensorClient.println("POST /update HTTP/1.1");
-        sensorClient.println("Host: api.thingspeak.com");
-        sensorClient.println("Connection: close");
-        sensorClient.println("X-THINGSPEAKAPIKEY: "+writeAPIKey);
-        sensorClient.println("Content-Type: application/x-www-form-urlencoded");
-        sensorClient.print("Content-Length: ");
-        sensorClient.print(data.length());
-        sensorClient.print("\n\n");
-        sensorClient.print(data);     
-        delay(200);
-        
-        getResponse();
-    
-        return 1;
+  //Sleep until the next sampling step, upload or link step is due; the radio is off unless an upload is waiting on it
+  if(lowPowerMode){
+      unsigned long idle = sampler.MillisUntilNextStep();
+      long untilUpload = (long)(nextUpload - power.Millis());
+      if(sampleStore.Count() > 0){
+        unsigned long wait = (untilUpload > 0) ? (unsigned long)untilUpload : wifiLink.MillisUntilNextStep();
+        if(wait < idle){ idle = wait; }
       }
-  else{return -1;}
-
+      if(queryServerEnabled && idle > QUERY_POLL_MS){ idle = QUERY_POLL_MS; }
+
+      if(idle > 0){
+        if(sampleStore.Count() == 0 || untilUpload > 0){
+          transport->Close();
+          if(!queryServerEnabled){ wifiLink.Release(); }
+        }
+        unsigned long slept = power.Sleep(idle);
+        sampler.ClockSkipped(slept);
+        wifiLink.ClockSkipped(slept);
+      }
+   }
 }
 
-// This function waits for the server to respond, and then builds a string with response message
-// Returns: Response string
-String getResponse(){
-  
-  String serverResponse;
-  unsigned long startTime = millis();
 
-  //Wait for server to indicate availability
-  while (sensorClient.available() == 0 && ((millis() - startTime) < TIMEOUT)){
-        delay(5);
-  }
+/***************************  INTERRUPT HANDLERS *****************************/
+/**************** *************************************************************/
 
-  //Create message string from chars received by server.
-  if(sensorClient.available() > 0){
-     char serverChar;
-     // Read chars from buffer and build a string
-     while (sensorClient.available() > 0){
-         serverChar = sensorClient.read();
-         serverResponse += serverChar;        
-         }
-    }
+// Runs on the falling edge of the MCP9808 Alert pin (also from standby); the I2C work is done in loop().
+// returns:  none
+void temperatureAlertISR(void){
 
-  //close session with Server.
-  sensorClient.stop();
+    temperatureAlert = true;
+    PowerManager::Wake();
 
-  return response;
+    return;
 }
 
-  
\ No newline at end of file
+
+// Runs when the SI1145 pulls INT low with a new autonomous reading; queues it for the sampler.
+// returns:  none
+void lightISR(void){
+
+    lightCollector.HandleInterrupt();
+
+    return;
+}
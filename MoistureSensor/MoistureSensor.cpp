@@ -4,15 +4,17 @@
 *********************************************/
 
 
-#include <Arduino.h>
 #include "MoistureSensor.h"
 
 
 //MoistureSensor.MoistureSensor -> Initializes instance of MoistureSensor Class
 //and sets up the pin that will be used in this MoistureSensor instance.
-//Inputs: Pin to be used for sensor input.
-MoistureSensor::MoistureSensor(uint8_t pin){
+//Inputs: Pin to be used for sensor input; bus providing the analog input (defaults to the system bus).
+MoistureSensor::MoistureSensor(uint8_t pin, SensorBus &bus){
 	_pin = pin;
+	_bus = &bus;
+	_bits = MOISTURE_DEFAULT_BITS;
+	_spacingUs = MOISTURE_DEFAULT_SPACING_US;
 }
 
 //MoistureSensor.readRaw() Function will read the raw data of the Moisture Sensor.
@@ -20,17 +22,58 @@ MoistureSensor::MoistureSensor(uint8_t pin){
 //Return: Raw Sensor Data (between 0  - 1023)
 uint16_t MoistureSensor::readRaw(){
 
-  return analogRead(_pin);
+  return _bus->AnalogRead(_pin);
 }
 
-//MoistureSensor.readAndAve() will read 10 samples raw data of the Moisture Sensor and average them.
+//MoistureSensor.readAndAve() reads the oversampled moisture level and scales it back to 10 bits.
 //Inputs: None
 //Return: Averaged sensor data (between 0  - 1023)
 uint16_t MoistureSensor::readAndAve(){
 
-  uint16_t runningSum = 0;
-  for(int i=0; i<10; i++){ runningSum += readRaw(); }
+  uint8_t shift = _bits - MOISTURE_NATIVE_BITS;
+  uint32_t value = readOversampled();
 
-  return runningSum/10;
-  
-}
\ No newline at end of file
+  //Round rather than truncate when dropping the extra bits
+  if(shift > 0){ value = (value + (1UL << (shift - 1))) >> shift; }
+  if(value > 1023){ value = 1023; }
+
+  return value;
+}
+
+//MoistureSensor.setResolution() selects how many bits readOversampled() returns.
+//Inputs: bits -> 10 - 16; spacingUs -> gap between software samples, so they see independent noise
+//Return: None
+void MoistureSensor::setResolution(uint8_t bits, uint16_t spacingUs){
+
+  if(bits < MOISTURE_NATIVE_BITS){ bits = MOISTURE_NATIVE_BITS; }
+  if(bits > MOISTURE_MAX_BITS){ bits = MOISTURE_MAX_BITS; }
+
+  _bits = bits;
+  _spacingUs = spacingUs;
+}
+
+uint8_t MoistureSensor::resolutionBits(){ return _bits; }
+
+//MoistureSensor.readOversampled() reads the moisture level with resolutionBits() bits.
+//Uses the bus's hardware averaging when it has one (SAMD21 ADC accumulator); otherwise takes
+//4^n spaced analogRead() samples into a 32-bit sum and decimates it by n bits.
+//Inputs: None
+//Return: Sensor data (between 0 and 2^resolutionBits() - 1)
+uint16_t MoistureSensor::readOversampled(){
+
+  uint16_t value;
+  if(_bus->AnalogReadHighRes(_pin, _bits, value)){ return value; }
+
+  uint8_t extra = _bits - MOISTURE_NATIVE_BITS;
+  uint16_t samples = 1 << (2 * extra);
+  uint32_t sum = 0;
+
+  for(uint16_t i = 0; i < samples; i++){
+    if(i > 0 && _spacingUs > 0){ delayMicroseconds(_spacingUs); }
+    sum += readRaw();
+  }
+
+  if(extra > 0){ sum += 1UL << (extra - 1); }
+
+  return sum >> extra;
+}
@@ -6,23 +6,37 @@
 #ifndef MoistureSensor_h
 #define MoistureSensor_h
 
-#include <Arduino.h>
+#include "SensorBus.h"
 
 
 #define NA555_PIN A1
 
+/******** Oversampling ********/
+//Each bit beyond the 10-bit analogRead() takes 4x the samples (oversampling + decimation).
+//The gain is real only while the signal carries about 1 LSB or more of noise to dither it.
+#define MOISTURE_NATIVE_BITS ANALOG_NATIVE_BITS
+#define MOISTURE_MAX_BITS ANALOG_MAX_BITS
+#define MOISTURE_DEFAULT_BITS 12
+#define MOISTURE_DEFAULT_SPACING_US 250
+
 class MoistureSensor
 {
 	public:
-		MoistureSensor(uint8_t pin);
+		MoistureSensor(uint8_t pin, SensorBus &bus = SystemBus());
 		uint16_t readRaw(void);
 		uint16_t readAndAve(void);
+		void setResolution(uint8_t bits, uint16_t spacingUs = MOISTURE_DEFAULT_SPACING_US);
+		uint8_t resolutionBits(void);
+		uint16_t readOversampled(void);
 
 	private:
 		int _pin;
+		SensorBus *_bus;
+		uint8_t _bits;
+		uint16_t _spacingUs;
 
 };
 
 
 
-#endif
\ No newline at end of file
+#endif
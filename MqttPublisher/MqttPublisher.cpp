@@ -0,0 +1,490 @@
+/********************************************
+  MqttPublisher.cc - MQTT 3.1.1 publisher with a persistent session and QoS 0/1.
+*********************************************/
+
+#include "MqttPublisher.h"
+
+/************************************
+EncodeLength() - MQTT Remaining Length: 7 bits per byte, low bits first (one byte up to 127).
+return: bytes written (1 or 2 for packets that fit the buffer)
+*************************************/
+static uint8_t EncodeLength(uint8_t *out, uint16_t length){
+
+  uint8_t n = 0;
+
+  do{
+    uint8_t byte = length % 128;
+    length /= 128;
+    if(length > 0){ byte |= 0x80; }
+    out[n++] = byte;
+  }while(length > 0);
+
+  return n;
+}
+
+/************************************
+PutString() - MQTT UTF-8 string: 16-bit big-endian length, then the bytes.
+*************************************/
+static uint16_t PutString(uint8_t *out, const char *text, uint16_t length){
+
+  out[0] = (uint8_t)(length >> 8);
+  out[1] = (uint8_t)length;
+  memcpy(&out[2], text, length);
+
+  return length + 2;
+}
+
+
+//MqttPublisher.MqttPublisher -> Publishes to a broker at QoS 0 in the packed layout until changed.
+//Inputs: client -> network client (WiFiClient or HostSocketClient); host/port -> broker;
+//        clientId -> unique per node (the broker keys the persistent session on it); topic -> topic or prefix
+MqttPublisher::MqttPublisher(Client &client, const char *host, uint16_t port, const char *clientId, const char *topic){
+  _client = &client;
+  _host = host;
+  _port = port;
+  _clientId = clientId;
+  _topic = topic;
+  _user = 0;
+  _pass = 0;
+  _qos = 0;
+  _layout = MQTT_TOPIC_PACKED;
+  _connects = 0;
+  _sessionPresent = false;
+  _returnCode = 0;
+  _lastSent = 0;
+  _nextId = 1;
+  _retryId = 1;
+  _retryPackets = 0;
+  _length = 0;
+  _rxLength = 0;
+  _rxIndex = 0;
+}
+
+/************************************
+SetCredentials() - User name and password sent in CONNECT (0 for none).
+*************************************/
+void MqttPublisher::SetCredentials(const char *user, const char *pass){
+
+  _user = user;
+  _pass = pass;
+
+  return;
+}
+
+/************************************
+SetQoS() - 0: fire and forget (a sample counts as delivered once written); 1: delivered when PUBACKed.
+*************************************/
+void MqttPublisher::SetQoS(uint8_t qos){
+
+  _qos = (qos > 0) ? 1 : 0;
+
+  return;
+}
+
+/************************************
+SetTopicLayout() - MQTT_TOPIC_PACKED (one PUBLISH per sample), MQTT_TOPIC_PER_CHANNEL (three), or
+MQTT_TOPIC_CBOR / MQTT_TOPIC_BINARY (up to MQTT_BATCH_RECORDS samples per PUBLISH, SamplePayload.h).
+*************************************/
+void MqttPublisher::SetTopicLayout(uint8_t layout){
+
+  _layout = layout;
+
+  return;
+}
+
+/************************************
+Publish() - Publishes the oldest stored samples, connecting first if needed. A kept-alive
+connection the broker has dropped is detected by the failed exchange and the samples are sent
+once more on a new one.
+Inputs: store -> sample store; count -> samples to send, set to the number delivered;
+        extraFields -> optional ,"name":value,... (a SampleSummary), published at QoS 0 to <topic>/summary
+return: UPLOAD_OK if all were delivered, otherwise an UPLOAD_ERR_ code
+*************************************/
+uint8_t MqttPublisher::Publish(SampleStore &store, uint16_t &count, const char *extraFields){
+
+  uint16_t requested = count;
+  bool reused = _client->connected();
+
+  if(!reused){
+    uint8_t result = Connect();
+    if(result != UPLOAD_OK){ count = 0; return result; }
+  }
+
+  uint8_t result = Send(store, count, extraFields);
+
+  if(reused && count == 0 && (result == UPLOAD_ERR_SEND || result == UPLOAD_ERR_TIMEOUT)){
+    count = requested;
+    result = Connect();
+    if(result != UPLOAD_OK){ count = 0; return result; }
+    result = Send(store, count, extraFields);
+  }
+
+  return result;
+}
+
+/************************************
+Connect() - Opens the connection and sends CONNECT with the clean session flag off, then waits for
+CONNACK. If the broker has no session for this client, unacknowledged PUBLISHes are sent as new ones.
+return: UPLOAD_OK, UPLOAD_ERR_CONNECT/SEND/TIMEOUT/PROTOCOL, or UPLOAD_ERR_STATUS if refused (LastReturnCode())
+*************************************/
+uint8_t MqttPublisher::Connect(void){
+
+  _client->stop();
+  _rxLength = 0;
+  _rxIndex = 0;
+  if(!_client->connect(_host, _port)){ return UPLOAD_ERR_CONNECT; }
+  _connects++;
+
+  uint16_t idLength = strlen(_clientId);
+  uint16_t userLength = (_user != 0) ? strlen(_user) : 0;
+  uint16_t passLength = (_pass != 0) ? strlen(_pass) : 0;
+  uint16_t remaining = 10 + 2 + idLength + ((_user != 0) ? 2 + userLength : 0) + ((_pass != 0) ? 2 + passLength : 0);
+  if(remaining + 3 > MQTT_BUFFER_SIZE){ _client->stop(); return UPLOAD_ERR_TOO_LARGE; }
+
+  uint8_t flags = 0;
+  if(_user != 0){ flags |= MQTT_CONNECT_USER; }
+  if(_pass != 0){ flags |= MQTT_CONNECT_PASS; }
+
+  _length = 0;
+  _buffer[_length++] = MQTT_CONNECT;
+  _length += EncodeLength(&_buffer[_length], remaining);
+  _length += PutString(&_buffer[_length], "MQTT", 4);
+  _buffer[_length++] = MQTT_PROTOCOL_LEVEL;
+  _buffer[_length++] = flags;
+  _buffer[_length++] = (uint8_t)(MQTT_KEEPALIVE_S >> 8);
+  _buffer[_length++] = (uint8_t)MQTT_KEEPALIVE_S;
+  _length += PutString(&_buffer[_length], _clientId, idLength);
+  if(_user != 0){ _length += PutString(&_buffer[_length], _user, userLength); }
+  if(_pass != 0){ _length += PutString(&_buffer[_length], _pass, passLength); }
+
+  if(!Flush()){ return UPLOAD_ERR_SEND; }
+
+  uint8_t body[2];
+  uint8_t length;
+  int type = ReadPacket(body, sizeof(body), length);
+  if(type < 0){ _client->stop(); return UPLOAD_ERR_TIMEOUT; }
+  if(type != MQTT_CONNACK || length != 2){ _client->stop(); return UPLOAD_ERR_PROTOCOL; }
+
+  _returnCode = body[1];
+  if(_returnCode != 0){ _client->stop(); return UPLOAD_ERR_STATUS; }
+
+  _sessionPresent = (body[0] & 0x01) != 0;
+  if(!_sessionPresent){ _retryPackets = 0; }
+
+  return UPLOAD_OK;
+}
+
+/************************************
+Send() - Builds the PUBLISHes for the samples, writes them a buffer at a time and, at QoS 1, waits
+for their PUBACKs. Packets left unacknowledged by an earlier call go first, with their identifiers
+and the DUP flag; the batched layouts group the samples the same way again, so a resent identifier
+carries the same records.
+Inputs: store, count, extraFields -> as Publish()
+return: UPLOAD_OK or an UPLOAD_ERR_ code; count is set to the samples delivered
+*************************************/
+uint8_t MqttPublisher::Send(SampleStore &store, uint16_t &count, const char *extraFields){
+
+  static const char *suffixes[3] = {"/moisture", "/light", "/temperature"};
+  bool batched = _layout == MQTT_TOPIC_CBOR || _layout == MQTT_TOPIC_BINARY;
+  uint8_t perSample = (_layout == MQTT_TOPIC_PER_CHANNEL) ? 3 : 1;
+  bool retrying = _qos > 0 && _retryPackets > 0;
+  uint16_t firstId = retrying ? _retryId : _nextId;
+  uint16_t id = firstId;
+  uint16_t packets = 0;
+  uint16_t flushed = 0;
+  uint16_t next = 0;
+  uint8_t channel = 0;
+  uint8_t payload[MQTT_BATCH_PAYLOAD_MAX];
+  char *text = (char *)payload;
+  PayloadEncoder encoder((_layout == MQTT_TOPIC_BINARY) ? PAYLOAD_PACKED : PAYLOAD_CBOR);
+
+  _length = 0;
+
+  //One PUBLISH per pass; _packetSamples[] records the samples each one completes
+  while(next < count && packets + ((channel == 0) ? perSample : 1) <= MQTT_MAX_PACKETS){
+
+    SensorSample sample;
+    if(!store.Peek(next, sample)){ break; }
+
+    uint8_t samples = 1;
+    int length;
+    const char *suffix = "";
+
+    if(batched){
+      encoder.Begin(payload, sizeof(payload));
+      encoder.Add(sample);
+      while(encoder.Count() < MQTT_BATCH_RECORDS && next + encoder.Count() < count &&
+            store.Peek(next + encoder.Count(), sample) && encoder.Add(sample)){}
+      samples = encoder.Count();
+      length = encoder.Finish();
+    }
+    else if(perSample == 1){
+      length = snprintf(text, MQTT_PAYLOAD_MAX, "t=%lu&m=%u&l=%lu&c=%d", (unsigned long)sample.Timestamp,
+                        (unsigned int)sample.Moisture, (unsigned long)sample.Light, (int)sample.Temperature);
+      if(sample.Flags != 0){ length += snprintf(&text[length], MQTT_PAYLOAD_MAX - length, "&f=%u", (unsigned int)sample.Flags); }
+    }
+    else{
+      if(channel == 0){ length = snprintf(text, MQTT_PAYLOAD_MAX, "%u", (unsigned int)sample.Moisture); }
+      else if(channel == 1){ length = snprintf(text, MQTT_PAYLOAD_MAX, "%lu", (unsigned long)sample.Light); }
+      else{
+        int temperature = sample.Temperature;
+        const char *sign = (temperature < 0) ? "-" : "";
+        if(temperature < 0){ temperature = -temperature; }
+        length = snprintf(text, MQTT_PAYLOAD_MAX, "%s%d.%02d", sign, temperature / 100, temperature % 100);
+      }
+      suffix = suffixes[channel];
+      channel = (channel + 1) % perSample;
+      samples = (channel == 0) ? 1 : 0;
+    }
+
+    bool dup = retrying && packets < _retryPackets;
+
+    if(!AddPublish(_topic, suffix, payload, length, _qos, dup, id)){
+      if(!Flush()){ break; }
+      flushed = packets;
+      if(!AddPublish(_topic, suffix, payload, length, _qos, dup, id)){
+        _client->stop();
+        count = 0;
+        return UPLOAD_ERR_TOO_LARGE;
+      }
+    }
+
+    _packetSamples[packets++] = samples;
+    next += samples;
+    if(_qos > 0){ id = NextId(id); }
+
+    if(!_client->connected()){ break; }
+  }
+
+  //The window summary is informational: QoS 0, and skipped if it does not fit
+  uint16_t extra = (extraFields != 0 && extraFields[0] == ',') ? strlen(extraFields) : 0;
+  if(extra > 0 && _client->connected() && extra + 1 <= MQTT_BUFFER_SIZE - MQTT_TOPIC_MAX){
+    uint8_t summary[MQTT_BUFFER_SIZE - MQTT_TOPIC_MAX];
+    summary[0] = '{';
+    memcpy(&summary[1], &extraFields[1], extra - 1);
+    summary[extra] = '}';
+    if(!AddPublish(_topic, "/summary", summary, extra + 1, 0, false, 0)){
+      if(Flush()){ AddPublish(_topic, "/summary", summary, extra + 1, 0, false, 0); }
+    }
+  }
+
+  bool written = _client->connected() && Flush();
+  if(written){ flushed = packets; }
+
+  if(!retrying || packets >= _retryPackets){ _nextId = id; }
+
+  count = 0;
+
+  if(_qos == 0){
+    for(uint16_t i = 0; i < flushed; i++){ count += _packetSamples[i]; }
+    return written ? UPLOAD_OK : UPLOAD_ERR_SEND;
+  }
+
+  uint16_t acked = 0;
+  uint8_t result = written ? AwaitAcks(firstId, packets, acked) : UPLOAD_ERR_SEND;
+
+  //Resend from the packet after the last one that completed a sample
+  uint16_t done = 0;
+  for(uint16_t i = 0; i < acked; i++){
+    count += _packetSamples[i];
+    if(_packetSamples[i] > 0){ done = i + 1; }
+  }
+  _retryId = firstId;
+  for(uint16_t i = 0; i < done; i++){ _retryId = NextId(_retryId); }
+  _retryPackets = packets - done;
+
+  return result;
+}
+
+/************************************
+AwaitAcks() - Reads PUBACKs, which a 3.1.1 broker sends in the order of the PUBLISHes.
+Inputs: firstId -> identifier of the first packet; packets -> packets sent; acked -> set to the PUBACKs received
+return: UPLOAD_OK, UPLOAD_ERR_TIMEOUT or UPLOAD_ERR_PROTOCOL (an identifier out of order)
+*************************************/
+uint8_t MqttPublisher::AwaitAcks(uint16_t firstId, uint16_t packets, uint16_t &acked){
+
+  uint16_t expected = firstId;
+  uint8_t body[2];
+  uint8_t length;
+
+  while(acked < packets){
+
+    int type = ReadPacket(body, sizeof(body), length);
+    if(type < 0){ _client->stop(); return UPLOAD_ERR_TIMEOUT; }
+    if((type & 0xF0) != MQTT_PUBACK){ continue; }
+
+    uint16_t id = ((uint16_t)body[0] << 8) | body[1];
+    if(length != 2 || id != expected){ _client->stop(); return UPLOAD_ERR_PROTOCOL; }
+
+    acked++;
+    expected = NextId(expected);
+  }
+
+  return UPLOAD_OK;
+}
+
+/************************************
+AddPublish() - Appends one PUBLISH to the packet buffer.
+Inputs: topic + suffix -> topic name; payload/payloadLength -> message; qos, dup, id -> QoS 0/1, DUP flag, packet identifier
+return: false if it does not fit in what is left of the buffer
+*************************************/
+bool MqttPublisher::AddPublish(const char *topic, const char *suffix, const uint8_t *payload, uint16_t payloadLength,
+                               uint8_t qos, bool dup, uint16_t id){
+
+  uint16_t topicLength = strlen(topic);
+  uint16_t suffixLength = strlen(suffix);
+  uint16_t remaining = 2 + topicLength + suffixLength + ((qos > 0) ? 2 : 0) + payloadLength;
+  uint16_t total = 1 + ((remaining < 128) ? 1 : 2) + remaining;
+
+  if(_length + total > MQTT_BUFFER_SIZE){ return false; }
+
+  uint8_t *out = &_buffer[_length];
+  uint16_t n = 0;
+
+  out[n++] = MQTT_PUBLISH | (dup ? MQTT_PUBLISH_DUP : 0) | (qos << 1);
+  n += EncodeLength(&out[n], remaining);
+  out[n++] = (uint8_t)((topicLength + suffixLength) >> 8);
+  out[n++] = (uint8_t)(topicLength + suffixLength);
+  memcpy(&out[n], topic, topicLength);
+  n += topicLength;
+  memcpy(&out[n], suffix, suffixLength);
+  n += suffixLength;
+  if(qos > 0){
+    out[n++] = (uint8_t)(id >> 8);
+    out[n++] = (uint8_t)id;
+  }
+  memcpy(&out[n], payload, payloadLength);
+  n += payloadLength;
+
+  _length += n;
+
+  return true;
+}
+
+/************************************
+Flush() - Writes the packet buffer in one write.
+return: false if the write failed (the connection is closed)
+*************************************/
+bool MqttPublisher::Flush(void){
+
+  if(_length == 0){ return true; }
+
+  bool sent = _client->write(_buffer, _length) == _length;
+  _length = 0;
+  _lastSent = millis();
+
+  if(!sent){ _client->stop(); }
+
+  return sent;
+}
+
+/************************************
+ReadPacket() - Reads one control packet; body bytes beyond size are read and dropped.
+Inputs: body/size -> variable header + payload; length -> set to the bytes kept
+return: the first byte (type and flags), or -1 on timeout or a closed connection
+*************************************/
+int MqttPublisher::ReadPacket(uint8_t *body, uint8_t size, uint8_t &length){
+
+  unsigned long deadline = millis() + MQTT_RESPONSE_TIMEOUT_MS;
+  int type = ReadByte(deadline);
+  if(type < 0){ return -1; }
+
+  uint32_t remaining = 0;
+  for(uint8_t shift = 0; shift < 28; shift += 7){
+    int byte = ReadByte(deadline);
+    if(byte < 0){ return -1; }
+    remaining |= (uint32_t)(byte & 0x7F) << shift;
+    if((byte & 0x80) == 0){ break; }
+  }
+
+  length = 0;
+  for(uint32_t i = 0; i < remaining; i++){
+    int byte = ReadByte(deadline);
+    if(byte < 0){ return -1; }
+    if(length < size){ body[length++] = (uint8_t)byte; }
+  }
+
+  return type;
+}
+
+/************************************
+ReadByte() - Next received byte, read from the client MQTT_READ_CHUNK bytes at a time.
+return: the byte, or -1 at the deadline or when the connection closed
+*************************************/
+int MqttPublisher::ReadByte(unsigned long deadline){
+
+  while(_rxIndex >= _rxLength){
+
+    if((long)(millis() - deadline) >= 0){ return -1; }
+
+    if(_client->available() == 0){
+      if(!_client->connected()){ return -1; }
+      delay(1);
+      continue;
+    }
+
+    int count = _client->read(_rx, sizeof(_rx));
+    if(count <= 0){ continue; }
+    _rxLength = count;
+    _rxIndex = 0;
+  }
+
+  return _rx[_rxIndex++];
+}
+
+/************************************
+NextId() - Packet identifiers run 1 - 65535 (0 is not allowed).
+*************************************/
+uint16_t MqttPublisher::NextId(uint16_t id){ return (id == 0xFFFF) ? 1 : id + 1; }
+
+/************************************
+Service() - Sends PINGREQ on a connection idle for most of the keep alive, so the broker does not
+drop it between uploads while the link is up.
+*************************************/
+void MqttPublisher::Service(void){
+
+  if(!_client->connected() || (unsigned long)(millis() - _lastSent) < MQTT_KEEPALIVE_S * 750UL){ return; }
+
+  _length = 0;
+  _buffer[_length++] = MQTT_PINGREQ;
+  _buffer[_length++] = 0;
+  if(!Flush()){ return; }
+
+  uint8_t length;
+  int type = ReadPacket(0, 0, length);
+  if(type != MQTT_PINGRESP){ _client->stop(); }
+
+  return;
+}
+
+/************************************
+Close() - Sends DISCONNECT and closes the connection (e.g. before the radio is turned off); the
+broker keeps the session.
+*************************************/
+void MqttPublisher::Close(void){
+
+  if(_client->connected()){
+    _length = 0;
+    _buffer[_length++] = MQTT_DISCONNECT;
+    _buffer[_length++] = 0;
+    Flush();
+  }
+  _client->stop();
+
+  return;
+}
+
+/************************************
+Connects() - Number of TCP connections opened.
+*************************************/
+uint32_t MqttPublisher::Connects(void){ return _connects; }
+
+/************************************
+SessionPresent() - The broker still had this client's session at the last CONNECT.
+*************************************/
+bool MqttPublisher::SessionPresent(void){ return _sessionPresent; }
+
+/************************************
+LastReturnCode() - CONNACK return code of the last CONNECT (0 = accepted).
+*************************************/
+uint8_t MqttPublisher::LastReturnCode(void){ return _returnCode; }
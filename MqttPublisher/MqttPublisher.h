@@ -0,0 +1,114 @@
+/********************************************
+  MqttPublisher.h - MQTT 3.1.1 uplink for stored samples (SampleTransport).
+  Connects with a persistent session (clean session off), so a broker keeps the
+  client's state across reconnects and radio-off periods, and publishes the
+  samples at QoS 0 or 1 in one of four layouts:
+    packed       <topic>              t=<ms since boot>&m=<moisture>&l=<lux>&c=<centi-degrees>[&f=<flags>]
+    per channel  <topic>/moisture     <moisture>
+                 <topic>/light        <lux>
+                 <topic>/temperature  <degrees with two decimals>
+    CBOR         <topic>              up to MQTT_BATCH_RECORDS samples, SamplePayload CBOR
+    binary       <topic>              up to MQTT_BATCH_RECORDS samples, SamplePayload packed
+  Packets are built in one fixed buffer; as many as fit go out in one write.
+  QoS 1 PUBLISHes are acknowledged in order, so the samples delivered are the
+  ones before the first missing PUBACK; the rest are resent with their packet
+  identifiers and the DUP flag after a reconnect (MQTT 3.1.1, 4.4).
+*********************************************/
+
+#ifndef MqttPublisher_h
+#define MqttPublisher_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Client.h>
+#else
+#include "HostNet.h"
+#endif
+
+#include "SampleStore.h"
+#include "SampleTransport.h"
+#include "SamplePayload.h"
+
+/******** MQTT Control Packets ********/
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+#define MQTT_PUBLISH_DUP 0x08
+#define MQTT_CONNECT_USER 0x80
+#define MQTT_CONNECT_PASS 0x40
+#define MQTT_PROTOCOL_LEVEL 4
+
+/******** Topic Layouts ********/
+#define MQTT_TOPIC_PACKED 0
+#define MQTT_TOPIC_PER_CHANNEL 1
+#define MQTT_TOPIC_CBOR 2
+#define MQTT_TOPIC_BINARY 3
+
+/******** Publisher Settings ********/
+#define MQTT_DEFAULT_PORT 1883
+//Holds a CONNECT, or several PUBLISHes (a SampleSummary one on its own)
+#define MQTT_BUFFER_SIZE 320
+#define MQTT_TOPIC_MAX 64
+#define MQTT_PAYLOAD_MAX 48
+//Samples per PUBLISH in the batched layouts, sized so any CBOR batch fits the buffer
+#define MQTT_BATCH_RECORDS 12
+#define MQTT_BATCH_PAYLOAD_MAX (PAYLOAD_CBOR_HEADER_MAX + MQTT_BATCH_RECORDS * PAYLOAD_CBOR_RECORD_MAX + 1)
+//PUBLISHes tracked per Publish(); samples beyond them wait for the next call
+#define MQTT_MAX_PACKETS 96
+#define MQTT_KEEPALIVE_S 600
+#define MQTT_RESPONSE_TIMEOUT_MS 5000
+#define MQTT_READ_CHUNK 32
+
+
+class MqttPublisher : public SampleTransport{
+  public:
+    MqttPublisher(Client &client, const char *host, uint16_t port, const char *clientId, const char *topic);
+    void SetCredentials(const char *user, const char *pass);
+    void SetQoS(uint8_t qos);
+    void SetTopicLayout(uint8_t layout);
+    uint8_t Publish(SampleStore &store, uint16_t &count, const char *extraFields = 0);
+    void Service(void);
+    void Close(void);
+    uint32_t Connects(void);
+    bool SessionPresent(void);
+    uint8_t LastReturnCode(void);
+
+  private:
+    uint8_t Connect(void);
+    uint8_t Send(SampleStore &store, uint16_t &count, const char *extraFields);
+    uint8_t AwaitAcks(uint16_t firstId, uint16_t packets, uint16_t &acked);
+    bool AddPublish(const char *topic, const char *suffix, const uint8_t *payload, uint16_t payloadLength,
+                    uint8_t qos, bool dup, uint16_t id);
+    bool Flush(void);
+    int ReadPacket(uint8_t *body, uint8_t size, uint8_t &length);
+    int ReadByte(unsigned long deadline);
+    uint16_t NextId(uint16_t id);
+    Client *_client;
+    const char *_host;
+    uint16_t _port;
+    const char *_clientId;
+    const char *_topic;
+    const char *_user;
+    const char *_pass;
+    uint8_t _qos;
+    uint8_t _layout;
+    uint32_t _connects;
+    bool _sessionPresent;
+    uint8_t _returnCode;
+    unsigned long _lastSent;
+    uint16_t _nextId;
+    uint16_t _retryId;
+    uint16_t _retryPackets;
+    uint8_t _packetSamples[MQTT_MAX_PACKETS];
+    uint8_t _buffer[MQTT_BUFFER_SIZE];
+    uint16_t _length;
+    uint8_t _rx[MQTT_READ_CHUNK];
+    uint8_t _rxLength;
+    uint8_t _rxIndex;
+};
+
+#endif
@@ -0,0 +1,381 @@
+/********************************************
+  PowerManager.cc - Duty-cycled sleep and per-phase energy accounting for PlantMantra.
+  On the SAMD21 SysTick stops in standby, so millis() does not advance while asleep;
+  Sleep() returns the time it missed and Millis() adds it back. On a host build
+  sleeping advances the simulated clock and nothing is missed.
+*********************************************/
+
+#include "PowerManager.h"
+
+static const char *PowerPhaseNames[POWER_PHASES] = {"sleep", "idle", "sample", "radio"};
+
+//Wake source (the EIC is a single peripheral, so this is shared by every PowerManager)
+static uint8_t powerWakePin = POWER_NO_WAKE_PIN;
+static void (*powerWakeHandler)(void) = 0;
+static volatile bool powerWakeRequested = false;
+
+#ifdef ARDUINO_ARCH_SAMD
+
+#define POWER_STANDBY_STOPS_MILLIS 1
+
+//Milliseconds not yet returned by PlatformStandby(), in 1/POWER_RTC_HZ ms
+static uint32_t powerRtcRemainder = 0;
+
+static void PowerRtcSync(void){ while(RTC->MODE0.STATUS.bit.SYNCBUSY); }
+
+static uint32_t PowerRtcCount(void){
+  RTC->MODE0.READREQ.reg = RTC_READREQ_RREQ;
+  PowerRtcSync();
+  return RTC->MODE0.COUNT.reg;
+}
+
+//The RTC as a free-running 32-bit counter (MODE0) at POWER_RTC_HZ: a 32.768 kHz oscillator divided
+//by 32 on GCLK2, both kept running in standby. Compare 0 wakes the core.
+//Boards built CRYSTALLESS (the Nano 33 IoT) have no 32.768 kHz crystal, so the core never starts
+//XOSC32K; they use OSCULP32K, which is always on but only accurate to a few percent. Elsewhere
+//the crystal is started here if the core has not already done so.
+static void PlatformBegin(void){
+
+#ifdef CRYSTALLESS
+  uint32_t source = GCLK_GENCTRL_SRC_OSCULP32K;
+#else
+  uint32_t source = GCLK_GENCTRL_SRC_XOSC32K;
+  if(!(SYSCTRL->XOSC32K.reg & SYSCTRL_XOSC32K_ENABLE)){
+    SYSCTRL->XOSC32K.reg = SYSCTRL_XOSC32K_STARTUP(6) | SYSCTRL_XOSC32K_XTALEN | SYSCTRL_XOSC32K_EN32K;
+    SYSCTRL->XOSC32K.reg |= SYSCTRL_XOSC32K_ENABLE;
+    while(!(SYSCTRL->PCLKSR.reg & SYSCTRL_PCLKSR_XOSC32KRDY));
+  }
+  SYSCTRL->XOSC32K.reg |= SYSCTRL_XOSC32K_RUNSTDBY | SYSCTRL_XOSC32K_EN32K;
+#endif
+
+  GCLK->GENDIV.reg = GCLK_GENDIV_ID(2) | GCLK_GENDIV_DIV(4);
+  while(GCLK->STATUS.bit.SYNCBUSY);
+  GCLK->GENCTRL.reg = GCLK_GENCTRL_GENEN | source | GCLK_GENCTRL_ID(2) | GCLK_GENCTRL_DIVSEL | GCLK_GENCTRL_RUNSTDBY;
+  while(GCLK->STATUS.bit.SYNCBUSY);
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK2 | GCLK_CLKCTRL_ID(GCM_RTC);
+  while(GCLK->STATUS.bit.SYNCBUSY);
+  PM->APBAMASK.reg |= PM_APBAMASK_RTC;
+
+  RTC->MODE0.CTRL.reg &= ~RTC_MODE0_CTRL_ENABLE;
+  PowerRtcSync();
+  RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_SWRST;
+  while(RTC->MODE0.CTRL.reg & RTC_MODE0_CTRL_SWRST);
+  RTC->MODE0.CTRL.reg = RTC_MODE0_CTRL_MODE_COUNT32 | RTC_MODE0_CTRL_PRESCALER_DIV1;
+  PowerRtcSync();
+  RTC->MODE0.INTENSET.reg = RTC_MODE0_INTENSET_CMP0;
+  NVIC_EnableIRQ(RTC_IRQn);
+  RTC->MODE0.CTRL.reg |= RTC_MODE0_CTRL_ENABLE;
+  PowerRtcSync();
+}
+
+void RTC_Handler(void){ RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_CMP0; }
+
+//Standby until the counter reaches the compare value (or the wake pin fires). The same counter
+//measures the sleep, so the time returned is what actually passed, carried to the next call below 1 ms.
+static unsigned long PlatformStandby(unsigned long ms){
+
+  uint32_t start = PowerRtcCount();
+  uint32_t compare = start + (uint32_t)(((uint64_t)ms * POWER_RTC_HZ) / 1000);
+
+  RTC->MODE0.INTFLAG.reg = RTC_MODE0_INTFLAG_CMP0;
+  RTC->MODE0.COMP[0].reg = compare;
+  PowerRtcSync();
+
+  //Only sleep on a compare value still strictly ahead once written: one already passed would match
+  //after the counter wraps, in 48 days
+  SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+  while((int32_t)(compare - PowerRtcCount()) > POWER_RTC_MIN_AHEAD && !powerWakeRequested){
+    __DSB();
+    __WFI();
+  }
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+  uint64_t elapsed = (uint64_t)(PowerRtcCount() - start) * 1000 + powerRtcRemainder;
+  powerRtcRemainder = elapsed % POWER_RTC_HZ;
+
+  return (unsigned long)(elapsed / POWER_RTC_HZ);
+}
+
+//Idle sleep: the core stops until the next interrupt (SysTick every 1 ms)
+static void PlatformIdle(unsigned long ms){
+  unsigned long start = millis();
+  SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+  while(millis() - start < ms && !powerWakeRequested){ __WFI(); }
+}
+
+//Falling edge on the pin runs the handler and wakes the core from standby: the EIC is clocked
+//from OSCULP32K through GCLK6 with RUNSTDBY so it keeps detecting edges while asleep
+static void PlatformWakeOnPin(uint8_t pin, void (*handler)(void)){
+
+  pinMode(pin, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(pin), handler, FALLING);
+
+  GCLK->GENCTRL.reg = GCLK_GENCTRL_GENEN | GCLK_GENCTRL_SRC_OSCULP32K | GCLK_GENCTRL_ID(6) | GCLK_GENCTRL_RUNSTDBY;
+  while(GCLK->STATUS.bit.SYNCBUSY);
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK6 | GCLK_CLKCTRL_ID(GCM_EIC);
+  while(GCLK->STATUS.bit.SYNCBUSY);
+
+  //Errata: keep the flash powered in sleep so the wake-up vector fetch does not fault
+  NVMCTRL->CTRLB.bit.SLEEPPRM = NVMCTRL_CTRLB_SLEEPPRM_DISABLED_Val;
+  EIC->WAKEUP.reg |= (1 << digitalPinToInterrupt(pin));
+}
+
+#else
+
+#define POWER_STANDBY_STOPS_MILLIS 0
+
+static uint8_t powerWakeLevel = HIGH;
+
+static void PlatformBegin(void){}
+
+//Stands in for the EIC: runs the handler on a falling edge of the wake pin (read through the bus)
+static void PlatformPollWakePin(void){
+
+  if(powerWakePin == POWER_NO_WAKE_PIN){ return; }
+
+  uint8_t level = SystemBus().DigitalRead(powerWakePin);
+  if(powerWakeLevel == HIGH && level == LOW && powerWakeHandler != 0){ powerWakeHandler(); }
+  powerWakeLevel = level;
+}
+
+static unsigned long PlatformSleepSteps(unsigned long ms){
+
+  unsigned long slept = 0;
+
+  while(slept < ms && !powerWakeRequested){
+    unsigned long step = (powerWakePin == POWER_NO_WAKE_PIN) ? ms - slept : POWER_HOST_WAKE_POLL_MS;
+    if(step > ms - slept){ step = ms - slept; }
+    delay(step);
+    slept += step;
+    PlatformPollWakePin();
+  }
+
+  return slept;
+}
+
+static unsigned long PlatformStandby(unsigned long ms){ return PlatformSleepSteps(ms); }
+
+static void PlatformIdle(unsigned long ms){ PlatformSleepSteps(ms); }
+
+static void PlatformWakeOnPin(uint8_t pin, void (*handler)(void)){
+  (void)handler;
+  powerWakeLevel = SystemBus().DigitalRead(pin);
+}
+
+#endif
+
+//PowerManager.PowerManager -> Initializes the budget with the default phase currents, in the sample phase.
+PowerManager::PowerManager(void){
+  _current[POWER_PHASE_SLEEP] = POWER_SLEEP_UA;
+  _current[POWER_PHASE_IDLE] = POWER_IDLE_UA;
+  _current[POWER_PHASE_SAMPLE] = POWER_SAMPLE_UA;
+  _current[POWER_PHASE_RADIO] = POWER_RADIO_UA;
+  _phase = POWER_PHASE_SAMPLE;
+  _slept = 0;
+  ResetBudget();
+}
+
+/************************************
+Begin() - Starts the RTC that wakes the MCU from standby. Call once from setup().
+*************************************/
+void PowerManager::Begin(void){
+  PlatformBegin();
+  _phaseStart = micros();
+  return;
+}
+
+/************************************
+Enter() - Charges the time since the last phase change to the current phase and switches phase.
+Inputs: phase -> POWER_PHASE_SAMPLE or POWER_PHASE_RADIO (sleep/idle are entered by Sleep())
+return: none
+*************************************/
+void PowerManager::Enter(uint8_t phase){
+
+  if(phase >= POWER_PHASES || phase == _phase){ return; }
+
+  Account();
+  _phase = phase;
+
+  return;
+}
+
+uint8_t PowerManager::Phase(void){ return _phase; }
+
+/************************************
+Sleep() - Sleeps for about ms: standby on the RTC counter, or idle sleep for short waits and the rest.
+Inputs: ms -> time until the next thing to do
+return: milliseconds slept that millis() did not see (pass to SampleScheduler::ClockSkipped())
+*************************************/
+unsigned long PowerManager::Sleep(unsigned long ms){
+
+  uint8_t phase = _phase;
+  unsigned long unseen = 0;
+  unsigned long remaining = ms;
+
+  Account();
+
+  if(ms >= POWER_MIN_STANDBY_MS){
+    _phase = POWER_PHASE_SLEEP;
+    unsigned long slept = PlatformStandby(ms);
+
+    if(POWER_STANDBY_STOPS_MILLIS){
+      unseen = slept;
+      _phaseMicros[POWER_PHASE_SLEEP] += (uint64_t)slept * 1000;
+    }
+    Account();
+
+    remaining = (slept < ms) ? ms - slept : 0;
+  }
+
+  if(remaining > 0 && !powerWakeRequested){
+    _phase = POWER_PHASE_IDLE;
+    PlatformIdle(remaining);
+    Account();
+  }
+
+  _phase = phase;
+  _slept += unseen;
+  powerWakeRequested = false;
+
+  return unseen;
+}
+
+/************************************
+WakeOnPin() - Wakes the MCU from Sleep() on a falling edge (e.g. the MCP9808 Alert output, open drain
+active low). The handler runs in interrupt context: it should only set a flag and call Wake().
+Inputs: pin -> external interrupt pin; handler -> interrupt routine
+return: none
+*************************************/
+void PowerManager::WakeOnPin(uint8_t pin, void (*handler)(void)){
+
+  powerWakePin = pin;
+  powerWakeHandler = handler;
+  PlatformWakeOnPin(pin, handler);
+
+  return;
+}
+
+/************************************
+Wake() - Ends the current (or next) Sleep() early. Safe to call from an interrupt handler.
+*************************************/
+void PowerManager::Wake(void){ powerWakeRequested = true; }
+
+/************************************
+Millis() - Time since boot including standby: millis() plus the time it missed while asleep.
+*************************************/
+unsigned long PowerManager::Millis(void){ return millis() + _slept; }
+
+unsigned long PowerManager::SleptMillis(void){ return _slept; }
+
+/************************************
+SetCurrent() - Replaces a phase's current draw (e.g. with a value measured on the actual board).
+Inputs: phase -> POWER_PHASE_*; microamps -> average draw in that phase
+return: none
+*************************************/
+void PowerManager::SetCurrent(uint8_t phase, uint32_t microamps){
+
+  if(phase >= POWER_PHASES){ return; }
+  _current[phase] = microamps;
+
+  return;
+}
+
+/************************************
+PhaseMicros() - Time spent in a phase since ResetBudget(), including the phase in progress.
+*************************************/
+uint64_t PowerManager::PhaseMicros(uint8_t phase){
+
+  if(phase >= POWER_PHASES){ return 0; }
+  Account();
+
+  return _phaseMicros[phase];
+}
+
+/************************************
+PhaseMicroampHours() - Charge drawn in a phase since ResetBudget().
+*************************************/
+float PowerManager::PhaseMicroampHours(uint8_t phase){
+
+  if(phase >= POWER_PHASES){ return 0; }
+
+  return (float)(PhaseMicros(phase) / 3600.0e6 * _current[phase]);
+}
+
+/************************************
+AverageMicroamps() - Average current over the budget window.
+*************************************/
+float PowerManager::AverageMicroamps(void){
+
+  double hours = 0;
+  double charge = 0;
+
+  for(uint8_t i = 0; i < POWER_PHASES; i++){
+    hours += PhaseMicros(i) / 3600.0e6;
+    charge += PhaseMicroampHours(i);
+  }
+
+  return (hours > 0) ? (float)(charge / hours) : 0;
+}
+
+/************************************
+BatteryDays() - Days a battery would last at the budget window's average current.
+Inputs: capacityMah -> battery capacity
+return: estimated days (0 if nothing has been accounted yet)
+*************************************/
+float PowerManager::BatteryDays(uint16_t capacityMah){
+
+  float average = AverageMicroamps();
+  if(average <= 0){ return 0; }
+
+  return capacityMah * 1000.0f / average / 24.0f;
+}
+
+/************************************
+FormatReport() - Writes the budget as text without printf float support:
+sleep=<ms>ms/<uAh>uAh idle=.. sample=.. radio=.. avg=<uA>uA life=<days>d
+Inputs: buffer/size -> output buffer (POWER_REPORT_MAX is always enough)
+return: number of characters written
+*************************************/
+uint16_t PowerManager::FormatReport(char *buffer, uint16_t size){
+
+  if(size == 0){ return 0; }
+  buffer[0] = '\0';
+
+  int length = 0;
+
+  for(uint8_t i = 0; i < POWER_PHASES && length < size; i++){
+    unsigned long tenths = (unsigned long)(PhaseMicroampHours(i) * 10 + 0.5f);
+    length += snprintf(&buffer[length], size - length, "%s%s=%lums/%lu.%luuAh", (i == 0) ? "" : " ", PowerPhaseNames[i],
+                       (unsigned long)(PhaseMicros(i) / 1000), tenths / 10, tenths % 10);
+  }
+
+  if(length < size){
+    length += snprintf(&buffer[length], size - length, " avg=%luuA life=%lud",
+                       (unsigned long)(AverageMicroamps() + 0.5f), (unsigned long)(BatteryDays() + 0.5f));
+  }
+
+  return (length < size) ? length : size - 1;
+}
+
+/************************************
+ResetBudget() - Starts a new accounting window (e.g. once a day after reporting).
+*************************************/
+void PowerManager::ResetBudget(void){
+
+  for(uint8_t i = 0; i < POWER_PHASES; i++){ _phaseMicros[i] = 0; }
+  _phaseStart = micros();
+
+  return;
+}
+
+/************************************
+Account() - Charges the time since the last call to the current phase.
+*************************************/
+void PowerManager::Account(void){
+
+  unsigned long now = micros();
+  _phaseMicros[_phase] += now - _phaseStart;
+  _phaseStart = now;
+
+  return;
+}
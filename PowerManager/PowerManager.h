@@ -0,0 +1,77 @@
+/********************************************
+  PowerManager.h - Duty-cycled sleep and per-phase energy accounting for PlantMantra.
+  Between cycles the SAMD21 sleeps in standby and is woken by the RTC counter;
+  short waits use idle sleep instead. Time is charged to the phase the node is in
+  (sleep, idle, sampling, radio) and turned into charge with each phase's current
+  draw, giving an energy budget and a battery-life estimate.
+*********************************************/
+
+#ifndef PowerManager_h
+#define PowerManager_h
+
+#include "SensorBus.h"
+
+/******** Power Phases ********/
+#define POWER_PHASE_SLEEP 0
+#define POWER_PHASE_IDLE 1
+#define POWER_PHASE_SAMPLE 2
+#define POWER_PHASE_RADIO 3
+#define POWER_PHASES 4
+
+/******** Phase Currents (uA) ********/
+//Board-level estimates for a Nano 33 IoT with the power LED removed:
+//sleep  - SAMD21 standby with RTC, regulator quiescent, MCP9808 shut down, SI1145 standby
+//idle   - SAMD21 idle sleep between SysTick ticks
+//sample - SAMD21 at 48 MHz plus the sensors converting
+//radio  - NINA-W102 associated and transmitting
+#define POWER_SLEEP_UA 180
+#define POWER_IDLE_UA 3500
+#define POWER_SAMPLE_UA 8000
+#define POWER_RADIO_UA 85000
+//Added to the sleep current while the MCP9808 keeps converting for its alert output
+#define POWER_MCP9808_CONVERTING_UA 200
+
+/******** Sleep Settings ********/
+//The RTC counts at 1024 Hz in standby; waits shorter than the minimum use idle sleep
+#define POWER_RTC_HZ 1024
+//A compare value must be this many counts ahead after its register sync, or standby is skipped
+#define POWER_RTC_MIN_AHEAD 2
+#define POWER_MIN_STANDBY_MS 20
+#define POWER_NO_WAKE_PIN 0xFF
+//Host builds have no EIC: sleeps are cut into steps and the wake pin is sampled between them
+#define POWER_HOST_WAKE_POLL_MS 10
+#define POWER_DEFAULT_BATTERY_MAH 2000
+
+//Longest FormatReport() output
+#define POWER_REPORT_MAX 160
+
+
+class PowerManager{
+  public:
+    PowerManager(void);
+    void Begin(void);
+    void Enter(uint8_t phase);
+    uint8_t Phase(void);
+    unsigned long Sleep(unsigned long ms);
+    void WakeOnPin(uint8_t pin, void (*handler)(void));
+    static void Wake(void);
+    unsigned long Millis(void);
+    unsigned long SleptMillis(void);
+    void SetCurrent(uint8_t phase, uint32_t microamps);
+    uint64_t PhaseMicros(uint8_t phase);
+    float PhaseMicroampHours(uint8_t phase);
+    float AverageMicroamps(void);
+    float BatteryDays(uint16_t capacityMah = POWER_DEFAULT_BATTERY_MAH);
+    uint16_t FormatReport(char *buffer, uint16_t size);
+    void ResetBudget(void);
+
+  private:
+    void Account(void);
+    uint32_t _current[POWER_PHASES];
+    uint64_t _phaseMicros[POWER_PHASES];
+    uint8_t _phase;
+    unsigned long _phaseStart;
+    unsigned long _slept;
+};
+
+#endif
@@ -0,0 +1,125 @@
+/********************************************
+  HttpListener.cc - WiFiNINA server (Arduino) and loopback socket listener (host).
+*********************************************/
+
+#include "HttpListener.h"
+
+#ifdef ARDUINO
+
+//NinaListener.NinaListener -> Listens on a TCP port once Begin() is called with the link up.
+//Inputs: port -> TCP port
+NinaListener::NinaListener(uint16_t port) : _server(port){
+}
+
+/************************************
+Begin() - Opens the server socket on the module. Call it again after the link was down (the
+module drops its sockets when it disassociates).
+*************************************/
+bool NinaListener::Begin(void){
+
+  _server.begin();
+
+  return _server.status() == LISTEN;
+}
+
+/************************************
+Accept() - WiFiServer::available() only returns a client that has data waiting, so this never waits.
+return: the client, or 0 if no request is waiting
+*************************************/
+Client *NinaListener::Accept(void){
+
+  WiFiClient client = _server.available();
+  if(!client){ return 0; }
+
+  _client = client;
+
+  return &_client;
+}
+
+void NinaListener::End(void){
+
+  if(_client){ _client.stop(); }
+
+  return;
+}
+
+#else
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+//HostListener.HostListener -> Listens on 127.0.0.1 once Begin() is called.
+//Inputs: port -> TCP port, or 0 for any free one (see Port())
+HostListener::HostListener(uint16_t port){
+  _fd = -1;
+  _port = port;
+  Accepted = 0;
+}
+
+HostListener::~HostListener(void){ End(); }
+
+/************************************
+Begin() - Binds a non-blocking listening socket on the loopback interface.
+return: false if the port cannot be bound
+*************************************/
+bool HostListener::Begin(void){
+
+  if(_fd >= 0){ return true; }
+
+  _fd = socket(AF_INET, SOCK_STREAM, 0);
+  if(_fd < 0){ return false; }
+
+  int reuse = 1;
+  setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(_port);
+
+  socklen_t length = sizeof(address);
+  if(bind(_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(_fd, 8) != 0 ||
+     getsockname(_fd, (struct sockaddr *)&address, &length) != 0){
+    End();
+    return false;
+  }
+
+  _port = ntohs(address.sin_port);
+  fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL, 0) | O_NONBLOCK);
+
+  return true;
+}
+
+/************************************
+Accept() - Takes the next queued connection without waiting (the previous client is closed).
+return: the client, or 0 if none is queued
+*************************************/
+Client *HostListener::Accept(void){
+
+  if(_fd < 0){ return 0; }
+
+  int fd = accept(_fd, 0, 0);
+  if(fd < 0){ return 0; }
+
+  _client.Attach(fd);
+  Accepted++;
+
+  return &_client;
+}
+
+void HostListener::End(void){
+
+  _client.stop();
+  if(_fd >= 0){ close(_fd); }
+  _fd = -1;
+
+  return;
+}
+
+uint16_t HostListener::Port(void){ return _port; }
+
+#endif
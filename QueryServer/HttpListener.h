@@ -0,0 +1,63 @@
+/********************************************
+  HttpListener.h - Non-blocking TCP listener used by QueryServer.
+  Accept() returns a client with a request waiting, or 0 straight away. On the
+  Arduino, NinaListener wraps a WiFiNINA WiFiServer (the module queues the
+  connections, so the MCU only has to poll); on a Linux host, HostListener
+  listens on a loopback socket and hands out a HostSocketClient.
+*********************************************/
+
+#ifndef HttpListener_h
+#define HttpListener_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFiNINA.h>
+#else
+#include "HostNet.h"
+#endif
+
+
+class HttpListener{
+  public:
+    virtual ~HttpListener(void){}
+    virtual bool Begin(void) = 0;
+    virtual Client *Accept(void) = 0;
+    virtual void End(void) = 0;
+};
+
+
+#ifdef ARDUINO
+
+class NinaListener : public HttpListener{
+  public:
+    NinaListener(uint16_t port);
+    bool Begin(void);
+    Client *Accept(void);
+    void End(void);
+
+  private:
+    WiFiServer _server;
+    WiFiClient _client;
+};
+
+#else
+
+class HostListener : public HttpListener{
+  public:
+    HostListener(uint16_t port);
+    ~HostListener(void);
+    bool Begin(void);
+    Client *Accept(void);
+    void End(void);
+    uint16_t Port(void);
+    uint32_t Accepted;
+
+  private:
+    int _fd;
+    uint16_t _port;
+    HostSocketClient _client;
+};
+
+#endif
+
+#endif
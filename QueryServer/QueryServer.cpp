@@ -0,0 +1,331 @@
+/********************************************
+  QueryServer.cc - Non-blocking local HTTP/JSON query endpoint.
+*********************************************/
+
+#include "QueryServer.h"
+
+#include <stdlib.h>
+
+/************************************
+StatusText() - Reason phrase for the status codes the server sends.
+*************************************/
+static const char *StatusText(uint16_t status){
+
+  switch(status){
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    default:  return "Service Unavailable";
+  }
+}
+
+
+//QueryServer.QueryServer -> Serves samples given to Record(); history also comes from the flash log if given.
+//Inputs: listener -> TCP listener (NinaListener / HostListener); log -> sample log, or 0 for the recent ring only
+QueryServer::QueryServer(HttpListener &listener, SampleLog *log){
+  _listener = &listener;
+  _log = log;
+  _powerReport = 0;
+  _listening = false;
+  _client = 0;
+  _accepted = 0;
+  _requestLength = 0;
+  _request[0] = '\0';
+  _haveLatest = false;
+  _recentHead = 0;
+  _recentCount = 0;
+  _requests = 0;
+  _errors = 0;
+  memset(&_latest, 0, sizeof(_latest));
+}
+
+/************************************
+Record() - Hands the server a new sample (call it for every sample, including alert samples).
+Inputs: sample -> sample just taken
+return: none
+*************************************/
+void QueryServer::Record(const SensorSample &sample){
+
+  _latest = sample;
+  _haveLatest = true;
+  _summary.Add(sample);
+
+  _recent[_recentHead] = sample;
+  _recentHead = (_recentHead + 1) % QUERY_RECENT_SAMPLES;
+  if(_recentCount < QUERY_RECENT_SAMPLES){ _recentCount++; }
+
+  return;
+}
+
+/************************************
+SetPowerReport() - Serves this text (PowerManager::FormatReport(), read at each request) as "power" in /stats.
+Inputs: report -> caller's buffer, left out of /stats while empty; 0 for none
+return: none
+*************************************/
+void QueryServer::SetPowerReport(const char *report){ _powerReport = report; }
+
+/************************************
+Service() - Call from loop(). Opens the listener when the link comes up, takes a waiting connection,
+reads what has arrived of its request and answers once the headers are complete. Never waits.
+Inputs: linkUp -> WiFi link connected (the listener is dropped while it is down)
+return: none
+*************************************/
+void QueryServer::Service(bool linkUp){
+
+  if(!linkUp){
+    if(_listening){
+      Close();
+      _listener->End();
+      _listening = false;
+    }
+    return;
+  }
+
+  if(!_listening){
+    _listening = _listener->Begin();
+    if(!_listening){ return; }
+  }
+
+  if(_client == 0){
+    _client = _listener->Accept();
+    if(_client == 0){ return; }
+    _accepted = millis();
+    _requestLength = 0;
+    _request[0] = '\0';
+  }
+
+  //Read in bulk: on the NINA every read is an SPI transaction
+  int waiting = _client->available();
+  uint8_t room = QUERY_REQUEST_MAX - 1 - _requestLength;
+  if(waiting > 0 && room > 0){
+    int got = _client->read((uint8_t *)&_request[_requestLength], (waiting < room) ? waiting : room);
+    if(got > 0){ _requestLength += got; }
+    _request[_requestLength] = '\0';
+  }
+
+  //Only the request line is used; the rest of a long request is not read
+  bool full = _requestLength == QUERY_REQUEST_MAX - 1;
+  if(strstr(_request, "\r\n\r\n") != 0 || strstr(_request, "\n\n") != 0 || (full && strchr(_request, '\n') != 0)){
+    Respond();
+    return;
+  }
+
+  if(full){
+    _errors++;
+    Send(400, snprintf(&_response[QUERY_HEADER_MAX], QUERY_RESPONSE_MAX - QUERY_HEADER_MAX, "{\"error\":\"request too long\"}"));
+    return;
+  }
+
+  if((unsigned long)(millis() - _accepted) >= QUERY_REQUEST_TIMEOUT_MS){
+    _errors++;
+    Send(408, snprintf(&_response[QUERY_HEADER_MAX], QUERY_RESPONSE_MAX - QUERY_HEADER_MAX, "{\"error\":\"timeout\"}"));
+    return;
+  }
+
+  if(!_client->connected()){ Close(); }
+
+  return;
+}
+
+/************************************
+Respond() - Routes the request line to its handler and sends the answer.
+*************************************/
+void QueryServer::Respond(void){
+
+  char *body = &_response[QUERY_HEADER_MAX];
+  uint16_t size = QUERY_RESPONSE_MAX - QUERY_HEADER_MAX;
+
+  _requests++;
+
+  if(strncmp(_request, "GET ", 4) != 0){
+    _errors++;
+    Send(405, snprintf(body, size, "{\"error\":\"GET only\"}"));
+    return;
+  }
+
+  const char *path = &_request[4];
+  size_t pathLength = strcspn(path, " ?\r\n");
+
+  if(pathLength == 7 && strncmp(path, "/latest", 7) == 0){
+    if(!_haveLatest){
+      _errors++;
+      Send(503, snprintf(body, size, "{\"error\":\"no sample yet\"}"));
+      return;
+    }
+    Send(200, FormatLatest(body, size));
+  }
+  else if(pathLength == 6 && strncmp(path, "/stats", 6) == 0){
+    Send(200, FormatStats(body, size));
+  }
+  else if(pathLength == 8 && strncmp(path, "/history", 8) == 0){
+    unsigned long since = 0;
+    bool bounded = false;
+    if(path[pathLength] == '?'){
+      const char *query = &path[pathLength + 1];
+      const char *value = strstr(query, "since=");
+      if(value != 0 && value < query + strcspn(query, " \r\n")){
+        since = strtoul(value + 6, 0, 10);
+        bounded = true;
+      }
+    }
+    Send(200, FormatHistory(body, size, since, bounded));
+  }
+  else{
+    _errors++;
+    Send(404, snprintf(body, size, "{\"error\":\"try /latest, /stats or /history?since=ms\"}"));
+  }
+
+  return;
+}
+
+/************************************
+FormatLatest() - {"t":ms,"moisture":..,"light":lux,"temperature":centi-degrees,"flags":..}
+*************************************/
+uint16_t QueryServer::FormatLatest(char *body, uint16_t size){
+
+  int length = snprintf(body, size, "{\"t\":%lu,\"moisture\":%u,\"light\":%lu,\"temperature\":%d,\"flags\":%u}",
+                        (unsigned long)_latest.Timestamp, (unsigned int)_latest.Moisture, (unsigned long)_latest.Light,
+                        (int)_latest.Temperature, (unsigned int)_latest.Flags);
+
+  return (length < size) ? length : size - 1;
+}
+
+/************************************
+FormatStats() - Count, mean, standard deviation, min and max of each channel since boot, the light
+integral (lux-hours) of today and yesterday, the log and server counters and the power report.
+*************************************/
+uint16_t QueryServer::FormatStats(char *body, uint16_t size){
+
+  RunningStats *channels[3] = {&_summary.Moisture, &_summary.Light, &_summary.Temperature};
+  const char *names[3] = {"moisture", "light", "temperature"};
+  char number[4][24];
+  int length = snprintf(body, size, "{\"samples\":%lu", (unsigned long)_summary.Moisture.Count());
+
+  for(uint8_t i = 0; i < 3 && length < size && _summary.Moisture.Count() > 0; i++){
+    SampleSummary::FormatFixed(number[0], sizeof(number[0]), channels[i]->Mean());
+    SampleSummary::FormatFixed(number[1], sizeof(number[1]), channels[i]->StdDev());
+    SampleSummary::FormatFixed(number[2], sizeof(number[2]), channels[i]->Min());
+    SampleSummary::FormatFixed(number[3], sizeof(number[3]), channels[i]->Max());
+    length += snprintf(&body[length], size - length, ",\"%s\":{\"mean\":%s,\"sd\":%s,\"min\":%s,\"max\":%s}",
+                       names[i], number[0], number[1], number[2], number[3]);
+  }
+
+  if(length < size){
+    SampleSummary::FormatFixed(number[0], sizeof(number[0]), _summary.LightIntegral.Today());
+    SampleSummary::FormatFixed(number[1], sizeof(number[1]), _summary.LightIntegral.Yesterday());
+    length += snprintf(&body[length], size - length, ",\"light_today\":%s,\"light_yesterday\":%s", number[0], number[1]);
+  }
+
+  if(length < size && _log != 0){
+    length += snprintf(&body[length], size - length, ",\"log\":{\"boot\":%u,\"blocks\":%lu,\"pending\":%u}",
+                       (unsigned int)_log->Boot(), (unsigned long)_log->Committed(), (unsigned int)_log->Pending());
+  }
+
+  if(length < size && _powerReport != 0 && _powerReport[0] != '\0'){
+    length += snprintf(&body[length], size - length, ",\"power\":\"%s\"", _powerReport);
+  }
+
+  if(length < size){
+    length += snprintf(&body[length], size - length, ",\"requests\":%lu,\"errors\":%lu}",
+                       (unsigned long)_requests, (unsigned long)_errors);
+  }
+
+  return (length < size) ? length : size - 1;
+}
+
+/************************************
+FormatHistory() - {"since":ms,"samples":[{"t":ms,"m":moisture,"l":lux,"c":centi-degrees,"f":flags},..],
+"more":bool,"next":ms}, oldest first. Samples come from this boot's blocks in the log (whole seconds),
+then from the recent ring for the ones the log has not committed yet. When the buffer fills, "more"
+is true and the next page is /history?since=<next>.
+Inputs: body/size -> output; since -> only samples with a later timestamp (ms since boot);
+        bounded -> false to start from the first sample of this boot (no since= given)
+return: body length
+*************************************/
+uint16_t QueryServer::FormatHistory(char *body, uint16_t size, unsigned long since, bool bounded){
+
+  uint16_t length = snprintf(body, size, "{\"since\":%lu,\"samples\":[", (unsigned long)since);
+  uint16_t count = 0;
+  unsigned long next = since;
+  bool more = false;
+  bool logged = false;
+  unsigned long loggedSeconds = 0;
+
+  if(_log != 0){
+    LogEntry entry;
+    _log->Rewind();
+    while(_log->Next(entry)){
+      if(entry.Boot != _log->Boot()){ continue; }
+      logged = true;
+      loggedSeconds = entry.Sample.Timestamp / 1000;
+      if(bounded && entry.Sample.Timestamp <= since){ continue; }
+      //A full page ends the walk; the recent ring is only needed when the log ran out first
+      if(length + QUERY_RECORD_MAX + QUERY_TRAILER_MAX > size){ more = true; break; }
+      if(count++ > 0){ body[length++] = ','; }
+      length += FormatRecord(&body[length], size - length, entry.Sample);
+      next = entry.Sample.Timestamp;
+    }
+  }
+
+  for(uint8_t i = 0; i < _recentCount && !more; i++){
+    const SensorSample &sample = _recent[(_recentHead + QUERY_RECENT_SAMPLES - _recentCount + i) % QUERY_RECENT_SAMPLES];
+    if((bounded && sample.Timestamp <= since) || (logged && sample.Timestamp / 1000 <= loggedSeconds)){ continue; }
+    if(length + QUERY_RECORD_MAX + QUERY_TRAILER_MAX > size){ more = true; break; }
+    if(count++ > 0){ body[length++] = ','; }
+    length += FormatRecord(&body[length], size - length, sample);
+    next = sample.Timestamp;
+  }
+
+  length += snprintf(&body[length], size - length, "],\"more\":%s,\"next\":%lu}", more ? "true" : "false", next);
+
+  return (length < size) ? length : size - 1;
+}
+
+/************************************
+FormatRecord() - One history record (at most QUERY_RECORD_MAX characters).
+*************************************/
+uint16_t QueryServer::FormatRecord(char *buffer, uint16_t size, const SensorSample &sample){
+
+  int length = snprintf(buffer, size, "{\"t\":%lu,\"m\":%u,\"l\":%lu,\"c\":%d,\"f\":%u}",
+                        (unsigned long)sample.Timestamp, (unsigned int)sample.Moisture, (unsigned long)sample.Light,
+                        (int)sample.Temperature, (unsigned int)sample.Flags);
+
+  return (length < size) ? length : size - 1;
+}
+
+/************************************
+Send() - Puts the status line and headers right in front of the body (formatted at QUERY_HEADER_MAX
+in the response buffer), sends it all in one write and closes the connection.
+Inputs: status -> HTTP status; length -> body length
+return: none
+*************************************/
+void QueryServer::Send(uint16_t status, uint16_t length){
+
+  char header[QUERY_HEADER_MAX];
+  int headerLength = snprintf(header, sizeof(header),
+                              "HTTP/1.1 %u %s\r\nContent-Type: application/json\r\nContent-Length: %u\r\n"
+                              "Connection: close\r\n\r\n", (unsigned int)status, StatusText(status), (unsigned int)length);
+
+  char *start = &_response[QUERY_HEADER_MAX - headerLength];
+  memcpy(start, header, headerLength);
+  _client->write((const uint8_t *)start, headerLength + length);
+
+  Close();
+
+  return;
+}
+
+void QueryServer::Close(void){
+
+  if(_client != 0){ _client->stop(); }
+  _client = 0;
+  _requestLength = 0;
+
+  return;
+}
+
+uint32_t QueryServer::Requests(void){ return _requests; }
+
+uint32_t QueryServer::Errors(void){ return _errors; }
@@ -0,0 +1,77 @@
+/********************************************
+  QueryServer.h - Local HTTP/JSON endpoint for controllers on the LAN.
+  GET /latest              newest sample
+  GET /stats               statistics of every sample since boot
+  GET /history[?since=ms]  samples of this boot (newer than `since`, ms since boot),
+                           oldest first; "more"/"next" page through long histories
+  Samples come from Record() and, for history, from the SampleLog in flash plus a
+  small ring of recent samples for the block the log has not committed yet.
+  Service() is non-blocking: it takes at most one waiting connection, reads what
+  has arrived of its request and answers it from one pre-formatted buffer with a
+  single write, then closes the connection (HTTP/1.1, Connection: close).
+*********************************************/
+
+#ifndef QueryServer_h
+#define QueryServer_h
+
+#include "HttpListener.h"
+#include "SensorSample.h"
+#include "SensorStats.h"
+#include "SampleLog.h"
+
+/******** Server Settings ********/
+#define QUERY_DEFAULT_PORT 80
+//Longest wait between Service() calls for sub-second answers (the sketch caps its sleep at this)
+#define QUERY_POLL_MS 100
+#define QUERY_REQUEST_TIMEOUT_MS 2000
+#define QUERY_REQUEST_MAX 128
+#define QUERY_RESPONSE_MAX 1200
+//Room kept ahead of the body for the status line and headers
+#define QUERY_HEADER_MAX 112
+//Covers the log block being built at one sample a minute (LOG_DEFAULT_MAX_AGE_MS)
+#define QUERY_RECENT_SAMPLES 16
+
+/******** Longest History Record ********/
+//{"t":4294967295,"m":65535,"l":4294967295,"c":-32768,"f":255},
+#define QUERY_RECORD_MAX 64
+//],"more":true,"next":4294967295}
+#define QUERY_TRAILER_MAX 40
+
+
+class QueryServer{
+  public:
+    QueryServer(HttpListener &listener, SampleLog *log = 0);
+    void Record(const SensorSample &sample);
+    void SetPowerReport(const char *report);
+    void Service(bool linkUp);
+    uint32_t Requests(void);
+    uint32_t Errors(void);
+
+  private:
+    void Respond(void);
+    uint16_t FormatLatest(char *body, uint16_t size);
+    uint16_t FormatStats(char *body, uint16_t size);
+    uint16_t FormatHistory(char *body, uint16_t size, unsigned long since, bool bounded);
+    static uint16_t FormatRecord(char *buffer, uint16_t size, const SensorSample &sample);
+    void Send(uint16_t status, uint16_t length);
+    void Close(void);
+    HttpListener *_listener;
+    SampleLog *_log;
+    const char *_powerReport;
+    bool _listening;
+    Client *_client;
+    unsigned long _accepted;
+    char _request[QUERY_REQUEST_MAX];
+    uint8_t _requestLength;
+    char _response[QUERY_RESPONSE_MAX];
+    bool _haveLatest;
+    SensorSample _latest;
+    SensorSample _recent[QUERY_RECENT_SAMPLES];
+    uint8_t _recentHead;
+    uint8_t _recentCount;
+    SampleSummary _summary;
+    uint32_t _requests;
+    uint32_t _errors;
+};
+
+#endif
@@ -0,0 +1,269 @@
+/********************************************
+  FlashDevice.cc - SAMD21 NVMCTRL flash driver and the host file-backed flash emulator.
+*********************************************/
+
+#include "FlashDevice.h"
+
+#ifdef ARDUINO
+
+/************************************
+WaitReady() - Waits for the NVM controller to finish a command.
+*************************************/
+static void WaitReady(void){
+
+  while(NVMCTRL->INTFLAG.bit.READY == 0){}
+
+  return;
+}
+
+//SamdFlash.SamdFlash -> Uses a reserved, row-aligned area of internal flash, e.g.
+//  __attribute__((__aligned__(SAMD_FLASH_ROW_SIZE))) const uint8_t logArea[65536] = {};
+//Inputs: area -> start of the area (row aligned); size -> bytes (a multiple of SAMD_FLASH_ROW_SIZE)
+SamdFlash::SamdFlash(const uint8_t *area, uint32_t size){
+  _area = area;
+  _size = size;
+}
+
+uint32_t SamdFlash::Size(void){ return _size; }
+
+uint16_t SamdFlash::PageSize(void){ return SAMD_FLASH_PAGE_SIZE; }
+
+uint32_t SamdFlash::EraseSize(void){ return SAMD_FLASH_ROW_SIZE; }
+
+/************************************
+Read() - Flash is memory mapped: a plain copy.
+*************************************/
+bool SamdFlash::Read(uint32_t address, uint8_t *data, uint16_t length){
+
+  if(address + length > _size){ return false; }
+  memcpy(data, _area + address, length);
+
+  return true;
+}
+
+/************************************
+Program() - Writes one page: clear the page buffer, fill it with 32-bit writes, then Write Page
+(manual write mode, so a half-filled buffer is never committed by the hardware).
+Inputs: address -> page-aligned offset in the area; data -> SAMD_FLASH_PAGE_SIZE bytes
+return: false if out of range or the controller flagged an error
+*************************************/
+bool SamdFlash::Program(uint32_t address, const uint8_t *data){
+
+  if((address % SAMD_FLASH_PAGE_SIZE) != 0 || address + SAMD_FLASH_PAGE_SIZE > _size){ return false; }
+
+  volatile uint32_t *dst = (volatile uint32_t *)(_area + address);
+
+  NVMCTRL->CTRLB.bit.MANW = 1;
+  NVMCTRL->STATUS.reg = NVMCTRL_STATUS_MASK;
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_PBC;
+  WaitReady();
+
+  for(uint8_t i = 0; i < SAMD_FLASH_PAGE_SIZE; i += 4){
+    uint32_t word;
+    memcpy(&word, data + i, 4);
+    *dst++ = word;
+  }
+
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_WP;
+  WaitReady();
+
+  return (NVMCTRL->STATUS.reg & (NVMCTRL_STATUS_PROGE | NVMCTRL_STATUS_LOCKE | NVMCTRL_STATUS_NVME)) == 0;
+}
+
+/************************************
+Erase() - Erases the row containing address (the ADDR register takes a 16-bit word address).
+*************************************/
+bool SamdFlash::Erase(uint32_t address){
+
+  if(address >= _size){ return false; }
+
+  NVMCTRL->STATUS.reg = NVMCTRL_STATUS_MASK;
+  NVMCTRL->ADDR.reg = ((uint32_t)_area + address - (address % SAMD_FLASH_ROW_SIZE)) / 2;
+  NVMCTRL->CTRLA.reg = NVMCTRL_CTRLA_CMDEX_KEY | NVMCTRL_CTRLA_CMD_ER;
+  WaitReady();
+
+  return (NVMCTRL->STATUS.reg & (NVMCTRL_STATUS_PROGE | NVMCTRL_STATUS_LOCKE | NVMCTRL_STATUS_NVME)) == 0;
+}
+
+#else
+
+#include <stdlib.h>
+
+//FileFlash.FileFlash -> An erased part held in memory; Open() backs it with an image file.
+//Inputs: size -> bytes; pageSize -> program unit; eraseSize -> erase unit (a multiple of pageSize)
+FileFlash::FileFlash(uint32_t size, uint16_t pageSize, uint32_t eraseSize){
+  _file = 0;
+  _size = size;
+  _pageSize = pageSize;
+  _eraseSize = eraseSize;
+  _image = (uint8_t *)malloc(size);
+  if(_image != 0){ memset(_image, 0xFF, size); }
+  _budget = FILE_FLASH_NO_CUT;
+  _seed = 1;
+  _cut = false;
+  Programs = 0;
+  Erases = 0;
+  BytesRead = 0;
+  memset(_eraseCount, 0, sizeof(_eraseCount));
+}
+
+FileFlash::~FileFlash(void){
+
+  Close();
+  free(_image);
+}
+
+/************************************
+Open() - Backs the part with an image file; every program and erase is written through to it.
+Inputs: path -> image file; create -> start from an erased part (else load the file; missing bytes read erased)
+return: false if the file cannot be opened
+*************************************/
+bool FileFlash::Open(const char *path, bool create){
+
+  Close();
+
+  _file = fopen(path, create ? "w+b" : "r+b");
+  if(_file == 0){ return false; }
+
+  if(create){ Persist(0, _size); }
+  else{
+    memset(_image, 0xFF, _size);
+    size_t loaded = fread(_image, 1, _size, _file);
+    (void)loaded;
+  }
+
+  return true;
+}
+
+void FileFlash::Close(void){
+
+  if(_file != 0){ fclose(_file); }
+  _file = 0;
+
+  return;
+}
+
+uint32_t FileFlash::Size(void){ return _size; }
+
+uint16_t FileFlash::PageSize(void){ return _pageSize; }
+
+uint32_t FileFlash::EraseSize(void){ return _eraseSize; }
+
+bool FileFlash::Read(uint32_t address, uint8_t *data, uint16_t length){
+
+  if(_image == 0 || address + length > _size){ return false; }
+  memcpy(data, _image + address, length);
+  BytesRead += length;
+
+  return true;
+}
+
+/************************************
+Program() - NOR semantics: the page is ANDed into the array. After a power cut nothing is written;
+the program that runs into the cut stops partway, leaving the bytes after it unprogrammed and the
+byte it stopped on with only some of its bits cleared.
+*************************************/
+bool FileFlash::Program(uint32_t address, const uint8_t *data){
+
+  if(_image == 0 || (address % _pageSize) != 0 || address + _pageSize > _size){ return false; }
+  if(_cut){ return false; }
+
+  uint32_t done = 0;
+  bool complete = Spend(_pageSize, done);
+
+  for(uint32_t i = 0; i < done; i++){ _image[address + i] &= data[i]; }
+  if(!complete){ _image[address + done] &= (data[done] | (uint8_t)_seed); }
+
+  Programs++;
+  Persist(address, _pageSize);
+
+  return complete;
+}
+
+/************************************
+Erase() - Sets the erase unit to 0xFF and counts it for wear statistics. An erase cut short leaves
+the unit with random bits set.
+*************************************/
+bool FileFlash::Erase(uint32_t address){
+
+  if(_image == 0 || address >= _size){ return false; }
+  if(_cut){ return false; }
+
+  uint32_t unit = address / _eraseSize;
+  uint32_t start = unit * _eraseSize;
+  uint32_t done = 0;
+  bool complete = Spend(_eraseSize, done);
+
+  if(complete){ memset(_image + start, 0xFF, _eraseSize); }
+  else if(done > 0){
+    for(uint32_t i = 0; i < _eraseSize; i++){
+      _seed ^= _seed << 13;
+      _seed ^= _seed >> 17;
+      _seed ^= _seed << 5;
+      _image[start + i] |= (uint8_t)_seed;
+    }
+  }
+
+  Erases++;
+  if(unit < FILE_FLASH_MAX_UNITS){ _eraseCount[unit]++; }
+  Persist(start, _eraseSize);
+
+  return complete;
+}
+
+/************************************
+CutPowerAfter() - Arms a power cut: after `bytes` more bytes of programming or erasing, the operation
+in progress is torn and every later one fails, until CutPowerAfter(FILE_FLASH_NO_CUT, ..) restores power.
+Inputs: bytes -> budget; seed -> for the torn bits (nonzero)
+return: none
+*************************************/
+void FileFlash::CutPowerAfter(uint32_t bytes, uint32_t seed){
+
+  _budget = bytes;
+  _seed = (seed != 0) ? seed : 1;
+  _cut = false;
+
+  return;
+}
+
+bool FileFlash::PowerCut(void){ return _cut; }
+
+uint32_t FileFlash::EraseCount(uint32_t unit){ return (unit < FILE_FLASH_MAX_UNITS) ? _eraseCount[unit] : 0; }
+
+uint8_t *FileFlash::Image(void){ return _image; }
+
+/************************************
+Spend() - Takes an operation's bytes from the power budget.
+Inputs: bytes -> operation size; done -> set to the bytes completed
+return: false if the power goes out during the operation
+*************************************/
+bool FileFlash::Spend(uint32_t bytes, uint32_t &done){
+
+  if(_budget == FILE_FLASH_NO_CUT || _budget >= bytes){
+    if(_budget != FILE_FLASH_NO_CUT){ _budget -= bytes; }
+    done = bytes;
+    return true;
+  }
+
+  done = _budget;
+  _budget = 0;
+  _cut = true;
+
+  return false;
+}
+
+/************************************
+Persist() - Writes a range of the image through to the backing file.
+*************************************/
+void FileFlash::Persist(uint32_t address, uint32_t length){
+
+  if(_file == 0){ return; }
+
+  fseek(_file, address, SEEK_SET);
+  fwrite(_image + address, 1, length, _file);
+  fflush(_file);
+
+  return;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/********************************************
+  FlashDevice.h - Page-programmed, block-erased NOR flash used by SampleLog.
+  Program() writes one whole page that must have been erased (bits only go 1 -> 0);
+  Erase() sets an erase unit back to 0xFF. On the Arduino, SamdFlash drives the
+  SAMD21's NVMCTRL on a reserved area of internal flash (64 B pages, 256 B rows);
+  on a Linux host, FileFlash emulates a part backed by an image file, with erase
+  counters and a power cut that can tear a program or erase partway through.
+*********************************************/
+
+#ifndef FlashDevice_h
+#define FlashDevice_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "HostPlatform.h"
+#endif
+
+/******** SAMD21 NVM Geometry ********/
+#define SAMD_FLASH_PAGE_SIZE 64
+#define SAMD_FLASH_ROW_SIZE 256
+
+/******** File Emulator Limits ********/
+#define FILE_FLASH_MAX_UNITS 1024
+#define FILE_FLASH_NO_CUT 0xFFFFFFFFUL
+
+
+class FlashDevice{
+  public:
+    virtual ~FlashDevice(void){}
+    virtual uint32_t Size(void) = 0;
+    virtual uint16_t PageSize(void) = 0;
+    virtual uint32_t EraseSize(void) = 0;
+    virtual bool Read(uint32_t address, uint8_t *data, uint16_t length) = 0;
+    virtual bool Program(uint32_t address, const uint8_t *data) = 0;
+    virtual bool Erase(uint32_t address) = 0;
+};
+
+
+#ifdef ARDUINO
+
+class SamdFlash : public FlashDevice{
+  public:
+    SamdFlash(const uint8_t *area, uint32_t size);
+    uint32_t Size(void);
+    uint16_t PageSize(void);
+    uint32_t EraseSize(void);
+    bool Read(uint32_t address, uint8_t *data, uint16_t length);
+    bool Program(uint32_t address, const uint8_t *data);
+    bool Erase(uint32_t address);
+
+  private:
+    const uint8_t *_area;
+    uint32_t _size;
+};
+
+#else
+
+class FileFlash : public FlashDevice{
+  public:
+    FileFlash(uint32_t size, uint16_t pageSize, uint32_t eraseSize);
+    ~FileFlash(void);
+    bool Open(const char *path, bool create);
+    void Close(void);
+    uint32_t Size(void);
+    uint16_t PageSize(void);
+    uint32_t EraseSize(void);
+    bool Read(uint32_t address, uint8_t *data, uint16_t length);
+    bool Program(uint32_t address, const uint8_t *data);
+    bool Erase(uint32_t address);
+    void CutPowerAfter(uint32_t bytes, uint32_t seed);
+    bool PowerCut(void);
+    uint32_t EraseCount(uint32_t unit);
+    uint8_t *Image(void);
+    uint32_t Programs;
+    uint32_t Erases;
+    uint32_t BytesRead;
+
+  private:
+    bool Spend(uint32_t bytes, uint32_t &done);
+    void Persist(uint32_t address, uint32_t length);
+    FILE *_file;
+    uint8_t *_image;
+    uint32_t _size;
+    uint16_t _pageSize;
+    uint32_t _eraseSize;
+    uint32_t _budget;
+    uint32_t _seed;
+    bool _cut;
+    uint32_t _eraseCount[FILE_FLASH_MAX_UNITS];
+};
+
+#endif
+
+#endif
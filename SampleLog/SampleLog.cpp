@@ -0,0 +1,493 @@
+/********************************************
+  SampleLog.cc - Delta/varint encoded, wear-leveled sample log in flash.
+*********************************************/
+
+#include "SampleLog.h"
+
+/******** Commit Retries ********/
+//Pages tried for one block before giving up (a page that fails to program or verify is skipped)
+#define LOG_COMMIT_TRIES 4
+//Pages are checked (blank, written back correctly) in chunks this size, so a commit leaves the read buffer alone
+#define LOG_CHECK_CHUNK 16
+
+/************************************
+PutVarint() / GetVarint() - LEB128: 7 bits per byte, low bits first, high bit set on all but the last.
+*************************************/
+static uint16_t PutVarint(uint32_t value, uint8_t *out){
+
+  uint16_t n = 0;
+
+  while(value >= 0x80){
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+
+  return n;
+}
+
+static bool GetVarint(const uint8_t *data, uint16_t &offset, uint16_t end, uint32_t &value){
+
+  value = 0;
+
+  for(uint8_t shift = 0; shift < 35; shift += 7){
+    if(offset >= end){ return false; }
+    uint8_t byte = data[offset++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if((byte & 0x80) == 0){ return true; }
+  }
+
+  return false;
+}
+
+/************************************
+ZigZag() / UnZigZag() - Maps signed deltas to small unsigned values (0, -1, 1, -2 .. -> 0, 1, 2, 3 ..).
+*************************************/
+static uint32_t ZigZag(int32_t value){ return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+
+static int32_t UnZigZag(uint32_t value){ return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+static void PutLE(uint8_t *out, uint32_t value, uint8_t bytes){
+
+  for(uint8_t i = 0; i < bytes; i++){ out[i] = (uint8_t)(value >> (8 * i)); }
+
+  return;
+}
+
+static uint32_t GetLE(const uint8_t *data, uint8_t bytes){
+
+  uint32_t value = 0;
+  for(uint8_t i = 0; i < bytes; i++){ value |= (uint32_t)data[i] << (8 * i); }
+
+  return value;
+}
+
+
+//SampleLog.SampleLog -> Initializes the log on a flash part; Begin() finds the existing log.
+//Inputs: flash -> part (or area) holding nothing but the log
+SampleLog::SampleLog(FlashDevice &flash){
+  _flash = &flash;
+  _pageSize = 0;
+  _pages = 0;
+  _pagesPerUnit = 1;
+  _boot = 0;
+  _sequence = 0;
+  _writePage = 0;
+  _written = false;
+  _oldestPage = 0;
+  _newestPage = 0;
+  _committed = 0;
+  _skipped = 0;
+  _maxAge = LOG_DEFAULT_MAX_AGE_MS;
+  _length = 0;
+  _count = 0;
+  _firstTimestamp = 0;
+  _lastStep = 0;
+  _readPage = 0;
+  _readVisited = 0;
+  _readSpan = 0;
+  _readSequence = 0;
+  _readStarted = false;
+  _readOffset = 0;
+  _readEnd = 0;
+  _readLeft = 0;
+  _readFlagsMask = LOG_TAG_FLAGS_MASK;
+  _readSameStep = LOG_TAG_SAME_STEP;
+  _readBoot = 0;
+  _readSeconds = 0;
+  _readStep = 0;
+  memset(&_last, 0, sizeof(_last));
+  memset(&_readLast, 0, sizeof(_readLast));
+}
+
+/************************************
+Begin() - Scans every page for the newest valid block and continues after it, with the boot count
+one higher. Blank, torn or foreign pages are ignored. The oldest block is the first valid one after
+the newest in page order.
+Inputs: none
+return: LOG_OK, or LOG_ERR_GEOMETRY if the part's page/erase sizes do not suit the log
+*************************************/
+uint8_t SampleLog::Begin(void){
+
+  _pageSize = _flash->PageSize();
+  uint32_t eraseSize = _flash->EraseSize();
+
+  if(_pageSize > LOG_MAX_PAGE_SIZE || _pageSize < LOG_HEADER_SIZE + LOG_SAMPLE_MAX + LOG_CRC_SIZE){ return LOG_ERR_GEOMETRY; }
+  if(eraseSize < _pageSize || (eraseSize % _pageSize) != 0 || (_flash->Size() % eraseSize) != 0){ return LOG_ERR_GEOMETRY; }
+  if(_flash->Size() < 2 * eraseSize){ return LOG_ERR_GEOMETRY; }
+
+  _pages = _flash->Size() / _pageSize;
+  _pagesPerUnit = eraseSize / _pageSize;
+
+  uint32_t newest = 0;
+  uint32_t newestPage = 0;
+  bool found = FindNewest(newestPage, newest);
+  uint16_t newestBoot = found ? (uint16_t)GetLE(_read + 4, 2) : 0;
+
+  _boot = found ? newestBoot + 1 : 0;
+  _sequence = found ? newest + 1 : 0;
+  _writePage = found ? (newestPage + 1) % _pages : 0;
+  _written = found;
+  _newestPage = newestPage;
+  _oldestPage = newestPage;
+  _length = 0;
+  _count = 0;
+  _readVisited = 0;
+  _readSpan = 0;
+
+  for(uint32_t i = 1; found && i < _pages; i++){
+    uint32_t page = (newestPage + i) % _pages;
+    uint32_t sequence;
+    if(ReadBlock(page, _read, sequence) && sequence < newest){
+      _oldestPage = page;
+      break;
+    }
+  }
+
+  return LOG_OK;
+}
+
+/************************************
+Append() - Adds a sample to the block being built. A full block, or one whose first sample is older
+than the maximum age, is committed first.
+Inputs: sample -> sample to log
+return: LOG_OK, or LOG_ERR_FLASH if a commit failed (the sample is not logged)
+*************************************/
+uint8_t SampleLog::Append(const SensorSample &sample){
+
+  if(_pageSize == 0){ return LOG_ERR_GEOMETRY; }
+
+  if(_count > 0 && (sample.Timestamp - _firstTimestamp) >= _maxAge){
+    uint8_t status = Commit();
+    if(status != LOG_OK){ return status; }
+  }
+
+  uint8_t encoded[LOG_SAMPLE_MAX];
+  uint16_t length = EncodeSample(sample, encoded);
+
+  if(_count == 0xFF || LOG_HEADER_SIZE + _length + length + LOG_CRC_SIZE > _pageSize){
+    uint8_t status = Commit();
+    if(status != LOG_OK){ return status; }
+    length = EncodeSample(sample, encoded);
+  }
+
+  if(_count == 0){ _firstTimestamp = sample.Timestamp; }
+
+  uint32_t seconds = sample.Timestamp / 1000;
+  _lastStep = (_count > 0) ? seconds - _last.Timestamp / 1000 : seconds;
+  _last = sample;
+
+  memcpy(_block + LOG_HEADER_SIZE + _length, encoded, length);
+  _length += length;
+  _count++;
+
+  return LOG_OK;
+}
+
+/************************************
+Flush() - Commits the block being built now (e.g. before a planned power-down). Each commit takes a
+whole page, so flushing often wastes space.
+return: LOG_OK or LOG_ERR_FLASH
+*************************************/
+uint8_t SampleLog::Flush(void){ return Commit(); }
+
+/************************************
+SetMaxAge() - Longest a sample waits in RAM before its block is committed (checked on Append()).
+Inputs: ms -> maximum age
+return: none
+*************************************/
+void SampleLog::SetMaxAge(unsigned long ms){ _maxAge = ms; }
+
+/************************************
+EncodeSample() - Encodes a sample against the last one in the block (or zero for the first).
+Inputs: sample -> sample; out -> at least LOG_SAMPLE_MAX bytes
+return: encoded length
+*************************************/
+uint16_t SampleLog::EncodeSample(const SensorSample &sample, uint8_t *out){
+
+  uint32_t seconds = sample.Timestamp / 1000;
+  uint32_t step = seconds;
+  int32_t moisture = sample.Moisture;
+  uint32_t light = sample.Light;
+  int32_t temperature = sample.Temperature;
+
+  if(_count > 0){
+    step = seconds - _last.Timestamp / 1000;
+    moisture -= _last.Moisture;
+    light -= _last.Light;
+    temperature -= _last.Temperature;
+  }
+
+  uint16_t n = 1;
+  out[0] = sample.Flags & LOG_TAG_FLAGS_MASK;
+
+  if(_count > 0 && step == _lastStep){ out[0] |= LOG_TAG_SAME_STEP; }
+  else{ n += PutVarint(step, out + n); }
+
+  n += PutVarint(ZigZag(moisture), out + n);
+  n += PutVarint(ZigZag((int32_t)light), out + n);
+  n += PutVarint(ZigZag(temperature), out + n);
+
+  return n;
+}
+
+/************************************
+Commit() - Writes the block being built to the next page and checks it back. A page that will not
+program or verify is skipped for the next one.
+return: LOG_OK (also when there was nothing to commit) or LOG_ERR_FLASH (the block is kept)
+*************************************/
+uint8_t SampleLog::Commit(void){
+
+  if(_count == 0){ return LOG_OK; }
+
+  _block[0] = LOG_BLOCK_MAGIC;
+  _block[1] = _count;
+  PutLE(_block + 2, _length, 2);
+  PutLE(_block + 4, _boot, 2);
+  PutLE(_block + 6, _sequence, 4);
+
+  uint16_t end = LOG_HEADER_SIZE + _length;
+  PutLE(_block + end, Crc16(_block, end), 2);
+  memset(_block + end + LOG_CRC_SIZE, 0xFF, _pageSize - end - LOG_CRC_SIZE);
+
+  for(uint8_t attempt = 0; attempt < LOG_COMMIT_TRIES; attempt++){
+
+    if(!PrepareNextPage()){ return LOG_ERR_FLASH; }
+
+    uint32_t page = _writePage;
+    _writePage = (_writePage + 1) % _pages;
+
+    if(_flash->Program(page * _pageSize, _block) && PageMatches(page, _block)){
+      if(!_written){ _oldestPage = page; }
+      _written = true;
+      _newestPage = page;
+      _sequence++;
+      _committed++;
+      _length = 0;
+      _count = 0;
+      return LOG_OK;
+    }
+
+    _skipped++;
+  }
+
+  return LOG_ERR_FLASH;
+}
+
+/************************************
+PrepareNextPage() - Makes the write position programmable: the first page of an erase unit erases the
+unit (dropping the oldest blocks); any other page must still be blank, else it is skipped (a torn
+write found by Begin()).
+return: false if the flash will not erase
+*************************************/
+bool SampleLog::PrepareNextPage(void){
+
+  for(uint32_t tries = 0; tries < _pages; tries++){
+
+    if((_writePage % _pagesPerUnit) == 0){
+      if(!_flash->Erase(_writePage * _pageSize)){ return false; }
+      //Erasing the oldest blocks moves the start of the log to the next unit
+      if(_written && _oldestPage / _pagesPerUnit == _writePage / _pagesPerUnit){
+        _oldestPage = (_writePage + _pagesPerUnit) % _pages;
+      }
+      return true;
+    }
+
+    if(PageMatches(_writePage, 0)){ return true; }
+
+    _skipped++;
+    _writePage = (_writePage + 1) % _pages;
+  }
+
+  return false;
+}
+
+/************************************
+PageMatches() - Compares a page with the data it should hold.
+Inputs: page -> page index; data -> expected page, or 0 for blank (all 0xFF)
+return: true if every byte matches
+*************************************/
+bool SampleLog::PageMatches(uint32_t page, const uint8_t *data){
+
+  uint8_t chunk[LOG_CHECK_CHUNK];
+
+  for(uint16_t offset = 0; offset < _pageSize; offset += LOG_CHECK_CHUNK){
+    uint16_t length = (_pageSize - offset < LOG_CHECK_CHUNK) ? _pageSize - offset : LOG_CHECK_CHUNK;
+    if(!_flash->Read(page * _pageSize + offset, chunk, length)){ return false; }
+    for(uint16_t i = 0; i < length; i++){
+      if(chunk[i] != ((data != 0) ? data[offset + i] : 0xFF)){ return false; }
+    }
+  }
+
+  return true;
+}
+
+/************************************
+ReadBlock() - Reads a page and checks it is a complete block: magic (either format), sane count and length, CRC.
+Inputs: page -> page index; block -> page-sized buffer; sequence -> set to the block's sequence number
+return: true for a valid block
+*************************************/
+bool SampleLog::ReadBlock(uint32_t page, uint8_t *block, uint32_t &sequence){
+
+  if(!_flash->Read(page * _pageSize, block, _pageSize)){ return false; }
+  if((block[0] != LOG_BLOCK_MAGIC && block[0] != LOG_BLOCK_MAGIC_V1) || block[1] == 0){ return false; }
+
+  uint16_t length = (uint16_t)GetLE(block + 2, 2);
+  if(LOG_HEADER_SIZE + length + LOG_CRC_SIZE > _pageSize){ return false; }
+
+  uint16_t end = LOG_HEADER_SIZE + length;
+  if(Crc16(block, end) != (uint16_t)GetLE(block + end, 2)){ return false; }
+
+  sequence = GetLE(block + 6, 4);
+
+  return true;
+}
+
+/************************************
+Rewind() - Starts reading at the oldest committed block (samples still in RAM are not included).
+The oldest and newest pages are tracked by Begin() and Commit(), so this touches no flash and the
+walk covers only the pages from the oldest block to the newest.
+*************************************/
+void SampleLog::Rewind(void){
+
+  _readPage = _oldestPage;
+  _readVisited = 0;
+  _readSpan = _written ? (_newestPage + _pages - _oldestPage) % _pages + 1 : 0;
+  _readLeft = 0;
+  _readStarted = false;
+
+  return;
+}
+
+/************************************
+FindNewest() - Scans every page for the valid block with the highest sequence number.
+Inputs: page, sequence -> set to the newest block's page and sequence number (left in the read buffer)
+return: false if the flash holds no valid block
+*************************************/
+bool SampleLog::FindNewest(uint32_t &page, uint32_t &sequence){
+
+  bool found = false;
+  uint32_t candidate;
+
+  for(uint32_t p = 0; p < _pages; p++){
+    if(!ReadBlock(p, _read, candidate)){ continue; }
+    if(!found || candidate > sequence){
+      found = true;
+      sequence = candidate;
+      page = p;
+    }
+  }
+
+  if(found){ ReadBlock(page, _read, candidate); }
+
+  return found;
+}
+
+/************************************
+Next() - Reads the next sample, oldest first. Walks the pages from the oldest block to the newest;
+invalid pages, and blocks that do not continue the rising sequence (stale or foreign), are skipped.
+Inputs: entry -> filled with the sample, its boot count and block sequence number
+return: false at the end of the log
+*************************************/
+bool SampleLog::Next(LogEntry &entry){
+
+  while(true){
+
+    if(_readLeft > 0){
+      if(DecodeSample(entry)){ return true; }
+      _readLeft = 0;
+    }
+
+    if(_readVisited >= _readSpan){ return false; }
+
+    uint32_t page = _readPage;
+    uint32_t sequence;
+    _readPage = (_readPage + 1) % _pages;
+    _readVisited++;
+
+    if(!ReadBlock(page, _read, sequence)){ continue; }
+    if(_readStarted && sequence <= _readSequence){ continue; }
+
+    _readStarted = true;
+    _readSequence = sequence;
+    _readBoot = (uint16_t)GetLE(_read + 4, 2);
+    _readLeft = _read[1];
+    _readFlagsMask = (_read[0] == LOG_BLOCK_MAGIC_V1) ? LOG_TAG_V1_FLAGS_MASK : LOG_TAG_FLAGS_MASK;
+    _readSameStep = (_read[0] == LOG_BLOCK_MAGIC_V1) ? LOG_TAG_V1_SAME_STEP : LOG_TAG_SAME_STEP;
+    _readOffset = LOG_HEADER_SIZE;
+    _readEnd = LOG_HEADER_SIZE + (uint16_t)GetLE(_read + 2, 2);
+    _readSeconds = 0;
+    _readStep = 0;
+    memset(&_readLast, 0, sizeof(_readLast));
+  }
+}
+
+/************************************
+DecodeSample() - Decodes the next sample of the block being read.
+return: false if the payload ends early (the rest of the block is dropped)
+*************************************/
+bool SampleLog::DecodeSample(LogEntry &entry){
+
+  if(_readOffset >= _readEnd){ return false; }
+
+  uint8_t tag = _read[_readOffset++];
+  uint32_t moisture;
+  uint32_t light;
+  uint32_t temperature;
+
+  if((tag & _readSameStep) == 0){
+    if(!GetVarint(_read, _readOffset, _readEnd, _readStep)){ return false; }
+  }
+  if(!GetVarint(_read, _readOffset, _readEnd, moisture)){ return false; }
+  if(!GetVarint(_read, _readOffset, _readEnd, light)){ return false; }
+  if(!GetVarint(_read, _readOffset, _readEnd, temperature)){ return false; }
+
+  _readSeconds += _readStep;
+  _readLast.Timestamp = (unsigned long)_readSeconds * 1000;
+  _readLast.Moisture = (uint16_t)(_readLast.Moisture + UnZigZag(moisture));
+  _readLast.Light = _readLast.Light + (uint32_t)UnZigZag(light);
+  _readLast.Temperature = (int16_t)(_readLast.Temperature + UnZigZag(temperature));
+  _readLast.Flags = tag & _readFlagsMask;
+  _readLeft--;
+
+  entry.Boot = _readBoot;
+  entry.Sequence = _readSequence;
+  entry.Sample = _readLast;
+
+  return true;
+}
+
+uint16_t SampleLog::Boot(void){ return _boot; }
+
+uint32_t SampleLog::Sequence(void){ return _sequence; }
+
+/************************************
+Pending() - Samples in the block being built (lost on a power cut).
+*************************************/
+uint16_t SampleLog::Pending(void){ return _count; }
+
+uint32_t SampleLog::Committed(void){ return _committed; }
+
+/************************************
+SkippedPages() - Pages passed over since Begin() because they were not blank or failed to program.
+*************************************/
+uint32_t SampleLog::SkippedPages(void){ return _skipped; }
+
+uint32_t SampleLog::PageCount(void){ return _pages; }
+
+/************************************
+Crc16() - CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bitwise to stay out of RAM.
+*************************************/
+uint16_t SampleLog::Crc16(const uint8_t *data, uint16_t length){
+
+  uint16_t crc = 0xFFFF;
+
+  for(uint16_t i = 0; i < length; i++){
+    crc ^= (uint16_t)data[i] << 8;
+    for(uint8_t bit = 0; bit < 8; bit++){
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+
+  return crc;
+}
@@ -0,0 +1,120 @@
+/********************************************
+  SampleLog.h - Persistent, append-only log of every sample in flash.
+  Samples are delta/varint encoded into a page-sized block in RAM; a full block
+  (or one older than the maximum age) is written to the next flash page as one
+  commit: header with a sequence number and boot count, payload, CRC-16. A page
+  whose CRC does not check (torn write, half-erased row) is simply not part of
+  the log, so a power cut loses at most the block being built.
+  Pages are written round-robin over the whole area, erasing the oldest row just
+  ahead of the write position, so every row wears at the same rate. Begin()
+  finds the write position again from the newest valid sequence number, and
+  the oldest and newest pages are then kept up to date so reading needs no scan.
+
+  Block (one page):  magic | count | length (2) | boot (2) | sequence (4) | payload | CRC-16
+  Sample in payload: tag (flags in bits 0-6, bit 7 = same time step as the last)
+                     [time step, s] zigzag(moisture delta) zigzag(light delta) zigzag(temperature delta)
+  Deltas are against the previous sample of the block (zero for the first), multi-byte
+  values are little endian and varints are LEB128. Blocks with the first format's
+  magic (flags in bits 0-3, bit 4 = same step) are still read.
+*********************************************/
+
+#ifndef SampleLog_h
+#define SampleLog_h
+
+#include "SensorSample.h"
+#include "FlashDevice.h"
+
+/******** Block Layout ********/
+#define LOG_BLOCK_MAGIC 0x5B
+#define LOG_BLOCK_MAGIC_V1 0x5A
+#define LOG_HEADER_SIZE 10
+#define LOG_CRC_SIZE 2
+#define LOG_MAX_PAGE_SIZE 256
+#define LOG_SAMPLE_MAX 21
+
+/******** Sample Tag ********/
+#define LOG_TAG_FLAGS_MASK 0x7F
+#define LOG_TAG_SAME_STEP 0x80
+#define LOG_TAG_V1_FLAGS_MASK 0x0F
+#define LOG_TAG_V1_SAME_STEP 0x10
+
+/******** Log Defaults ********/
+//A partly filled block is committed once its first sample is this old (bounds the loss on a power cut)
+#define LOG_DEFAULT_MAX_AGE_MS 900000UL
+
+/******** Log Status Codes ********/
+#define LOG_OK 0
+#define LOG_ERR_GEOMETRY 1
+#define LOG_ERR_FLASH 2
+
+
+//LogEntry - one sample read back from the log; Timestamp is in whole seconds (x 1000 ms) since boot `Boot`.
+struct LogEntry{
+  uint16_t Boot;
+  uint32_t Sequence;
+  SensorSample Sample;
+};
+
+
+class SampleLog{
+  public:
+    SampleLog(FlashDevice &flash);
+    uint8_t Begin(void);
+    uint8_t Append(const SensorSample &sample);
+    uint8_t Flush(void);
+    void SetMaxAge(unsigned long ms);
+    void Rewind(void);
+    bool Next(LogEntry &entry);
+    uint16_t Boot(void);
+    uint32_t Sequence(void);
+    uint16_t Pending(void);
+    uint32_t Committed(void);
+    uint32_t SkippedPages(void);
+    uint32_t PageCount(void);
+    static uint16_t Crc16(const uint8_t *data, uint16_t length);
+
+  private:
+    bool ReadBlock(uint32_t page, uint8_t *block, uint32_t &sequence);
+    bool FindNewest(uint32_t &page, uint32_t &sequence);
+    uint8_t Commit(void);
+    bool PrepareNextPage(void);
+    bool PageMatches(uint32_t page, const uint8_t *data);
+    uint16_t EncodeSample(const SensorSample &sample, uint8_t *out);
+    bool DecodeSample(LogEntry &entry);
+    FlashDevice *_flash;
+    uint16_t _pageSize;
+    uint32_t _pages;
+    uint32_t _pagesPerUnit;
+    uint16_t _boot;
+    uint32_t _sequence;
+    uint32_t _writePage;
+    bool _written;
+    uint32_t _oldestPage;
+    uint32_t _newestPage;
+    uint32_t _committed;
+    uint32_t _skipped;
+    unsigned long _maxAge;
+    uint8_t _block[LOG_MAX_PAGE_SIZE];
+    uint16_t _length;
+    uint8_t _count;
+    unsigned long _firstTimestamp;
+    SensorSample _last;
+    uint32_t _lastStep;
+    uint8_t _read[LOG_MAX_PAGE_SIZE];
+    uint32_t _readPage;
+    uint32_t _readVisited;
+    uint32_t _readSpan;
+    uint32_t _readSequence;
+    bool _readStarted;
+    uint16_t _readOffset;
+    uint16_t _readEnd;
+    uint8_t _readLeft;
+    uint8_t _readFlagsMask;
+    uint8_t _readSameStep;
+    uint16_t _readBoot;
+    uint32_t _readSeconds;
+    uint32_t _readStep;
+    SensorSample _readLast;
+};
+
+#endif
@@ -0,0 +1,298 @@
+/********************************************
+  SamplePayload.cc - CBOR and packed binary encodings of sensor samples.
+*********************************************/
+
+#include "SamplePayload.h"
+
+/************************************
+PutCbor() - CBOR head: major type in the top 3 bits, then the value in the shortest form
+(in the low 5 bits below 24, else 1, 2 or 4 big-endian bytes).
+return: bytes written (1 - 5)
+*************************************/
+static uint8_t PutCbor(uint8_t *out, uint8_t major, uint32_t value){
+
+  major <<= 5;
+
+  if(value < 24){
+    out[0] = major | (uint8_t)value;
+    return 1;
+  }
+  if(value <= 0xFF){
+    out[0] = major | 24;
+    out[1] = (uint8_t)value;
+    return 2;
+  }
+  if(value <= 0xFFFF){
+    out[0] = major | 25;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)value;
+    return 3;
+  }
+
+  out[0] = major | 26;
+  for(uint8_t i = 0; i < 4; i++){ out[1 + i] = (uint8_t)(value >> (24 - 8 * i)); }
+
+  return 5;
+}
+
+static void PutLE(uint8_t *out, uint32_t value, uint8_t bytes){
+
+  for(uint8_t i = 0; i < bytes; i++){ out[i] = (uint8_t)(value >> (8 * i)); }
+
+  return;
+}
+
+static uint32_t GetLE(const uint8_t *data, uint8_t bytes){
+
+  uint32_t value = 0;
+  for(uint8_t i = 0; i < bytes; i++){ value |= (uint32_t)data[i] << (8 * i); }
+
+  return value;
+}
+
+/************************************
+Floor() - Drops the milliseconds; later samples are stepped from here in whole seconds.
+*************************************/
+static unsigned long Floor(unsigned long timestamp){ return timestamp - timestamp % 1000; }
+
+
+//PayloadEncoder.PayloadEncoder -> Encoder for one payload format; Begin() before each payload.
+//Inputs: format -> PAYLOAD_CBOR or PAYLOAD_PACKED
+PayloadEncoder::PayloadEncoder(uint8_t format){
+  _format = format;
+  _out = 0;
+  _size = 0;
+  _length = 0;
+  _count = 0;
+  _last = 0;
+}
+
+/************************************
+Begin() - Starts a payload in the caller's buffer (MaxLength() bytes hold any records of that count).
+*************************************/
+void PayloadEncoder::Begin(uint8_t *out, uint16_t size){
+
+  _out = out;
+  _size = size;
+  _length = 0;
+  _count = 0;
+  _last = 0;
+
+  return;
+}
+
+/************************************
+Add() - Appends one sample; the first also writes the header with its timestamp. Later timestamps
+are sent as whole seconds since the previous one, so they come back with up to a second less.
+Inputs: sample -> the next sample, no older than the previous one
+return: false, leaving the payload as it was, if the record does not fit, the payload is full, or the
+        timestamp cannot follow the previous one (older, or beyond a packed step) - start another payload
+*************************************/
+bool PayloadEncoder::Add(const SensorSample &sample){
+
+  if(_out == 0 || _count >= PAYLOAD_MAX_RECORDS){ return false; }
+
+  uint32_t step = 0;
+  if(_count > 0){
+    if((long)(sample.Timestamp - Floor(_last)) < 0){ return false; }
+    step = (unsigned long)(sample.Timestamp - Floor(_last)) / 1000;
+  }
+
+  if(_format == PAYLOAD_PACKED){
+
+    uint16_t need = ((_count == 0) ? PAYLOAD_PACKED_HEADER : 0) + PAYLOAD_PACKED_RECORD;
+    if(_length + need > _size || step > PAYLOAD_PACKED_MAX_STEP){ return false; }
+
+    if(_count == 0){
+      _out[_length++] = PAYLOAD_VERSION;
+      _out[_length++] = 0;
+      PutLE(&_out[_length], sample.Timestamp, 4);
+      _length += 4;
+    }
+
+    PutLE(&_out[_length], step, 2);
+    PutLE(&_out[_length + 2], sample.Moisture, 2);
+    PutLE(&_out[_length + 4], sample.Light, 4);
+    PutLE(&_out[_length + 8], (uint16_t)sample.Temperature, 2);
+    _out[_length + 10] = sample.Flags;
+    _length += PAYLOAD_PACKED_RECORD;
+    _out[1] = _count + 1;
+  }
+  else{
+
+    //Room for the break byte is kept so Finish() always fits
+    uint16_t need = ((_count == 0) ? PAYLOAD_CBOR_HEADER_MAX : 0) + PAYLOAD_CBOR_RECORD_MAX + 1;
+    if(_length + need > _size){ return false; }
+
+    if(_count == 0){
+      _out[_length++] = CBOR_ARRAY_INDEFINITE;
+      _length += PutCbor(&_out[_length], 0, PAYLOAD_VERSION);
+      _length += PutCbor(&_out[_length], 0, sample.Timestamp);
+    }
+
+    _length += PutCbor(&_out[_length], 4, (sample.Flags != 0) ? 5 : 4);
+    _length += PutCbor(&_out[_length], 0, step);
+    _length += PutCbor(&_out[_length], 0, sample.Moisture);
+    _length += PutCbor(&_out[_length], 0, sample.Light);
+    if(sample.Temperature < 0){ _length += PutCbor(&_out[_length], 1, (uint32_t)(-1 - sample.Temperature)); }
+    else{ _length += PutCbor(&_out[_length], 0, (uint32_t)sample.Temperature); }
+    if(sample.Flags != 0){ _length += PutCbor(&_out[_length], 0, sample.Flags); }
+  }
+
+  _last = (_count == 0) ? sample.Timestamp : Floor(_last) + step * 1000;
+  _count++;
+
+  return true;
+}
+
+/************************************
+Finish() - Closes the payload (the CBOR break byte); Add() then fails until the next Begin().
+return: payload length, 0 if no sample was added
+*************************************/
+uint16_t PayloadEncoder::Finish(void){
+
+  if(_count == 0){ return 0; }
+
+  if(_format != PAYLOAD_PACKED && _out != 0){ _out[_length++] = CBOR_BREAK; }
+  _out = 0;
+
+  return _length;
+}
+
+uint8_t PayloadEncoder::Count(void){ return _count; }
+
+/************************************
+MaxLength() - Bytes needed for a payload of this many records, whatever their values.
+*************************************/
+uint16_t PayloadEncoder::MaxLength(uint8_t format, uint8_t records){
+
+  if(format == PAYLOAD_PACKED){ return PAYLOAD_PACKED_HEADER + records * PAYLOAD_PACKED_RECORD; }
+
+  return PAYLOAD_CBOR_HEADER_MAX + records * PAYLOAD_CBOR_RECORD_MAX + 1;
+}
+
+
+//PayloadDecoder.PayloadDecoder -> Reads the header; Next() then returns the samples in order.
+//Inputs: data/length -> one complete payload (e.g. an MQTT message body)
+PayloadDecoder::PayloadDecoder(const uint8_t *data, uint16_t length){
+  _data = data;
+  _length = length;
+  _offset = 0;
+  _format = PAYLOAD_INVALID;
+  _left = 0;
+  _error = true;
+  _started = false;
+  _last = 0;
+
+  if(length >= PAYLOAD_PACKED_HEADER && data[0] == PAYLOAD_VERSION){
+    _left = data[1];
+    if(length != PAYLOAD_PACKED_HEADER + _left * PAYLOAD_PACKED_RECORD){ return; }
+    _last = GetLE(&data[2], 4);
+    _offset = PAYLOAD_PACKED_HEADER;
+    _format = PAYLOAD_PACKED;
+    _error = false;
+  }
+  else if(length > 0 && data[0] == CBOR_ARRAY_INDEFINITE){
+    uint8_t major;
+    uint32_t version;
+    uint32_t timestamp;
+    _offset = 1;
+    if(!ReadCbor(major, version) || major != 0 || version != PAYLOAD_VERSION){ return; }
+    if(!ReadCbor(major, timestamp) || major != 0){ return; }
+    _last = timestamp;
+    _format = PAYLOAD_CBOR;
+    _error = false;
+  }
+}
+
+/************************************
+Format() - PAYLOAD_CBOR, PAYLOAD_PACKED, or PAYLOAD_INVALID if the header was not recognized.
+*************************************/
+uint8_t PayloadDecoder::Format(void){ return _format; }
+
+/************************************
+Next() - Decodes the next sample.
+return: false at the end of the payload, or on a malformed record (Error())
+*************************************/
+bool PayloadDecoder::Next(SensorSample &sample){
+
+  if(_error){ return false; }
+
+  uint32_t step;
+
+  if(_format == PAYLOAD_PACKED){
+
+    if(_left == 0){ return false; }
+
+    const uint8_t *record = &_data[_offset];
+    step = GetLE(record, 2);
+    sample.Moisture = GetLE(&record[2], 2);
+    sample.Light = GetLE(&record[4], 4);
+    sample.Temperature = (int16_t)GetLE(&record[8], 2);
+    sample.Flags = record[10];
+    _offset += PAYLOAD_PACKED_RECORD;
+    _left--;
+  }
+  else{
+
+    if(_offset < _length && _data[_offset] == CBOR_BREAK){
+      _offset++;
+      _error = _offset != _length;
+      return false;
+    }
+
+    uint8_t major;
+    uint32_t items, moisture, light, temperature, flags = 0;
+    _error = true;
+    if(!ReadCbor(major, items) || major != 4 || (items != 4 && items != 5)){ return false; }
+    if(!ReadCbor(major, step) || major != 0){ return false; }
+    if(!ReadCbor(major, moisture) || major != 0 || moisture > 0xFFFF){ return false; }
+    if(!ReadCbor(major, light) || major != 0){ return false; }
+    if(!ReadCbor(major, temperature) || major > 1 || temperature > 0x7FFF){ return false; }
+    sample.Temperature = (major == 1) ? (int16_t)(-1 - (int32_t)temperature) : (int16_t)temperature;
+    if(items == 5 && (!ReadCbor(major, flags) || major != 0 || flags > 0xFF)){ return false; }
+    _error = false;
+
+    sample.Moisture = moisture;
+    sample.Light = light;
+    sample.Flags = flags;
+  }
+
+  sample.Timestamp = _started ? Floor(_last) + step * 1000 : _last;
+  _last = sample.Timestamp;
+  _started = true;
+
+  return true;
+}
+
+/************************************
+Error() - The payload was not recognized, or ended early or with a malformed record.
+*************************************/
+bool PayloadDecoder::Error(void){ return _error; }
+
+/************************************
+ReadCbor() - Reads one CBOR head (major type and value, up to 4 value bytes).
+return: false past the end or on an unsupported head (8-byte or indefinite values)
+*************************************/
+bool PayloadDecoder::ReadCbor(uint8_t &major, uint32_t &value){
+
+  if(_offset >= _length){ return false; }
+
+  uint8_t head = _data[_offset++];
+  uint8_t info = head & 0x1F;
+  major = head >> 5;
+
+  if(info < 24){
+    value = info;
+    return true;
+  }
+  if(info > 26){ return false; }
+
+  uint8_t bytes = 1 << (info - 24);
+  if(_offset + bytes > _length){ return false; }
+
+  value = 0;
+  for(uint8_t i = 0; i < bytes; i++){ value = (value << 8) | _data[_offset++]; }
+
+  return true;
+}
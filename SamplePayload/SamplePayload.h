@@ -0,0 +1,83 @@
+/********************************************
+  SamplePayload.h - Compact binary uplink payloads for one sample or a batch.
+  Two encodings of the same records, both starting from the first sample's
+  timestamp (ms since boot) and carrying later timestamps as whole-second steps:
+
+  CBOR (RFC 8949), self-describing, for gateways with a CBOR library:
+    [_ 1, t0, [dt, moisture, lux, centi-degrees(, flags)], ... ]
+    an indefinite-length array: version, t0, then one definite array per sample
+    (flags only when nonzero), ended by the break byte.
+  Packed, fixed layout (little endian):
+    version (1) | count (1) | t0 (4) | count x [dt (2) | moisture (2) | lux (4) | centi-degrees (2) | flags (1)]
+
+  The first byte tells them apart (0x9F for CBOR, the version for packed).
+  PayloadEncoder writes into a caller's buffer with no allocation; PayloadDecoder
+  reads either form back, on the node or on a host gateway.
+*********************************************/
+
+#ifndef SamplePayload_h
+#define SamplePayload_h
+
+#include "SensorSample.h"
+
+/******** Payload Formats ********/
+#define PAYLOAD_CBOR 0
+#define PAYLOAD_PACKED 1
+#define PAYLOAD_INVALID 0xFF
+#define PAYLOAD_VERSION 1
+
+/******** CBOR Layout ********/
+#define CBOR_ARRAY_INDEFINITE 0x9F
+#define CBOR_BREAK 0xFF
+//0x9F, version, t0 (up to a 5-byte unsigned)
+#define PAYLOAD_CBOR_HEADER_MAX 7
+//array head, dt (5), moisture (3), lux (5), temperature (3), flags (2)
+#define PAYLOAD_CBOR_RECORD_MAX 19
+
+/******** Packed Layout ********/
+#define PAYLOAD_PACKED_HEADER 6
+#define PAYLOAD_PACKED_RECORD 11
+#define PAYLOAD_PACKED_MAX_STEP 0xFFFF
+
+#define PAYLOAD_MAX_RECORDS 255
+
+
+class PayloadEncoder{
+  public:
+    PayloadEncoder(uint8_t format = PAYLOAD_CBOR);
+    void Begin(uint8_t *out, uint16_t size);
+    bool Add(const SensorSample &sample);
+    uint16_t Finish(void);
+    uint8_t Count(void);
+    static uint16_t MaxLength(uint8_t format, uint8_t records);
+
+  private:
+    uint8_t _format;
+    uint8_t *_out;
+    uint16_t _size;
+    uint16_t _length;
+    uint8_t _count;
+    unsigned long _last;
+};
+
+
+class PayloadDecoder{
+  public:
+    PayloadDecoder(const uint8_t *data, uint16_t length);
+    uint8_t Format(void);
+    bool Next(SensorSample &sample);
+    bool Error(void);
+
+  private:
+    bool ReadCbor(uint8_t &major, uint32_t &value);
+    const uint8_t *_data;
+    uint16_t _length;
+    uint16_t _offset;
+    uint8_t _format;
+    uint8_t _left;
+    bool _error;
+    bool _started;
+    unsigned long _last;
+};
+
+#endif
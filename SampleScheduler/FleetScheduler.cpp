@@ -0,0 +1,159 @@
+/********************************************
+  FleetScheduler.cc - Round-robin sampling of several plants from one node.
+*********************************************/
+
+#include "FleetScheduler.h"
+
+//FleetScheduler.FleetScheduler -> Initializes an empty fleet. Plants are added with Add().
+FleetScheduler::FleetScheduler(void){
+  _count = 0;
+  _released = 0;
+  _next = 0;
+  _nextSample = 0;
+  _interval = SCHED_DEFAULT_INTERVAL_MS;
+  _budget = FLEET_DEFAULT_BUDGET_US;
+  _start = 0;
+  _started = false;
+  _maxService = 0;
+}
+
+/************************************
+Add() - Adds one plant's scheduler (built on that plant's sensors) to the rotation.
+Inputs: plant -> scheduler for the plant; its interval is set by the fleet
+return: false if the fleet is full
+*************************************/
+bool FleetScheduler::Add(SampleScheduler &plant){
+
+  if(_count >= FLEET_MAX_PLANTS){ return false; }
+
+  plant.SetInterval(_interval);
+  _plants[_count] = &plant;
+  _stepMicros[_count] = 0;
+  _count++;
+
+  return true;
+}
+
+uint8_t FleetScheduler::Count(void){ return _count; }
+
+/************************************
+SetInterval() - Sets every plant's sample period. Plants start interval/Count() apart.
+*************************************/
+void FleetScheduler::SetInterval(unsigned long intervalMs){
+
+  _interval = intervalMs;
+  for(uint8_t i = 0; i < _count; i++){ _plants[i]->SetInterval(intervalMs); }
+
+  return;
+}
+
+/************************************
+SetBusBudget() - Bus time one Service() call may spend. A step is only started if the slowest
+step seen so far for that plant still fits, so a call runs over the budget only when a single
+step is longer than the budget itself.
+Inputs: budgetUs -> microseconds per Service() call
+*************************************/
+void FleetScheduler::SetBusBudget(unsigned long budgetUs){ _budget = budgetUs; }
+
+/************************************
+ReleaseTime() - Offset from the fleet start at which a plant runs its first cycle.
+*************************************/
+unsigned long FleetScheduler::ReleaseTime(uint8_t plant){
+
+  return (_interval / _count) * plant;
+}
+
+/************************************
+Service() - Advances due plants in round-robin order until the bus budget is used.
+Call from loop(); returns immediately if nothing is due.
+*************************************/
+void FleetScheduler::Service(void){
+
+  if(_count == 0){ return; }
+
+  unsigned long now = millis();
+  if(!_started){
+    _start = now;
+    _started = true;
+  }
+
+  //Stagger first cycles so the plants do not all sample at the same instant
+  while(_released < _count && (now - _start) >= ReleaseTime(_released)){ _released++; }
+
+  unsigned long begin = micros();
+  unsigned long used = 0;
+  bool stepped = false;
+
+  for(uint8_t n = 0; n < _released; n++){
+
+    uint8_t i = _next;
+    if(_plants[i]->MillisUntilNextStep() > 0){
+      _next = (_next + 1) % _released;
+      continue;
+    }
+
+    //Leave this plant for the next call if its slowest step would overrun the budget
+    if(stepped && used + _stepMicros[i] > _budget){ break; }
+
+    unsigned long stepStart = micros();
+    _plants[i]->Service();
+    unsigned long stepTime = micros() - stepStart;
+
+    if(stepTime > _stepMicros[i]){ _stepMicros[i] = stepTime; }
+    used = micros() - begin;
+    stepped = true;
+    _next = (_next + 1) % _released;
+  }
+
+  if(used > _maxService){ _maxService = used; }
+
+  return;
+}
+
+/************************************
+TakeSample() - Hands over one completed sample, taking plants in turn.
+Inputs: plant -> index (in Add() order) of the plant the sample belongs to; sample -> the reading
+return: true if a sample was available
+*************************************/
+bool FleetScheduler::TakeSample(uint8_t &plant, SensorSample &sample){
+
+  for(uint8_t n = 0; n < _count; n++){
+    uint8_t i = (_nextSample + n) % _count;
+    if(_plants[i]->TakeSample(sample)){
+      plant = i;
+      _nextSample = (i + 1) % _count;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/************************************
+MillisUntilNextStep() - Time until any plant (or the next staggered start) has something to do.
+*************************************/
+unsigned long FleetScheduler::MillisUntilNextStep(void){
+
+  if(_count == 0){ return _interval; }
+  if(!_started){ return 0; }
+
+  unsigned long wait = _interval;
+
+  if(_released < _count){
+    unsigned long elapsed = millis() - _start;
+    unsigned long release = ReleaseTime(_released);
+    wait = (release > elapsed) ? release - elapsed : 0;
+  }
+
+  for(uint8_t i = 0; i < _released; i++){
+    unsigned long plantWait = _plants[i]->MillisUntilNextStep();
+    if(plantWait < wait){ wait = plantWait; }
+  }
+
+  return wait;
+}
+
+/************************************
+MaxServiceMicros() - Longest time a single Service() call has taken.
+*************************************/
+unsigned long FleetScheduler::MaxServiceMicros(void){ return _maxService; }
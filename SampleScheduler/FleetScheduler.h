@@ -0,0 +1,45 @@
+/********************************************
+  FleetScheduler.h - Round-robin sampling of several plants from one node.
+  Each plant keeps its own SampleScheduler; the fleet staggers their cycles across
+  the interval and limits how much bus time a single Service() call may spend,
+  so one loop() pass never stalls behind a whole shelf of sensors.
+*********************************************/
+
+#ifndef FleetScheduler_h
+#define FleetScheduler_h
+
+#include "SampleScheduler.h"
+
+/******** Fleet Limits ********/
+#define FLEET_MAX_PLANTS 8
+#define FLEET_DEFAULT_BUDGET_US 8000
+
+
+class FleetScheduler{
+  public:
+    FleetScheduler(void);
+    bool Add(SampleScheduler &plant);
+    uint8_t Count(void);
+    void SetInterval(unsigned long intervalMs);
+    void SetBusBudget(unsigned long budgetUs);
+    void Service(void);
+    bool TakeSample(uint8_t &plant, SensorSample &sample);
+    unsigned long MillisUntilNextStep(void);
+    unsigned long MaxServiceMicros(void);
+
+  private:
+    unsigned long ReleaseTime(uint8_t plant);
+    SampleScheduler *_plants[FLEET_MAX_PLANTS];
+    unsigned long _stepMicros[FLEET_MAX_PLANTS];
+    uint8_t _count;
+    uint8_t _released;
+    uint8_t _next;
+    uint8_t _nextSample;
+    unsigned long _interval;
+    unsigned long _budget;
+    unsigned long _start;
+    bool _started;
+    unsigned long _maxService;
+};
+
+#endif
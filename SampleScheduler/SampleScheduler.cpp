@@ -0,0 +1,373 @@
+/********************************************
+  SampleScheduler.cc - Non-blocking sample cycle for the PlantMantra sensors.
+  Replaces the fixed delay(5000) after MeasureALSCMD() with polling of the SI1145
+  response counter, so a cycle only lasts as long as the ALS conversion.
+*********************************************/
+
+#include "SampleScheduler.h"
+
+//SampleScheduler.SampleScheduler -> Initializes the scheduler with the sensors it samples.
+//The first cycle starts on the first call to Service().
+//Inputs: moisture, sunlight and temperature sensor instances.
+SampleScheduler::SampleScheduler(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp){
+  _moisture = &moisture;
+  _sunlight = &sunlight;
+  _temp = &temp;
+  _collector = 0;
+  _range = 0;
+  _alsAttempts = 0;
+  _light = 0;
+  _lightSum = 0;
+  _lightCount = 0;
+  _state = SCHED_IDLE;
+  _interval = SCHED_DEFAULT_INTERVAL_MS;
+  _cycleStart = 0;
+  _nextStep = 0;
+  _alsDeadline = 0;
+  _tempReady = 0;
+  _skipped = 0;
+  _lowPower = false;
+  _tempContinuous = false;
+  _firstCycle = true;
+  _lightFault = false;
+  _flags = 0;
+  _sampleReady = false;
+}
+
+/************************************
+SetInterval() - Sets the time between the start of consecutive sample cycles.
+Inputs: intervalMs -> cycle period in milliseconds
+return: none
+*************************************/
+void SampleScheduler::SetInterval(unsigned long intervalMs){
+  _interval = intervalMs;
+}
+
+/************************************
+SetLowPower() - Keeps the sensors in their low-power states between cycles: MCP9808 shut down
+(0.1 uA instead of 200 uA), SI1145 in standby. Each cycle then wakes the MCP9808 first and reads
+it one conversion time later (TempSensor::ConversionMillis(), 30-250 ms depending on resolution).
+Inputs: enable -> true for low-power mode
+return: none
+*************************************/
+void SampleScheduler::SetLowPower(bool enable){
+
+  _lowPower = enable;
+
+  if(_state == SCHED_IDLE){
+    _temp->SetShutdownMode(enable && !_tempContinuous);
+    if(enable && _collector == 0){ _sunlight->Standby(); }
+  }
+
+  return;
+}
+
+/************************************
+SetTempContinuous() - Leaves the MCP9808 converting between cycles even in low-power mode, as its
+Alert output needs (a shut-down sensor does not compare against its limits). Cycles then read the
+latest conversion without waiting for one.
+Inputs: enable -> true while temperature alerts are armed
+return: none
+*************************************/
+void SampleScheduler::SetTempContinuous(bool enable){
+
+  _tempContinuous = enable;
+  if(_state == SCHED_IDLE){ _temp->SetShutdownMode(_lowPower && !enable); }
+
+  return;
+}
+
+/************************************
+SetLightSource() - Takes light from an autonomous-mode collector instead of forcing a measurement each
+cycle: no ALS wait, the sensor is not put in standby, and the scheduler holds the collector off the bus
+while it talks to the sensors. The collector must already be started (AlsAutoCollector::Begin()).
+Inputs: collector -> running collector, or 0 to go back to forced measurements
+return: none
+*************************************/
+void SampleScheduler::SetLightSource(AlsAutoCollector *collector){ _collector = collector; }
+
+/************************************
+SetLightRange() - Auto-ranges the forced measurements: a reading that is out of range (overflow or too
+few counts) moves the gain and is measured again in the same cycle, up to ALS_RANGE_MAX_MEASUREMENTS
+times, and the ALS timeout follows the integration time of the chosen gain. The ranger must already be
+started (AlsAutoRange::Begin()). Not used with an AlsAutoCollector.
+Inputs: range -> started ranger, or 0 for the fixed configured gain
+return: none
+*************************************/
+void SampleScheduler::SetLightRange(AlsAutoRange *range){ _range = range; }
+
+/************************************
+SetLightFault() - Flags every sample SAMPLE_FLAG_ALS_CONFIG while the SI1145 is known not to hold its
+configuration (ApplyConfig() failed), so its light readings are not taken at face value.
+Inputs: fault -> true while the configuration is not in place
+return: none
+*************************************/
+void SampleScheduler::SetLightFault(bool fault){ _lightFault = fault; }
+
+/************************************
+ClockSkipped() - Accounts for time that passed without millis() advancing (SAMD21 standby),
+so the interval and sample timestamps stay in real time.
+Inputs: ms -> milliseconds slept that millis() did not see
+return: none
+*************************************/
+void SampleScheduler::ClockSkipped(unsigned long ms){ _skipped += ms; }
+
+/************************************
+Now() - millis() plus the time skipped in standby.
+*************************************/
+unsigned long SampleScheduler::Now(void){ return millis() + _skipped; }
+
+/************************************
+Service() - Advances the sampling state machine. Call from loop(); returns immediately
+if no step is due.
+Inputs: none
+return: none
+*************************************/
+void SampleScheduler::Service(void){
+
+  unsigned long now = Now();
+
+  //Keep the collector's queue empty between steps (no bus traffic)
+  if(_collector != 0){ DrainCollector(); }
+
+  //Nothing to do until the next step is due
+  if((long)(now - _nextStep) < 0){ return; }
+
+  //The collector's interrupt handler must not use the bus in the middle of a step
+  if(_collector != 0){ _collector->Hold(); }
+
+  switch(_state){
+
+    case SCHED_IDLE:
+      if(!_firstCycle && (now - _cycleStart) < _interval){
+        _nextStep = _cycleStart + _interval;
+        break;
+      }
+      _firstCycle = false;
+      _cycleStart = now;
+      _flags = 0;
+      StepArmALS(now);
+      break;
+
+    case SCHED_WAIT_ALS:
+      StepWaitALS(now);
+      break;
+
+    case SCHED_READ_SENSORS:
+      StepReadSensors(now);
+      break;
+  }
+
+  if(_collector != 0){ _collector->Release(); }
+
+  return;
+}
+
+/************************************
+ScheduleRead() - Moves to the read step: on the next Service() call, so each call stays short (later
+in low-power mode if the MCP9808 has not finished converting).
+Inputs: now -> current millis()
+return: none
+*************************************/
+void SampleScheduler::ScheduleRead(unsigned long now){
+
+  _state = SCHED_READ_SENSORS;
+  _nextStep = now;
+  if(_lowPower && !_tempContinuous && (long)(_tempReady - now) > 0){ _nextStep = _tempReady; }
+
+  return;
+}
+
+/************************************
+StepArmALS() - Makes sure the SI1145 is unlocked and forces an ALS measurement.
+Inputs: now -> current millis()
+return: none
+*************************************/
+void SampleScheduler::StepArmALS(unsigned long now){
+
+  //Finicky sunlight sensor loses its HW_KEY on brown-out; restore it instead of hanging.
+  //A brown-out also resets its RAM, so drop the driver's shadow and restore the configuration.
+  if(_sunlight->RegRead(REG_HW_KEY) != 0x17){
+    _sunlight->InvalidateShadow();
+    _sunlight->SetHWKEY(0x17);
+    _sunlight->ReapplyConfig();
+    if(_collector != 0){ _collector->Restart(); }
+  }
+
+  //Start the MCP9808's first conversion now; it runs alongside the ALS measurement
+  if(_lowPower && !_tempContinuous){
+    _temp->SetShutdownMode(false);
+    _tempReady = now + _temp->ConversionMillis();
+  }
+
+  //Autonomous mode: the readings are already being collected
+  if(_collector != 0){
+    ScheduleRead(now);
+    return;
+  }
+
+  _alsAttempts = 0;
+  ArmALS(now);
+
+  return;
+}
+
+/************************************
+ArmALS() - Forces one ALS measurement and waits for it.
+Inputs: now -> current millis()
+return: none
+*************************************/
+void SampleScheduler::ArmALS(unsigned long now){
+
+  _sunlight->StartALS();
+  _alsAttempts++;
+
+  _alsDeadline = now + ((_range != 0) ? _range->TimeoutMillis() : SCHED_ALS_TIMEOUT_MS);
+  _nextStep = now + SCHED_ALS_POLL_MS;
+  _state = SCHED_WAIT_ALS;
+
+  return;
+}
+
+/************************************
+StepWaitALS() - Polls for ALS completion; moves to the read step once it completes, overflows or times out.
+With a ranger, a reading that moved the gain is measured again while attempts remain.
+Inputs: now -> current millis()
+return: none
+*************************************/
+void SampleScheduler::StepWaitALS(unsigned long now){
+
+  uint8_t status = _sunlight->PollALS();
+
+  if(status == ALS_BUSY){
+    if((long)(now - _alsDeadline) < 0){
+      _nextStep = now + SCHED_ALS_POLL_MS;
+      return;
+    }
+    _flags |= SAMPLE_FLAG_ALS_TIMEOUT;
+  }
+  else if(status == ALS_ERROR){
+    //No valid reading; the auto-range levels stay where they were
+    _flags |= SAMPLE_FLAG_ALS_ERROR;
+  }
+  else if(_range != 0){
+    uint16_t vis = 0;
+    uint16_t ir = 0;
+    _sunlight->ReadALSData(vis, ir);
+
+    uint8_t range = _range->Update(status, vis, ir);
+    if(range == ALS_RANGE_RETRY && _alsAttempts < ALS_RANGE_MAX_MEASUREMENTS){
+      ArmALS(now);
+      return;
+    }
+    if(range == ALS_RANGE_FAULT){ _flags |= SAMPLE_FLAG_ALS_CONFIG; }
+    if(status != ALS_DONE){ _flags |= SAMPLE_FLAG_ALS_OVERFLOW; }
+    _light = _range->VisLux();
+  }
+  else if(status != ALS_DONE){
+    _flags |= SAMPLE_FLAG_ALS_OVERFLOW;
+  }
+
+  ScheduleRead(now);
+
+  return;
+}
+
+/************************************
+StepReadSensors() - Reads every sensor into the pending sample and schedules the next cycle.
+Inputs: now -> current millis()
+return: none
+*************************************/
+void SampleScheduler::StepReadSensors(unsigned long now){
+
+  _sample.Timestamp = now;
+  _sample.Moisture = _moisture->readAndAve();
+  if(_collector != 0){ _sample.Light = CollectedLight(); }
+  else if(_range != 0){ _sample.Light = _light; }
+  else{ _sample.Light = _sunlight->CountsToLux(ALS_CH_VIS, _sunlight->ReadAmbVisData()); }
+  _sample.Temperature = _temp->ReadTemp();
+  _sample.Flags = _flags | (_lightFault ? SAMPLE_FLAG_ALS_CONFIG : 0);
+  _sampleReady = true;
+
+  if(_lowPower){
+    if(!_tempContinuous){ _temp->SetShutdownMode(true); }
+    if(_collector == 0){ _sunlight->Standby(); }
+  }
+
+  _state = SCHED_IDLE;
+  _nextStep = _cycleStart + _interval;
+
+  return;
+}
+
+/************************************
+DrainCollector() - Folds the collector's queued readings into the running light sum for the next sample.
+*************************************/
+void SampleScheduler::DrainCollector(void){
+
+  AlsReading reading;
+
+  while(_lightCount < 0xFFFF && _collector->Take(reading)){
+    _lightSum += reading.Vis;
+    _lightCount++;
+  }
+
+  return;
+}
+
+/************************************
+CollectedLight() - Mean visible reading of everything collected since the last sample, which starts a
+new sum. With nothing collected (sensor stopped or reset) the sample is flagged as an ALS timeout and
+gets whatever is left in the data registers.
+return: visible light for the sample, in lux
+*************************************/
+uint32_t SampleScheduler::CollectedLight(void){
+
+  DrainCollector();
+
+  if(_lightCount == 0){
+    _flags |= SAMPLE_FLAG_ALS_TIMEOUT;
+    return _sunlight->CountsToLux(ALS_CH_VIS, _sunlight->ReadAmbVisData());
+  }
+
+  uint16_t counts = (uint16_t)((_lightSum + _lightCount / 2) / _lightCount);
+  _lightSum = 0;
+  _lightCount = 0;
+
+  return _sunlight->CountsToLux(ALS_CH_VIS, counts);
+}
+
+/************************************
+SampleReady() - Reports whether a completed sample is waiting to be taken.
+return: true if TakeSample() will return a sample
+*************************************/
+bool SampleScheduler::SampleReady(void){ return _sampleReady; }
+
+/************************************
+TakeSample() - Hands the latest completed sample to the caller.
+Inputs: sample -> filled with the latest reading
+return: true if a new sample was available
+*************************************/
+bool SampleScheduler::TakeSample(SensorSample &sample){
+
+  if(!_sampleReady){ return false; }
+
+  sample = _sample;
+  _sampleReady = false;
+
+  return true;
+}
+
+uint8_t SampleScheduler::State(void){ return _state; }
+
+/************************************
+MillisUntilNextStep() - Time the MCU can sleep or do other work before Service() has something to do.
+return: milliseconds until the next scheduled step (0 if due now)
+*************************************/
+unsigned long SampleScheduler::MillisUntilNextStep(void){
+
+  unsigned long now = Now();
+  if((long)(now - _nextStep) >= 0){ return 0; }
+
+  return _nextStep - now;
+}
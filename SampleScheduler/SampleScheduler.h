@@ -0,0 +1,84 @@
+/********************************************
+  SampleScheduler.h - Cooperative, millis()-scheduled sampling of the PlantMantra sensors.
+  Service() never blocks: each call advances the state machine by at most one step
+  (arm ALS force -> poll SI1145 RESPONSE for completion -> read all sensors).
+  In low-power mode the MCP9808 is shut down and the SI1145 left in standby between
+  cycles, and time spent in MCU standby (where millis() stops) is added back through
+  ClockSkipped().  With an AlsAutoCollector as the light source the SI1145 measures
+  on its own and each sample's light reading is the mean of the readings collected
+  since the previous sample.  With an AlsAutoRange the forced measurement is repeated
+  (within the same cycle) until the reading is in range.  Light is in lux either way.
+*********************************************/
+
+#ifndef SampleScheduler_h
+#define SampleScheduler_h
+
+#include "SensorSample.h"
+#include "MoistureSensor.h"
+#include "SunlightSensor.h"
+#include "AlsAutoCollector.h"
+#include "AlsAutoRange.h"
+#include "TempSensor.h"
+
+/******** Scheduler States ********/
+#define SCHED_IDLE 0
+#define SCHED_WAIT_ALS 1
+#define SCHED_READ_SENSORS 2
+
+/******** Scheduler Timing (ms) ********/
+#define SCHED_DEFAULT_INTERVAL_MS 60000
+#define SCHED_ALS_POLL_MS 1
+#define SCHED_ALS_TIMEOUT_MS 100
+
+
+class SampleScheduler{
+  public:
+    SampleScheduler(MoistureSensor &moisture, SunlightSensor &sunlight, TempSensor &temp);
+    void SetInterval(unsigned long intervalMs);
+    void SetLowPower(bool enable);
+    void SetTempContinuous(bool enable);
+    void SetLightSource(AlsAutoCollector *collector);
+    void SetLightRange(AlsAutoRange *range);
+    void SetLightFault(bool fault);
+    void ClockSkipped(unsigned long ms);
+    void Service(void);
+    bool SampleReady(void);
+    bool TakeSample(SensorSample &sample);
+    uint8_t State(void);
+    unsigned long MillisUntilNextStep(void);
+
+  private:
+    unsigned long Now(void);
+    void ScheduleRead(unsigned long now);
+    void StepArmALS(unsigned long now);
+    void StepWaitALS(unsigned long now);
+    void StepReadSensors(unsigned long now);
+    void ArmALS(unsigned long now);
+    uint32_t CollectedLight(void);
+    void DrainCollector(void);
+    MoistureSensor *_moisture;
+    SunlightSensor *_sunlight;
+    TempSensor *_temp;
+    AlsAutoCollector *_collector;
+    AlsAutoRange *_range;
+    uint8_t _alsAttempts;
+    uint32_t _light;
+    uint32_t _lightSum;
+    uint16_t _lightCount;
+    uint8_t _state;
+    unsigned long _interval;
+    unsigned long _cycleStart;
+    unsigned long _nextStep;
+    unsigned long _alsDeadline;
+    unsigned long _tempReady;
+    unsigned long _skipped;
+    bool _lowPower;
+    bool _tempContinuous;
+    bool _firstCycle;
+    bool _lightFault;
+    uint8_t _flags;
+    bool _sampleReady;
+    SensorSample _sample;
+};
+
+#endif
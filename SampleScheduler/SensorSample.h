@@ -0,0 +1,25 @@
+/********************************************
+  SensorSample.h - One timestamped reading of every PlantMantra sensor.
+*********************************************/
+
+#ifndef SensorSample_h
+#define SensorSample_h
+
+#include "SensorBus.h"
+
+/******** Sample Flags ********/
+#define SAMPLE_FLAG_ALS_TIMEOUT 0x01
+#define SAMPLE_FLAG_ALS_OVERFLOW 0x02
+#define SAMPLE_FLAG_TEMP_ALERT 0x04
+#define SAMPLE_FLAG_ALS_CONFIG 0x08   // the SI1145 did not take its configuration at boot or an auto-range level
+#define SAMPLE_FLAG_ALS_ERROR 0x10    // the ALS measurement ended with an SI1145 error code
+
+struct SensorSample{
+  unsigned long Timestamp;
+  uint16_t Moisture;
+  uint32_t Light;         // visible illuminance in lux (SunlightSensor::CountsToLux())
+  int16_t Temperature;    // centi-degrees in TEMP_UNIT (TempSensor.h)
+  uint8_t Flags;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/********************************************
+  SampleStore.cc - Fixed-capacity ring buffer of timestamped sensor samples.
+  No dynamic allocation: the buffer is sized at compile time by SAMPLE_STORE_CAPACITY.
+*********************************************/
+
+#include "SampleStore.h"
+
+//SampleStore.SampleStore -> Initializes an empty store.
+SampleStore::SampleStore(void){
+  _head = 0;
+  _count = 0;
+  _overwritten = 0;
+  _lastSentTimestamp = 0;
+  _haveSent = false;
+}
+
+/************************************
+Push() - Appends a sample. When full, the oldest sample is overwritten so the newest data is kept.
+Inputs: sample -> reading to store
+return: true if stored without overwriting, false if the oldest sample was lost
+*************************************/
+bool SampleStore::Push(const SensorSample &sample){
+
+  uint16_t tail = (_head + _count) % SAMPLE_STORE_CAPACITY;
+  _samples[tail] = sample;
+
+  if(_count < SAMPLE_STORE_CAPACITY){
+    _count++;
+    return true;
+  }
+
+  //Full: the slot we just wrote was the oldest sample
+  _head = (_head + 1) % SAMPLE_STORE_CAPACITY;
+  _overwritten++;
+
+  return false;
+}
+
+/************************************
+Peek() - Copies a stored sample without removing it.
+Inputs: index -> 0 is the oldest sample; sample -> filled with the reading
+return: true if index is valid
+*************************************/
+bool SampleStore::Peek(uint16_t index, SensorSample &sample){
+
+  if(index >= _count){ return false; }
+
+  sample = _samples[(_head + index) % SAMPLE_STORE_CAPACITY];
+  return true;
+}
+
+/************************************
+Drop() - Removes the oldest samples, e.g. once they have been uploaded.
+Inputs: count -> number of samples to remove
+return: none
+*************************************/
+void SampleStore::Drop(uint16_t count){
+
+  if(count > _count){ count = _count; }
+  if(count == 0){ return; }
+
+  //Remember where the uploaded data ends, bulk-update deltas continue from there
+  _lastSentTimestamp = _samples[(_head + count - 1) % SAMPLE_STORE_CAPACITY].Timestamp;
+  _haveSent = true;
+
+  _head = (_head + count) % SAMPLE_STORE_CAPACITY;
+  _count -= count;
+
+  return;
+}
+
+void SampleStore::Clear(void){ _head = 0; _count = 0; }
+
+uint16_t SampleStore::Count(void){ return _count; }
+
+uint16_t SampleStore::Capacity(void){ return SAMPLE_STORE_CAPACITY; }
+
+bool SampleStore::Full(void){ return _count == SAMPLE_STORE_CAPACITY; }
+
+/************************************
+Overwritten() - Number of samples lost because the store was full.
+return: overwrite count since boot
+*************************************/
+uint32_t SampleStore::Overwritten(void){ return _overwritten; }
+
+
+/**********************************************************/
+/*------------- ThingSpeak Bulk-Update JSON --------------*/
+/**********************************************************/
+
+//Body layout: {"write_api_key":"KEY","updates":[record,record,...]}
+//Each record carries delta_t, the seconds since the previous entry, so no RTC is needed.
+
+/************************************
+FormatBulkHeader() - Writes the opening of a bulk-update body.
+Inputs: apiKey -> channel write key; buffer/size -> output buffer
+return: number of characters written (excluding terminator)
+*************************************/
+uint16_t SampleStore::FormatBulkHeader(const char *apiKey, char *buffer, uint16_t size){
+
+  int length = snprintf(buffer, size, "{\"write_api_key\":\"%s\",\"updates\":[", apiKey);
+
+  if(length < 0){ return 0; }
+  return (length < size) ? length : size - 1;
+}
+
+/************************************
+FormatBulkRecord() - Writes one stored sample as a bulk-update record (comma-prefixed after the first).
+Inputs: index -> 0 is the oldest sample; buffer/size -> output buffer (BULK_RECORD_MAX is always enough)
+return: number of characters written (0 if index is invalid)
+*************************************/
+uint16_t SampleStore::FormatBulkRecord(uint16_t index, char *buffer, uint16_t size){
+
+  SensorSample sample;
+  if(!Peek(index, sample)){ return 0; }
+
+  //Delta from the previous record, or from the last uploaded one for the first record
+  unsigned long previous = sample.Timestamp;
+  if(index > 0){
+    SensorSample before;
+    Peek(index - 1, before);
+    previous = before.Timestamp;
+  }
+  else if(_haveSent){ previous = _lastSentTimestamp; }
+
+  unsigned long deltaSeconds = (sample.Timestamp - previous) / 1000;
+
+  //Temperature is in centi-degrees: written as degrees with two decimals, without float formatting
+  int temperature = sample.Temperature;
+  const char *sign = (temperature < 0) ? "-" : "";
+  if(temperature < 0){ temperature = -temperature; }
+
+  int length = snprintf(buffer, size, "%s{\"delta_t\":%lu,\"field1\":%u,\"field2\":%lu,\"field3\":%s%d.%02d}",
+                        (index > 0) ? "," : "", deltaSeconds,
+                        (unsigned int)sample.Moisture, (unsigned long)sample.Light, sign, temperature / 100, temperature % 100);
+
+  if(length < 0){ return 0; }
+  return (length < size) ? length : size - 1;
+}
@@ -0,0 +1,47 @@
+/********************************************
+  SampleStore.h - Fixed-capacity ring buffer of timestamped sensor samples.
+  Keeps sampling through network outages and formats the stored samples as a
+  ThingSpeak bulk-update JSON body so one connection can carry many samples.
+*********************************************/
+
+#ifndef SampleStore_h
+#define SampleStore_h
+
+#include "SensorSample.h"
+
+/******** Store Limits ********/
+#ifndef SAMPLE_STORE_CAPACITY
+#define SAMPLE_STORE_CAPACITY 128
+#endif
+
+//Longest single bulk-update record, 72 chars plus the terminator:
+//,{"delta_t":4294967,"field1":65535,"field2":4294967295,"field3":-327.68}
+#define BULK_RECORD_MAX 80
+#define BULK_MAX_RECORDS 32
+#define BULK_TRAILER "]}"
+
+
+class SampleStore{
+  public:
+    SampleStore(void);
+    bool Push(const SensorSample &sample);
+    bool Peek(uint16_t index, SensorSample &sample);
+    void Drop(uint16_t count);
+    void Clear(void);
+    uint16_t Count(void);
+    uint16_t Capacity(void);
+    bool Full(void);
+    uint32_t Overwritten(void);
+    static uint16_t FormatBulkHeader(const char *apiKey, char *buffer, uint16_t size);
+    uint16_t FormatBulkRecord(uint16_t index, char *buffer, uint16_t size);
+
+  private:
+    SensorSample _samples[SAMPLE_STORE_CAPACITY];
+    uint16_t _head;
+    uint16_t _count;
+    uint32_t _overwritten;
+    unsigned long _lastSentTimestamp;
+    bool _haveSent;
+};
+
+#endif
@@ -0,0 +1,35 @@
+/********************************************
+  SampleTransport.h - Interface of the uplinks that drain a SampleStore.
+  Publish() sends the oldest samples of the store and reports how many were
+  delivered; the caller drops exactly that many, so a failed or partial upload
+  is retried from the first sample not delivered. Implemented by
+  ThingSpeakUploader (HTTP bulk update) and MqttPublisher (MQTT 3.1.1).
+*********************************************/
+
+#ifndef SampleTransport_h
+#define SampleTransport_h
+
+#include "SampleStore.h"
+
+/******** Upload Results ********/
+#define UPLOAD_OK 0
+#define UPLOAD_ERR_CONNECT 1
+#define UPLOAD_ERR_SEND 2
+#define UPLOAD_ERR_TIMEOUT 3
+#define UPLOAD_ERR_STATUS 4
+#define UPLOAD_ERR_PROTOCOL 5
+#define UPLOAD_ERR_TOO_LARGE 6
+
+
+class SampleTransport{
+  public:
+    virtual ~SampleTransport(void){}
+    //count: samples to send from the oldest; set to the number delivered (to Drop()), also on failure
+    virtual uint8_t Publish(SampleStore &store, uint16_t &count, const char *extraFields = 0) = 0;
+    //Keeps an idle connection alive; call from loop()
+    virtual void Service(void){}
+    virtual void Close(void) = 0;
+    virtual uint32_t Connects(void) = 0;
+};
+
+#endif
@@ -0,0 +1,59 @@
+/********************************************
+  HostPlatform.cc - Simulated clock and Serial stand-in for Linux host builds.
+*********************************************/
+
+#include "HostPlatform.h"
+
+#ifndef ARDUINO
+
+static uint64_t hostClockMicros = 0;
+
+HostSerial Serial;
+
+unsigned long millis(void){ return (unsigned long)(hostClockMicros / 1000); }
+
+unsigned long micros(void){ return (unsigned long)hostClockMicros; }
+
+void delay(unsigned long ms){ hostClockMicros += (uint64_t)ms * 1000; }
+
+void delayMicroseconds(unsigned int us){ hostClockMicros += us; }
+
+void HostAdvanceMicros(uint64_t us){ hostClockMicros += us; }
+
+uint64_t HostMicros64(void){ return hostClockMicros; }
+
+void pinMode(uint8_t pin, uint8_t mode){ (void)pin; (void)mode; }
+
+
+void HostSerial::begin(unsigned long baud){ (void)baud; }
+
+void HostSerial::print(const char *text){ fputs(text, stdout); }
+
+/************************************
+print() - Prints an integer in the requested base (DEC, HEX or BIN) like the Arduino Print class.
+Inputs: value -> number to print; base -> numeric base
+return: none
+*************************************/
+void HostSerial::print(long value, int base){
+
+  char digits[66];
+  int pos = sizeof(digits) - 1;
+  unsigned long magnitude = (value < 0 && base == DEC) ? -(unsigned long)value : (unsigned long)value;
+
+  digits[pos] = '\0';
+  do{
+    uint8_t digit = magnitude % base;
+    digits[--pos] = (digit < 10) ? ('0' + digit) : ('A' + digit - 10);
+    magnitude /= base;
+  } while(magnitude != 0 && pos > 1);
+
+  if(value < 0 && base == DEC){ digits[--pos] = '-'; }
+
+  fputs(&digits[pos], stdout);
+}
+
+void HostSerial::println(const char *text){ print(text); fputc('\n', stdout); }
+
+void HostSerial::println(long value, int base){ print(value, base); fputc('\n', stdout); }
+
+#endif
@@ -0,0 +1,66 @@
+/********************************************
+  HostPlatform.h - Minimal stand-in for the Arduino core when building on a Linux host.
+  Time is simulated: delay() and bus traffic advance a virtual clock instead of
+  sleeping, so driver code runs at full host speed with device-accurate timestamps.
+*********************************************/
+
+#ifndef HostPlatform_h
+#define HostPlatform_h
+
+#ifndef ARDUINO
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+/******** Pin Names (Nano 33 IoT) ********/
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+/******** Digital I/O ********/
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+/******** Print Bases ********/
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+typedef bool boolean;
+
+/******** Simulated Clock ********/
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void HostAdvanceMicros(uint64_t us);
+uint64_t HostMicros64(void);
+
+/******** GPIO (reads go through SensorBus::DigitalRead) ********/
+void pinMode(uint8_t pin, uint8_t mode);
+
+/******** Serial Monitor Stand-in ********/
+class HostSerial{
+  public:
+    void begin(unsigned long baud);
+    void print(const char *text);
+    void print(long value, int base = DEC);
+    void println(const char *text = "");
+    void println(long value, int base = DEC);
+};
+
+extern HostSerial Serial;
+
+#endif
+
+#endif
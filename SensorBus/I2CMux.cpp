@@ -0,0 +1,107 @@
+/********************************************
+  I2CMux.cc - TCA9548A 1-to-8 I2C switch support for the sensor bus.
+*********************************************/
+
+#include "I2CMux.h"
+
+//I2CMux.I2CMux -> Initializes a TCA9548A on the given bus. The channel state is unknown
+//until the first Select(), which always writes the control register.
+//Inputs: bus the mux is attached to; address -> 0x70 - 0x77 (A2..A0 pins).
+I2CMux::I2CMux(SensorBus &bus, uint8_t address){
+  _bus = &bus;
+  _address = address;
+  _selected = MUX_NO_CHANNEL;
+  _selects = 0;
+}
+
+/************************************
+Select() - Connects one downstream channel (and only that one) to the bus.
+Skipped when the channel is already selected.
+Inputs: channel -> 0 - 7
+return: BUS_OK or the bus error of the control register write
+*************************************/
+uint8_t I2CMux::Select(uint8_t channel){
+
+  if(channel >= TCA9548A_CHANNELS){ return BUS_ERR_OTHER; }
+  if(channel == _selected){ return BUS_OK; }
+
+  uint8_t status = WriteMask(1 << channel);
+  _selected = (status == BUS_OK) ? channel : MUX_NO_CHANNEL;
+
+  return status;
+}
+
+/************************************
+Disable() - Disconnects every downstream channel.
+*************************************/
+uint8_t I2CMux::Disable(void){
+
+  uint8_t status = WriteMask(0);
+  _selected = MUX_NO_CHANNEL;
+
+  return status;
+}
+
+/************************************
+WriteMask() - Writes the TCA9548A control register (one bit per channel).
+*************************************/
+uint8_t I2CMux::WriteMask(uint8_t mask){
+
+  _bus->BeginTransmission(_address);
+  _bus->Write(mask);
+  _selects++;
+
+  return _bus->EndTransmission();
+}
+
+uint8_t I2CMux::Selected(void){ return _selected; }
+
+/************************************
+Invalidate() - Forgets the selected channel (e.g. after a bus reset or mux power cycle).
+*************************************/
+void I2CMux::Invalidate(void){ _selected = MUX_NO_CHANNEL; }
+
+SensorBus &I2CMux::Bus(void){ return *_bus; }
+
+/************************************
+Selects() - Number of control register writes issued.
+*************************************/
+uint32_t I2CMux::Selects(void){ return _selects; }
+
+
+//MuxChannelBus.MuxChannelBus -> Bus view for the devices on one mux channel.
+//Inputs: mux -> the TCA9548A; channel -> 0 - 7
+MuxChannelBus::MuxChannelBus(I2CMux &mux, uint8_t channel){
+  _mux = &mux;
+  _channel = channel;
+}
+
+//The channel is selected before the target frame starts, never inside one, so a
+//write + repeated-start read pair stays back to back on the bus.
+void MuxChannelBus::BeginTransmission(uint8_t address){
+  _mux->Select(_channel);
+  _mux->Bus().BeginTransmission(address);
+}
+
+uint8_t MuxChannelBus::Write(uint8_t data){ return _mux->Bus().Write(data); }
+
+uint8_t MuxChannelBus::EndTransmission(bool sendStop){
+  uint8_t status = _mux->Bus().EndTransmission(sendStop);
+  if(status != BUS_OK){ _mux->Invalidate(); }
+  return status;
+}
+
+uint8_t MuxChannelBus::RequestFrom(uint8_t address, uint8_t quantity){
+  _mux->Select(_channel);
+  return _mux->Bus().RequestFrom(address, quantity);
+}
+
+int MuxChannelBus::Read(void){ return _mux->Bus().Read(); }
+
+int MuxChannelBus::Available(void){ return _mux->Bus().Available(); }
+
+uint16_t MuxChannelBus::AnalogRead(uint8_t pin){ return _mux->Bus().AnalogRead(pin); }
+
+uint8_t MuxChannelBus::DigitalRead(uint8_t pin){ return _mux->Bus().DigitalRead(pin); }
+
+bool MuxChannelBus::AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value){ return _mux->Bus().AnalogReadHighRes(pin, bits, value); }
@@ -0,0 +1,59 @@
+/********************************************
+  I2CMux.h - TCA9548A 1-to-8 I2C switch support for the sensor bus.
+  The SI1145 has a fixed address (0x60), so several of them on one node each sit on
+  their own mux channel. MuxChannelBus is a SensorBus that selects its channel
+  before every transfer; the mux remembers the selected channel so back-to-back
+  transfers on the same channel cost no extra bus traffic.
+*********************************************/
+
+#ifndef I2CMux_h
+#define I2CMux_h
+
+#include "SensorBus.h"
+
+/******** TCA9548A ********/
+#define TCA9548A_DEFAULT_ADDR 0x70
+#define TCA9548A_CHANNELS 8
+#define MUX_NO_CHANNEL 0xFF
+
+
+class I2CMux{
+  public:
+    I2CMux(SensorBus &bus = SystemBus(), uint8_t address = TCA9548A_DEFAULT_ADDR);
+    uint8_t Select(uint8_t channel);
+    uint8_t Disable(void);
+    uint8_t Selected(void);
+    void Invalidate(void);
+    SensorBus &Bus(void);
+    uint32_t Selects(void);
+
+  private:
+    uint8_t WriteMask(uint8_t mask);
+    SensorBus *_bus;
+    uint8_t _address;
+    uint8_t _selected;
+    uint32_t _selects;
+};
+
+
+//MuxChannelBus - the view of the bus a sensor on one mux channel sees.
+//Devices on the upstream bus stay reachable through it; analog and digital reads pass straight through.
+class MuxChannelBus : public SensorBus{
+  public:
+    MuxChannelBus(I2CMux &mux, uint8_t channel);
+    void BeginTransmission(uint8_t address);
+    uint8_t Write(uint8_t data);
+    uint8_t EndTransmission(bool sendStop = true);
+    uint8_t RequestFrom(uint8_t address, uint8_t quantity);
+    int Read(void);
+    int Available(void);
+    uint16_t AnalogRead(uint8_t pin);
+    uint8_t DigitalRead(uint8_t pin);
+    bool AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value);
+
+  private:
+    I2CMux *_mux;
+    uint8_t _channel;
+};
+
+#endif
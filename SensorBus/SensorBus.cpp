@@ -0,0 +1,119 @@
+/********************************************
+  SensorBus.cc - Arduino implementation of the sensor bus (forwards to Wire and analogRead).
+*********************************************/
+
+#include "SensorBus.h"
+
+#ifdef ARDUINO_ARCH_SAMD
+#include "wiring_private.h"
+#endif
+
+#ifdef ARDUINO
+
+void WireSensorBus::BeginTransmission(uint8_t address){ Wire.beginTransmission(address); }
+
+uint8_t WireSensorBus::Write(uint8_t data){ return Wire.write(data); }
+
+uint8_t WireSensorBus::EndTransmission(bool sendStop){ return Wire.endTransmission(sendStop); }
+
+uint8_t WireSensorBus::RequestFrom(uint8_t address, uint8_t quantity){ return Wire.requestFrom(address, quantity); }
+
+int WireSensorBus::Read(void){ return Wire.read(); }
+
+int WireSensorBus::Available(void){ return Wire.available(); }
+
+uint16_t WireSensorBus::AnalogRead(uint8_t pin){ return analogRead(pin); }
+
+uint8_t WireSensorBus::DigitalRead(uint8_t pin){ return digitalRead(pin); }
+
+#ifdef ARDUINO_ARCH_SAMD
+static void SyncADC(void){ while(ADC->STATUS.bit.SYNCBUSY == 1); }
+
+/************************************
+AnalogReadHighRes() - One oversampled conversion using the SAMD21 ADC's own accumulator.
+The core's analogRead() runs two conversions per call (the first is discarded) with the ADC
+enabled and disabled around them, so the old 10-read average cost 20 conversions; here the
+samples are accumulated and decimated by the ADC in one enable cycle, with no CPU work per sample. The core's ADC settings are restored after.
+Inputs: pin -> analog pin; bits -> resolution wanted (10 - 16)
+return: true, with value holding the result
+*************************************/
+bool WireSensorBus::AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value){
+
+  uint8_t sampleLog2;
+  uint8_t adjRes;
+  if(!SAMDAdcAveraging(bits, sampleLog2, adjRes)){ return false; }
+
+  if(pin < A0){ pin += A0; }
+  pinPeripheral(pin, PIO_ANALOG);
+
+  SyncADC();
+  uint16_t ctrlb = ADC->CTRLB.reg;
+  uint8_t avgctrl = ADC->AVGCTRL.reg;
+
+  ADC->INPUTCTRL.bit.MUXPOS = g_APinDescription[pin].ulADCChannelNumber;
+  SyncADC();
+  ADC->CTRLB.bit.RESSEL = (sampleLog2 > 0) ? ADC_CTRLB_RESSEL_16BIT_Val : ADC_CTRLB_RESSEL_12BIT_Val;
+  SyncADC();
+  ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM(sampleLog2) | ADC_AVGCTRL_ADJRES(adjRes);
+  SyncADC();
+  ADC->CTRLA.bit.ENABLE = 1;
+  SyncADC();
+
+  //Same start/clear/start sequence as analogRead(): the first result after a mux change is not used
+  ADC->SWTRIG.bit.START = 1;
+  ADC->INTFLAG.reg = ADC_INTFLAG_RESRDY;
+  SyncADC();
+  ADC->SWTRIG.bit.START = 1;
+  while(ADC->INTFLAG.bit.RESRDY == 0);
+  uint16_t result = ADC->RESULT.reg;
+
+  SyncADC();
+  ADC->CTRLA.bit.ENABLE = 0;
+  SyncADC();
+  ADC->AVGCTRL.reg = avgctrl;
+  SyncADC();
+  ADC->CTRLB.reg = ctrlb;
+  SyncADC();
+
+  value = (bits < 12) ? (result >> (12 - bits)) : result;
+
+  return true;
+}
+#endif
+
+
+/************************************
+SystemBus() - Returns the shared Wire-backed bus.
+return: reference to the bus instance
+*************************************/
+SensorBus &SystemBus(void){
+  static WireSensorBus wireBus;
+  return wireBus;
+}
+
+#endif
+
+
+/************************************
+SAMDAdcAveraging() - Averaging settings for the SAMD21 12-bit ADC. Up to 12 bits, 4 samples are
+averaged back to 12 bits for noise only; beyond that each extra bit needs 4x the samples. Past 16 samples the ADC shifts the sum right by
+itself (log2(samples) - 4 bits), which ADJRES tops up to reach the target resolution.
+*************************************/
+bool SAMDAdcAveraging(uint8_t bits, uint8_t &sampleLog2, uint8_t &adjRes){
+
+  if(bits < ANALOG_NATIVE_BITS || bits > ANALOG_MAX_BITS){ return false; }
+
+  if(bits <= 12){
+    sampleLog2 = 2;
+    adjRes = 2;
+    return true;
+  }
+
+  uint8_t extra = bits - 12;
+  uint8_t autoShift = 0;
+  sampleLog2 = 2 * extra;
+  if(sampleLog2 > 4){ autoShift = sampleLog2 - 4; }
+  adjRes = extra - autoShift;
+
+  return true;
+}
@@ -0,0 +1,76 @@
+/********************************************
+  SensorBus.h - Injectable I2C + analog/digital input bus used by the PlantMantra sensor drivers.
+  On the Arduino the bus forwards to Wire and analogRead(); on a Linux host
+  the drivers run against SimBus, which emulates the SI1145 and MCP9808.
+*********************************************/
+
+#ifndef SensorBus_h
+#define SensorBus_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Wire.h>
+#else
+#include "HostPlatform.h"
+#endif
+
+/******** I2C Status Codes (match Wire.endTransmission) ********/
+#define BUS_OK 0
+#define BUS_ERR_DATA_TOO_LONG 1
+#define BUS_ERR_ADDR_NACK 2
+#define BUS_ERR_DATA_NACK 3
+#define BUS_ERR_OTHER 4
+
+/******** Bus Limits ********/
+#define BUS_BUFFER_LENGTH 32
+
+/******** Analog Resolution ********/
+#define ANALOG_NATIVE_BITS 10
+#define ANALOG_MAX_BITS 16
+
+
+class SensorBus{
+  public:
+    virtual ~SensorBus(void){}
+    virtual void BeginTransmission(uint8_t address) = 0;
+    virtual uint8_t Write(uint8_t data) = 0;
+    virtual uint8_t EndTransmission(bool sendStop = true) = 0;
+    virtual uint8_t RequestFrom(uint8_t address, uint8_t quantity) = 0;
+    virtual int Read(void) = 0;
+    virtual int Available(void) = 0;
+    virtual uint16_t AnalogRead(uint8_t pin) = 0;
+    virtual uint8_t DigitalRead(uint8_t pin) = 0;
+
+    //Hardware oversampling: a bus whose ADC can average in hardware returns the pin level with
+    //`bits` of resolution (ANALOG_NATIVE_BITS+1 - ANALOG_MAX_BITS). Default: not supported.
+    virtual bool AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value){ (void)pin; (void)bits; (void)value; return false; }
+};
+
+
+#ifdef ARDUINO
+class WireSensorBus : public SensorBus{
+  public:
+    void BeginTransmission(uint8_t address);
+    uint8_t Write(uint8_t data);
+    uint8_t EndTransmission(bool sendStop = true);
+    uint8_t RequestFrom(uint8_t address, uint8_t quantity);
+    int Read(void);
+    int Available(void);
+    uint16_t AnalogRead(uint8_t pin);
+    uint8_t DigitalRead(uint8_t pin);
+#ifdef ARDUINO_ARCH_SAMD
+    bool AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value);
+#endif
+};
+#endif
+
+//SAMDAdcAveraging() - SAMD21 ADC averaging settings giving `bits` of resolution from its 12-bit converter
+//(datasheet 33.6.7): sampleLog2 -> AVGCTRL.SAMPLENUM (log2 of the sample count), adjRes -> AVGCTRL.ADJRES.
+//return: false if bits is outside ANALOG_NATIVE_BITS - ANALOG_MAX_BITS
+bool SAMDAdcAveraging(uint8_t bits, uint8_t &sampleLog2, uint8_t &adjRes);
+
+//SystemBus() returns the bus the drivers use when none is passed to their constructor.
+//Arduino: the Wire/analogRead bus.  Host: the shared SimBus instance.
+SensorBus &SystemBus(void);
+
+#endif
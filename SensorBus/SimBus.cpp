@@ -0,0 +1,708 @@
+/********************************************
+  SimBus.cc - Host-side simulated sensor bus with SI1145 and MCP9808 emulation.
+  Register behaviour follows the SI1145 and MCP9808 datasheets closely enough for
+  the drivers' command/response handshakes, auto-increment and shutdown logic.
+*********************************************/
+
+#include "SimBus.h"
+
+#ifndef ARDUINO
+
+#include <math.h>
+
+/******** SI1145 Register/Command Map (datasheet values) ********/
+static const uint8_t SI_PART_ID = 0x00;
+static const uint8_t SI_REV_ID = 0x01;
+static const uint8_t SI_SEQ_ID = 0x02;
+static const uint8_t SI_INT_CFG = 0x03;
+static const uint8_t SI_IRQ_ENABLE = 0x04;
+static const uint8_t SI_HW_KEY = 0x07;
+static const uint8_t SI_MEAS_RATE0 = 0x08;
+static const uint8_t SI_MEAS_RATE1 = 0x09;
+static const uint8_t SI_PARAM_WR = 0x17;
+static const uint8_t SI_COMMAND = 0x18;
+static const uint8_t SI_RESPONSE = 0x20;
+static const uint8_t SI_IRQ_STATUS = 0x21;
+static const uint8_t SI_VIS_DATA0 = 0x22;
+static const uint8_t SI_IR_DATA0 = 0x24;
+static const uint8_t SI_PARAM_RD = 0x2E;
+
+static const uint8_t SI_RAM_CHLIST = 0x01;
+static const uint8_t SI_RAM_PS_ADC_COUNTER = 0x0A;
+static const uint8_t SI_RAM_VIS_ADC_COUNTER = 0x10;
+static const uint8_t SI_RAM_VIS_ADC_GAIN = 0x11;
+static const uint8_t SI_RAM_VIS_ADC_MISC = 0x12;
+static const uint8_t SI_RAM_IR_ADC_COUNTER = 0x1D;
+static const uint8_t SI_RAM_IR_ADC_GAIN = 0x1E;
+static const uint8_t SI_RAM_IR_ADC_MISC = 0x1F;
+
+static const uint8_t SI_CMD_NOP = 0x00;
+static const uint8_t SI_CMD_RESET = 0x01;
+static const uint8_t SI_CMD_ALS_FORCE = 0x06;
+static const uint8_t SI_CMD_ALS_PAUSE = 0x0A;
+static const uint8_t SI_CMD_PSALS_PAUSE = 0x0B;
+static const uint8_t SI_CMD_ALS_AUTO = 0x0E;
+static const uint8_t SI_CMD_PSALS_AUTO = 0x0F;
+static const uint8_t SI_CMD_GET_CAL = 0x12;
+static const uint8_t SI_CMD_PARAM_QUERY = 0x80;
+static const uint8_t SI_CMD_PARAM_SET = 0xA0;
+
+//Sensitivity and timing model for the ALS photodiodes (gain 0, normal range)
+static const float SI_VIS_COUNTS_PER_LUX = 0.282f;
+static const float SI_IR_COUNTS_PER_LUX = 2.44f;
+static const float SI_HIGH_RANGE_DIVIDER = 14.5f;
+static const uint32_t SI_ALS_BASE_US = 155;
+static const uint32_t SI_ALS_PER_GAIN_US = 410;
+
+/******** MCP9808 Register Map ********/
+static const uint8_t MCP_CONFIG = 0x1;
+static const uint8_t MCP_UPPER = 0x2;
+static const uint8_t MCP_LOWER = 0x3;
+static const uint8_t MCP_CRIT = 0x4;
+static const uint8_t MCP_TA = 0x5;
+static const uint8_t MCP_MANUF = 0x6;
+static const uint8_t MCP_DEVID = 0x7;
+static const uint8_t MCP_RES = 0x8;
+static const uint16_t MCP_SHDN = 0x0100;
+static const uint16_t MCP_ALERT_MODE = 0x0001;
+static const uint16_t MCP_ALERT_SEL = 0x0004;
+static const uint16_t MCP_ALERT_CNT = 0x0008;
+static const uint16_t MCP_ALERT_STAT = 0x0010;
+static const uint16_t MCP_INT_CLEAR = 0x0020;
+static const uint32_t MCP_TCONV_MS[4] = {30, 65, 130, 250};
+
+
+//Sign-extend a 13-bit MCP9808 temperature field (1/16 degC units)
+static int16_t Mcp13BitToInt(uint16_t raw){
+  int16_t value = raw & 0x1FFF;
+  if(value & 0x1000){ value -= 0x2000; }
+  return value;
+}
+
+
+/**************************************************************/
+/*----------------------- SI1145 Model -----------------------*/
+/**************************************************************/
+
+SimSI1145::SimSI1145(void){
+  _visLux = 0;
+  _irLux = 0;
+  CommandsIssued = 0;
+  AutoMeasurements = 0;
+  ParamWriteMask = 0xFF;
+  MeasureError = 0;
+  Reset();
+}
+
+/************************************
+Reset() - Restores power-on register and parameter RAM contents.
+*************************************/
+void SimSI1145::Reset(void){
+  memset(Reg, 0, sizeof(Reg));
+  memset(Ram, 0, sizeof(Ram));
+
+  Reg[SI_PART_ID] = 0x45;
+  Reg[SI_REV_ID] = 0x00;
+  Reg[SI_SEQ_ID] = 0x08;
+
+  Ram[SI_RAM_PS_ADC_COUNTER] = 0x70;
+  Ram[SI_RAM_VIS_ADC_COUNTER] = 0x70;
+  Ram[SI_RAM_IR_ADC_COUNTER] = 0x70;
+
+  _pointer = 0;
+  _autoIncrement = true;
+  _alsPending = false;
+  _alsDoneMicros = 0;
+  _autoAls = false;
+  _nextAutoMicros = 0;
+}
+
+/************************************
+SetAmbient() - Sets the light level seen by the simulated photodiodes.
+Inputs: visLux -> visible illuminance; irLux -> IR illuminance
+*************************************/
+void SimSI1145::SetAmbient(float visLux, float irLux){
+  _visLux = visLux;
+  _irLux = irLux;
+}
+
+/************************************
+I2CWrite() - First byte selects the register (bit 6 disables auto-increment), the rest are written.
+*************************************/
+void SimSI1145::I2CWrite(const uint8_t *data, uint8_t length){
+
+  Update();
+  if(length == 0){ return; }
+
+  _pointer = data[0] & 0x3F;
+  _autoIncrement = (data[0] & 0x40) == 0;
+
+  for(uint8_t i = 1; i < length; i++){
+
+    if(_pointer == SI_IRQ_STATUS){ Reg[SI_IRQ_STATUS] &= ~data[i]; }
+    else if(_pointer == SI_COMMAND){ Reg[SI_COMMAND] = data[i]; RunCommand(data[i]); }
+    else if(_pointer < SI_RESPONSE){ Reg[_pointer] = data[i]; }
+
+    if(_autoIncrement){ _pointer = (_pointer + 1) & 0x3F; }
+  }
+}
+
+/************************************
+I2CRead() - Returns the byte at the register pointer, advancing it unless auto-increment is off.
+*************************************/
+uint8_t SimSI1145::I2CRead(void){
+
+  Update();
+
+  uint8_t value = Reg[_pointer];
+  if(_autoIncrement){ _pointer = (_pointer + 1) & 0x3F; }
+
+  return value;
+}
+
+/************************************
+InterruptAsserted() - INT pin is driven low while an enabled interrupt flag is set and INT_OE is on.
+*************************************/
+bool SimSI1145::InterruptAsserted(void){
+
+  Update();
+  return (Reg[SI_INT_CFG] & 0x01) && (Reg[SI_IRQ_STATUS] & Reg[SI_IRQ_ENABLE]);
+}
+
+/************************************
+Update() - Completes a pending forced ALS conversion once the simulated clock passes its finish time,
+and runs the autonomous measurements due since the last call (MEAS_RATE x 31.25 us apart). Only the
+latest of those is kept in the data registers, as on the device when the host falls behind.
+*************************************/
+void SimSI1145::Update(void){
+
+  uint64_t now = HostMicros64();
+
+  if(_alsPending && now >= _alsDoneMicros){
+    _alsPending = false;
+    Measure(true);
+  }
+
+  uint64_t period = (uint64_t)((Reg[SI_MEAS_RATE1] << 8) | Reg[SI_MEAS_RATE0]) * 3125 / 100;
+  if(_autoAls && period > 0 && now >= _nextAutoMicros){
+    uint64_t due = (now - _nextAutoMicros) / period + 1;
+    AutoMeasurements += due;
+    _nextAutoMicros += due * period;
+    Measure(false);
+  }
+}
+
+/************************************
+Measure() - Writes one ALS measurement to the data registers and raises the ALS interrupt flag.
+Forced measurements also advance RESPONSE; autonomous ones only report overflows there.
+*************************************/
+void SimSI1145::Measure(bool forced){
+
+  uint8_t chlist = Ram[SI_RAM_CHLIST];
+  bool visOverflow = false;
+  bool irOverflow = false;
+
+  if(chlist & 0x10){
+    uint16_t vis = ComputeCounts(_visLux * SI_VIS_COUNTS_PER_LUX, SI_RAM_VIS_ADC_GAIN, SI_RAM_VIS_ADC_MISC, &visOverflow);
+    Reg[SI_VIS_DATA0] = vis & 0xFF;
+    Reg[SI_VIS_DATA0 + 1] = vis >> 8;
+  }
+  if(chlist & 0x20){
+    uint16_t ir = ComputeCounts(_irLux * SI_IR_COUNTS_PER_LUX, SI_RAM_IR_ADC_GAIN, SI_RAM_IR_ADC_MISC, &irOverflow);
+    Reg[SI_IR_DATA0] = ir & 0xFF;
+    Reg[SI_IR_DATA0 + 1] = ir >> 8;
+  }
+
+  if(MeasureError != 0){ Reg[SI_RESPONSE] = MeasureError; }
+  else if(visOverflow){ Reg[SI_RESPONSE] = 0x8C; }
+  else if(irOverflow){ Reg[SI_RESPONSE] = 0x8D; }
+  else if(forced){ BumpResponse(); }
+
+  //ALS_IE raises the ALS interrupt flag
+  if(Reg[SI_IRQ_ENABLE] & 0x01){ Reg[SI_IRQ_STATUS] |= 0x01; }
+}
+
+/************************************
+ComputeCounts() - Converts a light level to ADC counts using the channel's gain and range RAM settings.
+*************************************/
+uint16_t SimSI1145::ComputeCounts(float signal, uint8_t gainOffset, uint8_t miscOffset, bool *overflow){
+
+  float counts = signal * (float)(1 << (Ram[gainOffset] & 0x07));
+  if(Ram[miscOffset] & 0x20){ counts /= SI_HIGH_RANGE_DIVIDER; }
+  counts += SIM_SI1145_DARK_COUNTS;
+
+  if(counts >= 65535.0f){ *overflow = true; return 0xFFFF; }
+  return (uint16_t)counts;
+}
+
+/************************************
+RunCommand() - Executes a COMMAND register write the way the SI1145 sequencer does.
+*************************************/
+void SimSI1145::RunCommand(uint8_t command){
+
+  CommandsIssued++;
+
+  //Sequencer ignores everything until HW_KEY is unlocked
+  if(Reg[SI_HW_KEY] != 0x17 && command != SI_CMD_RESET){ return; }
+
+  if(command == SI_CMD_NOP){ Reg[SI_RESPONSE] = 0; return; }
+  if(command == SI_CMD_RESET){ Reset(); return; }
+
+  //An error code in RESPONSE blocks further commands until NOP
+  if(Reg[SI_RESPONSE] & 0x80){ return; }
+
+  if((command & 0xE0) == SI_CMD_PARAM_QUERY){
+    Reg[SI_PARAM_RD] = Ram[command & 0x1F];
+    BumpResponse();
+  }
+  else if((command & 0xE0) == SI_CMD_PARAM_SET){
+    Ram[command & 0x1F] = Reg[SI_PARAM_WR] & ParamWriteMask;
+    Reg[SI_PARAM_RD] = Ram[command & 0x1F];
+    BumpResponse();
+  }
+  else if(command == SI_CMD_ALS_FORCE){
+    uint32_t convMicros = 0;
+    if(Ram[SI_RAM_CHLIST] & 0x10){ convMicros += SI_ALS_BASE_US + SI_ALS_PER_GAIN_US * (1 << (Ram[SI_RAM_VIS_ADC_GAIN] & 0x07)); }
+    if(Ram[SI_RAM_CHLIST] & 0x20){ convMicros += SI_ALS_BASE_US + SI_ALS_PER_GAIN_US * (1 << (Ram[SI_RAM_IR_ADC_GAIN] & 0x07)); }
+    _alsPending = true;
+    _alsDoneMicros = HostMicros64() + convMicros;
+  }
+  else if(command == SI_CMD_ALS_AUTO || command == SI_CMD_PSALS_AUTO){
+    uint64_t period = (uint64_t)((Reg[SI_MEAS_RATE1] << 8) | Reg[SI_MEAS_RATE0]) * 3125 / 100;
+    _autoAls = true;
+    _nextAutoMicros = HostMicros64() + period;
+    BumpResponse();
+  }
+  else if(command == SI_CMD_ALS_PAUSE || command == SI_CMD_PSALS_PAUSE){
+    _autoAls = false;
+    BumpResponse();
+  }
+  else if(command == SI_CMD_GET_CAL){
+    BumpResponse();
+  }
+}
+
+void SimSI1145::BumpResponse(void){ Reg[SI_RESPONSE] = (Reg[SI_RESPONSE] + 1) & 0x0F; }
+
+
+/**************************************************************/
+/*---------------------- MCP9808 Model -----------------------*/
+/**************************************************************/
+
+SimMCP9808::SimMCP9808(void){
+  _celsius = 22.0f;
+  Reset();
+}
+
+/************************************
+Reset() - Restores power-on register contents.
+*************************************/
+void SimMCP9808::Reset(void){
+  memset(Reg, 0, sizeof(Reg));
+  Reg[MCP_MANUF] = 0x0054;
+  Reg[MCP_DEVID] = 0x0400;
+  Reg[MCP_RES] = 0x03;
+  Reg[MCP_TA] = EncodeTemperature(_celsius);
+  _pointer = 0;
+  _readIndex = 0;
+  _convStartMicros = HostMicros64();
+  _outside = false;
+  _critical = false;
+  _alertLatched = false;
+}
+
+/************************************
+SetTemperature() - Sets the die temperature; picked up at the next completed conversion.
+Inputs: celsius -> ambient temperature
+*************************************/
+void SimMCP9808::SetTemperature(float celsius){ _celsius = celsius; }
+
+/************************************
+I2CWrite() - First byte is the register pointer, followed by MSB/LSB (or one byte for resolution).
+*************************************/
+void SimMCP9808::I2CWrite(const uint8_t *data, uint8_t length){
+
+  Update();
+  if(length == 0){ return; }
+
+  _pointer = data[0] & 0x0F;
+  _readIndex = 0;
+
+  if(_pointer == MCP_RES && length >= 2){ Reg[MCP_RES] = data[1] & 0x03; }
+  else if(_pointer >= MCP_CONFIG && _pointer <= MCP_CRIT && length >= 3){
+
+    uint16_t value = (data[1] << 8) | data[2];
+    if(_pointer != MCP_CONFIG){ value &= 0x1FFC; }
+
+    //Leaving shutdown starts a fresh conversion
+    if(_pointer == MCP_CONFIG && (Reg[MCP_CONFIG] & MCP_SHDN) && !(value & MCP_SHDN)){ _convStartMicros = HostMicros64(); }
+
+    //Interrupt clear and alert status are not stored (clear reads back 0, status is live)
+    //(conversions finished before the write are compared first, so a clear covers them too)
+    if(_pointer == MCP_CONFIG){
+      Update();
+      if(value & MCP_INT_CLEAR){ _alertLatched = false; }
+      value &= ~(MCP_INT_CLEAR | MCP_ALERT_STAT);
+    }
+
+    Reg[_pointer] = value;
+  }
+}
+
+void SimMCP9808::I2CReadStart(void){ _readIndex = 0; }
+
+/************************************
+I2CRead() - Returns the MSB then LSB of the selected register (resolution register is one byte).
+*************************************/
+uint8_t SimMCP9808::I2CRead(void){
+
+  Update();
+  if(_pointer >= SIM_MCP9808_REGS){ return 0; }
+  if(_pointer == MCP_RES){ return Reg[MCP_RES]; }
+
+  uint16_t value = Reg[_pointer];
+  if(_pointer == MCP_CONFIG && AlertActive()){ value |= MCP_ALERT_STAT; }
+  return ((_readIndex++ & 1) == 0) ? (value >> 8) : (value & 0xFF);
+}
+
+/************************************
+Update() - Latches a new ambient reading each time a conversion period elapses (continuous mode only).
+*************************************/
+void SimMCP9808::Update(void){
+
+  if(Reg[MCP_CONFIG] & MCP_SHDN){ return; }
+
+  uint64_t now = HostMicros64();
+  if(now - _convStartMicros < ConversionMicros()){ return; }
+  _convStartMicros = now;
+
+  uint16_t ta = EncodeTemperature(_celsius);
+  int16_t value = Mcp13BitToInt(ta);
+
+  if(value >= Mcp13BitToInt(Reg[MCP_CRIT])){ ta |= 0x8000; }
+  if(value > Mcp13BitToInt(Reg[MCP_UPPER])){ ta |= 0x4000; }
+  if(value < Mcp13BitToInt(Reg[MCP_LOWER])){ ta |= 0x2000; }
+
+  Reg[MCP_TA] = ta;
+
+  //Interrupt mode latches every crossing of the window (either direction) until Interrupt Clear
+  bool outside = (ta & 0x6000) != 0;
+  uint16_t latching = MCP_ALERT_CNT | MCP_ALERT_MODE;
+  if((Reg[MCP_CONFIG] & latching) == latching && outside != _outside){ _alertLatched = true; }
+  _outside = outside;
+  _critical = (ta & 0x8000) != 0;
+}
+
+/************************************
+AlertActive() - State of the Alert output: T_CRIT always acts as a comparator; the window is a
+comparator or a latched interrupt depending on Alert Mode. Only active-low polarity is modelled.
+*************************************/
+bool SimMCP9808::AlertActive(void){
+
+  uint16_t config = Reg[MCP_CONFIG];
+
+  if(!(config & MCP_ALERT_CNT)){ return false; }
+  if(_critical){ return true; }
+  if(config & MCP_ALERT_SEL){ return false; }
+
+  return (config & MCP_ALERT_MODE) ? _alertLatched : _outside;
+}
+
+/************************************
+InterruptAsserted() - Alert pin (open drain, active low) is driven while the alert output is active.
+*************************************/
+bool SimMCP9808::InterruptAsserted(void){
+
+  Update();
+  return AlertActive();
+}
+
+uint32_t SimMCP9808::ConversionMicros(void){ return MCP_TCONV_MS[Reg[MCP_RES] & 0x03] * 1000; }
+
+/************************************
+EncodeTemperature() - Converts degC to the 13-bit two's complement TA field at the current resolution.
+*************************************/
+uint16_t SimMCP9808::EncodeTemperature(float celsius){
+
+  int16_t sixteenths = (int16_t)floorf(celsius * 16.0f);
+
+  //Drop the fraction bits the selected resolution does not produce
+  uint8_t droppedBits = 3 - (Reg[MCP_RES] & 0x03);
+  sixteenths &= ~((1 << droppedBits) - 1);
+
+  return sixteenths & 0x1FFF;
+}
+
+
+/**************************************************************/
+/*--------------------- TCA9548A Model -----------------------*/
+/**************************************************************/
+
+SimTCA9548A::SimTCA9548A(void){
+  Control = 0;
+  ControlWrites = 0;
+  _deviceCount = 0;
+}
+
+/************************************
+Attach() - Places a simulated device on one downstream channel.
+*************************************/
+void SimTCA9548A::Attach(uint8_t channel, uint8_t address, SimI2CDevice *device){
+  if(_deviceCount >= SIM_MUX_MAX_DEVICES || channel >= SIM_MUX_CHANNELS){ return; }
+  _channels[_deviceCount] = channel;
+  _addresses[_deviceCount] = address;
+  _devices[_deviceCount] = device;
+  _deviceCount++;
+}
+
+//Every written byte lands in the control register; the last one wins
+void SimTCA9548A::I2CWrite(const uint8_t *data, uint8_t length){
+  if(length == 0){ return; }
+  Control = data[length - 1];
+  ControlWrites++;
+}
+
+uint8_t SimTCA9548A::I2CRead(void){ return Control; }
+
+SimI2CDevice *SimTCA9548A::Route(uint8_t address){
+  for(uint8_t i = 0; i < _deviceCount; i++){
+    if(_addresses[i] == address && (Control & (1 << _channels[i]))){ return _devices[i]; }
+  }
+  return 0;
+}
+
+
+/**************************************************************/
+/*------------------------ Bus Model -------------------------*/
+/**************************************************************/
+
+SimBus::SimBus(void){
+  _deviceCount = 0;
+  _clockHz = SIM_DEFAULT_I2C_HZ;
+  _txAddress = 0;
+  _txLength = 0;
+  _rxLength = 0;
+  _rxIndex = 0;
+  _noiseState = 0x2545F491;
+  _hardwareAveraging = true;
+
+  for(int i = 0; i < SIM_MAX_ANALOG_PINS; i++){ _analogLevel[i] = 0; _analogNoise[i] = 0; }
+  for(int i = 0; i < SIM_MAX_DIGITAL_PINS; i++){ _interruptSource[i] = 0; }
+
+  Attach(0x60, &Sunlight);
+  Attach(0x18, &Temp);
+  ResetStats();
+}
+
+/************************************
+Attach() - Places a simulated device at a 7-bit I2C address.
+*************************************/
+void SimBus::Attach(uint8_t address, SimI2CDevice *device){
+  if(_deviceCount >= SIM_MAX_DEVICES){ return; }
+  _addresses[_deviceCount] = address;
+  _devices[_deviceCount] = device;
+  _deviceCount++;
+}
+
+void SimBus::SetClockHz(uint32_t hz){ _clockHz = hz; }
+
+/************************************
+SetAnalog() - Sets the level (in ADC counts) and gaussian noise (std dev, counts) seen on an analog pin.
+*************************************/
+void SimBus::SetAnalog(uint8_t pin, float level, float noise){
+  if(pin >= SIM_MAX_ANALOG_PINS){ return; }
+  _analogLevel[pin] = level;
+  _analogNoise[pin] = noise;
+}
+
+/************************************
+ConnectInterrupt() - Wires a device's open-drain interrupt output to a digital pin.
+*************************************/
+void SimBus::ConnectInterrupt(uint8_t pin, SimI2CDevice *device){
+  if(pin >= SIM_MAX_DIGITAL_PINS){ return; }
+  _interruptSource[pin] = device;
+}
+
+/************************************
+SetHardwareAveraging() - Enables the SAMD21 ADC accumulator behind AnalogReadHighRes(). On by default
+like the Nano 33 IoT; turn it off to exercise the drivers' software oversampling path.
+*************************************/
+void SimBus::SetHardwareAveraging(bool enable){ _hardwareAveraging = enable; }
+
+void SimBus::ResetStats(void){ memset(&Stats, 0, sizeof(Stats)); }
+
+/************************************
+Detach() - Removes the device at an address (e.g. to move the default SI1145 behind a mux).
+*************************************/
+void SimBus::Detach(uint8_t address){
+  for(uint8_t i = 0; i < _deviceCount; i++){
+    if(_addresses[i] != address){ continue; }
+    _deviceCount--;
+    _addresses[i] = _addresses[_deviceCount];
+    _devices[i] = _devices[_deviceCount];
+    return;
+  }
+}
+
+/************************************
+FindDevice() - Device answering an address: one on the bus itself, else one behind an enabled switch channel.
+*************************************/
+SimI2CDevice *SimBus::FindDevice(uint8_t address){
+  for(uint8_t i = 0; i < _deviceCount; i++){
+    if(_addresses[i] == address){ return _devices[i]; }
+  }
+  for(uint8_t i = 0; i < _deviceCount; i++){
+    SimI2CDevice *device = _devices[i]->Route(address);
+    if(device != 0){ return device; }
+  }
+  return 0;
+}
+
+/************************************
+ChargeFrame() - Accounts one I2C frame: START + address + data bytes (9 clocks each) + STOP.
+*************************************/
+void SimBus::ChargeFrame(uint8_t dataBytes){
+  uint32_t bits = 9 * (dataBytes + 1) + 2;
+  uint32_t micros = (bits * 1000000UL + _clockHz - 1) / _clockHz;
+
+  Stats.Transactions++;
+  Stats.BusTimeMicros += micros;
+  HostAdvanceMicros(micros);
+}
+
+void SimBus::BeginTransmission(uint8_t address){
+  _txAddress = address;
+  _txLength = 0;
+}
+
+uint8_t SimBus::Write(uint8_t data){
+  if(_txLength >= BUS_BUFFER_LENGTH){ return 0; }
+  _txBuffer[_txLength++] = data;
+  return 1;
+}
+
+uint8_t SimBus::EndTransmission(bool sendStop){
+
+  (void)sendStop;
+  SimI2CDevice *device = FindDevice(_txAddress);
+
+  if(device == 0){ ChargeFrame(0); return BUS_ERR_ADDR_NACK; }
+
+  ChargeFrame(_txLength);
+  Stats.BytesWritten += _txLength;
+  device->I2CWrite(_txBuffer, _txLength);
+  _txLength = 0;
+
+  return BUS_OK;
+}
+
+uint8_t SimBus::RequestFrom(uint8_t address, uint8_t quantity){
+
+  SimI2CDevice *device = FindDevice(address);
+  _rxLength = 0;
+  _rxIndex = 0;
+
+  if(device == 0){ ChargeFrame(0); return 0; }
+  if(quantity > BUS_BUFFER_LENGTH){ quantity = BUS_BUFFER_LENGTH; }
+
+  ChargeFrame(quantity);
+  Stats.BytesRead += quantity;
+
+  device->I2CReadStart();
+  for(uint8_t i = 0; i < quantity; i++){ _rxBuffer[i] = device->I2CRead(); }
+  _rxLength = quantity;
+
+  return quantity;
+}
+
+int SimBus::Read(void){
+  if(_rxIndex >= _rxLength){ return -1; }
+  return _rxBuffer[_rxIndex++];
+}
+
+int SimBus::Available(void){ return _rxLength - _rxIndex; }
+
+/************************************
+AnalogRead() - Returns a 10-bit conversion of the pin level plus noise, costing one ADC conversion time.
+*************************************/
+uint16_t SimBus::AnalogRead(uint8_t pin){
+
+  Stats.AnalogReads++;
+  HostAdvanceMicros(SIM_ADC_CONVERSION_US);
+  if(pin >= SIM_MAX_ANALOG_PINS){ return 0; }
+
+  float value = _analogLevel[pin] + _analogNoise[pin] * NoiseSample();
+  if(value < 0){ value = 0; }
+  if(value > 1023){ value = 1023; }
+
+  return (uint16_t)(value + 0.5f);
+}
+
+/************************************
+AnalogReadHighRes() - SAMD21 hardware averaging: 12-bit samples accumulated, auto-shifted and
+ADJRES-shifted as the ADC does, costing one discarded conversion plus one per accumulated sample.
+*************************************/
+bool SimBus::AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value){
+
+  uint8_t sampleLog2;
+  uint8_t adjRes;
+  if(!_hardwareAveraging || !SAMDAdcAveraging(bits, sampleLog2, adjRes)){ return false; }
+
+  uint32_t samples = 1UL << sampleLog2;
+  Stats.AnalogReads++;
+  HostAdvanceMicros((uint64_t)(samples + 1) * SIM_ADC_HW_SAMPLE_US);
+  if(pin >= SIM_MAX_ANALOG_PINS){ value = 0; return true; }
+
+  //Pin levels are kept in 10-bit counts; the 12-bit converter sees four times that
+  uint32_t sum = 0;
+  for(uint32_t i = 0; i < samples; i++){
+    float sample = 4 * (_analogLevel[pin] + _analogNoise[pin] * NoiseSample());
+    if(sample < 0){ sample = 0; }
+    if(sample > 4095){ sample = 4095; }
+    sum += (uint32_t)(sample + 0.5f);
+  }
+
+  uint8_t autoShift = (sampleLog2 > 4) ? sampleLog2 - 4 : 0;
+  sum >>= autoShift + adjRes;
+  value = (bits < 12) ? (sum >> (12 - bits)) : sum;
+
+  return true;
+}
+
+/************************************
+DigitalRead() - Reads a pin; pins wired to an interrupt output read LOW while it is asserted (pulled up otherwise).
+*************************************/
+uint8_t SimBus::DigitalRead(uint8_t pin){
+
+  HostAdvanceMicros(SIM_GPIO_READ_US);
+  if(pin >= SIM_MAX_DIGITAL_PINS || _interruptSource[pin] == 0){ return HIGH; }
+
+  return _interruptSource[pin]->InterruptAsserted() ? LOW : HIGH;
+}
+
+/************************************
+NoiseSample() - Unit-variance approximately gaussian noise (sum of four uniforms), deterministic seed.
+*************************************/
+float SimBus::NoiseSample(void){
+  float sum = 0;
+  for(int i = 0; i < 4; i++){
+    _noiseState ^= _noiseState << 13;
+    _noiseState ^= _noiseState >> 17;
+    _noiseState ^= _noiseState << 5;
+    sum += (float)(_noiseState & 0xFFFF) / 65535.0f - 0.5f;
+  }
+  return sum * 1.7320508f;
+}
+
+
+/************************************
+HostSimBus() / SystemBus() - Host builds run the drivers against a shared SimBus instance.
+*************************************/
+SimBus &HostSimBus(void){
+  static SimBus simBus;
+  return simBus;
+}
+
+SensorBus &SystemBus(void){ return HostSimBus(); }
+
+#endif
@@ -0,0 +1,187 @@
+/********************************************
+  SimBus.h - Host-side simulated sensor bus.
+  Emulates the SI1145 register map + parameter RAM, the MCP9808 register file and
+  the Nano's analog inputs, and counts the I2C transactions, bytes and bus time
+  every driver call costs so they can be profiled off the device.
+*********************************************/
+
+#ifndef SimBus_h
+#define SimBus_h
+
+#ifndef ARDUINO
+
+#include "SensorBus.h"
+
+/******** Simulation Limits ********/
+#define SIM_MAX_DEVICES 16
+#define SIM_MAX_ANALOG_PINS 32
+#define SIM_MAX_DIGITAL_PINS 32
+#define SIM_GPIO_READ_US 1
+#define SIM_DEFAULT_I2C_HZ 100000
+#define SIM_ADC_CONVERSION_US 425
+#define SIM_ADC_HW_SAMPLE_US 180
+
+/******** SI1145 Emulation ********/
+#define SIM_SI1145_REGS 0x40
+#define SIM_SI1145_RAM 0x20
+#define SIM_SI1145_DARK_COUNTS 256
+
+/******** MCP9808 Emulation ********/
+#define SIM_MCP9808_REGS 0x09
+
+/******** TCA9548A Emulation ********/
+#define SIM_MUX_CHANNELS 8
+#define SIM_MUX_MAX_DEVICES 16
+
+
+//SimI2CDevice - one peripheral on the simulated bus.
+//I2CWrite receives every byte of a write frame; I2CRead supplies one byte of a read frame.
+//Route() lets a bus switch expose the devices on its enabled downstream channels.
+class SimI2CDevice{
+  public:
+    virtual void I2CWrite(const uint8_t *data, uint8_t length) = 0;
+    virtual void I2CReadStart(void){}
+    virtual uint8_t I2CRead(void) = 0;
+    virtual bool InterruptAsserted(void){ return false; }
+    virtual SimI2CDevice *Route(uint8_t address){ (void)address; return 0; }
+};
+
+
+class SimSI1145 : public SimI2CDevice{
+  public:
+    SimSI1145(void);
+    void Reset(void);
+    void SetAmbient(float visLux, float irLux);
+    void I2CWrite(const uint8_t *data, uint8_t length);
+    uint8_t I2CRead(void);
+    bool InterruptAsserted(void);
+    uint8_t Reg[SIM_SI1145_REGS];
+    uint8_t Ram[SIM_SI1145_RAM];
+    uint32_t CommandsIssued;
+    uint32_t AutoMeasurements;
+    uint8_t ParamWriteMask;   // bits PARAM_SET can store (clear one to model a stuck RAM bit)
+    uint8_t MeasureError;     // nonzero: RESPONSE error code the next measurements end with
+
+  private:
+    void Update(void);
+    void Measure(bool forced);
+    void RunCommand(uint8_t command);
+    void BumpResponse(void);
+    uint16_t ComputeCounts(float signal, uint8_t gainOffset, uint8_t miscOffset, bool *overflow);
+    uint8_t _pointer;
+    bool _autoIncrement;
+    bool _alsPending;
+    uint64_t _alsDoneMicros;
+    bool _autoAls;
+    uint64_t _nextAutoMicros;
+    float _visLux;
+    float _irLux;
+};
+
+
+class SimMCP9808 : public SimI2CDevice{
+  public:
+    SimMCP9808(void);
+    void Reset(void);
+    void SetTemperature(float celsius);
+    void I2CWrite(const uint8_t *data, uint8_t length);
+    void I2CReadStart(void);
+    uint8_t I2CRead(void);
+    bool InterruptAsserted(void);
+    uint16_t Reg[SIM_MCP9808_REGS];
+
+  private:
+    void Update(void);
+    bool AlertActive(void);
+    uint32_t ConversionMicros(void);
+    uint16_t EncodeTemperature(float celsius);
+    uint8_t _pointer;
+    uint8_t _readIndex;
+    uint64_t _convStartMicros;
+    float _celsius;
+    bool _outside;
+    bool _critical;
+    bool _alertLatched;
+};
+
+
+//SimTCA9548A - 1-to-8 I2C switch; the control register is a bit mask of connected channels.
+class SimTCA9548A : public SimI2CDevice{
+  public:
+    SimTCA9548A(void);
+    void Attach(uint8_t channel, uint8_t address, SimI2CDevice *device);
+    void I2CWrite(const uint8_t *data, uint8_t length);
+    uint8_t I2CRead(void);
+    SimI2CDevice *Route(uint8_t address);
+    uint8_t Control;
+    uint32_t ControlWrites;
+
+  private:
+    uint8_t _channels[SIM_MUX_MAX_DEVICES];
+    uint8_t _addresses[SIM_MUX_MAX_DEVICES];
+    SimI2CDevice *_devices[SIM_MUX_MAX_DEVICES];
+    uint8_t _deviceCount;
+};
+
+
+struct SimBusStats{
+  uint32_t Transactions;
+  uint32_t BytesWritten;
+  uint32_t BytesRead;
+  uint32_t AnalogReads;
+  uint64_t BusTimeMicros;
+};
+
+
+class SimBus : public SensorBus{
+  public:
+    SimBus(void);
+    void Attach(uint8_t address, SimI2CDevice *device);
+    void Detach(uint8_t address);
+    void SetClockHz(uint32_t hz);
+    void SetAnalog(uint8_t pin, float level, float noise = 0);
+    void ConnectInterrupt(uint8_t pin, SimI2CDevice *device);
+    void SetHardwareAveraging(bool enable);
+    void ResetStats(void);
+
+    void BeginTransmission(uint8_t address);
+    uint8_t Write(uint8_t data);
+    uint8_t EndTransmission(bool sendStop = true);
+    uint8_t RequestFrom(uint8_t address, uint8_t quantity);
+    int Read(void);
+    int Available(void);
+    uint16_t AnalogRead(uint8_t pin);
+    uint8_t DigitalRead(uint8_t pin);
+    bool AnalogReadHighRes(uint8_t pin, uint8_t bits, uint16_t &value);
+
+    SimSI1145 Sunlight;
+    SimMCP9808 Temp;
+    SimBusStats Stats;
+
+  private:
+    SimI2CDevice *FindDevice(uint8_t address);
+    void ChargeFrame(uint8_t dataBytes);
+    float NoiseSample(void);
+    uint8_t _addresses[SIM_MAX_DEVICES];
+    SimI2CDevice *_devices[SIM_MAX_DEVICES];
+    uint8_t _deviceCount;
+    uint32_t _clockHz;
+    uint8_t _txAddress;
+    uint8_t _txBuffer[BUS_BUFFER_LENGTH];
+    uint8_t _txLength;
+    uint8_t _rxBuffer[BUS_BUFFER_LENGTH];
+    uint8_t _rxLength;
+    uint8_t _rxIndex;
+    float _analogLevel[SIM_MAX_ANALOG_PINS];
+    float _analogNoise[SIM_MAX_ANALOG_PINS];
+    bool _hardwareAveraging;
+    SimI2CDevice *_interruptSource[SIM_MAX_DIGITAL_PINS];
+    uint32_t _noiseState;
+};
+
+//HostSimBus() returns the SimBus instance that SystemBus() hands to the drivers on a host build.
+SimBus &HostSimBus(void);
+
+#endif
+
+#endif
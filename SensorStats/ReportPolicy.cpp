@@ -0,0 +1,109 @@
+/********************************************
+  ReportPolicy.cc - Report-by-exception filter for PlantMantra samples.
+*********************************************/
+
+#include "ReportPolicy.h"
+
+//ReportPolicy.ReportPolicy -> Initializes the policy with the default deadbands.
+//The first sample evaluated is always reported.
+//Inputs: heartbeatMs -> longest time between reported samples
+ReportPolicy::ReportPolicy(unsigned long heartbeatMs){
+  _heartbeat = heartbeatMs;
+  _haveReference = false;
+  _forced = false;
+  _referenceFlags = 0;
+  _lastReport = 0;
+  _suppressed = 0;
+  _totalReported = 0;
+  _totalSuppressed = 0;
+
+  SetDeadband(REPORT_CH_MOISTURE, REPORT_MOISTURE_DEADBAND, REPORT_MOISTURE_PERCENT);
+  SetDeadband(REPORT_CH_LIGHT, REPORT_LIGHT_DEADBAND, REPORT_LIGHT_PERCENT);
+  SetDeadband(REPORT_CH_TEMPERATURE, REPORT_TEMPERATURE_DEADBAND, REPORT_TEMPERATURE_PERCENT);
+
+  for(uint8_t i = 0; i < REPORT_CHANNELS; i++){ _reference[i] = 0; }
+}
+
+/************************************
+SetDeadband() - Sets how far a channel must move from its last reported value to be reported.
+Inputs: channel -> REPORT_CH_*; absolute -> step in reading units; percent -> step as % of the last reported value
+return: none
+*************************************/
+void ReportPolicy::SetDeadband(uint8_t channel, uint16_t absolute, uint8_t percent){
+
+  if(channel >= REPORT_CHANNELS){ return; }
+
+  _absolute[channel] = absolute;
+  _percent[channel] = percent;
+
+  return;
+}
+
+void ReportPolicy::SetHeartbeat(unsigned long heartbeatMs){ _heartbeat = heartbeatMs; }
+
+/************************************
+Force() - Reports the next sample regardless of the deadbands (e.g. after an alert).
+*************************************/
+void ReportPolicy::Force(void){ _forced = true; }
+
+/************************************
+Moved() - True if value is outside the channel's deadband around its last reported value.
+*************************************/
+bool ReportPolicy::Moved(uint8_t channel, int32_t value){
+
+  int32_t reference = _reference[channel];
+  uint32_t magnitude = (reference < 0) ? -reference : reference;
+  uint32_t band = (magnitude * _percent[channel]) / 100;
+  if(band < _absolute[channel]){ band = _absolute[channel]; }
+
+  uint32_t change = (value > reference) ? value - reference : reference - value;
+
+  return change >= band;
+}
+
+/************************************
+Evaluate() - Decides whether a sample is reported. A reported sample becomes the new reference.
+Inputs: sample -> the latest sample
+return: REPORT_NONE if suppressed, otherwise the REPORT_ reason
+*************************************/
+uint8_t ReportPolicy::Evaluate(const SensorSample &sample){
+
+  int32_t values[REPORT_CHANNELS] = {sample.Moisture, (int32_t)sample.Light, sample.Temperature};
+  uint8_t reason = REPORT_NONE;
+
+  if(!_haveReference){ reason = REPORT_FIRST; }
+  else if(_forced){ reason = REPORT_FORCED; }
+  else if(sample.Flags != _referenceFlags){ reason = REPORT_FLAGS; }
+  else if(sample.Timestamp - _lastReport >= _heartbeat){ reason = REPORT_HEARTBEAT; }
+  else{
+    for(uint8_t i = 0; i < REPORT_CHANNELS; i++){
+      if(Moved(i, values[i])){ reason = REPORT_DEADBAND; }
+    }
+  }
+
+  if(reason == REPORT_NONE){
+    _suppressed++;
+    _totalSuppressed++;
+    return REPORT_NONE;
+  }
+
+  for(uint8_t i = 0; i < REPORT_CHANNELS; i++){ _reference[i] = values[i]; }
+  _referenceFlags = sample.Flags;
+  _lastReport = sample.Timestamp;
+  _haveReference = true;
+  _forced = false;
+  _totalReported++;
+
+  return reason;
+}
+
+/************************************
+Suppressed() - Samples suppressed since the last ResetSuppressed() (i.e. since the last upload).
+*************************************/
+uint32_t ReportPolicy::Suppressed(void){ return _suppressed; }
+
+void ReportPolicy::ResetSuppressed(void){ _suppressed = 0; }
+
+uint32_t ReportPolicy::TotalReported(void){ return _totalReported; }
+
+uint32_t ReportPolicy::TotalSuppressed(void){ return _totalSuppressed; }
@@ -0,0 +1,66 @@
+/********************************************
+  ReportPolicy.h - Report-by-exception filter for PlantMantra samples.
+  A sample is reported only when a channel has moved past its deadband since the
+  last reported sample, its status flags changed, or the heartbeat interval ran out;
+  everything else is counted as suppressed.
+*********************************************/
+
+#ifndef ReportPolicy_h
+#define ReportPolicy_h
+
+#include "SensorSample.h"
+
+/******** Report Reasons ********/
+#define REPORT_NONE 0
+#define REPORT_FIRST 1
+#define REPORT_DEADBAND 2
+#define REPORT_FLAGS 3
+#define REPORT_HEARTBEAT 4
+#define REPORT_FORCED 5
+
+/******** Channels ********/
+#define REPORT_CH_MOISTURE 0
+#define REPORT_CH_LIGHT 1
+#define REPORT_CH_TEMPERATURE 2
+#define REPORT_CHANNELS 3
+
+/******** Default Policy ********/
+//Deadband = the larger of an absolute step (reading units: lux for light, centi-degrees for temperature) and a
+//percentage of the last reported value
+#define REPORT_DEFAULT_HEARTBEAT_MS 3600000UL
+#define REPORT_MOISTURE_DEADBAND 8
+#define REPORT_MOISTURE_PERCENT 0
+#define REPORT_LIGHT_DEADBAND 5
+#define REPORT_LIGHT_PERCENT 10
+#define REPORT_TEMPERATURE_DEADBAND 100
+#define REPORT_TEMPERATURE_PERCENT 0
+
+
+class ReportPolicy{
+  public:
+    ReportPolicy(unsigned long heartbeatMs = REPORT_DEFAULT_HEARTBEAT_MS);
+    void SetDeadband(uint8_t channel, uint16_t absolute, uint8_t percent);
+    void SetHeartbeat(unsigned long heartbeatMs);
+    void Force(void);
+    uint8_t Evaluate(const SensorSample &sample);
+    uint32_t Suppressed(void);
+    void ResetSuppressed(void);
+    uint32_t TotalReported(void);
+    uint32_t TotalSuppressed(void);
+
+  private:
+    bool Moved(uint8_t channel, int32_t value);
+    uint16_t _absolute[REPORT_CHANNELS];
+    uint8_t _percent[REPORT_CHANNELS];
+    int32_t _reference[REPORT_CHANNELS];
+    uint8_t _referenceFlags;
+    unsigned long _lastReport;
+    unsigned long _heartbeat;
+    bool _haveReference;
+    bool _forced;
+    uint32_t _suppressed;
+    uint32_t _totalReported;
+    uint32_t _totalSuppressed;
+};
+
+#endif
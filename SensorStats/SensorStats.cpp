@@ -0,0 +1,192 @@
+/********************************************
+  SensorStats.cc - Constant-memory streaming statistics for the PlantMantra sensor channels.
+*********************************************/
+
+#include "SensorStats.h"
+
+#include <math.h>
+
+//RunningStats.RunningStats -> Initializes an empty window.
+//Inputs: ewmaAlpha -> EWMA weight of the newest value (0 - 1)
+RunningStats::RunningStats(float ewmaAlpha){
+  _alpha = ewmaAlpha;
+  _ewma = 0;
+  _ewmaValid = false;
+  Reset();
+}
+
+/************************************
+Add() - Folds one value into the window (Welford's update: no sums of squares to lose precision).
+Inputs: value -> new reading
+return: none
+*************************************/
+void RunningStats::Add(float value){
+
+  _count++;
+  float delta = value - _mean;
+  _mean += delta / _count;
+  _m2 += delta * (value - _mean);
+
+  if(_count == 1 || value < _min){ _min = value; }
+  if(_count == 1 || value > _max){ _max = value; }
+
+  _ewma = _ewmaValid ? _ewma + _alpha * (value - _ewma) : value;
+  _ewmaValid = true;
+
+  return;
+}
+
+/************************************
+Reset() - Starts a new window (count, mean, variance, min, max). The EWMA is kept.
+*************************************/
+void RunningStats::Reset(void){
+  _count = 0;
+  _mean = 0;
+  _m2 = 0;
+  _min = 0;
+  _max = 0;
+}
+
+uint32_t RunningStats::Count(void){ return _count; }
+
+float RunningStats::Mean(void){ return _mean; }
+
+/************************************
+Variance() - Sample variance of the window (0 until two values are in).
+*************************************/
+float RunningStats::Variance(void){ return (_count > 1) ? _m2 / (_count - 1) : 0; }
+
+float RunningStats::StdDev(void){ return sqrtf(Variance()); }
+
+float RunningStats::Min(void){ return _min; }
+
+float RunningStats::Max(void){ return _max; }
+
+float RunningStats::Ewma(void){ return _ewma; }
+
+
+//DailyIntegral.DailyIntegral -> Initializes an integral with no samples.
+DailyIntegral::DailyIntegral(void){
+  Reset();
+}
+
+/************************************
+Add() - Integrates the reading over the time since the previous one and rolls the day over
+every STATS_DAY_MS. Gaps longer than STATS_MAX_GAP_MS are skipped rather than bridged.
+Inputs: value -> reading; timestampMs -> millis() when it was taken
+return: none
+*************************************/
+void DailyIntegral::Add(float value, unsigned long timestampMs){
+
+  if(!_started){
+    _started = true;
+    _dayStart = timestampMs;
+  }
+  else{
+    unsigned long gap = timestampMs - _lastTime;
+    if(gap <= STATS_MAX_GAP_MS){ _today += (value + _lastValue) * 0.5f * (gap / STATS_MS_PER_HOUR); }
+  }
+
+  while(timestampMs - _dayStart >= STATS_DAY_MS){
+    _yesterday = _today;
+    _today = 0;
+    _dayStart += STATS_DAY_MS;
+  }
+
+  _lastTime = timestampMs;
+  _lastValue = value;
+
+  return;
+}
+
+float DailyIntegral::Today(void){ return _today; }
+
+/************************************
+Yesterday() - Total of the last complete day.
+*************************************/
+float DailyIntegral::Yesterday(void){ return _yesterday; }
+
+void DailyIntegral::Reset(void){
+  _started = false;
+  _dayStart = 0;
+  _lastTime = 0;
+  _lastValue = 0;
+  _today = 0;
+  _yesterday = 0;
+}
+
+
+/************************************
+Add() - Feeds one sample to every channel (temperature in degrees). Light is skipped when its measurement timed out or failed.
+*************************************/
+void SampleSummary::Add(const SensorSample &sample){
+
+  Moisture.Add(sample.Moisture);
+  Temperature.Add(sample.Temperature / 100.0f);
+
+  if(!(sample.Flags & (SAMPLE_FLAG_ALS_TIMEOUT | SAMPLE_FLAG_ALS_ERROR))){
+    Light.Add(sample.Light);
+    LightIntegral.Add(sample.Light, sample.Timestamp);
+  }
+
+  return;
+}
+
+/************************************
+Reset() - Starts a new summary window on every channel (EWMAs and the light integral carry on).
+*************************************/
+void SampleSummary::Reset(void){
+  Moisture.Reset();
+  Light.Reset();
+  Temperature.Reset();
+}
+
+/************************************
+FormatFixed() - Writes value with two decimals without printf float support (not linked on the SAMD core).
+*************************************/
+int SampleSummary::FormatFixed(char *buffer, uint16_t size, float value){
+
+  long scaled = lroundf(value * 100);
+  const char *sign = (scaled < 0) ? "-" : "";
+  if(scaled < 0){ scaled = -scaled; }
+
+  return snprintf(buffer, size, "%s%ld.%02ld", sign, scaled / 100, scaled % 100);
+}
+
+/************************************
+FormatFields() - Writes the window summary as extra bulk-update fields, to be appended to a record:
+,"field4":moisture mean,"field5":light mean,"field6":temp min,"field7":temp max,"field8":light integral today,
+"status":"n=.. sup=.. sd=m/l/t ewma=m/l/t"
+Inputs: buffer/size -> output buffer (SUMMARY_FIELDS_MAX is always enough);
+        suppressed -> samples held back by the ReportPolicy in this window
+return: number of characters written (0 if no sample has been added since Reset())
+*************************************/
+uint16_t SampleSummary::FormatFields(char *buffer, uint16_t size, uint32_t suppressed){
+
+  if(size == 0){ return 0; }
+  buffer[0] = '\0';
+  if(Moisture.Count() == 0){ return 0; }
+
+  float fields[5] = {Moisture.Mean(), Light.Mean(), Temperature.Min(), Temperature.Max(), LightIntegral.Today()};
+  float status[6] = {Moisture.StdDev(), Light.StdDev(), Temperature.StdDev(), Moisture.Ewma(), Light.Ewma(), Temperature.Ewma()};
+  char number[24];
+  int length = 0;
+
+  for(uint8_t i = 0; i < 5 && length < size; i++){
+    FormatFixed(number, sizeof(number), fields[i]);
+    length += snprintf(&buffer[length], size - length, ",\"field%u\":%s", (unsigned int)(i + 4), number);
+  }
+
+  if(length < size){ length += snprintf(&buffer[length], size - length, ",\"status\":\"n=%lu sup=%lu",
+                                        (unsigned long)Moisture.Count(), (unsigned long)suppressed); }
+
+  for(uint8_t i = 0; i < 6 && length < size; i++){
+    FormatFixed(number, sizeof(number), status[i]);
+    const char *label = (i == 0) ? " sd=" : (i == 3) ? " ewma=" : "/";
+    length += snprintf(&buffer[length], size - length, "%s%s", label, number);
+  }
+
+  if(length < size){ length += snprintf(&buffer[length], size - length, "\""); }
+
+  return (length < size) ? length : size - 1;
+}
@@ -0,0 +1,83 @@
+/********************************************
+  SensorStats.h - Constant-memory streaming statistics for the PlantMantra sensor channels.
+  Each sample updates running mean/variance (Welford), min/max and an EWMA per channel,
+  plus a daily light integral, so one upload can carry a summary of everything sampled
+  since the last one.
+*********************************************/
+
+#ifndef SensorStats_h
+#define SensorStats_h
+
+#include "SensorSample.h"
+
+/******** Statistics Settings ********/
+#define STATS_DEFAULT_EWMA_ALPHA 0.1f
+#define STATS_DAY_MS 86400000UL
+#define STATS_MS_PER_HOUR 3600000.0f
+//Readings further apart than this are not integrated across (sensor or node was down)
+#define STATS_MAX_GAP_MS 900000UL
+
+//Longest FormatFields() output: five numeric fields plus the status text
+#define SUMMARY_FIELDS_MAX 240
+
+
+//RunningStats - one channel's window statistics. Reset() starts a new window; the EWMA is a
+//continuous smoother and carries over.
+class RunningStats{
+  public:
+    RunningStats(float ewmaAlpha = STATS_DEFAULT_EWMA_ALPHA);
+    void Add(float value);
+    void Reset(void);
+    uint32_t Count(void);
+    float Mean(void);
+    float Variance(void);
+    float StdDev(void);
+    float Min(void);
+    float Max(void);
+    float Ewma(void);
+
+  private:
+    uint32_t _count;
+    float _mean;
+    float _m2;
+    float _min;
+    float _max;
+    float _alpha;
+    float _ewma;
+    bool _ewmaValid;
+};
+
+
+//DailyIntegral - time integral of a reading (trapezoidal, in reading-hours) per 24 h since the first sample.
+class DailyIntegral{
+  public:
+    DailyIntegral(void);
+    void Add(float value, unsigned long timestampMs);
+    float Today(void);
+    float Yesterday(void);
+    void Reset(void);
+
+  private:
+    bool _started;
+    unsigned long _dayStart;
+    unsigned long _lastTime;
+    float _lastValue;
+    float _today;
+    float _yesterday;
+};
+
+
+//SampleSummary - statistics of every channel, fed one SensorSample at a time.
+class SampleSummary{
+  public:
+    void Add(const SensorSample &sample);
+    void Reset(void);
+    uint16_t FormatFields(char *buffer, uint16_t size, uint32_t suppressed = 0);
+    static int FormatFixed(char *buffer, uint16_t size, float value);
+    RunningStats Moisture;
+    RunningStats Light;
+    RunningStats Temperature;
+    DailyIntegral LightIntegral;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/********************************************
+  AlsAutoCollector.cc - Interrupt-driven collection of SI1145 autonomous ALS readings.
+*********************************************/
+
+#include "AlsAutoCollector.h"
+
+/************************************
+QueueBarrier() - Compiler barrier: _items[] is not volatile, so without it the compiler may move a
+slot copy across the volatile _head/_tail accesses and hand over a slot before it is filled (or
+read one before it is published). The
+Cortex-M0+ is single core and in order, so nothing more is needed there.
+*************************************/
+static inline void QueueBarrier(void){ __asm__ volatile("" ::: "memory"); }
+
+//AlsQueue.AlsQueue -> Initializes an empty queue.
+AlsQueue::AlsQueue(void){
+  _head = 0;
+  _tail = 0;
+  _overruns = 0;
+}
+
+/************************************
+Push() - Producer side: stores a reading, then publishes it by advancing the head.
+Inputs: reading -> reading to store
+return: false if the queue was full (the reading is dropped and counted)
+*************************************/
+bool AlsQueue::Push(const AlsReading &reading){
+
+  uint8_t head = _head;
+  uint8_t next = (head + 1) & ALS_QUEUE_MASK;
+
+  if(next == _tail){
+    _overruns++;
+    return false;
+  }
+
+  _items[head] = reading;
+  QueueBarrier();
+  _head = next;
+
+  return true;
+}
+
+/************************************
+Pop() - Consumer side: copies out the oldest reading, then frees its slot by advancing the tail.
+Inputs: reading -> filled with the oldest reading
+return: false if the queue was empty
+*************************************/
+bool AlsQueue::Pop(AlsReading &reading){
+
+  uint8_t tail = _tail;
+  if(tail == _head){ return false; }
+
+  //The slot is only read after _head shows it filled
+  QueueBarrier();
+  reading = _items[tail];
+  QueueBarrier();
+  _tail = (tail + 1) & ALS_QUEUE_MASK;
+
+  return true;
+}
+
+uint8_t AlsQueue::Count(void){ return (_head - _tail) & ALS_QUEUE_MASK; }
+
+uint32_t AlsQueue::Overruns(void){ return _overruns; }
+
+
+//AlsAutoCollector.AlsAutoCollector -> Initializes a stopped collector.
+//Inputs: sensor -> SI1145 driver; intPin -> pin wired to its INT output (open drain, active low)
+AlsAutoCollector::AlsAutoCollector(SunlightSensor &sensor, uint8_t intPin){
+  _sensor = &sensor;
+  _intPin = intPin;
+  _period = 0;
+  _running = false;
+  _held = false;
+  _pending = false;
+  _collected = 0;
+}
+
+/************************************
+Begin() - Starts autonomous measurements and attaches the INT handler (falling edge).
+The handler is a plain function that calls HandleInterrupt() on this collector.
+Inputs: periodMs -> time between measurements; handler -> interrupt routine
+return: PARAM_OK, or the error from SunlightSensor::StartAutoALS()
+*************************************/
+uint8_t AlsAutoCollector::Begin(uint16_t periodMs, void (*handler)(void)){
+
+  _period = periodMs;
+  _sensor->SetInterruptPin(_intPin);
+
+  uint8_t status = _sensor->StartAutoALS(periodMs);
+  if(status != PARAM_OK){ return status; }
+
+  _running = true;
+#ifdef ARDUINO
+  attachInterrupt(digitalPinToInterrupt(_intPin), handler, FALLING);
+#else
+  (void)handler;
+#endif
+
+  return PARAM_OK;
+}
+
+/************************************
+Stop() - Detaches the handler, stops the measurements and turns the sensor's INT output off.
+Readings already queued can still be taken.
+*************************************/
+void AlsAutoCollector::Stop(void){
+
+#ifdef ARDUINO
+  detachInterrupt(digitalPinToInterrupt(_intPin));
+#endif
+  _running = false;
+  _pending = false;
+
+  _sensor->Standby();
+  _sensor->SetInterruptPin(ALS_NO_INT_PIN);
+
+  return;
+}
+
+/************************************
+Restart() - Puts the sensor back in autonomous mode after it lost its settings (brown-out / reset);
+the interrupt stays attached. Call with the collector held, like any other bus use from loop().
+return: PARAM_OK, or the error from SunlightSensor::StartAutoALS(); PARAM_OK if not running
+*************************************/
+uint8_t AlsAutoCollector::Restart(void){
+
+  if(!_running){ return PARAM_OK; }
+
+  return _sensor->StartAutoALS(_period);
+}
+
+/************************************
+HandleInterrupt() - INT handler body. Collects the reading unless loop() is using the bus (Hold()),
+in which case it is left pending for Release().
+*************************************/
+void AlsAutoCollector::HandleInterrupt(void){
+
+  if(_held){
+    _pending = true;
+    return;
+  }
+
+  Collect();
+
+  return;
+}
+
+/************************************
+Hold() - Call before other I2C traffic from loop(): the handler must not start a transaction in the middle
+of one. INT stays low until the reading is acknowledged, so nothing is missed while held.
+*************************************/
+void AlsAutoCollector::Hold(void){ _held = true; }
+
+/************************************
+Release() - Collects a reading that arrived during the Hold(), then lets the handler use the bus again.
+Readings are collected while still held, so the handler and loop() never push to the queue at once.
+*************************************/
+void AlsAutoCollector::Release(void){
+
+  while(_pending){
+    _pending = false;
+    Collect();
+  }
+
+  _held = false;
+
+  return;
+}
+
+/************************************
+Service() - Call from loop(). Collects a reading whose edge was missed (INT still low, e.g. it arrived
+just as Release() finished), which costs one pin read. Host builds have no interrupts, so every
+reading is collected here.
+*************************************/
+void AlsAutoCollector::Service(void){
+
+  if(!_running || _held){ return; }
+  if(!_sensor->InterruptAsserted()){ return; }
+
+  Hold();
+  _pending = true;
+  Release();
+
+  return;
+}
+
+/************************************
+Take() - Hands the oldest collected reading to loop().
+Inputs: reading -> filled with the reading
+return: false if no reading is waiting
+*************************************/
+bool AlsAutoCollector::Take(AlsReading &reading){ return _queue.Pop(reading); }
+
+uint8_t AlsAutoCollector::Available(void){ return _queue.Count(); }
+
+bool AlsAutoCollector::Running(void){ return _running; }
+
+/************************************
+Collected() - Readings latched since Begin(), including any dropped on a full queue.
+*************************************/
+uint32_t AlsAutoCollector::Collected(void){ return _collected; }
+
+uint32_t AlsAutoCollector::Overruns(void){ return _queue.Overruns(); }
+
+/************************************
+Collect() - Reads and acknowledges the sensor's latest reading and queues it.
+*************************************/
+void AlsAutoCollector::Collect(void){
+
+  AlsReading reading;
+  if(!_sensor->TakeAutoALS(reading.Vis, reading.Ir)){ return; }
+
+  reading.Timestamp = millis();
+  _collected++;
+  _queue.Push(reading);
+
+  return;
+}
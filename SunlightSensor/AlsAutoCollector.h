@@ -0,0 +1,73 @@
+/********************************************
+  AlsAutoCollector.h - Interrupt-driven collection of SI1145 autonomous ALS readings.
+  The sensor measures on its own every MEAS_RATE period and pulls INT low when a
+  reading is ready; the INT handler reads it (one burst + acknowledge) and latches it
+  into AlsQueue, a lock-free single-producer/single-consumer ring that loop() drains.
+  No CPU time is spent waiting for conversions.
+*********************************************/
+
+#ifndef AlsAutoCollector_h
+#define AlsAutoCollector_h
+
+#include "SunlightSensor.h"
+
+/******** Queue Size (power of two, one slot is kept free) ********/
+#define ALS_QUEUE_SIZE 32
+#define ALS_QUEUE_MASK (ALS_QUEUE_SIZE - 1)
+
+//AlsReading - one autonomous ALS measurement and the millis() it was collected at.
+struct AlsReading{
+  uint16_t Vis;
+  uint16_t Ir;
+  unsigned long Timestamp;
+};
+
+
+//AlsQueue - single-producer (interrupt handler) / single-consumer (loop()) ring.
+//The producer only writes _head and the consumer only writes _tail, so neither side needs
+//to disable interrupts; a full queue drops the new reading and counts an overrun.
+class AlsQueue{
+  public:
+    AlsQueue(void);
+    bool Push(const AlsReading &reading);
+    bool Pop(AlsReading &reading);
+    uint8_t Count(void);
+    uint32_t Overruns(void);
+
+  private:
+    AlsReading _items[ALS_QUEUE_SIZE];
+    volatile uint8_t _head;
+    volatile uint8_t _tail;
+    volatile uint32_t _overruns;
+};
+
+
+class AlsAutoCollector{
+  public:
+    AlsAutoCollector(SunlightSensor &sensor, uint8_t intPin);
+    uint8_t Begin(uint16_t periodMs, void (*handler)(void));
+    void Stop(void);
+    uint8_t Restart(void);
+    void HandleInterrupt(void);
+    void Hold(void);
+    void Release(void);
+    void Service(void);
+    bool Take(AlsReading &reading);
+    uint8_t Available(void);
+    bool Running(void);
+    uint32_t Collected(void);
+    uint32_t Overruns(void);
+
+  private:
+    void Collect(void);
+    SunlightSensor *_sensor;
+    uint8_t _intPin;
+    uint16_t _period;
+    AlsQueue _queue;
+    volatile bool _running;
+    volatile bool _held;
+    volatile bool _pending;
+    volatile uint32_t _collected;
+};
+
+#endif
@@ -0,0 +1,193 @@
+/********************************************
+  AlsAutoRange.cc - Auto-ranging of the SI1145 ALS gain and signal range.
+*********************************************/
+
+#include "AlsAutoRange.h"
+
+//AlsAutoRange.AlsAutoRange -> Initializes the controller for a sensor; Begin() applies the first level.
+AlsAutoRange::AlsAutoRange(SunlightSensor &sensor){
+  _sensor = &sensor;
+  _level[ALS_CH_VIS] = ALS_RANGE_DEFAULT_LEVEL;
+  _level[ALS_CH_IR] = ALS_RANGE_DEFAULT_LEVEL;
+  _lux[ALS_CH_VIS] = 0;
+  _lux[ALS_CH_IR] = 0;
+  _changes = 0;
+  _fault = false;
+}
+
+/************************************
+Begin() - Sets both channels to a starting level (call after SunlightSensor::ApplyConfig()).
+Inputs: level -> 0 (most sensitive) - ALS_RANGE_HIGH_LEVEL
+return: PARAM_OK, or the error from SunlightSensor::SetALSRange()
+*************************************/
+uint8_t AlsAutoRange::Begin(uint8_t level){
+
+  if(level > ALS_RANGE_HIGH_LEVEL){ level = ALS_RANGE_HIGH_LEVEL; }
+
+  uint8_t status = SetLevel(ALS_CH_VIS, level);
+  if(status == PARAM_OK){ status = SetLevel(ALS_CH_IR, level); }
+  if(status == PARAM_OK){ _fault = false; }
+
+  return status;
+}
+
+/************************************
+Update() - Takes a finished measurement: converts it to lux at the level it was made with and moves
+each channel to the level its reading calls for.
+Inputs: status -> ALS status of the measurement (MeasureALS() / PollALS()); visData, irData -> its readings
+return: ALS_RANGE_OK if both readings were in range (lux is valid), ALS_RANGE_RETRY if a level
+        changed and the measurement should be repeated, ALS_RANGE_SATURATED if a channel overflows
+        even at the least sensitive level, ALS_RANGE_FAULT if a level could not be programmed
+*************************************/
+uint8_t AlsAutoRange::Update(uint8_t status, uint16_t visData, uint16_t irData){
+
+  //A failed level change may have left part of the new setting in the sensor, so this reading was
+  //made at an unknown gain: discard it and program the recorded levels again
+  if(_fault){
+    if(SetLevel(ALS_CH_VIS, _level[ALS_CH_VIS]) == PARAM_OK && SetLevel(ALS_CH_IR, _level[ALS_CH_IR]) == PARAM_OK){
+      _fault = false;
+    }
+    return ALS_RANGE_FAULT;
+  }
+
+  uint16_t counts[2] = {visData, irData};
+  bool overflow[2] = {status == ALS_VIS_OVERFLOW, status == ALS_IR_OVERFLOW};
+  uint16_t scale[2] = {ALS_VIS_MILLILUX_PER_COUNT, ALS_IR_MILLILUX_PER_COUNT};
+  uint8_t result = ALS_RANGE_OK;
+
+  for(uint8_t ch = ALS_CH_VIS; ch <= ALS_CH_IR; ch++){
+
+    uint8_t level = _level[ch];
+    _lux[ch] = SunlightSensor::CountsToLux(counts[ch], scale[ch], LevelGain(level), level == ALS_RANGE_HIGH_LEVEL);
+
+    uint8_t next = NextLevel(level, counts[ch], overflow[ch]);
+    if(next != level){
+      if(SetLevel(ch, next) != PARAM_OK){ result = ALS_RANGE_FAULT; }
+      else if(result != ALS_RANGE_FAULT){ result = ALS_RANGE_RETRY; }
+    }
+    else if(overflow[ch] || counts[ch] >= ALS_DARK_COUNTS + ALS_RANGE_HIGH_COUNTS){
+      if(result == ALS_RANGE_OK){ result = ALS_RANGE_SATURATED; }
+    }
+  }
+
+  return result;
+}
+
+/************************************
+Measure() - Blocking measurement that repeats until both channels are in range, at most
+ALS_RANGE_MAX_MEASUREMENTS times.
+Inputs: visLux, irLux -> filled with the last readings in lux
+return: ALS_DONE if in range; ALS_TIMEOUT, ALS_ERROR (also when a level could not be programmed),
+        ALS_VIS_OVERFLOW or ALS_IR_OVERFLOW otherwise
+*************************************/
+uint8_t AlsAutoRange::Measure(uint32_t &visLux, uint32_t &irLux){
+
+  uint8_t status = ALS_TIMEOUT;
+
+  for(uint8_t i = 0; i < ALS_RANGE_MAX_MEASUREMENTS; i++){
+
+    uint16_t vis = 0;
+    uint16_t ir = 0;
+    status = _sensor->MeasureALS(vis, ir, TimeoutMillis());
+    if(status == ALS_TIMEOUT || status == ALS_ERROR){ break; }
+
+    uint8_t range = Update(status, vis, ir);
+    if(range != ALS_RANGE_RETRY){
+      if(range == ALS_RANGE_OK){ status = ALS_DONE; }
+      else if(range == ALS_RANGE_FAULT){ status = ALS_ERROR; }
+      break;
+    }
+  }
+
+  visLux = _lux[ALS_CH_VIS];
+  irLux = _lux[ALS_CH_IR];
+
+  return status;
+}
+
+/************************************
+TimeoutMillis() - ALS timeout for the current levels: the default plus 1 ms per unit of integration
+time (2^gain per channel), since gain 7 integrates 128 times longer than gain 0.
+*************************************/
+unsigned long AlsAutoRange::TimeoutMillis(void){
+
+  return ALS_DEFAULT_TIMEOUT_MS + (1UL << LevelGain(_level[ALS_CH_VIS])) + (1UL << LevelGain(_level[ALS_CH_IR]));
+}
+
+uint8_t AlsAutoRange::Level(uint8_t channel){ return _level[channel & 1]; }
+
+/************************************
+VisLux() - Visible illuminance of the last Update(), in lux.
+*************************************/
+uint32_t AlsAutoRange::VisLux(void){ return _lux[ALS_CH_VIS]; }
+
+uint32_t AlsAutoRange::IrLux(void){ return _lux[ALS_CH_IR]; }
+
+/************************************
+Changes() - Level changes made since construction (each one costs a repeated measurement).
+*************************************/
+uint32_t AlsAutoRange::Changes(void){ return _changes; }
+
+/************************************
+LevelGain() - ADC gain used at a ladder level.
+*************************************/
+uint8_t AlsAutoRange::LevelGain(uint8_t level){
+
+  return (level >= ALS_GAIN_MAX) ? 0 : ALS_GAIN_MAX - level;
+}
+
+/************************************
+NextLevel() - Picks the level for the next measurement from a reading made at `level`.
+Overflow: straight to the high signal range (the reading says nothing about how far over it was).
+Otherwise, if out of range, the signal is scaled to each level and the most sensitive one where it
+stays at or under ALS_RANGE_TARGET_COUNTS is chosen; a dark reading goes to the most sensitive level.
+Inputs: level -> level of the reading; counts -> ADC reading; overflow -> the ADC overflowed
+return: level for the next measurement
+*************************************/
+uint8_t AlsAutoRange::NextLevel(uint8_t level, uint16_t counts, bool overflow){
+
+  if(overflow){ return ALS_RANGE_HIGH_LEVEL; }
+
+  uint32_t signal = (counts > ALS_DARK_COUNTS) ? counts - ALS_DARK_COUNTS : 0;
+  if(signal >= ALS_RANGE_LOW_COUNTS && signal < ALS_RANGE_HIGH_COUNTS){ return level; }
+  if(signal == 0){ return 0; }
+
+  //expected signal at next = signal * sensitivity(next) / sensitivity(level)
+  uint32_t limit = ALS_RANGE_TARGET_COUNTS * LevelSensitivity(level);
+
+  for(uint8_t next = 0; next < ALS_RANGE_HIGH_LEVEL; next++){
+    if(signal * LevelSensitivity(next) <= limit){ return next; }
+  }
+
+  return ALS_RANGE_HIGH_LEVEL;
+}
+
+/************************************
+LevelSensitivity() - Relative sensitivity of a level: 10 for the high signal range, 145 x 2^gain otherwise.
+*************************************/
+uint32_t AlsAutoRange::LevelSensitivity(uint8_t level){
+
+  if(level >= ALS_RANGE_HIGH_LEVEL){ return 10; }
+
+  return (uint32_t)ALS_HIGH_RANGE_X10 << LevelGain(level);
+}
+
+/************************************
+SetLevel() - Programs a channel's gain and range for a ladder level. The level is only recorded once
+the sensor accepted it; on failure the channel keeps its old level and the controller is marked
+faulty until Update() or Begin() programs the sensor again.
+return: PARAM_OK, or the error from SunlightSensor::SetALSRange()
+*************************************/
+uint8_t AlsAutoRange::SetLevel(uint8_t channel, uint8_t level){
+
+  uint8_t status = _sensor->SetALSRange(channel, LevelGain(level), level == ALS_RANGE_HIGH_LEVEL);
+  if(status != PARAM_OK){
+    _fault = true;
+    return status;
+  }
+
+  if(level != _level[channel]){ _changes++; }
+  _level[channel] = level;
+
+  return PARAM_OK;
+}
@@ -0,0 +1,61 @@
+/********************************************
+  AlsAutoRange.h - Auto-ranging of the SI1145 ALS gain and signal range.
+  Each channel (visible, IR) sits on a ladder of ALS_RANGE_LEVELS settings, from
+  gain 7 (dim rooms) down to gain 0 and then the high signal range (direct sun).
+  After every measurement the next setting is picked from the reading itself: an
+  overflow jumps to the least sensitive level, anything else is scaled straight to
+  the level that puts it near ALS_RANGE_TARGET_COUNTS. A reading is in range within
+  ALS_RANGE_MAX_MEASUREMENTS measurements from any starting level.
+*********************************************/
+
+#ifndef AlsAutoRange_h
+#define AlsAutoRange_h
+
+#include "SunlightSensor.h"
+
+/******** Range Ladder ********/
+//Level 0 = gain 7 ... level 7 = gain 0, level 8 = gain 0 in the high signal range
+#define ALS_RANGE_LEVELS 9
+#define ALS_RANGE_HIGH_LEVEL 8
+#define ALS_RANGE_DEFAULT_LEVEL 7
+
+/******** Range Thresholds (counts above dark) ********/
+//Out of range above HIGH (ADC near full scale) or below LOW (too few counts to resolve);
+//a new level is picked to land at or just under TARGET, which leaves hysteresis on both sides
+#define ALS_RANGE_HIGH_COUNTS 40000
+#define ALS_RANGE_LOW_COUNTS 2000
+#define ALS_RANGE_TARGET_COUNTS 25000
+#define ALS_RANGE_MAX_MEASUREMENTS 3
+
+/******** Update() Results ********/
+#define ALS_RANGE_OK 0
+#define ALS_RANGE_RETRY 1
+#define ALS_RANGE_SATURATED 2
+#define ALS_RANGE_FAULT 3      // a level could not be programmed; the reading's gain is not known
+
+
+class AlsAutoRange{
+  public:
+    AlsAutoRange(SunlightSensor &sensor);
+    uint8_t Begin(uint8_t level = ALS_RANGE_DEFAULT_LEVEL);
+    uint8_t Update(uint8_t status, uint16_t visData, uint16_t irData);
+    uint8_t Measure(uint32_t &visLux, uint32_t &irLux);
+    unsigned long TimeoutMillis(void);
+    uint8_t Level(uint8_t channel);
+    uint32_t VisLux(void);
+    uint32_t IrLux(void);
+    uint32_t Changes(void);
+    static uint8_t LevelGain(uint8_t level);
+    static uint8_t NextLevel(uint8_t level, uint16_t counts, bool overflow);
+    static uint32_t LevelSensitivity(uint8_t level);
+
+  private:
+    uint8_t SetLevel(uint8_t channel, uint8_t level);
+    SunlightSensor *_sensor;
+    uint8_t _level[2];
+    uint32_t _lux[2];
+    uint32_t _changes;
+    bool _fault;
+};
+
+#endif
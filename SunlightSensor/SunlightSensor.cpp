@@ -6,9 +6,27 @@
   Created by Sierra Catelani, March 21, 2020.
 *********************************************/
 
-#include <Arduino.h>
 #include "SunlightSensor.h"
 
+//SunlightSensor.SunlightSensor -> Initializes instance of SunlightSensor Class
+//and sets up the bus used to reach the SI1145.
+//Inputs: bus the sensor is attached to (defaults to the system I2C bus).
+SunlightSensor::SunlightSensor(SensorBus &bus) : SunlightSensor(PhotoDetI2CAdd, bus){}
+
+//SunlightSensor.SunlightSensor -> Same, for an SI1145 at a non-default address.
+//Inputs: address -> 7-bit I2C address; bus the sensor is attached to.
+SunlightSensor::SunlightSensor(uint8_t address, SensorBus &bus){
+  _bus = &bus;
+  _address = address;
+  _intPin = ALS_NO_INT_PIN;
+  _responseBase = 0;
+  _regValid = 0;
+  _ramValid = 0;
+  _response = 0;
+  _responseKnown = false;
+  _configured = false;
+}
+
 /**************************************************************/
 /*--------------- I2C Transaction Functions ------------------*/
 /**************************************************************/
@@ -21,14 +39,23 @@ return: none
 void SunlightSensor::RegWrite(uint8_t reg, uint8_t data){
 
   //Access ambient temperature register of temperature sensor
-  Wire.beginTransmission(PhotoDetI2CAdd);
+  _bus->BeginTransmission(_address);
   
   //Set register offset to the Temp Sensor for writing
-  Wire.write(reg);
+  _bus->Write(reg);
 
   //Write two bytes of data to Temp Sensor and end transmission
-  Wire.write(data);
-  Wire.endTransmission();
+  _bus->Write(data);
+  _bus->EndTransmission();
+
+  //A new command changes RESPONSE; the handshake code re-learns it
+  if(reg == REG_COMMAND){ _responseKnown = false; }
+
+  //Keep the configuration register shadow in step with the device
+  if(IsShadowedReg(reg)){
+    _regShadow[reg] = data;
+    _regValid |= (1UL << reg);
+  }
 
   //complete
   return;
@@ -44,24 +71,75 @@ uint8_t SunlightSensor::RegRead(uint8_t reg){
   uint8_t returnData;
 
   //Begin I2C Transmission with Temperature Sensor
-  Wire.beginTransmission(PhotoDetI2CAdd);
+  _bus->BeginTransmission(_address);
   
   //Set register offset to the Sunlight Sensor for reading (bitmask enables non-)
-  Wire.write(reg | 0b01000000);
-  Wire.endTransmission();
+  _bus->Write(reg | 0b01000000);
+  _bus->EndTransmission();
 
   //Wire.beginTransmission(PhotoDetI2CAdd);
   //request data from TempSense device
-  Wire.requestFrom(PhotoDetI2CAdd,1);
+  _bus->RequestFrom(_address,1);
 
   //return byte from data read (returns one byte of data)
-  returnData = Wire.read();
+  returnData = _bus->Read();
     //Wire.endTransmission();
 
+  if(IsShadowedReg(reg)){
+    _regShadow[reg] = returnData;
+    _regValid |= (1UL << reg);
+  }
+
   
   return returnData;
 }
 
+/************************************
+RegReadBlock() - Reads consecutive registers in one I2C transaction using the SI1145 auto-increment.
+Unlike RegRead(), bit 6 of the address is left clear so the register pointer advances on each byte,
+which also guarantees multi-byte results come from the same conversion.
+Inputs: reg = First register; data = buffer for the bytes read; length = number of registers (max 32).
+return: none
+*************************************/
+void SunlightSensor::RegReadBlock(uint8_t reg, uint8_t *data, uint8_t length){
+
+  //Set register pointer with auto-increment enabled, then read with a repeated start
+  _bus->BeginTransmission(_address);
+  _bus->Write(reg & 0x3F);
+  _bus->EndTransmission(false);
+
+  _bus->RequestFrom(_address, length);
+
+  for(uint8_t i = 0; i < length; i++){ data[i] = _bus->Read(); }
+
+  return;
+}
+
+/************************************
+RegWriteBlock() - Writes consecutive registers in one I2C transaction using the SI1145 auto-increment.
+Inputs: reg = First register; data = bytes to write; length = number of registers (max 31).
+return: none
+*************************************/
+void SunlightSensor::RegWriteBlock(uint8_t reg, const uint8_t *data, uint8_t length){
+
+  _bus->BeginTransmission(_address);
+  _bus->Write(reg & 0x3F);
+  for(uint8_t i = 0; i < length; i++){ _bus->Write(data[i]); }
+  _bus->EndTransmission();
+
+  //Mirror what RegWrite() does for each register touched
+  for(uint8_t i = 0; i < length; i++){
+    uint8_t target = (reg & 0x3F) + i;
+    if(target == REG_COMMAND){ _responseKnown = false; }
+    if(IsShadowedReg(target)){
+      _regShadow[target] = data[i];
+      _regValid |= (1UL << target);
+    }
+  }
+
+  return;
+}
+
 /************************************
 DumpI2CRegs() - Dumps full register map for debugging purposes.
 Inputs: none
@@ -70,9 +148,9 @@ return: none
 void SunlightSensor::DumpI2CRegs(void){
   
   //Begin I2C Transmission with Sunlight Sensor
-  Wire.beginTransmission(PhotoDetI2CAdd);
-  Wire.write(0x00);
-  Wire.endTransmission();
+  _bus->BeginTransmission(_address);
+  _bus->Write(0x00);
+  _bus->EndTransmission();
 
   //Loop through full register map
   for(int i=0;i<0x3F;i++){
@@ -83,8 +161,8 @@ void SunlightSensor::DumpI2CRegs(void){
     
     
     //read and print data each Sunlight register
-    Wire.requestFrom(PhotoDetI2CAdd,1);
-    Serial.print(Wire.read(), HEX);
+    _bus->RequestFrom(_address,1);
+    Serial.print(_bus->Read(), HEX);
     Serial.print("\n");
     delay(500);
   }
@@ -100,9 +178,9 @@ return: none
 *************************************/
 void SunlightSensor::RegSetBit(uint8_t reg, uint8_t bit0){
 
-  //Read current data from register
+  //Read current data from register (served from the shadow for configuration registers)
   uint8_t registerContents = 0;
-  registerContents = RegRead(reg);
+  registerContents = ShadowRegRead(reg);
 
   //Create bitmask
   uint8_t bitmask = 1;
@@ -122,9 +200,9 @@ return: none
 *************************************/
 void SunlightSensor::RegClearBit(uint8_t reg, uint8_t bit0){
 
-  //Read current data from register
+  //Read current data from register (served from the shadow for configuration registers)
   uint8_t registerContents = 0;
-  registerContents = RegRead(reg);
+  registerContents = ShadowRegRead(reg);
 
   //Create bitmask
   uint8_t bitmask = 1;
@@ -162,6 +240,7 @@ return: none
 *************************************/
 void SunlightSensor::SWResetCMD(void){
   RegWrite(REG_COMMAND,CMD_RESET);
+  InvalidateShadow();
   return;
 }
 
@@ -189,6 +268,236 @@ void SunlightSensor::MeasureALSCMD(void){
 
 /************ Response Register Functions ***********/
 
+/************************************
+ReadResponse() - Reads the RESPONSE register. Bits 3:0 are a counter incremented on each
+completed command; values with bit 7 set are error codes (e.g. ALS_VIS_ADC_OVERFLOW).
+Inputs: none
+return: RESPONSE register contents
+*************************************/
+uint8_t SunlightSensor::ReadResponse(void){
+  return RegRead(REG_RESPONSE);
+}
+
+/************************************
+ResponseStatus() - Maps a RESPONSE value to an ALS status using the counter captured by StartALS().
+Inputs: response -> RESPONSE register contents
+return: ALS_DONE, ALS_BUSY, ALS_VIS_OVERFLOW, ALS_IR_OVERFLOW, or ALS_ERROR for any other error code
+*************************************/
+uint8_t SunlightSensor::ResponseStatus(uint8_t response){
+
+  if(response == ALS_VIS_ADC_OVERFLOW){ return ALS_VIS_OVERFLOW; }
+  if(response == ALS_IR_ADC_OVERFLOW){ return ALS_IR_OVERFLOW; }
+
+  //Any other error code (e.g. 0x80 invalid setting) ends the command without a valid reading
+  if(response & RESPONSE_ERROR_BIT){ return ALS_ERROR; }
+
+  if((response & RESPONSE_COUNTER_MASK) != _responseBase){ return ALS_DONE; }
+  return ALS_BUSY;
+}
+
+
+/************************************
+CurrentResponse() - Returns the RESPONSE counter before a new command, reading it only if unknown.
+An error code is cleared with NOP first, since it blocks the sequencer.
+Inputs: none
+return: response counter (0-15)
+*************************************/
+uint8_t SunlightSensor::CurrentResponse(void){
+
+  if(_responseKnown){ return _response; }
+
+  uint8_t response = ReadResponse();
+  if(response & RESPONSE_ERROR_BIT){
+    ClearResponseCMD();
+    response = 0;
+  }
+
+  return response & RESPONSE_COUNTER_MASK;
+}
+
+/************************************
+WaitForResponse() - Command-completion handshake: polls RESPONSE until the counter moves past base.
+Inputs: base -> counter value before the command was written
+return: PARAM_OK, PARAM_REJECTED (error code reported) or PARAM_TIMEOUT
+*************************************/
+uint8_t SunlightSensor::WaitForResponse(uint8_t base){
+
+  unsigned long startTime = millis();
+
+  while((millis() - startTime) < SI1145_CMD_TIMEOUT_MS){
+
+    uint8_t response = ReadResponse();
+
+    if(response & RESPONSE_ERROR_BIT){ return PARAM_REJECTED; }
+    if((response & RESPONSE_COUNTER_MASK) != base){
+      _response = response & RESPONSE_COUNTER_MASK;
+      _responseKnown = true;
+      return PARAM_OK;
+    }
+  }
+
+  return PARAM_TIMEOUT;
+}
+
+
+/*************************************************************/
+/*--------------- Completion-Driven ALS Reads ---------------*/
+/*************************************************************/
+
+/************************************
+SetInterruptPin() - Waits for ALS completion on the INT pin instead of polling RESPONSE over I2C.
+Enables INT_OE and the ALS interrupt. The pin is open-drain, active low.
+Inputs: pin -> Arduino pin wired to the SI1145 INT output (ALS_NO_INT_PIN to go back to polling)
+return: none
+*************************************/
+void SunlightSensor::SetInterruptPin(uint8_t pin){
+
+  _intPin = pin;
+
+  if(pin == ALS_NO_INT_PIN){
+    RegWrite(REG_IRQ_ENABLE, 0x00);
+    RegWrite(REG_INT_CFG, 0x00);
+    return;
+  }
+
+  pinMode(pin, INPUT_PULLUP);
+  RegWrite(REG_INT_CFG, 0x01);
+  RegWrite(REG_IRQ_ENABLE, 0x01);
+
+  return;
+}
+
+/************************************
+InterruptAsserted() - Reads the INT pin set with SetInterruptPin(); no I2C traffic.
+return: true while INT is pulled low (false if no pin is configured)
+*************************************/
+bool SunlightSensor::InterruptAsserted(void){
+
+  if(_intPin == ALS_NO_INT_PIN){ return false; }
+
+  return _bus->DigitalRead(_intPin) == LOW;
+}
+
+/************************************
+StartALS() - Forces an ALS measurement and records the response counter to detect completion.
+An error code left in RESPONSE (e.g. a previous overflow) is cleared first, since it blocks the sequencer.
+Inputs: none
+return: none
+*************************************/
+void SunlightSensor::StartALS(void){
+
+  _responseBase = CurrentResponse();
+  MeasureALSCMD();
+
+  return;
+}
+
+/************************************
+PollALS() - Non-blocking check of the measurement started by StartALS().
+With an INT pin configured, costs no I2C traffic until the interrupt fires.
+Inputs: none
+return: ALS_BUSY while converting; ALS_DONE, ALS_VIS_OVERFLOW, ALS_IR_OVERFLOW or ALS_ERROR once finished
+*************************************/
+uint8_t SunlightSensor::PollALS(void){
+
+  if(_intPin != ALS_NO_INT_PIN){
+    if(_bus->DigitalRead(_intPin) == HIGH){ return ALS_BUSY; }
+
+    //Acknowledge the ALS interrupt (write 1 to clear)
+    RegWrite(REG_IRQ_STATUS, 0x01);
+  }
+
+  uint8_t response = ReadResponse();
+  uint8_t status = ResponseStatus(response);
+
+  //Remember the counter so the next command can skip its baseline read
+  if(status == ALS_DONE){
+    _response = response & RESPONSE_COUNTER_MASK;
+    _responseKnown = true;
+  }
+
+  return status;
+}
+
+/************************************
+MeasureALS() - Forces an ALS measurement, waits for completion and reads the VIS and IR data.
+Returns as soon as the conversion finishes (a few ms) rather than after a fixed delay.
+Inputs: visData, irData -> filled with the readings; timeoutMs -> give up after this long
+return: ALS_DONE, ALS_TIMEOUT, ALS_VIS_OVERFLOW, ALS_IR_OVERFLOW or ALS_ERROR
+*************************************/
+uint8_t SunlightSensor::MeasureALS(uint16_t &visData, uint16_t &irData, unsigned long timeoutMs){
+
+  unsigned long startTime = millis();
+  uint8_t status;
+
+  StartALS();
+
+  while((status = PollALS()) == ALS_BUSY){
+    if((millis() - startTime) >= timeoutMs){ return ALS_TIMEOUT; }
+    if(_intPin == ALS_NO_INT_PIN){ delayMicroseconds(ALS_POLL_US); }
+  }
+
+  ReadALSData(visData, irData);
+
+  return status;
+}
+
+
+/*************************************************************/
+/*------------------ Autonomous ALS Reads -------------------*/
+/*************************************************************/
+
+/************************************
+StartAutoALS() - Puts the sensor in autonomous mode: it measures ALS every periodMs by itself and
+pulls INT low when new data is ready (INT_OE and ALS_IE on). Registers the shadow shows are already
+set are not rewritten. Standby() stops it again.
+Inputs: periodMs -> time between measurements (1 - ALS_AUTO_MAX_PERIOD_MS)
+return: PARAM_OK, PARAM_REJECTED or PARAM_TIMEOUT from the ALS_AUTO command handshake
+*************************************/
+uint8_t SunlightSensor::StartAutoALS(uint16_t periodMs){
+
+  if(periodMs == 0){ periodMs = 1; }
+  if(periodMs > ALS_AUTO_MAX_PERIOD_MS){ periodMs = ALS_AUTO_MAX_PERIOD_MS; }
+
+  uint16_t ticks = periodMs * MEAS_RATE_TICKS_PER_MS;
+  uint8_t rate[2] = {(uint8_t)(ticks & 0xFF), (uint8_t)(ticks >> 8)};
+  if(ShadowRegRead(REG_MEAS_RATE0) != rate[0] || ShadowRegRead(REG_MEAS_RATE1) != rate[1]){
+    RegWriteBlock(REG_MEAS_RATE0, rate, 2);
+  }
+
+  if(ShadowRegRead(REG_INT_CFG) != 0x01){ RegWrite(REG_INT_CFG, 0x01); }
+  if(ShadowRegRead(REG_IRQ_ENABLE) != IRQ_ALS_FLAG){ RegWrite(REG_IRQ_ENABLE, IRQ_ALS_FLAG); }
+
+  //A flag left over from forced mode would hold INT low and hide the first edge
+  RegWrite(REG_IRQ_STATUS, IRQ_ALS_FLAG);
+
+  uint8_t base = CurrentResponse();
+  RegWrite(REG_COMMAND, CMD_ALS_AUTO);
+
+  return WaitForResponse(base);
+}
+
+/************************************
+TakeAutoALS() - Reads IRQ_STATUS and the VIS/IR data (0x21-0x25) in one burst and, if the ALS flag
+was set, acknowledges it so INT is released. Short enough to run from the INT pin's interrupt handler.
+Inputs: visData, irData -> filled with the new reading
+return: true if a new reading was waiting
+*************************************/
+bool SunlightSensor::TakeAutoALS(uint16_t &visData, uint16_t &irData){
+
+  uint8_t rawData[5];
+
+  RegReadBlock(REG_IRQ_STATUS, rawData, 5);
+  if(!(rawData[0] & IRQ_ALS_FLAG)){ return false; }
+
+  RegWrite(REG_IRQ_STATUS, IRQ_ALS_FLAG);
+
+  visData = rawData[1] | (rawData[2] << 8);
+  irData = rawData[3] | (rawData[4] << 8);
+
+  return true;
+}
+
 
 /***************************************************************/
 /*--------------- Specific I2C Reg Functions ------------------*/
@@ -216,6 +525,25 @@ void SunlightSensor::SetMeasRate(uint8_t byte0, uint8_t byte1){
   return;
 }
 
+/************************************
+Standby() - Leaves the sensor in standby (~150 nA) until the next forced measurement.
+Forced mode drops back to standby by itself after each measurement, so with MEAS_RATE = 0
+(read from the shadow) this costs no bus traffic; autonomous measurements are paused and stopped.
+Inputs: none
+return: none
+*************************************/
+void SunlightSensor::Standby(void){
+
+  if(ShadowRegRead(REG_MEAS_RATE0) == 0 && ShadowRegRead(REG_MEAS_RATE1) == 0){ return; }
+
+  uint8_t base = CurrentResponse();
+  RegWrite(REG_COMMAND,CMD_PSALS_PAUSE);
+  WaitForResponse(base);
+  SetMeasRate(0x00,0x00);
+
+  return;
+}
+
 /**************************************************************/
 /*------------------ RAM Access Functions --------------------*/
 /**************************************************************/
@@ -223,21 +551,36 @@ void SunlightSensor::SetMeasRate(uint8_t byte0, uint8_t byte1){
 
 /************************************
 RAMSET() - Write to the on-chip RAM, which is used to configuring the sensor ADC and other sensor read features.
+PARAM_WR and COMMAND are adjacent, so value and PARAM_SET command go out in one I2C frame,
+followed by the response-counter handshake that confirms the sequencer took the write. The sequencer
+then echoes the stored value in PARAM_RD, which is read back and compared.
 Inputs: offset -> RAM target offset (sets location to write to); data -> data to write to the RAM target address.
-return: none
+return: PARAM_OK, PARAM_REJECTED, PARAM_TIMEOUT or PARAM_MISMATCH (PARAM_RD differs from data)
 *************************************/
-void SunlightSensor::RAMSET(uint8_t offset, uint8_t data){
+uint8_t SunlightSensor::RAMSET(uint8_t offset, uint8_t data){
 
   //Set RAMTarget (command = CMD_PARAM_SET | offset)
   uint8_t RAMTarget = (CMD_PARAM_SET | offset);
-  
-  //Write data to be written to RAMTarget to REG_PARAM_WR
-  RegWrite(REG_PARAM_WR, data);
 
-  //Write RAMTarget to COMMAND register
-  RegWrite(REG_COMMAND,RAMTarget);
+  //Skip the write if the shadow shows the RAM already holds this value
+  if((_ramValid & (1UL << offset)) && _ramShadow[offset] == data){ return PARAM_OK; }
 
-  return;
+  uint8_t base = CurrentResponse();
+
+  //Write data to REG_PARAM_WR and RAMTarget to REG_COMMAND in one burst
+  uint8_t frame[2] = {data, RAMTarget};
+  RegWriteBlock(REG_PARAM_WR, frame, 2);
+
+  uint8_t status = WaitForResponse(base);
+  if(status == PARAM_OK && RegRead(REG_PARAM_RD) != data){ status = PARAM_MISMATCH; }
+
+  if(status == PARAM_OK){
+    _ramShadow[offset] = data;
+    _ramValid |= (1UL << offset);
+  }
+  else{ _ramValid &= ~(1UL << offset); }
+
+  return status;
   
 }
 
@@ -253,17 +596,93 @@ uint8_t SunlightSensor::RAMQUERY(uint8_t offset){
   //Set RAMTarget (command = CMD_PARAM_QUERY | offset)
   uint8_t RAMTarget = (CMD_PARAM_QUERY | offset);
   
+  uint8_t base = CurrentResponse();
+
   //Write RAMTarget to COMMAND register
   RegWrite(REG_COMMAND,RAMTarget);
+
+  //PARAM_RD is only valid once the sequencer has answered
+  if(WaitForResponse(base) != PARAM_OK){ return 0; }
   
   //Read data output from REG_PARAM_RD
   returnValue = RegRead(REG_PARAM_RD);
 
+  _ramShadow[offset] = returnValue;
+  _ramValid |= (1UL << offset);
+
   return returnValue;
   
 }
 
 
+/************************************
+RAMGET() - Returns a parameter RAM value from the shadow, querying the sensor only on a cache miss.
+Inputs: offset -> RAM target offset
+return: RAM contents
+*************************************/
+uint8_t SunlightSensor::RAMGET(uint8_t offset){
+
+  if(_ramValid & (1UL << offset)){ return _ramShadow[offset]; }
+
+  return RAMQUERY(offset);
+}
+
+
+/**********************************************************/
+/*----------------- Register/RAM Shadow ------------------*/
+/**********************************************************/
+
+//Configuration registers (0x03-0x16) and parameter RAM only change when this driver writes
+//them, so a write-through copy saves the read half of every read-modify-write.
+//Call InvalidateShadow() if the sensor may have reset behind our back (e.g. HW_KEY lost).
+
+/************************************
+InvalidateShadow() - Forgets all cached register and RAM values.
+Inputs: none
+return: none
+*************************************/
+void SunlightSensor::InvalidateShadow(void){
+  _regValid = 0;
+  _ramValid = 0;
+  return;
+}
+
+/************************************
+ResyncShadow() - Re-reads the configuration registers in one burst and re-queries every cached RAM entry.
+Inputs: none
+return: none
+*************************************/
+void SunlightSensor::ResyncShadow(void){
+
+  uint32_t cachedRam = _ramValid;
+
+  RegReadBlock(SHADOW_REG_FIRST, &_regShadow[SHADOW_REG_FIRST], SHADOW_REG_LAST - SHADOW_REG_FIRST + 1);
+  _regValid = 0;
+  for(uint8_t reg = SHADOW_REG_FIRST; reg <= SHADOW_REG_LAST; reg++){ _regValid |= (1UL << reg); }
+
+  _ramValid = 0;
+  for(uint8_t offset = 0; offset < SHADOW_RAM_SIZE; offset++){
+    if(cachedRam & (1UL << offset)){ RAMQUERY(offset); }
+  }
+
+  return;
+}
+
+bool SunlightSensor::IsShadowedReg(uint8_t reg){ return reg >= SHADOW_REG_FIRST && reg <= SHADOW_REG_LAST; }
+
+/************************************
+ShadowRegRead() - Returns a register value, from the shadow when cached, otherwise from the device.
+Inputs: reg = target register
+return: register contents
+*************************************/
+uint8_t SunlightSensor::ShadowRegRead(uint8_t reg){
+
+  if(IsShadowedReg(reg) && (_regValid & (1UL << reg))){ return _regShadow[reg]; }
+
+  return RegRead(reg);
+}
+
+
 /**********************************************************/
 /*------------ Specific RAM Access Functions -------------*/
 /**********************************************************/
@@ -278,8 +697,8 @@ void SunlightSensor::EnProximatySensors(bool enable){
   uint8_t RAMContents = 0;
   uint8_t regSetData = 0;
 
-  //Read CHLIST (channel list) RAM Data
-  RAMContents = RAMQUERY(RAM_CHLIST);
+  //Read CHLIST (channel list) RAM Data (cached after the first query)
+  RAMContents = RAMGET(RAM_CHLIST);
 
   //Set or clear the proximatey sensor control bits
   if (enable == 0){ regSetData = RAMContents & 0xF8;}
@@ -302,8 +721,8 @@ void SunlightSensor::EnALSSensors(bool enable){
   uint8_t RAMContents = 0;
   uint8_t regSetData = 0;
 
-  //Read CHLIST (channel list) RAM Data
-  RAMContents = RAMQUERY(RAM_CHLIST);
+  //Read CHLIST (channel list) RAM Data (cached after the first query)
+  RAMContents = RAMGET(RAM_CHLIST);
 
   //Set or clear the ALS sensor control bits
   if (enable == 0){ regSetData = RAMContents & 0xCF;}
@@ -325,8 +744,8 @@ void SunlightSensor::EnUVSensor(bool enable){
   uint8_t RAMContents = 0;
   uint8_t regSetData = 0;
 
-  //Read CHLIST (channel list) RAM Data
-  RAMContents = RAMQUERY(RAM_CHLIST);
+  //Read CHLIST (channel list) RAM Data (cached after the first query)
+  RAMContents = RAMGET(RAM_CHLIST);
 
   //Set or clear the UV sensor control bit
   if (enable == 0){ regSetData = RAMContents & 0x7F;}
@@ -348,8 +767,8 @@ void SunlightSensor::EnAUXSensor(bool enable){
   uint8_t RAMContents = 0;
   uint8_t regSetData = 0;
 
-  //Read CHLIST (channel list) RAM Data
-  RAMContents = RAMQUERY(RAM_CHLIST);
+  //Read CHLIST (channel list) RAM Data (cached after the first query)
+  RAMContents = RAMGET(RAM_CHLIST);
 
   //Set or clear the AUX sensor control bit
   if (enable == 0){ regSetData = RAMContents & 0xBF;}
@@ -363,6 +782,141 @@ void SunlightSensor::EnAUXSensor(bool enable){
 
 
 
+/************************************
+SetChannelList() - Writes the whole CHLIST in one RAM write (e.g. ALS on, PS/UV/AUX off).
+Inputs: chlist -> OR of CHLIST_EN_* bits
+return: none
+*************************************/
+void SunlightSensor::SetChannelList(uint8_t chlist){
+  RAMSET(RAM_CHLIST, chlist);
+  return;
+}
+
+
+
+/************************************
+ApplyConfig() - Applies a complete SI1145Config in one computed pass: HW_KEY, MEAS_RATE (one burst)
+and each parameter RAM entry, skipping entries the shadow shows are already set. Every RAM write
+is confirmed by the response handshake and read back from PARAM_RD. The config is kept so
+ReapplyConfig() can restore it.
+Inputs: config -> desired configuration
+return: PARAM_OK, or the first PARAM_REJECTED / PARAM_TIMEOUT / PARAM_MISMATCH encountered
+*************************************/
+uint8_t SunlightSensor::ApplyConfig(const SI1145Config &config){
+
+  _config = config;
+  _configured = true;
+
+  if(ShadowRegRead(REG_HW_KEY) != 0x17){ SetHWKEY(0x17); }
+
+  uint8_t rate[2] = {(uint8_t)(config.MeasRate & 0xFF), (uint8_t)(config.MeasRate >> 8)};
+  if(ShadowRegRead(REG_MEAS_RATE0) != rate[0] || ShadowRegRead(REG_MEAS_RATE1) != rate[1]){
+    RegWriteBlock(REG_MEAS_RATE0, rate, 2);
+  }
+
+  const uint8_t offsets[] = {RAM_CHLIST, RAM_ALS_VIS_ADC_GAIN, RAM_ALS_VIS_ADC_COUNTER, RAM_ALS_VIS_ADC_MISC,
+                             RAM_ALS_IR_ADC_MUX, RAM_ALS_IR_ADC_GAIN, RAM_ALS_IR_ADC_COUNTER, RAM_ALS_IR_ADC_MISC};
+  const uint8_t values[] = {config.ChannelList, config.VisGain, config.VisCounter, config.VisMisc,
+                            config.IrMux, config.IrGain, config.IrCounter, config.IrMisc};
+
+  for(uint8_t i = 0; i < sizeof(offsets); i++){
+    uint8_t status = RAMSET(offsets[i], values[i]);
+    if(status != PARAM_OK){ return status; }
+  }
+
+  return PARAM_OK;
+}
+
+/************************************
+SetALSRange() - Sets a channel's ADC gain and signal range. The ADC recovery counter is set to the
+complement of the gain as the datasheet recommends. The stored config is updated too, so
+ReapplyConfig() restores the current range after a reset.
+Inputs: channel -> ALS_CH_VIS or ALS_CH_IR; gain -> 0 - ALS_GAIN_MAX; highRange -> high signal range
+return: PARAM_OK, or the first PARAM_REJECTED / PARAM_TIMEOUT encountered
+*************************************/
+uint8_t SunlightSensor::SetALSRange(uint8_t channel, uint8_t gain, bool highRange){
+
+  if(gain > ALS_GAIN_MAX){ gain = ALS_GAIN_MAX; }
+
+  uint8_t counter = ((~gain) & 0x07) << 4;
+  uint8_t misc = highRange ? ADC_MISC_HIGH_RANGE : 0x00;
+  bool vis = (channel == ALS_CH_VIS);
+
+  uint8_t status = RAMSET(vis ? RAM_ALS_VIS_ADC_GAIN : RAM_ALS_IR_ADC_GAIN, gain);
+  if(status == PARAM_OK){ status = RAMSET(vis ? RAM_ALS_VIS_ADC_COUNTER : RAM_ALS_IR_ADC_COUNTER, counter); }
+  if(status == PARAM_OK){ status = RAMSET(vis ? RAM_ALS_VIS_ADC_MISC : RAM_ALS_IR_ADC_MISC, misc); }
+
+  if(vis){
+    _config.VisGain = gain;
+    _config.VisCounter = counter;
+    _config.VisMisc = misc;
+  }
+  else{
+    _config.IrGain = gain;
+    _config.IrCounter = counter;
+    _config.IrMisc = misc;
+  }
+
+  return status;
+}
+
+/************************************
+ALSGain() - A channel's ADC gain (from the RAM shadow; the sensor is queried only on a cache miss).
+*************************************/
+uint8_t SunlightSensor::ALSGain(uint8_t channel){
+
+  return RAMGET((channel == ALS_CH_VIS) ? RAM_ALS_VIS_ADC_GAIN : RAM_ALS_IR_ADC_GAIN) & 0x07;
+}
+
+bool SunlightSensor::ALSHighRange(uint8_t channel){
+
+  return (RAMGET((channel == ALS_CH_VIS) ? RAM_ALS_VIS_ADC_MISC : RAM_ALS_IR_ADC_MISC) & ADC_MISC_HIGH_RANGE) != 0;
+}
+
+/************************************
+CountsToLux() - Converts a channel's reading to lux at the gain and range it is currently set to.
+Inputs: channel -> ALS_CH_VIS or ALS_CH_IR; counts -> ADC reading
+return: illuminance in lux
+*************************************/
+uint32_t SunlightSensor::CountsToLux(uint8_t channel, uint16_t counts){
+
+  uint16_t scale = (channel == ALS_CH_VIS) ? ALS_VIS_MILLILUX_PER_COUNT : ALS_IR_MILLILUX_PER_COUNT;
+
+  return CountsToLux(counts, scale, ALSGain(channel), ALSHighRange(channel));
+}
+
+/************************************
+CountsToLux() - Removes the dark offset and scales counts to lux for a gain and range.
+Inputs: counts -> ADC reading; milliluxPerCount -> channel sensitivity at gain 0, normal range;
+        gain -> 0 - ALS_GAIN_MAX; highRange -> high signal range
+return: illuminance in lux (rounded)
+*************************************/
+uint32_t SunlightSensor::CountsToLux(uint16_t counts, uint16_t milliluxPerCount, uint8_t gain, bool highRange){
+
+  if(counts <= ALS_DARK_COUNTS){ return 0; }
+
+  uint64_t millilux = (uint64_t)(counts - ALS_DARK_COUNTS) * milliluxPerCount;
+  if(highRange){ millilux = millilux * ALS_HIGH_RANGE_X10 / 10; }
+
+  uint64_t divisor = 1000ULL << gain;
+
+  return (uint32_t)((millilux + divisor / 2) / divisor);
+}
+
+/************************************
+ReapplyConfig() - Re-applies the last ApplyConfig() configuration (e.g. after the sensor reset itself).
+Inputs: none
+return: PARAM_OK, or the first error from ApplyConfig(); PARAM_OK if never configured
+*************************************/
+uint8_t SunlightSensor::ReapplyConfig(void){
+
+  if(!_configured){ return PARAM_OK; }
+
+  SI1145Config config = _config;
+  return ApplyConfig(config);
+}
+
+
 /**********************************************************/
 /*-------------- Measurement Read Functions --------------*/
 /**********************************************************/
@@ -373,14 +927,13 @@ ReadAmbVisData() - Read data from Ambient Visible light Registers.
 return: uint16_t -> two byes of data, one from each Amb Vis reg.
 *************************************/
 uint16_t SunlightSensor::ReadAmbVisData(void){
-  uint16_t measReturn = 0;
+  uint8_t rawData[2];
 
-  //read data from registers and create return data
-  measReturn = (RegRead(REG_ALS_VIS_DATA0) );
-  measReturn |= (RegRead(REG_ALS_VIS_DATA1)<< 8);
+  //read both data registers in one burst so the bytes belong to the same conversion
+  RegReadBlock(REG_ALS_VIS_DATA0, rawData, 2);
 
   //complete and return
-  return measReturn;
+  return rawData[0] | (rawData[1] << 8);
 }
 
 /************************************
@@ -389,13 +942,45 @@ return: uint16_t -> two byes of data, one from each Amb IR reg.
 *************************************/
 
 uint16_t SunlightSensor::ReadAmbIRData(void){
-  uint16_t measReturn = 0;
+  uint8_t rawData[2];
 
-  //read data from registers and create return data
-  measReturn = RegRead(REG_ALS_IR_DATA0);
-  measReturn |= (RegRead(REG_ALS_IR_DATA1) << 8);
+  //read both data registers in one burst so the bytes belong to the same conversion
+  RegReadBlock(REG_ALS_IR_DATA0, rawData, 2);
 
   //complete and return
-  return measReturn;
+  return rawData[0] | (rawData[1] << 8);
+}
+
+/************************************
+ReadALSData() - Read the Ambient Visible and IR data (0x22-0x25) in a single burst.
+Inputs: visData, irData -> filled with the readings
+return: none
+*************************************/
+void SunlightSensor::ReadALSData(uint16_t &visData, uint16_t &irData){
+  uint8_t rawData[4];
+
+  RegReadBlock(REG_ALS_VIS_DATA0, rawData, 4);
+
+  visData = rawData[0] | (rawData[1] << 8);
+  irData = rawData[2] | (rawData[3] << 8);
+
+  return;
+}
+
+/************************************
+ReadAllMeasData() - Read the full measurement block (0x22-0x2D) in a single burst.
+Inputs: data -> array of MEAS_DATA_WORDS words, indexed by MEAS_VIS, MEAS_IR, MEAS_PS1..MEAS_AUX
+return: none
+*************************************/
+void SunlightSensor::ReadAllMeasData(uint16_t *data){
+  uint8_t rawData[MEAS_DATA_WORDS * 2];
+
+  RegReadBlock(REG_ALS_VIS_DATA0, rawData, sizeof(rawData));
+
+  for(uint8_t i = 0; i < MEAS_DATA_WORDS; i++){
+    data[i] = rawData[2*i] | (rawData[2*i + 1] << 8);
+  }
+
+  return;
 }
 
@@ -6,37 +6,115 @@
 #ifndef SunlightSensor_h
 #define SunlightSensor_h
 
-#include <Wire.h>
-#include <Arduino.h>
+#include "SensorBus.h"
 
 /******** I2C Targets ********/
-#define PhotoDetI2CAdd 0x60
+#define PhotoDetI2CAdd 0x60  //fixed; put several SI1145s behind a TCA9548A (I2CMux.h)
 
 /******** Command Register CMDs ********/
 #define CMD_NOP 0x00
 #define CMD_RESET 0x01
 #define CMD_GETCAL 0x12
 #define CMD_ALSFORCE 0x06
+#define CMD_ALS_PAUSE 0x0A
+#define CMD_PSALS_PAUSE 0x0B
+#define CMD_ALS_AUTO 0x0E
 #define CMD_PARAM_QUERY 0x80
 #define CMD_PARAM_SET 0xA0
 
 /******** Response Register Error Codes ********/
+#define RESPONSE_ERROR_BIT 0x80
+#define RESPONSE_COUNTER_MASK 0x0F
 #define ALS_VIS_ADC_OVERFLOW 0x8C
 #define ALS_IR_ADC_OVERFLOW 0x8D
 
+/******** ALS Measurement Status ********/
+#define ALS_DONE 0
+#define ALS_BUSY 1
+#define ALS_TIMEOUT 2
+#define ALS_VIS_OVERFLOW 3
+#define ALS_IR_OVERFLOW 4
+#define ALS_ERROR 5
+
+/******** Command Handshake Status ********/
+#define PARAM_OK 0
+#define PARAM_TIMEOUT 1
+#define PARAM_REJECTED 2
+#define PARAM_MISMATCH 3
+#define SI1145_CMD_TIMEOUT_MS 10
+//Wait after CMD_RESET before the next command
+#define SI1145_RESET_MS 25
+
+/******** ALS Measurement Timing ********/
+#define ALS_DEFAULT_TIMEOUT_MS 100
+#define ALS_POLL_US 500
+#define ALS_NO_INT_PIN 0xFF
+
+/******** Autonomous ALS (MEAS_RATE counts 31.25 us ticks) ********/
+#define MEAS_RATE_TICKS_PER_MS 32
+#define ALS_AUTO_MAX_PERIOD_MS 2047
+#define IRQ_ALS_FLAG 0x01
+
 /******** I2C Registers ********/
+#define REG_INT_CFG 0x03
+#define REG_IRQ_ENABLE 0x04
 #define REG_HW_KEY 0x07
 #define REG_MEAS_RATE0 0x08
 #define REG_MEAS_RATE1 0x09
 #define REG_COMMAND 0x18
 #define REG_RESPONSE 0x20
+#define REG_IRQ_STATUS 0x21
 #define REG_ALS_VIS_DATA0 0x22
 #define REG_ALS_VIS_DATA1 0x23
 #define REG_ALS_IR_DATA0 0x24
 #define REG_ALS_IR_DATA1 0x25
+#define REG_PS1_DATA0 0x26
+#define REG_PS2_DATA0 0x28
+#define REG_PS3_DATA0 0x2A
+#define REG_AUX_DATA0 0x2C
 #define REG_PARAM_WR 0x17
 #define REG_PARAM_RD 0x2E
 
+/******** Measurement Data Block (0x22-0x2D: VIS, IR, PS1, PS2, PS3, AUX/UV) ********/
+#define MEAS_DATA_WORDS 6
+#define MEAS_VIS 0
+#define MEAS_IR 1
+#define MEAS_PS1 2
+#define MEAS_PS2 3
+#define MEAS_PS3 4
+#define MEAS_AUX 5
+
+/******** CHLIST Channel Enable Bits ********/
+#define CHLIST_EN_PS1 0x01
+#define CHLIST_EN_PS2 0x02
+#define CHLIST_EN_PS3 0x04
+#define CHLIST_EN_ALS_VIS 0x10
+#define CHLIST_EN_ALS_IR 0x20
+#define CHLIST_EN_AUX 0x40
+#define CHLIST_EN_UV 0x80
+
+/******** Register/RAM Shadow ********/
+#define SHADOW_REG_FIRST 0x03
+#define SHADOW_REG_LAST 0x16
+#define SHADOW_RAM_SIZE 0x20
+
+/******** ADC MISC Bits ********/
+#define ADC_MISC_HIGH_RANGE 0x20
+
+/******** ALS Gain / Range ********/
+//Each gain step doubles the ADC integration time (and the counts); the high signal range
+//divides the response by 14.5 for direct sunlight
+#define ALS_GAIN_MAX 7
+#define ALS_CH_VIS 0
+#define ALS_CH_IR 1
+
+/******** Lux Conversion (gain 0, normal range) ********/
+//The datasheet gives 0.282 (visible) and 2.44 (IR) counts per lux, i.e. 1/0.282 and 1/2.44 lux per count
+#define ALS_DARK_COUNTS 256
+#define ALS_VIS_MILLILUX_PER_COUNT 3546
+#define ALS_IR_MILLILUX_PER_COUNT 410
+#define ALS_HIGH_RANGE_X10 145
+
 /******** RAM Offset ********/
 #define RAM_CHLIST 0x01
 #define RAM_ALS_IR_ADC_MUX 0x0E
@@ -48,10 +126,32 @@
 #define RAM_ALS_IR_ADC_MISC 0x1F
 
 
+//SI1145Config - complete boot configuration, applied in one pass by ApplyConfig().
+//MeasRate = 0 selects forced (polled) mode.
+struct SI1145Config{
+  uint8_t ChannelList;
+  uint8_t VisGain;
+  uint8_t VisCounter;
+  uint8_t VisMisc;
+  uint8_t IrMux;
+  uint8_t IrGain;
+  uint8_t IrCounter;
+  uint8_t IrMisc;
+  uint16_t MeasRate;
+};
+
+//ALS visible + IR in forced mode, datasheet default gain/counter/range
+#define SI1145_DEFAULT_CONFIG {CHLIST_EN_ALS_VIS | CHLIST_EN_ALS_IR, 0x00, 0x70, 0x00, 0x00, 0x00, 0x70, 0x00, 0x0000}
+
+
 class SunlightSensor{
   public:
+    SunlightSensor(SensorBus &bus = SystemBus());
+    SunlightSensor(uint8_t address, SensorBus &bus = SystemBus());
     void RegWrite(uint8_t reg, uint8_t data);
     uint8_t RegRead(uint8_t reg);
+    void RegReadBlock(uint8_t reg, uint8_t *data, uint8_t length);
+    void RegWriteBlock(uint8_t reg, const uint8_t *data, uint8_t length);
     void DumpI2CRegs(void);
     void RegSetBit(uint8_t reg, uint8_t bit0);
     void RegClearBit(uint8_t reg, uint8_t bit0);
@@ -59,16 +159,57 @@ class SunlightSensor{
     void SWResetCMD(void);
     void GetCalDataCMD(void);
     void MeasureALSCMD(void);
+    uint8_t ReadResponse(void);
+    void SetInterruptPin(uint8_t pin);
+    bool InterruptAsserted(void);
+    void StartALS(void);
+    uint8_t PollALS(void);
+    uint8_t MeasureALS(uint16_t &visData, uint16_t &irData, unsigned long timeoutMs = ALS_DEFAULT_TIMEOUT_MS);
+    uint8_t StartAutoALS(uint16_t periodMs);
+    bool TakeAutoALS(uint16_t &visData, uint16_t &irData);
     void SetHWKEY(uint8_t value = 0x17);
     void SetMeasRate(uint8_t byte0, uint8_t byte1);
-    void RAMSET(uint8_t offset, uint8_t data);
+    void Standby(void);
+    uint8_t RAMSET(uint8_t offset, uint8_t data);
     uint8_t RAMQUERY(uint8_t offset);
+    uint8_t RAMGET(uint8_t offset);
+    void SetChannelList(uint8_t chlist);
+    uint8_t SetALSRange(uint8_t channel, uint8_t gain, bool highRange);
+    uint8_t ALSGain(uint8_t channel);
+    bool ALSHighRange(uint8_t channel);
+    uint32_t CountsToLux(uint8_t channel, uint16_t counts);
+    static uint32_t CountsToLux(uint16_t counts, uint16_t milliluxPerCount, uint8_t gain, bool highRange);
+    uint8_t ApplyConfig(const SI1145Config &config);
+    uint8_t ReapplyConfig(void);
+    void InvalidateShadow(void);
+    void ResyncShadow(void);
     void EnProximatySensors(bool enable);
     void EnALSSensors(bool enable);
     void EnUVSensor(bool enable);
     void EnAUXSensor(bool enable);
     uint16_t ReadAmbVisData(void);
     uint16_t ReadAmbIRData(void);
+    void ReadALSData(uint16_t &visData, uint16_t &irData);
+    void ReadAllMeasData(uint16_t *data);
+
+  private:
+    uint8_t ResponseStatus(uint8_t response);
+    uint8_t CurrentResponse(void);
+    uint8_t WaitForResponse(uint8_t base);
+    bool IsShadowedReg(uint8_t reg);
+    uint8_t ShadowRegRead(uint8_t reg);
+    SensorBus *_bus;
+    uint8_t _address;
+    uint8_t _regShadow[SHADOW_REG_LAST + 1];
+    uint32_t _regValid;
+    uint8_t _ramShadow[SHADOW_RAM_SIZE];
+    uint32_t _ramValid;
+    uint8_t _intPin;
+    uint8_t _responseBase;
+    uint8_t _response;
+    bool _responseKnown;
+    SI1145Config _config;
+    bool _configured;
 };
 
 #endif
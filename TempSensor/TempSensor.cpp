@@ -4,12 +4,25 @@
   Also enables setting of specific sensor functions and reading specific registers.
   Created by Sierra Catelani, March 21, 2020.
 *********************************************/
-#include <Arduino.h>
 #include "TempSensor.h"
 
 
+//TempSensor.TempSensor -> Initializes instance of TempSensor Class
+//and sets up the bus used to reach the MCP9808.
+//Inputs: bus the sensor is attached to (defaults to the system I2C bus).
+TempSensor::TempSensor(SensorBus &bus) : TempSensor(TempSenseI2CAdd, bus){}
+
+//TempSensor.TempSensor -> Same, for an MCP9808 strapped to another address.
+//Inputs: address -> TEMP_ADDR_MIN..TEMP_ADDR_MAX; bus the sensor is attached to.
+TempSensor::TempSensor(uint8_t address, SensorBus &bus){
+  _bus = &bus;
+  _address = address;
+  _shadowValid = 0;
+  _alertFlags = 0;
+}
+
 /************************************
-RegWrite() - Writes two byes of data to a specified register using I2C.
+RegWrite() - Writes two byes of data to a specified register using I2C (one byte for the resolution register).
 Inputs: reg = Target Register; data = two bytes of data to write.
 return: none
 *************************************/
@@ -17,15 +30,19 @@ return: none
 void TempSensor::RegWrite(uint16_t reg, uint16_t data){
 
   //Access ambient temperature register of temperature sensor
-  Wire.beginTransmission(TempSenseI2CAdd);
+  _bus->BeginTransmission(_address);
   
   //Set register offset to the Temp Sensor for writing
-  Wire.write(reg);
+  _bus->Write(reg);
 
-  //Write two bytes of data to Temp Sensor (one at a time) and end transmission
-  Wire.write(data>>8);
-  Wire.write(data & 0xFF);
-  Wire.endTransmission();
+  //Write two bytes of data to Temp Sensor (one at a time) and end transmission.
+  //The resolution register is 8 bits wide and takes the first byte sent, so it gets only the LSB.
+  if(reg != ResolutionREG){ _bus->Write(data>>8); }
+  _bus->Write(data & 0xFF);
+  _bus->EndTransmission();
+
+  //Keep the configuration shadow in step with the device
+  ShadowStore(reg, data);
 
   //complete
   return;
@@ -39,11 +56,11 @@ return: none
 void TempSensor::SetTargetReg(uint16_t reg){
 
   //Access ambient temperature register of temperature sensor
-  Wire.beginTransmission(TempSenseI2CAdd);
+  _bus->BeginTransmission(_address);
   
   //Set register offset to the Temp Sensor for writing
-  Wire.write(reg);
-  Wire.endTransmission();
+  _bus->Write(reg);
+  _bus->EndTransmission();
 }
 
 /************************************
@@ -53,9 +70,9 @@ return: none
 *************************************/
 void TempSensor::RegSetBit(uint16_t reg, uint8_t bit0){
 
-  //Read current data from register
+  //Read current data from register (served from the shadow for configuration registers)
   uint16_t registerContents = 0;
-  registerContents = RegRead(reg);
+  registerContents = ShadowRead(reg);
 
   //Create bitmask
   uint16_t bitmask = 1;
@@ -77,9 +94,9 @@ return: none
 *************************************/
 void TempSensor::RegClearBit(uint16_t reg, uint8_t bit0){
 
-  //Read current data from register
+  //Read current data from register (served from the shadow for configuration registers)
   uint16_t registerContents = 0;
-  registerContents = RegRead(reg);
+  registerContents = ShadowRead(reg);
 
   //Create bitmask
   uint16_t bitmask = 1;
@@ -104,10 +121,13 @@ bool TempSensor::RegCheckBit(uint16_t reg, uint8_t bit0){
   uint16_t bitmask = 1;
   uint16_t regReturn, bitcheck = 0;
 
-  regReturn = RegRead(reg);
-
   //Set bitmask to corresponding bit and check against register data
   bitmask <<= bit0;
+
+  //Alert status bits change on their own, so they always come from the device
+  if(reg == ConfigREG && (bitmask & CONFIG_VOLATILE_BITS)){ regReturn = RegRead(reg); }
+  else{ regReturn = ShadowRead(reg); }
+
   bitcheck = regReturn & bitmask;
 
   //return 1 if bitcheck != 0
@@ -122,7 +142,7 @@ Inputs: 1 enables ShutdownMode, 0 disables ShutdownMode
 return: none
 *************************************/
 void TempSensor::SetShutdownMode(bool enable){
-  uint8_t shutdownBit = 8; 
+  uint8_t shutdownBit = CONFIG_SHDN_BIT; 
   
   //Set or clear shutdown bit depending on enable value
   if(enable){RegSetBit(ConfigREG, shutdownBit);}
@@ -130,6 +150,95 @@ void TempSensor::SetShutdownMode(bool enable){
 }
 
 
+/************ Alert Output Functions ***********/
+
+/************************************
+SetAlertLimits() - Programs the alert window (T_LOWER / T_UPPER) and the critical limit (T_CRIT).
+Limits are kept at the registers' 0.25 C resolution; unchanged limits cost no bus traffic.
+Inputs: lower, upper, critical -> centi-degrees in TEMP_UNIT (e.g. 9500 = 95.00 F)
+return: none
+*************************************/
+void TempSensor::SetAlertLimits(int16_t lower, int16_t upper, int16_t critical){
+
+  uint16_t limits[3] = {CentiToLimit(lower), CentiToLimit(upper), CentiToLimit(critical)};
+  uint16_t regs[3] = {T_LowerBoundREG, T_UpperBoundREG, T_CriticalREG};
+
+  for(uint8_t i = 0; i < 3; i++){
+    if(ShadowRead(regs[i]) != limits[i]){ RegWrite(regs[i], limits[i]); }
+  }
+
+  return;
+}
+
+/************************************
+EnableAlert() - Turns on the Alert output (active low, open drain) in one configuration write, released
+(Interrupt Clear) so it starts deasserted. Set the limits at least one conversion time earlier, so the
+first comparison already uses them instead of reporting a crossing of the old ones.
+Inputs: mode -> TEMP_ALERT_COMPARATOR or TEMP_ALERT_INTERRUPT; criticalOnly -> alert on T_CRIT only
+return: none
+*************************************/
+void TempSensor::EnableAlert(uint8_t mode, bool criticalOnly){
+
+  uint16_t config = ShadowRead(ConfigREG) & ~CONFIG_ALERT_BITS;
+
+  config |= (1 << CONFIG_ALERT_CNT_BIT);
+  if(mode == TEMP_ALERT_INTERRUPT){ config |= (1 << CONFIG_ALERT_MODE_BIT); }
+  if(criticalOnly){ config |= (1 << CONFIG_ALERT_SEL_BIT); }
+
+  if(config != ShadowRead(ConfigREG) || mode == TEMP_ALERT_INTERRUPT){ RegWrite(ConfigREG, config | (1 << CONFIG_INT_CLEAR_BIT)); }
+
+  return;
+}
+
+/************************************
+DisableAlert() - Turns the Alert output off.
+*************************************/
+void TempSensor::DisableAlert(void){ RegClearBit(ConfigREG, CONFIG_ALERT_CNT_BIT); }
+
+/************************************
+ClearAlert() - Releases an interrupt-mode alert so the next window crossing can assert it again.
+(A temperature at or above T_CRIT keeps the output asserted regardless.)
+*************************************/
+void TempSensor::ClearAlert(void){ RegSetBit(ConfigREG, CONFIG_INT_CLEAR_BIT); }
+
+/************************************
+AlertFlags() - TEMP_FLAG_ bits (lower / upper / critical) from the last temperature read; no bus traffic.
+*************************************/
+uint8_t TempSensor::AlertFlags(void){ return _alertFlags; }
+
+
+
+/************************************
+SetResolution() - Selects the conversion resolution; finer steps take longer to convert.
+Skipped (no bus traffic) when the shadow shows it is already set.
+Inputs: resolution -> TEMP_RES_0_5C (30 ms), TEMP_RES_0_25C (65 ms), TEMP_RES_0_125C (130 ms) or TEMP_RES_0_0625C (250 ms)
+return: none
+*************************************/
+void TempSensor::SetResolution(uint8_t resolution){
+
+  resolution &= 0x03;
+  if(ShadowRead(ResolutionREG) == resolution){ return; }
+
+  RegWrite(ResolutionREG, resolution);
+
+  return;
+}
+
+/************************************
+Resolution() - Current TEMP_RES_ setting (from the shadow once known).
+*************************************/
+uint8_t TempSensor::Resolution(void){ return ShadowRead(ResolutionREG) & 0x03; }
+
+/************************************
+ConversionMillis() - Datasheet conversion time at the current resolution: how long after leaving
+shutdown (or changing resolution) before the temperature register holds a new reading.
+*************************************/
+uint16_t TempSensor::ConversionMillis(void){
+
+  static const uint16_t conversionMs[4] = {TEMP_TCONV_0_5C_MS, TEMP_TCONV_0_25C_MS, TEMP_TCONV_0_125C_MS, TEMP_TCONV_0_0625C_MS};
+
+  return conversionMs[Resolution()];
+}
 
 /************************************
 RegRead_SingleByte() - Reads the least significan byte of a Register.
@@ -142,10 +251,10 @@ uint8_t TempSensor::RegRead_SingleByte(uint16_t reg){
   SetTargetReg(reg);
 
   //request data from TempSense device
-  Wire.requestFrom(TempSenseI2CAdd,1);
+  _bus->RequestFrom(_address,1);
 
   //return byte from data read (returns one byte of data)
-  return Wire.read();
+  return _bus->Read();
   
 }
 
@@ -163,11 +272,13 @@ uint16_t TempSensor::RegRead(uint16_t reg){
   SetTargetReg(reg);
 
   //request data from TempSense device
-  Wire.requestFrom(TempSenseI2CAdd,2);
+  _bus->RequestFrom(_address,2);
 
   //create return data
-  returndata = (Wire.read()<<8);
-  returndata |= Wire.read();
+  returndata = (_bus->Read()<<8);
+  returndata |= _bus->Read();
+
+  ShadowStore(reg, returndata);
     
   return returndata;
   
@@ -188,24 +299,183 @@ uint16_t TempSensor::ReadDeviceIDREV(void){ return RegRead(DevIDREG); }
 
 
 /************************************
-ReadTempValue() - Reads Device ID/Rev register
-return: Reads temperature sensor and converts to Farenheit
+ReadTempRaw() - Reads the ambient temperature register.
+return: signed temperature in 1/16 C (full 0.0625 C resolution; flag bits removed)
 *************************************/
-float TempSensor::ReadTempValue(void){
+int16_t TempSensor::ReadTempRaw(void){
 
-  float temperature;
   uint8_t upperByte, lowerByte;
 
-  //Access ambient temperature register of temperature sensor and clear flag bits
+  //Access ambient temperature register of temperature sensor
   SetTargetReg(T_TempReadREG);
-  Wire.requestFrom(TempSenseI2CAdd,2);
-  upperByte = Wire.read();
-  lowerByte = Wire.read();
-  upperByte &= 0x0F;
+  _bus->RequestFrom(_address,2);
+  upperByte = _bus->Read();
+  lowerByte = _bus->Read();
+
+  //Keep the alert flags (bits 15:13), then clear them and sign-extend the 13-bit two's complement value
+  _alertFlags = upperByte >> 5;
+  int16_t raw = ((uint16_t)upperByte << 8 | lowerByte) & TA_VALUE_MASK;
+  if(raw & TA_SIGN_BIT){ raw -= (TA_VALUE_MASK + 1); }
+
+  return raw;
+}
+
+/************************************
+ReadTemp() - Reads the temperature in integer centi-degrees, no floating point.
+return: hundredths of a degree in TEMP_UNIT (e.g. 7156 = 71.56 F)
+*************************************/
+int16_t TempSensor::ReadTemp(void){
+
+#if TEMP_UNIT == TEMP_UNIT_CELSIUS
+  return RawToCentiCelsius(ReadTempRaw());
+#else
+  return RawToCentiFahrenheit(ReadTempRaw());
+#endif
+}
 
-  //computer Temperature and convert to Fareinheit (upperbyte * 16 + lowerbyte/16 - from MCP9808 datasheet)
-  temperature = (float(upperByte)*16 + (float(lowerByte)/16))*9/5 + 32;
+/************************************
+ReadTempOneShot() - One conversion from shutdown: wakes the sensor, waits ConversionMillis(), reads
+and shuts it down again (0.1 uA instead of 200 uA between readings). Blocks for the conversion;
+SampleScheduler does the same sequence without blocking in low-power mode.
+return: centi-degrees in TEMP_UNIT
+*************************************/
+int16_t TempSensor::ReadTempOneShot(void){
+
+  SetShutdownMode(false);
+  delay(ConversionMillis());
+
+  int16_t temperature = ReadTemp();
+  SetShutdownMode(true);
 
   return temperature;
 }
 
+/************************************
+ReadTempValue() - Reads the temperature in Fahrenheit.
+return: temperature in F (kept for sketches that print a float; ReadTemp() avoids the float math)
+*************************************/
+float TempSensor::ReadTempValue(void){ return RawToCentiFahrenheit(ReadTempRaw()) / 100.0f; }
+
+/************************************
+CentiToLimit() - Centi-degrees in TEMP_UNIT to limit register format: 13-bit two's complement in
+1/16 C, rounded to the nearest 0.25 C (bits 1:0 unused).
+*************************************/
+uint16_t TempSensor::CentiToLimit(int16_t centi){
+
+  //Quarter degrees C: centi-C / 25, or (centi-F - 3200) / 45
+#if TEMP_UNIT == TEMP_UNIT_CELSIUS
+  int32_t scaled = centi;
+  int32_t divisor = 25;
+#else
+  int32_t scaled = (int32_t)centi - 3200;
+  int32_t divisor = 45;
+#endif
+
+  int32_t quarters = (scaled + ((scaled < 0) ? -divisor / 2 : divisor / 2)) / divisor;
+
+  //1/16 C units, bits 1:0 unused
+  return (uint16_t)(quarters * 4) & T_LIMIT_MASK;
+}
+
+/************************************
+RawToCentiCelsius() - 1/16 C to centi-Celsius: raw * 100 / 16 = raw * 25 / 4, rounded half away from zero.
+*************************************/
+int16_t TempSensor::RawToCentiCelsius(int16_t raw){
+
+  int32_t scaled = (int32_t)raw * 25;
+
+  return (scaled + ((scaled < 0) ? -2 : 2)) / 4;
+}
+
+/************************************
+RawToCentiFahrenheit() - 1/16 C to centi-Fahrenheit: raw * 100 * 9 / (16 * 5) + 3200 = raw * 45 / 4 + 3200.
+Clamped to the int16_t range (only reached outside -199 C to +295 C, far beyond the sensor's range).
+*************************************/
+int16_t TempSensor::RawToCentiFahrenheit(int16_t raw){
+
+  int32_t scaled = (int32_t)raw * 45;
+  int32_t centi = (scaled + ((scaled < 0) ? -2 : 2)) / 4 + 3200;
+
+  if(centi > INT16_MAX){ centi = INT16_MAX; }
+  if(centi < INT16_MIN){ centi = INT16_MIN; }
+
+  return centi;
+}
+
+
+/**************************************************************/
+/*---------------- Configuration Register Shadow -------------*/
+/**************************************************************/
+
+//Configuration registers (CONFIG, limits, resolution) are only changed by this driver, so a
+//write-through copy lets read-modify-write operations skip the I2C read.
+
+/************************************
+InvalidateShadow() - Forgets all cached register values (e.g. after a power cycle of the sensor).
+Inputs: none
+return: none
+*************************************/
+void TempSensor::InvalidateShadow(void){ _shadowValid = 0; }
+
+/************************************
+ResyncShadow() - Re-reads every shadowed configuration register from the device.
+Inputs: none
+return: none
+*************************************/
+void TempSensor::ResyncShadow(void){
+
+  _shadowValid = 0;
+
+  for(uint16_t reg = 0; reg < TEMP_SHADOW_REGS; reg++){
+    if(IsShadowed(reg)){ ShadowStore(reg, BusReadReg(reg)); }
+  }
+
+  return;
+}
+
+bool TempSensor::IsShadowed(uint16_t reg){ return reg < TEMP_SHADOW_REGS && (TEMP_SHADOW_MASK & (1 << reg)); }
+
+/************************************
+BusReadReg() - Reads a register from the device using its native width (resolution register is one byte).
+Inputs: reg = target register
+return: register contents
+*************************************/
+uint16_t TempSensor::BusReadReg(uint16_t reg){
+
+  if(reg == ResolutionREG){ return RegRead_SingleByte(reg); }
+  return RegRead(reg);
+}
+
+/************************************
+ShadowRead() - Returns a register value, from the shadow when cached, otherwise from the device.
+Inputs: reg = target register
+return: register contents
+*************************************/
+uint16_t TempSensor::ShadowRead(uint16_t reg){
+
+  if(IsShadowed(reg) && (_shadowValid & (1 << reg))){ return _shadow[reg]; }
+
+  uint16_t value = BusReadReg(reg);
+  ShadowStore(reg, value);
+
+  return value;
+}
+
+/************************************
+ShadowStore() - Records a value written to / read from a shadowed register, as the device will hold it.
+Inputs: reg = target register; data = register contents
+return: none
+*************************************/
+void TempSensor::ShadowStore(uint16_t reg, uint16_t data){
+
+  if(!IsShadowed(reg)){ return; }
+
+  if(reg == ConfigREG){ data &= ~CONFIG_VOLATILE_BITS; }
+  else if(reg == ResolutionREG){ data &= 0x0003; }
+  else{ data &= T_LIMIT_MASK; }
+
+  _shadow[reg] = data;
+  _shadowValid |= (1 << reg);
+
+  return;
+}
@@ -1,11 +1,15 @@
 #ifndef TempSensor_h
 #define TempSensor_h
 
-#include <Wire.h>
+#include "SensorBus.h"
 
 
 #define TempSenseI2CAdd 0x18
 
+//A2..A1..A0 address pins select 0x18 - 0x1F, so up to eight MCP9808s share one bus
+#define TEMP_ADDR_MIN 0x18
+#define TEMP_ADDR_MAX 0x1F
+
 #define ConfigREG 0x1
 #define T_UpperBoundREG 0x2
 #define T_LowerBoundREG 0x3
@@ -15,21 +19,99 @@
 #define DevIDREG 0x7
 #define ResolutionREG 0x8
 
+//Configuration registers kept in the write-through shadow
+#define TEMP_SHADOW_REGS 0x9
+#define TEMP_SHADOW_MASK ((1 << ConfigREG) | (1 << T_UpperBoundREG) | (1 << T_LowerBoundREG) | (1 << T_CriticalREG) | (1 << ResolutionREG))
+#define CONFIG_VOLATILE_BITS 0x0030
+#define T_LIMIT_MASK 0x1FFC
+
+/******** Temperature Units ********/
+//ReadTemp() and the uploaded samples use signed centi-degrees (hundredths) in TEMP_UNIT.
+//Select with -DTEMP_UNIT=TEMP_UNIT_CELSIUS; Fahrenheit is the default.
+#define TEMP_UNIT_CELSIUS 0
+#define TEMP_UNIT_FAHRENHEIT 1
+#ifndef TEMP_UNIT
+#define TEMP_UNIT TEMP_UNIT_FAHRENHEIT
+#endif
+
+//TA register: 13-bit two's complement in 1/16 C (sign in bit 12), flags in bits 15:13
+#define TA_VALUE_MASK 0x1FFF
+#define TA_SIGN_BIT 0x1000
+
+/******** Alert Output (ConfigREG bits) ********/
+#define CONFIG_ALERT_MODE_BIT 0     //0 = comparator, 1 = interrupt
+#define CONFIG_ALERT_POL_BIT 1      //0 = active low (open drain, needs a pull-up)
+#define CONFIG_ALERT_SEL_BIT 2      //1 = T_CRIT only
+#define CONFIG_ALERT_CNT_BIT 3      //1 = output enabled
+#define CONFIG_INT_CLEAR_BIT 5
+#define CONFIG_SHDN_BIT 8
+#define CONFIG_ALERT_BITS 0x000F
+
+#define TEMP_ALERT_COMPARATOR 0     //asserted while outside the window / above T_CRIT
+#define TEMP_ALERT_INTERRUPT 1      //asserted on each window crossing until ClearAlert()
+
+//Alert flags in the top bits of the TA register (AlertFlags())
+#define TEMP_FLAG_LOWER 0x01
+#define TEMP_FLAG_UPPER 0x02
+#define TEMP_FLAG_CRITICAL 0x04
+
+/******** Resolution (ResolutionREG) ********/
+#define TEMP_RES_0_5C 0
+#define TEMP_RES_0_25C 1
+#define TEMP_RES_0_125C 2
+#define TEMP_RES_0_0625C 3    //power-on default
+
+//Datasheet conversion time per resolution (ms). A new reading needs one full conversion
+//after leaving shutdown; TEMP_WAKE_MS is the longest (0.0625 C).
+#define TEMP_TCONV_0_5C_MS 30
+#define TEMP_TCONV_0_25C_MS 65
+#define TEMP_TCONV_0_125C_MS 130
+#define TEMP_TCONV_0_0625C_MS 250
+#define TEMP_WAKE_MS TEMP_TCONV_0_0625C_MS
 
 
 class TempSensor{
 public:
+  TempSensor(SensorBus &bus = SystemBus());
+  TempSensor(uint8_t address, SensorBus &bus = SystemBus());
   void RegWrite(uint16_t reg, uint16_t data);
   void SetTargetReg(uint16_t reg);
   void RegSetBit(uint16_t reg, uint8_t bit0);
   void RegClearBit(uint16_t reg, uint8_t bit0);
   bool RegCheckBit(uint16_t reg, uint8_t bit0);
   void SetShutdownMode(bool enable);
+  void SetAlertLimits(int16_t lower, int16_t upper, int16_t critical);
+  void EnableAlert(uint8_t mode, bool criticalOnly = false);
+  void DisableAlert(void);
+  void ClearAlert(void);
+  uint8_t AlertFlags(void);
+  void SetResolution(uint8_t resolution);
+  uint8_t Resolution(void);
+  uint16_t ConversionMillis(void);
   uint8_t RegRead_SingleByte(uint16_t reg);
   uint16_t RegRead(uint16_t reg);
   uint16_t ReadManufactID(void);
   uint16_t ReadDeviceIDREV(void);
+  int16_t ReadTempRaw(void);
+  int16_t ReadTemp(void);
+  int16_t ReadTempOneShot(void);
   float ReadTempValue(void);
+  static int16_t RawToCentiCelsius(int16_t raw);
+  static int16_t RawToCentiFahrenheit(int16_t raw);
+  static uint16_t CentiToLimit(int16_t centi);
+  void InvalidateShadow(void);
+  void ResyncShadow(void);
+
+private:
+  bool IsShadowed(uint16_t reg);
+  uint16_t BusReadReg(uint16_t reg);
+  uint16_t ShadowRead(uint16_t reg);
+  void ShadowStore(uint16_t reg, uint16_t data);
+  SensorBus *_bus;
+  uint8_t _address;
+  uint16_t _shadow[TEMP_SHADOW_REGS];
+  uint16_t _shadowValid;
+  uint8_t _alertFlags;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,146 @@
+/********************************************
+  HttpResponseParser.cc - Incremental HTTP/1.x response parser that never allocates.
+*********************************************/
+
+#include "HttpResponseParser.h"
+
+#include <stdlib.h>
+#include <strings.h>
+
+//HttpResponseParser.HttpResponseParser -> Initializes a parser waiting for a status line.
+HttpResponseParser::HttpResponseParser(void){
+  Reset();
+}
+
+/************************************
+Reset() - Prepares the parser for the next response on the connection.
+*************************************/
+void HttpResponseParser::Reset(void){
+  _state = HTTP_PARSE_STATUS;
+  _status = 0;
+  _contentLength = -1;
+  _remaining = 0;
+  _chunked = false;
+  _keepAlive = true;
+  _lineLength = 0;
+}
+
+/************************************
+Feed() - Consumes received bytes. Bytes after the end of the response are ignored.
+Inputs: data/length -> bytes read from the connection
+return: parser state after the bytes are consumed (HTTP_PARSE_DONE once the response is complete)
+*************************************/
+uint8_t HttpResponseParser::Feed(const uint8_t *data, uint16_t length){
+
+  uint16_t i = 0;
+
+  while(i < length && _state != HTTP_PARSE_DONE && _state != HTTP_PARSE_ERROR){
+
+    //Body bytes are skipped in bulk rather than one at a time
+    if(_state == HTTP_PARSE_BODY || _state == HTTP_PARSE_CHUNK_DATA){
+      unsigned long skip = length - i;
+      if(skip > _remaining){ skip = _remaining; }
+      _remaining -= skip;
+      i += skip;
+
+      if(_remaining == 0){ _state = (_state == HTTP_PARSE_BODY) ? HTTP_PARSE_DONE : HTTP_PARSE_CHUNK_END; }
+      continue;
+    }
+
+    if(_state == HTTP_PARSE_UNTIL_CLOSE){ i = length; continue; }
+
+    //Everything else is line oriented
+    char c = (char)data[i++];
+
+    if(c == '\n'){
+      _line[_lineLength] = '\0';
+      LineDone();
+      _lineLength = 0;
+    }
+    else if(c != '\r' && _lineLength < HTTP_LINE_MAX - 1){ _line[_lineLength++] = c; }
+  }
+
+  return _state;
+}
+
+/************************************
+LineDone() - Handles one complete status, header, chunk-size or trailer line.
+*************************************/
+void HttpResponseParser::LineDone(void){
+
+  switch(_state){
+
+    case HTTP_PARSE_STATUS:
+      //HTTP/1.1 202 Accepted
+      if(strncmp(_line, "HTTP/1.", 7) != 0 || _lineLength < 12){ _state = HTTP_PARSE_ERROR; return; }
+      _status = atoi(&_line[9]);
+      _keepAlive = (_line[7] == '1');
+      _state = HTTP_PARSE_HEADER;
+      break;
+
+    case HTTP_PARSE_HEADER:
+      if(_lineLength == 0){ HeadersDone(); return; }
+
+      if(strncasecmp(_line, "Content-Length:", 15) == 0){ _contentLength = atol(&_line[15]); }
+      else if(strncasecmp(_line, "Transfer-Encoding:", 18) == 0){
+        const char *value = &_line[18];
+        while(*value == ' '){ value++; }
+        _chunked = (strncasecmp(value, "chunked", 7) == 0);
+      }
+      else if(strncasecmp(_line, "Connection:", 11) == 0){
+        const char *value = &_line[11];
+        while(*value == ' '){ value++; }
+        if(strncasecmp(value, "close", 5) == 0){ _keepAlive = false; }
+        else if(strncasecmp(value, "keep-alive", 10) == 0){ _keepAlive = true; }
+      }
+      break;
+
+    case HTTP_PARSE_CHUNK_SIZE:
+      _remaining = strtoul(_line, 0, 16);
+      _state = (_remaining == 0) ? HTTP_PARSE_TRAILER : HTTP_PARSE_CHUNK_DATA;
+      break;
+
+    case HTTP_PARSE_CHUNK_END:
+      _state = HTTP_PARSE_CHUNK_SIZE;
+      break;
+
+    case HTTP_PARSE_TRAILER:
+      if(_lineLength == 0){ _state = HTTP_PARSE_DONE; }
+      break;
+  }
+}
+
+/************************************
+HeadersDone() - Picks the body framing once the blank line after the headers arrives.
+*************************************/
+void HttpResponseParser::HeadersDone(void){
+
+  //1xx, 204 and 304 responses never carry a body
+  if(_status < 200 || _status == 204 || _status == 304){
+    if(_status < 200){ Reset(); return; }
+    _state = HTTP_PARSE_DONE;
+    return;
+  }
+
+  if(_chunked){ _state = HTTP_PARSE_CHUNK_SIZE; return; }
+
+  if(_contentLength >= 0){
+    _remaining = _contentLength;
+    _state = (_remaining == 0) ? HTTP_PARSE_DONE : HTTP_PARSE_BODY;
+    return;
+  }
+
+  //No framing: the body runs until the server closes the connection
+  _keepAlive = false;
+  _state = HTTP_PARSE_UNTIL_CLOSE;
+}
+
+uint8_t HttpResponseParser::State(void){ return _state; }
+
+bool HttpResponseParser::Done(void){ return _state == HTTP_PARSE_DONE; }
+
+uint16_t HttpResponseParser::StatusCode(void){ return _status; }
+
+bool HttpResponseParser::KeepAlive(void){ return _keepAlive; }
+
+long HttpResponseParser::ContentLength(void){ return _contentLength; }
@@ -0,0 +1,56 @@
+/********************************************
+  HttpResponseParser.h - Incremental HTTP/1.x response parser that never allocates.
+  Bytes are fed as they arrive; only the status code, Content-Length, chunked
+  transfer coding and Connection header are tracked, and the body is skipped.
+*********************************************/
+
+#ifndef HttpResponseParser_h
+#define HttpResponseParser_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "HostPlatform.h"
+#endif
+
+/******** Parser States ********/
+#define HTTP_PARSE_STATUS 0
+#define HTTP_PARSE_HEADER 1
+#define HTTP_PARSE_BODY 2
+#define HTTP_PARSE_CHUNK_SIZE 3
+#define HTTP_PARSE_CHUNK_DATA 4
+#define HTTP_PARSE_CHUNK_END 5
+#define HTTP_PARSE_TRAILER 6
+#define HTTP_PARSE_UNTIL_CLOSE 7
+#define HTTP_PARSE_DONE 8
+#define HTTP_PARSE_ERROR 9
+
+//Longest header line kept; longer lines are truncated (none of the headers we read come close)
+#define HTTP_LINE_MAX 48
+
+
+class HttpResponseParser{
+  public:
+    HttpResponseParser(void);
+    void Reset(void);
+    uint8_t Feed(const uint8_t *data, uint16_t length);
+    uint8_t State(void);
+    bool Done(void);
+    uint16_t StatusCode(void);
+    bool KeepAlive(void);
+    long ContentLength(void);
+
+  private:
+    void LineDone(void);
+    void HeadersDone(void);
+    uint8_t _state;
+    uint16_t _status;
+    long _contentLength;
+    unsigned long _remaining;
+    bool _chunked;
+    bool _keepAlive;
+    char _line[HTTP_LINE_MAX];
+    uint8_t _lineLength;
+};
+
+#endif
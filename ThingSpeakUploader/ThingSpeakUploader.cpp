@@ -0,0 +1,187 @@
+/********************************************
+  ThingSpeakUploader.cc - Keep-alive HTTP uploader for the ThingSpeak bulk-update endpoint.
+  Replaces connect -> "Connection: close" -> fixed delay(200) -> stop() per sample with one
+  long-lived connection whose responses are read to the end of the body, so the next request
+  can go out on the same socket.
+  The body is formatted straight into _request after a reserved header area; the headers are
+  then written just in front of it once Content-Length is known, and the whole request leaves
+  in a single write() (one SPI transfer to the NINA module instead of one per fragment).
+*********************************************/
+
+#include "ThingSpeakUploader.h"
+
+//ThingSpeakUploader.ThingSpeakUploader -> Initializes the uploader. No connection is made until the first post.
+//Inputs: client -> network client to use (WiFiClient on the Nano); host/port -> server;
+//bulkPath -> /channels/<id>/bulk_update.json; apiKey -> channel write key.
+ThingSpeakUploader::ThingSpeakUploader(Client &client, const char *host, uint16_t port, const char *bulkPath, const char *apiKey){
+  _client = &client;
+  _host = host;
+  _port = port;
+  _bulkPath = bulkPath;
+  _apiKey = apiKey;
+  _lastStatus = 0;
+  _connects = 0;
+  _requestStart = 0;
+  _requestLength = 0;
+}
+
+/************************************
+PostBulk() - Posts the oldest stored samples in one bulk-update request.
+A kept-alive socket the server has silently closed is detected by the failed exchange and the
+same request buffer is resent once on a fresh connection.
+Inputs: store -> sample store; count -> number of samples (from the oldest) to send. Trimmed to
+        the number that fit in the request buffer, which is what should be dropped on success.
+        extraFields -> optional ,"name":value,... text added to the last record sent (e.g. a SampleSummary)
+return: UPLOAD_OK on HTTP 200/202, otherwise an UPLOAD_ERR_ code
+*************************************/
+uint8_t ThingSpeakUploader::PostBulk(SampleStore &store, uint16_t &count, const char *extraFields){
+
+  if(!BuildRequest(store, count, extraFields)){ return UPLOAD_ERR_TOO_LARGE; }
+
+  bool reused = _client->connected();
+  uint8_t result = Exchange();
+
+  if(reused && (result == UPLOAD_ERR_SEND || result == UPLOAD_ERR_TIMEOUT)){
+    result = Exchange();
+  }
+
+  return result;
+}
+
+/************************************
+Publish() - SampleTransport entry point: one bulk update, all or nothing.
+Inputs: store, count, extraFields -> as PostBulk(); count is set to the records delivered (0 on failure)
+return: as PostBulk()
+*************************************/
+uint8_t ThingSpeakUploader::Publish(SampleStore &store, uint16_t &count, const char *extraFields){
+
+  uint8_t result = PostBulk(store, count, extraFields);
+  if(result != UPLOAD_OK){ count = 0; }
+
+  return result;
+}
+
+/************************************
+BuildRequest() - Formats the request line, headers and JSON body into _request.
+Inputs: store -> sample store; count -> requested records, reduced to the number that fit;
+        extraFields -> text spliced into the last record before its closing brace (may be 0)
+return: true if the request (with at least one record) fits
+*************************************/
+bool ThingSpeakUploader::BuildRequest(SampleStore &store, uint16_t &count, const char *extraFields){
+
+  char *body = &_request[UPLOAD_HEADER_RESERVE];
+  uint16_t space = UPLOAD_BUFFER_SIZE - UPLOAD_HEADER_RESERVE;
+  uint16_t length = SampleStore::FormatBulkHeader(_apiKey, body, space);
+  uint16_t trailer = strlen(BULK_TRAILER);
+  uint16_t extra = (extraFields != 0) ? strlen(extraFields) : 0;
+
+  //Stop at the first record that could overflow, leaving room for the extra fields and trailer
+  uint16_t records = 0;
+  while(records < count && length + BULK_RECORD_MAX + extra + trailer <= space){
+    length += store.FormatBulkRecord(records, &body[length], space - length);
+    records++;
+  }
+
+  if(records == 0 && count > 0){ return false; }
+
+  //Records end in '}': reopen the last one for the extra fields
+  if(extra > 0 && records > 0){
+    memcpy(&body[length - 1], extraFields, extra);
+    length += extra - 1;
+    body[length++] = '}';
+  }
+
+  memcpy(&body[length], BULK_TRAILER, trailer);
+  length += trailer;
+  count = records;
+
+  char header[UPLOAD_HEADER_RESERVE];
+  int headerLength = snprintf(header, sizeof(header),
+                              "POST %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n"
+                              "Content-Type: application/json\r\nContent-Length: %u\r\n\r\n",
+                              _bulkPath, _host, (unsigned int)length);
+  if(headerLength <= 0 || headerLength >= (int)sizeof(header)){ return false; }
+
+  _requestStart = UPLOAD_HEADER_RESERVE - headerLength;
+  _requestLength = headerLength + length;
+  memcpy(&_request[_requestStart], header, headerLength);
+
+  return true;
+}
+
+/************************************
+Exchange() - Sends the built request and reads the response, connecting first only if needed.
+*************************************/
+uint8_t ThingSpeakUploader::Exchange(void){
+
+  if(!_client->connected()){
+    _client->stop();
+    if(!_client->connect(_host, _port)){ return UPLOAD_ERR_CONNECT; }
+    _connects++;
+  }
+
+  if(_client->write((const uint8_t *)&_request[_requestStart], _requestLength) != _requestLength){
+    _client->stop();
+    return UPLOAD_ERR_SEND;
+  }
+
+  return ReadResponse();
+}
+
+/************************************
+ReadResponse() - Feeds received bytes to the parser until the response (body included) is complete.
+return: UPLOAD_OK, UPLOAD_ERR_TIMEOUT, UPLOAD_ERR_PROTOCOL or UPLOAD_ERR_STATUS
+*************************************/
+uint8_t ThingSpeakUploader::ReadResponse(void){
+
+  uint8_t chunk[UPLOAD_READ_CHUNK];
+  unsigned long deadline = millis() + UPLOAD_RESPONSE_TIMEOUT_MS;
+
+  _parser.Reset();
+  _lastStatus = 0;
+
+  while(!_parser.Done()){
+
+    if((long)(millis() - deadline) >= 0){ _client->stop(); return UPLOAD_ERR_TIMEOUT; }
+
+    if(_client->available() == 0){
+      if(!_client->connected()){
+        //A body without framing ends at close; anything else closing early is a failed exchange
+        if(_parser.State() == HTTP_PARSE_UNTIL_CLOSE){ break; }
+        _client->stop();
+        return UPLOAD_ERR_TIMEOUT;
+      }
+      delay(1);
+      continue;
+    }
+
+    int count = _client->read(chunk, sizeof(chunk));
+    if(count > 0 && _parser.Feed(chunk, count) == HTTP_PARSE_ERROR){
+      _client->stop();
+      return UPLOAD_ERR_PROTOCOL;
+    }
+  }
+
+  _lastStatus = _parser.StatusCode();
+  if(!_parser.Done() || !_parser.KeepAlive()){ _client->stop(); }
+
+  if(_lastStatus == 200 || _lastStatus == 202){ return UPLOAD_OK; }
+  return UPLOAD_ERR_STATUS;
+}
+
+/************************************
+Close() - Closes the kept-alive connection (e.g. before the radio is turned off).
+*************************************/
+void ThingSpeakUploader::Close(void){ _client->stop(); }
+
+uint16_t ThingSpeakUploader::LastStatus(void){ return _lastStatus; }
+
+/************************************
+Connects() - Number of TCP connections opened; stays at 1 while keep-alive holds.
+*************************************/
+uint32_t ThingSpeakUploader::Connects(void){ return _connects; }
+
+/************************************
+LastRequestLength() - Size in bytes of the last request built (headers + body).
+*************************************/
+uint16_t ThingSpeakUploader::LastRequestLength(void){ return _requestLength; }
@@ -0,0 +1,62 @@
+/********************************************
+  ThingSpeakUploader.h - Posts stored samples to ThingSpeak over a persistent
+  (keep-alive) HTTP connection. The socket is reused across posts and only
+  reopened when the server closes it or a request fails.
+  Requests are assembled in a fixed buffer and sent with one write; responses
+  are parsed incrementally, so an upload never touches the heap.
+*********************************************/
+
+#ifndef ThingSpeakUploader_h
+#define ThingSpeakUploader_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Client.h>
+#else
+#include "HostNet.h"
+#endif
+
+#include "SampleStore.h"
+#include "SampleTransport.h"
+#include "HttpResponseParser.h"
+
+/******** Upload Settings ********/
+#define UPLOAD_RESPONSE_TIMEOUT_MS 5000
+#define UPLOAD_READ_CHUNK 32
+
+//Request buffer: request line + headers fit in the reserve, the JSON body follows it.
+//Records are ~50 bytes, so a full BULK_MAX_RECORDS batch normally fits; larger ones are trimmed.
+#ifndef UPLOAD_BUFFER_SIZE
+#define UPLOAD_BUFFER_SIZE 2048
+#endif
+#define UPLOAD_HEADER_RESERVE 192
+
+
+class ThingSpeakUploader : public SampleTransport{
+  public:
+    ThingSpeakUploader(Client &client, const char *host, uint16_t port, const char *bulkPath, const char *apiKey);
+    uint8_t PostBulk(SampleStore &store, uint16_t &count, const char *extraFields = 0);
+    uint8_t Publish(SampleStore &store, uint16_t &count, const char *extraFields = 0);
+    void Close(void);
+    uint16_t LastStatus(void);
+    uint32_t Connects(void);
+    uint16_t LastRequestLength(void);
+
+  private:
+    bool BuildRequest(SampleStore &store, uint16_t &count, const char *extraFields);
+    uint8_t Exchange(void);
+    uint8_t ReadResponse(void);
+    Client *_client;
+    const char *_host;
+    uint16_t _port;
+    const char *_bulkPath;
+    const char *_apiKey;
+    uint16_t _lastStatus;
+    uint32_t _connects;
+    HttpResponseParser _parser;
+    char _request[UPLOAD_BUFFER_SIZE];
+    uint16_t _requestStart;
+    uint16_t _requestLength;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/********************************************
+  WiFiLink.cc - Non-blocking WiFi connection manager with exponential backoff.
+  Replaces the WiFi.begin() + delay(10000) retry loop, which stopped sampling for as
+  long as the access point was unreachable.
+*********************************************/
+
+#include "WiFiLink.h"
+
+//WiFiLink.WiFiLink -> Initializes an idle link (radio off, not requested).
+//Inputs: radio -> radio driver; ssid, pass -> WPA/WPA2 network (kept by pointer)
+WiFiLink::WiFiLink(WiFiRadio &radio, const char *ssid, const char *pass){
+  _radio = &radio;
+  _ssid = ssid;
+  _pass = pass;
+  _state = LINK_IDLE;
+  _wanted = false;
+  _consecutive = 0;
+  _nextStep = 0;
+  _deadline = 0;
+  _skipped = 0;
+  _seed = 1;
+  _attempts = 0;
+  _failures = 0;
+  _connects = 0;
+}
+
+/************************************
+Begin() - Seeds the backoff jitter. Give each node a different seed (e.g. analog noise from an
+unconnected pin) so a fleet that lost the same access point spreads its retries.
+Inputs: seed -> any value; 0 is replaced
+return: none
+*************************************/
+void WiFiLink::Begin(uint32_t seed){
+
+  _seed = (seed != 0) ? seed : 1;
+
+  return;
+}
+
+/************************************
+Request() - Asks for the link; the next Service() starts an attempt unless a backoff window is running.
+*************************************/
+void WiFiLink::Request(void){ _wanted = true; }
+
+/************************************
+Release() - The link is no longer needed: the radio is turned off (close any open client first).
+A running backoff window is kept, so releasing and requesting again does not skip it.
+*************************************/
+void WiFiLink::Release(void){
+
+  _wanted = false;
+
+  if(_state == LINK_CONNECTING || _state == LINK_UP){
+    _radio->End();
+    _state = LINK_IDLE;
+  }
+
+  return;
+}
+
+/************************************
+ClockSkipped() - Accounts for time the MCU slept without millis() advancing (see SampleScheduler).
+Inputs: ms -> milliseconds slept that millis() did not see
+return: none
+*************************************/
+void WiFiLink::ClockSkipped(unsigned long ms){ _skipped += ms; }
+
+unsigned long WiFiLink::Now(void){ return millis() + _skipped; }
+
+/************************************
+Service() - Advances the link. Call from loop(); costs at most one radio status query.
+Inputs: none
+return: none
+*************************************/
+void WiFiLink::Service(void){
+
+  unsigned long now = Now();
+
+  if(_state == LINK_IDLE){
+    if(_wanted){ StartAttempt(now); }
+    return;
+  }
+
+  if((long)(now - _nextStep) < 0){ return; }
+
+  switch(_state){
+
+    case LINK_BACKOFF:
+      if(_wanted){ StartAttempt(now); }
+      break;
+
+    case LINK_CONNECTING:{
+      uint8_t status = _radio->Status();
+      if(status == RADIO_CONNECTED){
+        _state = LINK_UP;
+        _consecutive = 0;
+        _connects++;
+        _nextStep = now + LINK_CHECK_MS;
+      }
+      else if(status == RADIO_CONNECTING && (long)(now - _deadline) < 0){
+        _nextStep = now + LINK_POLL_MS;
+      }
+      else{ Fail(now); }
+      break;
+    }
+
+    case LINK_UP:
+      if(_radio->Status() == RADIO_CONNECTED){ _nextStep = now + LINK_CHECK_MS; }
+      else{ Fail(now); }
+      break;
+  }
+
+  return;
+}
+
+/************************************
+StartAttempt() - Starts one association; the radio answers through Status() on later Service() calls.
+*************************************/
+void WiFiLink::StartAttempt(unsigned long now){
+
+  _attempts++;
+
+  if(_radio->Begin(_ssid, _pass) != RADIO_CONNECTING){
+    Fail(now);
+    return;
+  }
+
+  _state = LINK_CONNECTING;
+  _deadline = now + LINK_CONNECT_TIMEOUT_MS;
+  _nextStep = now + LINK_POLL_MS;
+
+  return;
+}
+
+/************************************
+Fail() - Turns the radio off and waits out the backoff window before the next attempt.
+*************************************/
+void WiFiLink::Fail(unsigned long now){
+
+  _radio->End();
+  _failures++;
+  if(_consecutive < 0xFF){ _consecutive++; }
+
+  _state = LINK_BACKOFF;
+  _nextStep = now + BackoffMillis(_consecutive);
+
+  return;
+}
+
+/************************************
+BackoffMillis() - Radio-off window after a number of consecutive failures: LINK_BACKOFF_MIN_MS doubled
+per failure up to LINK_BACKOFF_MAX_MS, then a random point in its upper half ("equal jitter"), so the
+wait still grows but two nodes rarely pick the same one.
+Inputs: failures -> consecutive failures, 1 or more
+return: milliseconds to wait
+*************************************/
+unsigned long WiFiLink::BackoffMillis(uint8_t failures){
+
+  unsigned long window = LINK_BACKOFF_MIN_MS;
+
+  for(uint8_t i = 1; i < failures && window < LINK_BACKOFF_MAX_MS; i++){ window <<= 1; }
+  if(window > LINK_BACKOFF_MAX_MS){ window = LINK_BACKOFF_MAX_MS; }
+
+  return window / 2 + Random() % (window / 2 + 1);
+}
+
+/************************************
+Random() - xorshift32; enough to decorrelate retries without pulling in the C library's rand().
+*************************************/
+uint32_t WiFiLink::Random(void){
+
+  _seed ^= _seed << 13;
+  _seed ^= _seed >> 17;
+  _seed ^= _seed << 5;
+
+  return _seed;
+}
+
+bool WiFiLink::Connected(void){ return _state == LINK_UP; }
+
+bool WiFiLink::RadioOn(void){ return _state == LINK_CONNECTING || _state == LINK_UP; }
+
+uint8_t WiFiLink::State(void){ return _state; }
+
+/************************************
+MillisUntilNextStep() - Time the MCU can sleep before Service() has something to do. A backoff window
+only ends something while the link is requested.
+return: milliseconds until the next poll or retry, 0 if due now, LINK_NEVER if none is pending
+*************************************/
+unsigned long WiFiLink::MillisUntilNextStep(void){
+
+  if(_state == LINK_IDLE){ return _wanted ? 0 : LINK_NEVER; }
+  if(_state == LINK_BACKOFF && !_wanted){ return LINK_NEVER; }
+
+  unsigned long now = Now();
+  if((long)(now - _nextStep) >= 0){ return 0; }
+
+  return _nextStep - now;
+}
+
+uint32_t WiFiLink::Attempts(void){ return _attempts; }
+
+uint32_t WiFiLink::Failures(void){ return _failures; }
+
+uint32_t WiFiLink::Connects(void){ return _connects; }
@@ -0,0 +1,68 @@
+/********************************************
+  WiFiLink.h - Non-blocking WiFi connection manager driven from loop().
+  The link is only brought up while it is requested (an upload is due). Each attempt
+  starts the association and returns; Service() polls the radio every LINK_POLL_MS
+  until it connects or LINK_CONNECT_TIMEOUT_MS passes. A failed attempt or a lost
+  link turns the radio off for a backoff window that doubles with each consecutive
+  failure (LINK_BACKOFF_MIN_MS .. LINK_BACKOFF_MAX_MS), with random jitter so nodes
+  that lost the same access point do not retry in step. Sampling never waits on it.
+*********************************************/
+
+#ifndef WiFiLink_h
+#define WiFiLink_h
+
+#include "WiFiRadio.h"
+
+/******** Link States ********/
+#define LINK_IDLE 0
+#define LINK_CONNECTING 1
+#define LINK_UP 2
+#define LINK_BACKOFF 3
+
+/******** Link Timing (ms) ********/
+#define LINK_POLL_MS 250
+#define LINK_CHECK_MS 5000
+#define LINK_CONNECT_TIMEOUT_MS 20000
+#define LINK_BACKOFF_MIN_MS 15000UL
+#define LINK_BACKOFF_MAX_MS 1800000UL
+#define LINK_NEVER 0xFFFFFFFFUL
+
+
+class WiFiLink{
+  public:
+    WiFiLink(WiFiRadio &radio, const char *ssid, const char *pass);
+    void Begin(uint32_t seed);
+    void Request(void);
+    void Release(void);
+    void ClockSkipped(unsigned long ms);
+    void Service(void);
+    bool Connected(void);
+    bool RadioOn(void);
+    uint8_t State(void);
+    unsigned long MillisUntilNextStep(void);
+    unsigned long BackoffMillis(uint8_t failures);
+    uint32_t Attempts(void);
+    uint32_t Failures(void);
+    uint32_t Connects(void);
+
+  private:
+    unsigned long Now(void);
+    void StartAttempt(unsigned long now);
+    void Fail(unsigned long now);
+    uint32_t Random(void);
+    WiFiRadio *_radio;
+    const char *_ssid;
+    const char *_pass;
+    uint8_t _state;
+    bool _wanted;
+    uint8_t _consecutive;
+    unsigned long _nextStep;
+    unsigned long _deadline;
+    unsigned long _skipped;
+    uint32_t _seed;
+    uint32_t _attempts;
+    uint32_t _failures;
+    uint32_t _connects;
+};
+
+#endif
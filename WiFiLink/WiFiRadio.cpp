@@ -0,0 +1,132 @@
+/********************************************
+  WiFiRadio.cc - NINA-W102 radio control (Arduino) and the host access point stand-in.
+*********************************************/
+
+#include "WiFiRadio.h"
+
+#ifdef ARDUINO
+
+#include <WiFiNINA.h>
+#include <utility/wifi_drv.h>
+
+/************************************
+Begin() - Powers the module up and hands it the credentials; the module associates on its own.
+WiFi.status() resets the module after WiFi.end() (about 750 ms, inside WiFiNINA); the rest returns
+immediately, unlike WiFi.begin(), which polls for up to 10 s.
+Inputs: ssid, pass -> WPA/WPA2 network
+return: RADIO_CONNECTING, RADIO_FAILED or RADIO_NO_MODULE
+*************************************/
+uint8_t NinaRadio::Begin(const char *ssid, const char *pass){
+
+  if(WiFi.status() == WL_NO_MODULE){ return RADIO_NO_MODULE; }
+
+  if(WiFiDrv::wifiSetPassphrase(ssid, strlen(ssid), pass, strlen(pass)) == WL_FAILURE){ return RADIO_FAILED; }
+
+  return RADIO_CONNECTING;
+}
+
+/************************************
+Status() - One status query over SPI.
+return: RADIO_CONNECTED, RADIO_CONNECTING (still associating) or RADIO_FAILED
+*************************************/
+uint8_t NinaRadio::Status(void){
+
+  uint8_t status = WiFiDrv::getConnectionStatus();
+
+  if(status == WL_CONNECTED){ return RADIO_CONNECTED; }
+  if(status == WL_NO_MODULE){ return RADIO_NO_MODULE; }
+  if(status == WL_IDLE_STATUS || status == WL_NO_SSID_AVAIL || status == WL_SCAN_COMPLETED){ return RADIO_CONNECTING; }
+
+  return RADIO_FAILED;
+}
+
+/************************************
+End() - Disconnects and powers the module down.
+*************************************/
+void NinaRadio::End(void){
+
+  WiFi.end();
+
+  return;
+}
+
+#else
+
+//SimRadio.SimRadio -> Radio off, module present, access point up.
+SimRadio::SimRadio(void){
+  ModulePresent = true;
+  AssociateMillis = SIM_RADIO_ASSOCIATE_MS;
+  Begins = 0;
+  StatusPolls = 0;
+  _on = false;
+  _apUp = true;
+  _associated = false;
+  _begin = 0;
+  _onSince = 0;
+  _onMicros = 0;
+}
+
+/************************************
+Begin() - Powers the radio up and starts associating; it connects AssociateMillis later if the
+access point is up by then.
+*************************************/
+uint8_t SimRadio::Begin(const char *ssid, const char *pass){
+
+  (void)ssid;
+  (void)pass;
+
+  if(!ModulePresent){ return RADIO_NO_MODULE; }
+
+  Begins++;
+  if(!_on){ _onSince = HostMicros64(); }
+  _on = true;
+  _associated = false;
+  _begin = millis();
+
+  return RADIO_CONNECTING;
+}
+
+/************************************
+Status() - Connected once associated while the access point stays up; a lost access point drops the link.
+*************************************/
+uint8_t SimRadio::Status(void){
+
+  StatusPolls++;
+
+  if(!ModulePresent){ return RADIO_NO_MODULE; }
+  if(!_on){ return RADIO_OFF; }
+
+  if(_associated){
+    if(_apUp){ return RADIO_CONNECTED; }
+    _associated = false;
+    return RADIO_FAILED;
+  }
+
+  if(_apUp && (millis() - _begin) >= AssociateMillis){
+    _associated = true;
+    return RADIO_CONNECTED;
+  }
+
+  return RADIO_CONNECTING;
+}
+
+void SimRadio::End(void){
+
+  if(_on){ _onMicros += HostMicros64() - _onSince; }
+  _on = false;
+  _associated = false;
+
+  return;
+}
+
+void SimRadio::SetAccessPoint(bool up){ _apUp = up; }
+
+/************************************
+OnMicros() - Total time the radio has been powered (the NINA draws POWER_RADIO_UA while on).
+*************************************/
+uint64_t SimRadio::OnMicros(void){
+
+  return _onMicros + (_on ? HostMicros64() - _onSince : 0);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/********************************************
+  WiFiRadio.h - Non-blocking control of the WiFi radio used by WiFiLink.
+  Begin() only starts the association and returns; Status() is polled for the
+  result. On the Arduino, NinaRadio drives the NINA-W102 through WiFiNINA's driver
+  layer (WiFi.begin() itself waits up to 10 s per attempt); on a Linux host,
+  SimRadio emulates an access point that can be taken down and brought back.
+*********************************************/
+
+#ifndef WiFiRadio_h
+#define WiFiRadio_h
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "HostPlatform.h"
+#endif
+
+/******** Radio States ********/
+#define RADIO_OFF 0
+#define RADIO_CONNECTING 1
+#define RADIO_CONNECTED 2
+#define RADIO_FAILED 3
+#define RADIO_NO_MODULE 4
+
+/******** Simulated Access Point (host) ********/
+#define SIM_RADIO_ASSOCIATE_MS 3000
+
+
+class WiFiRadio{
+  public:
+    virtual ~WiFiRadio(void){}
+    virtual uint8_t Begin(const char *ssid, const char *pass) = 0;
+    virtual uint8_t Status(void) = 0;
+    virtual void End(void) = 0;
+};
+
+
+#ifdef ARDUINO
+
+class NinaRadio : public WiFiRadio{
+  public:
+    uint8_t Begin(const char *ssid, const char *pass);
+    uint8_t Status(void);
+    void End(void);
+};
+
+#else
+
+class SimRadio : public WiFiRadio{
+  public:
+    SimRadio(void);
+    uint8_t Begin(const char *ssid, const char *pass);
+    uint8_t Status(void);
+    void End(void);
+    void SetAccessPoint(bool up);
+    uint64_t OnMicros(void);
+    bool ModulePresent;
+    unsigned long AssociateMillis;
+    uint32_t Begins;
+    uint32_t StatusPolls;
+
+  private:
+    bool _on;
+    bool _apUp;
+    bool _associated;
+    unsigned long _begin;
+    uint64_t _onSince;
+    uint64_t _onMicros;
+};
+
+#endif
+
+#endif